@@ -0,0 +1,72 @@
+// arithmetic is evaluated as a compiled program where it can be, and must give what the
+// expression tree gives, including the types of intermediate results
+
+var t = db.getSiblingDB( "aggdb" ).arith;
+t.drop();
+
+t.insert({ _id: 1, i: 3, j: 4, l: NumberLong( 5 ), d: 2.5, z: 0, n: null, big: 100000,
+           s: "str", dt: new Date( 1000 ) });
+assert.eq( null, t.getDB().getLastError() );
+
+function project( spec ) {
+    var res = t.aggregate( { $project: spec } );
+    assert.commandWorked( res );
+    return res.result[ 0 ];
+}
+
+var r = project({ _id: 0,
+                  addInt: { $add: [ "$i", "$j" ] },
+                  addLong: { $add: [ "$i", "$l" ] },
+                  addDouble: { $add: [ "$i", "$d" ] },
+                  addNull: { $add: [ "$i", "$n", "$missing" ] },
+                  nested: { $multiply: [ { $add: [ "$i", "$d" ] }, "$j" ] },
+                  subLong: { $subtract: [ "$l", "$i" ] },
+                  subNull: { $subtract: [ "$n", "$i" ] },
+                  div: { $divide: [ "$j", "$i" ] },
+                  divZero: { $add: [ { $divide: [ "$i", "$z" ] }, 1 ] },
+                  modLong: { $mod: [ "$l", "$i" ] },
+                  modDouble: { $mod: [ "$d", "$i" ] },
+                  modZero: { $add: [ { $mod: [ "$i", "$z" ] }, 2 ] },
+                  // the int product overflows, and is narrowed before it is widened again
+                  narrowed: { $add: [ { $multiply: [ "$big", "$big" ] }, NumberLong( 0 ) ] },
+                  withCond: { $multiply: [ { $cond: [ { $gt: [ "$i", 1 ] }, "$d", "$i" ] }, 2 ] } });
+
+assert.eq( 7, r.addInt );
+assert.eq( NumberLong( 8 ), r.addLong );
+assert.eq( 5.5, r.addDouble );
+assert.eq( 3, r.addNull );
+assert.eq( 22, r.nested );
+assert.eq( NumberLong( 2 ), r.subLong );
+assert.eq( -3, r.subNull );
+assert.eq( 4 / 3, r.div );
+assert.eq( 1, r.divZero );
+assert.eq( NumberLong( 2 ), r.modLong );
+assert.eq( 2, r.modDouble );
+assert.eq( 2, r.modZero );
+assert.eq( NumberLong( 1410065408 ), r.narrowed );
+assert.eq( 5, r.withCond );
+
+// strings and dates aren't numbers, and are left to the tree
+r = project({ _id: 0,
+              concat: { $add: [ "$s", "$i" ] },
+              date: { $add: [ "$dt", 1 ] },
+              dateDiff: { $subtract: [ "$dt", { $multiply: [ "$z", 2 ] } ] } });
+assert.eq( "str3", r.concat );
+assert.eq( new Date( 1000 + 24 * 60 * 60 * 1000 ), r.date );
+assert.eq( new Date( 1000 ), r.dateDiff );
+
+assert.commandFailed( t.aggregate( { $project: { x: { $add: [ "$dt", "$dt" ] } } } ) );
+
+// and in $group
+for ( var k = 0; k < 100; k++ )
+    t.insert({ _id: 100 + k, g: k % 3, v: k, w: 0.5 });
+var groups = t.aggregate( { $match: { g: { $exists: true } } },
+                          { $group: { _id: { $mod: [ "$g", 2 ] },
+                                      total: { $sum: { $add: [ { $multiply: [ "$v", 2 ] }, "$w" ] } } } },
+                          { $sort: { _id: 1 } } ).result;
+var expected = [ { _id: 0, total: 0 }, { _id: 1, total: 0 } ];
+for ( var k = 0; k < 100; k++ )
+    expected[ ( k % 3 ) % 2 ].total += k * 2 + 0.5;
+assert.eq( expected, groups );
+
+t.drop();
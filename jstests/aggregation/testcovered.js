@@ -0,0 +1,85 @@
+// A pipeline whose fields are all in the index its $match uses reads the index keys and not the
+// documents; the results must be what reading the documents gives
+
+var t = db.getSiblingDB( "aggdb" ).covered;
+t.drop();
+
+t.ensureIndex({ a: 1, b: 1 });
+for ( var i = 0; i < 1000; i++ ) {
+    t.insert({ _id: i, a: i % 10, b: i % 7, c: i });
+}
+assert.eq( null, t.getDB().getLastError() );
+
+function agg( pipeline ) {
+    var res = t.getDB().runCommand({ aggregate: t.getName(), pipeline: pipeline });
+    assert.commandWorked( res );
+    return res.result;
+}
+
+function indexOnly( pipeline ) {
+    var res = t.getDB().runCommand({ aggregate: t.getName(), pipeline: pipeline, explain: true });
+    assert.commandWorked( res );
+    return res.serverPipeline[ 0 ].cursor.indexOnly;
+}
+
+// sums of b and c over the documents with a >= 5, by a
+function expected() {
+    var sums = {};
+    t.find().toArray().forEach( function( d ) {
+        if ( d.a < 5 )
+            return;
+        if ( !sums[ d.a ] )
+            sums[ d.a ] = { _id: d.a, b: 0, c: 0, n: 0 };
+        sums[ d.a ].b += d.b;
+        sums[ d.a ].c += d.c;
+        sums[ d.a ].n++;
+    } );
+    var res = [];
+    for ( var a = 5; a < 10; a++ )
+        res.push( sums[ a ] );
+    return res;
+}
+var sums = expected();
+
+// a projection of the index fields
+var project = [ { $match: { a: { $gte: 5 } } }, { $project: { _id: 0, a: 1, b: 1 } } ];
+assert( indexOnly( project ) );
+var projected = agg( project );
+assert.eq( 500, projected.length );
+projected.forEach( function( d ) { assert.eq( [ "a", "b" ], Object.keySet( d ) ); } );
+
+// a $group on the index fields
+var group = [ { $match: { a: { $gte: 5 } } },
+              { $group: { _id: "$a", b: { $sum: "$b" }, n: { $sum: 1 } } },
+              { $sort: { _id: 1 } } ];
+assert( indexOnly( group ) );
+var grouped = agg( group );
+assert.eq( 5, grouped.length );
+for ( var j = 0; j < 5; j++ ) {
+    assert.eq( sums[ j ]._id, grouped[ j ]._id );
+    assert.eq( sums[ j ].b, grouped[ j ].b );
+    assert.eq( sums[ j ].n, grouped[ j ].n );
+}
+
+// a count needs no fields at all
+var count = [ { $match: { a: { $gte: 5 } } }, { $group: { _id: null, n: { $sum: 1 } } } ];
+assert( indexOnly( count ) );
+assert.eq( 500, agg( count )[ 0 ].n );
+
+// c isn't in the index, so the documents are read
+var notCovered = [ { $match: { a: { $gte: 5 } } },
+                   { $group: { _id: "$a", c: { $sum: "$c" } } },
+                   { $sort: { _id: 1 } } ];
+assert( !indexOnly( notCovered ) );
+var cs = agg( notCovered );
+for ( var j = 0; j < 5; j++ )
+    assert.eq( sums[ j ].c, cs[ j ].c );
+
+// nor are they when the pipeline ends on a stage that needs the whole document
+assert( !indexOnly( [ { $match: { a: { $gte: 5 } } }, { $limit: 5 } ] ) );
+
+// a missing field is missing, not null as its index key is
+t.insert({ _id: "nob", a: 20 });
+t.insert({ _id: "nullb", a: 21, b: null });
+assert.eq( [ {} ], agg( [ { $match: { a: 20 } }, { $project: { _id: 0, b: 1 } } ] ) );
+assert.eq( [ { b: null } ], agg( [ { $match: { a: 21 } }, { $project: { _id: 0, b: 1 } } ] ) );
@@ -0,0 +1,54 @@
+// with allowDiskUse, $sort and $group spill to disk past aggregationSpillBytes and
+// produce what they would have in memory
+
+var t = db.getSiblingDB( "aggdb" ).diskuse;
+t.drop();
+
+for ( var i = 0; i < 5000; i++ ) {
+    t.insert({ _id: i, k: ( i * 7919 ) % 5000, g: i % 37, v: i % 11, s: "x" + ( i % 13 ),
+               pad: "padding to make the documents take some room" });
+}
+t.insert({ _id: -1, g: 3 }); // no k or v
+assert.eq( null, t.getDB().getLastError() );
+
+var was = db.adminCommand({ setParameter: 1, aggregationSpillBytes: 16 * 1024 }).was;
+assert( was, "setParameter failed" );
+
+function agg( pipeline, allowDiskUse ) {
+    var cmd = { aggregate: t.getName(), pipeline: pipeline };
+    if ( allowDiskUse )
+        cmd.allowDiskUse = true;
+    var res = t.getDB().runCommand( cmd );
+    assert.commandWorked( res );
+    return res.result;
+}
+
+// $sort, including a missing key, descending and a key with ties
+var sorts = [ [ { $sort: { k: 1 } } ],
+              [ { $sort: { k: -1 } } ],
+              [ { $sort: { v: 1, k: -1 } } ] ];
+sorts.forEach( function( p ) {
+    assert.eq( agg( p, false ), agg( p, true ), tojson( p ) );
+});
+
+// groups over many spills
+var group = { $group: { _id: "$g", n: { $sum: 1 }, total: { $sum: "$v" }, avg: { $avg: "$v" },
+                        lo: { $min: "$k" }, hi: { $max: "$k" }, first: { $first: "$k" },
+                        last: { $last: "$k" }, all: { $push: "$k" }, s: { $addToSet: "$s" } } };
+function sortSets( docs ) {
+    docs.forEach( function( d ) { d.s.sort(); } );
+    return docs;
+}
+var p = [ group, { $sort: { _id: 1 } } ];
+var inMemory = sortSets( agg( p, false ) );
+assert.eq( 37, inMemory.length );
+assert.eq( inMemory, sortSets( agg( p, true ) ) );
+
+// a group that fits stays in memory
+assert.eq( agg( [ { $group: { _id: null, n: { $sum: 1 } } } ], true ), [ { _id: null, n: 5001 } ] );
+
+// without the option, the limit doesn't apply
+assert.eq( 5001, agg( [ { $sort: { k: 1 } } ], false ).length );
+
+db.adminCommand({ setParameter: 1, aggregationSpillBytes: was });
+t.drop();
@@ -0,0 +1,64 @@
+// $group keeps its groups in an open addressing table that grows as groups are added; many
+// groups, numerically equal _ids of different types, and the accumulators kept in the table
+// must give what they always have
+
+var t = db.getSiblingDB( "aggdb" ).grouptable;
+t.drop();
+
+var N = 20000;
+for ( var i = 0; i < N; i++ ) {
+    t.insert({ _id: i, k: i % 5000, v: i, l: NumberLong( i ), d: i + 0.5 });
+}
+// 1, 1.0 and NumberLong(1) are the same group
+t.insert({ _id: "a", k: 1.0, v: 1 });
+t.insert({ _id: "b", k: NumberLong( 1 ), v: 1 });
+// a missing key is in the null group
+t.insert({ _id: "c", v: 7 });
+t.insert({ _id: "d", k: null, v: 9 });
+assert.eq( null, t.getDB().getLastError() );
+
+function agg( pipeline ) {
+    var res = t.getDB().runCommand({ aggregate: t.getName(), pipeline: pipeline });
+    assert.commandWorked( res );
+    return res.result;
+}
+
+var groups = agg( [ { $group: { _id: "$k", n: { $sum: 1 }, v: { $sum: "$v" }, l: { $sum: "$l" },
+                                d: { $sum: "$d" }, avg: { $avg: "$v" }, lo: { $min: "$v" },
+                                hi: { $max: "$v" }, first: { $first: "$_id" },
+                                last: { $last: "$_id" }, all: { $push: "$v" } } },
+                    { $sort: { _id: 1 } } ] );
+assert.eq( 5001, groups.length );
+
+assert.eq( { _id: null, n: 2, v: 16, l: 0, d: 0, avg: 8, lo: 7, hi: 9, first: "c", last: "d",
+             all: [ 7, 9 ] }, groups[ 0 ] );
+
+var one = groups[ 2 ];
+assert.eq( 1, one._id );
+assert.eq( 6, one.n );
+assert.eq( 1 + 5001 + 10001 + 15001 + 1 + 1, one.v );
+assert.eq( "number", typeof one.v );
+assert.eq( NumberLong( 1 + 5001 + 10001 + 15001 ), one.l );
+assert.eq( 1.5 + 5001.5 + 10001.5 + 15001.5, one.d );
+assert.eq( 1, one.lo );
+assert.eq( 15001, one.hi );
+assert.eq( 1, one.first );
+assert.eq( "b", one.last );
+assert.eq( [ 1, 5001, 10001, 15001, 1, 1 ], one.all );
+
+for ( var g = 1; g < groups.length; g++ ) {
+    var k = groups[ g ]._id;
+    assert.eq( k, groups[ g ].first, tojson( groups[ g ] ) );
+    assert.eq( k + 15000, groups[ g ].hi, tojson( groups[ g ] ) );
+    if ( k != 1 ) {
+        assert.eq( 4, groups[ g ].n, tojson( groups[ g ] ) );
+        assert.eq( k + 7500, groups[ g ].avg, tojson( groups[ g ] ) );
+    }
+}
+
+// a group for every document
+var all = agg( [ { $group: { _id: "$_id", n: { $sum: 1 } } } ] );
+assert.eq( N + 4, all.length );
+all.forEach( function( d ) { assert.eq( 1, d.n ); } );
+
+t.drop();
@@ -0,0 +1,59 @@
+// $out writes the results of a pipeline to a collection, replacing what was there
+
+var aggdb = db.getSiblingDB( "aggdb" );
+var t = aggdb.outsrc;
+var out = aggdb.outdst;
+t.drop();
+out.drop();
+
+for ( var i = 0; i < 2000; i++ ) {
+    t.insert({ _id: i, g: i % 10, v: i, pad: new Array( 500 ).join( "x" ) });
+}
+assert.eq( null, aggdb.getLastError() );
+
+function agg( pipeline ) {
+    return aggdb.runCommand({ aggregate: t.getName(), pipeline: pipeline });
+}
+
+// grouped output
+var group = { $group: { _id: "$g", n: { $sum: 1 }, total: { $sum: "$v" } } };
+var res = agg( [ group, { $out: out.getName() } ] );
+assert.commandWorked( res );
+assert.eq( out.getFullName(), res.outputNs );
+assert.eq( 10, res.n );
+assert.eq( agg( [ group, { $sort: { _id: 1 } } ] ).result, out.find().sort( { _id: 1 } ).toArray() );
+
+// the output collection keeps its indexes and loses its old contents
+out.ensureIndex( { n: 1 } );
+out.insert( { _id: "old" } );
+res = agg( [ { $match: { g: 3 } }, { $project: { v: 1 } }, { $out: out.getName() } ] );
+assert.commandWorked( res );
+assert.eq( 200, out.count() );
+assert.eq( 0, out.count( { _id: "old" } ) );
+assert.eq( 200, out.count( { v: { $mod: [ 10, 3 ] } } ) );
+assert.eq( 2, out.getIndexes().length );
+
+// larger than a single batch
+res = agg( [ { $out: out.getName() } ] );
+assert.commandWorked( res );
+assert.eq( 2000, res.n );
+assert.eq( t.find().sort( { _id: 1 } ).toArray(), out.find().sort( { _id: 1 } ).toArray() );
+
+// no temporary collections are left behind
+assert.eq( 0, aggdb.system.namespaces.count( { name: /\.tmp\.agg_out\./ } ) );
+
+// errors
+assert.commandFailed( agg( [ { $out: out.getName() }, { $match: { g: 1 } } ] ), "not last" );
+assert.commandFailed( agg( [ { $out: 1 } ] ), "not a string" );
+assert.commandFailed( agg( [ { $out: "" } ] ), "empty" );
+assert.commandFailed( agg( [ { $out: "system.foo" } ] ), "system" );
+assert.commandFailed( agg( [ { $out: "a$b" } ] ), "$" );
+assert.commandFailed( aggdb.runCommand({ aggregate: t.getName(), pipeline: [ { $out: out.getName() } ],
+                                         cursor: {} }), "with a cursor" );
+
+// a failed run leaves the old output alone
+assert.commandFailed( agg( [ { $project: { x: { $add: [ "$pad", 1 ] } } }, { $out: out.getName() } ] ) );
+assert.eq( 2000, out.count() );
+
+t.drop();
+out.drop();
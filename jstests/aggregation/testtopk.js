@@ -0,0 +1,53 @@
+// a $sort followed by a $limit keeps only the first documents while sorting; the
+// results must be what sorting everything would give
+
+var t = db.getSiblingDB( "aggdb" ).topk;
+t.drop();
+
+for ( var i = 0; i < 3000; i++ ) {
+    t.insert({ _id: i, k: ( i * 7919 ) % 3000, g: i % 7 });
+}
+t.insert({ _id: -1, g: 3 }); // no k, sorts first
+assert.eq( null, t.getDB().getLastError() );
+
+function agg( pipeline, allowDiskUse ) {
+    var cmd = { aggregate: t.getName(), pipeline: pipeline };
+    if ( allowDiskUse )
+        cmd.allowDiskUse = true;
+    var res = t.getDB().runCommand( cmd );
+    assert.commandWorked( res );
+    return res.result;
+}
+
+function check( sort, n ) {
+    var expected = t.find().sort( sort ).limit( n ).toArray();
+    var p = [ { $sort: sort }, { $limit: n } ];
+    assert.eq( expected, agg( p, false ), tojson( p ) );
+    assert.eq( expected, agg( p, true ), tojson( p ) + " allowDiskUse" );
+}
+
+check( { k: 1 }, 1 );
+check( { k: 1 }, 10 );
+check( { k: -1 }, 100 );
+check( { g: 1, k: -1 }, 50 );
+check( { k: 1 }, 5000 ); // more than there are
+
+// adjacent limits reduce to the smaller
+assert.eq( t.find().sort( { k: -1 } ).limit( 5 ).toArray(),
+           agg( [ { $sort: { k: -1 } }, { $limit: 20 }, { $limit: 5 } ] ) );
+assert.eq( t.find().sort( { k: -1 } ).limit( 5 ).toArray(),
+           agg( [ { $sort: { k: -1 } }, { $limit: 5 }, { $limit: 20 } ] ) );
+
+// a $match after the $sort is moved ahead of it
+assert.eq( t.find( { g: 2 } ).sort( { k: 1 } ).limit( 10 ).toArray(),
+           agg( [ { $sort: { k: 1 } }, { $match: { g: 2 } }, { $limit: 10 } ] ) );
+
+// the limit applies after a $skip in between
+assert.eq( t.find().sort( { k: 1 } ).skip( 3 ).limit( 10 ).toArray(),
+           agg( [ { $sort: { k: 1 } }, { $skip: 3 }, { $limit: 10 } ] ) );
+
+// after a $group
+var groups = agg( [ { $group: { _id: "$g", n: { $sum: 1 } } }, { $sort: { _id: -1 } }, { $limit: 3 } ] );
+assert.eq( [ 6, 5, 4 ], groups.map( function( d ) { return d._id; } ) );
+
+t.drop();
@@ -0,0 +1,44 @@
+// Servers started with --networkCompression compress the messages between them, and fall back to
+// plain messages with servers that aren't.
+
+var baseName = "jstests_clonecompressed";
+
+ports = allocatePorts( 3 );
+
+f = startMongod( "--port", ports[ 0 ], "--dbpath", "/data/db/" + baseName + "_from", "--nohttpinterface", "--bind_ip", "127.0.0.1", "--networkCompression" ).getDB( baseName );
+t = startMongod( "--port", ports[ 1 ], "--dbpath", "/data/db/" + baseName + "_to", "--nohttpinterface", "--bind_ip", "127.0.0.1", "--networkCompression" ).getDB( baseName );
+p = startMongod( "--port", ports[ 2 ], "--dbpath", "/data/db/" + baseName + "_plain", "--nohttpinterface", "--bind_ip", "127.0.0.1" ).getDB( baseName );
+
+function compression( db ) {
+    return db.serverStatus().network.compression;
+}
+
+big = new Array( 200 ).toString();
+for( i = 0; i < 1000; ++i ) {
+    f.a.save( { i:i, s:big } );
+}
+assert.eq( 1000, f.a.count() );
+
+// The replies from the source are compressed and decompressed by the target.
+assert.commandWorked( t.cloneCollection( "localhost:" + ports[ 0 ], "a" ) );
+assert.eq( 1000, t.a.count() );
+assert.eq( big, t.a.findOne( { i:500 } ).s );
+assert.lt( 0, compression( f ).messagesCompressed );
+assert.lt( compression( f ).bytesAfterCompression, compression( f ).bytesBeforeCompression );
+assert.lt( 0, compression( t ).messagesDecompressed );
+
+// A server without the option gets plain messages.
+before = compression( f ).messagesCompressed;
+assert.commandWorked( p.cloneCollection( "localhost:" + ports[ 0 ], "a" ) );
+assert.eq( 1000, p.a.count() );
+assert.eq( before, compression( f ).messagesCompressed );
+assert.eq( 0, compression( p ).messagesDecompressed );
+
+// And doesn't ask for compression from a server with the option.
+t.b.drop();
+for( i = 0; i < 100; ++i ) {
+    p.b.save( { i:i, s:big } );
+}
+assert.commandWorked( t.cloneCollection( "localhost:" + ports[ 2 ], "b" ) );
+assert.eq( 100, t.b.count() );
+assert.eq( 0, compression( p ).messagesCompressed );
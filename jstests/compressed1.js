@@ -0,0 +1,71 @@
+// collections created with { compressed: true } store documents snappy compressed
+
+var t = db.compressed1;
+var plain = db.compressed1_plain;
+t.drop();
+plain.drop();
+
+assert.commandWorked( db.createCollection( t.getName(), { compressed: true } ) );
+db.createCollection( plain.getName() );
+assert( t.stats().userFlags & 2, tojson( t.stats() ) );
+
+var filler = new Array( 50 ).join( "the quick brown fox jumps over the lazy dog " );
+function doc( i ) {
+    return { _id: i, a: i % 10, s: filler, tags: [ "x" + i, "y" ] };
+}
+
+t.ensureIndex({ a: 1 });
+for ( var i = 0; i < 500; i++ ) {
+    t.insert( doc( i ) );
+    plain.insert( doc( i ) );
+}
+t.insert({ small: 1 }); // too small to be worth compressing, stored plain
+assert.eq( null, db.getLastError() );
+
+assert.lt( t.stats().size * 3, plain.stats().size, "not compressed" );
+
+// reads see the documents as written, by table scan and by index
+assert.eq( 501, t.find().itcount() );
+assert.eq( 50, t.find({ a: 3 }).itcount() );
+assert.eq( doc( 42 ), t.findOne({ _id: 42 }) );
+assert.eq( 1, t.findOne({ small: 1 }).small );
+assert( t.findOne({ small: 1 })._id, "_id not added" );
+
+// modifiers rewrite rather than update a compressed record in place
+t.update({ _id: 7 }, { $inc: { a: 100 } });
+t.update({ a: 5 }, { $set: { b: 1 } }, false, true);
+t.update({ _id: 8 }, { $push: { tags: filler } });
+assert.eq( null, db.getLastError() );
+assert.eq( 107, t.findOne({ _id: 7 }).a );
+assert.eq( 1, t.find({ a: 107 }).itcount() );
+assert.eq( 50, t.find({ b: 1 }).itcount() );
+assert.eq( 3, t.findOne({ _id: 8 }).tags.length );
+
+// a replacement that no longer compresses well
+t.update({ _id: 9 }, { _id: 9, a: 9, r: Math.random() });
+assert.eq( 9, t.findOne({ _id: 9 }).a );
+
+t.remove({ a: 0 });
+assert.eq( 451, t.count() );
+
+// turning compression off leaves a mix of compressed and plain records
+var res = db.runCommand({ collMod: t.getName(), compressed: false });
+assert.commandWorked( res );
+assert( res.compressed_old );
+for ( var i = 1000; i < 1100; i++ ) {
+    t.insert( doc( i ) );
+}
+assert.eq( 551, t.find().itcount() );
+assert.eq( doc( 1050 ), t.findOne({ _id: 1050 }) );
+assert.eq( doc( 42 ), t.findOne({ _id: 42 }) );
+assert( t.validate( true ).valid );
+
+// capped collections can't be compressed
+db.compressed1_capped.drop();
+assert.commandFailed( db.createCollection( "compressed1_capped", { capped: true, size: 100000, compressed: true } ) );
+db.createCollection( "compressed1_capped", { capped: true, size: 100000 } );
+assert.commandFailed( db.runCommand({ collMod: "compressed1_capped", compressed: true }) );
+db.compressed1_capped.drop();
+
+t.drop();
+plain.drop();
@@ -34,15 +34,18 @@ assert.eq( 1000 , x.stats.nscannedObjects , "AC3" )
 
 t.ensureIndex( { a : 1 } )
 
+// the index is led by the key, so only one entry per value is scanned
 x = d( "a" );
-assert.eq( 1000 , x.stats.n , "BA1" )
-assert.eq( 1000 , x.stats.nscanned , "BA2" )
+assert.eq( 10 , x.stats.n , "BA1" )
+assert.eq( 10 , x.stats.nscanned , "BA2" )
 assert.eq( 0 , x.stats.nscannedObjects , "BA3" )
+assert.eq( [ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 ] , x.values.sort() , "BA4" )
 
 x = d( "a" , { a : { $gt : 5 } } );
-assert.eq( 398 , x.stats.n , "BB1" )
-assert.eq( 398 , x.stats.nscanned , "BB2" )
+assert.eq( 4 , x.stats.n , "BB1" )
+assert.eq( 4 , x.stats.nscanned , "BB2" )
 assert.eq( 0 , x.stats.nscannedObjects , "BB3" )
+assert.eq( [ 6, 7, 8, 9 ] , x.values.sort() , "BB4" )
 
 x = d( "b" , { a : { $gt : 5 } } );
 assert.eq( 398 , x.stats.n , "BC1" )
@@ -58,3 +61,14 @@ assert.eq( 171 , x.stats.n )
 assert.eq( 275 , x.stats.nscanned )
 // Disable temporarily - exact value doesn't matter.
 // assert.eq( 266 , x.stats.nscannedObjects )
+
+// the key led index isn't forced on a query with fields outside it, as another index may bound
+// the query more tightly
+t.dropIndexes();
+t.ensureIndex( { a : 1 } );
+t.ensureIndex( { b : 1 } );
+x = d( "a" , { a : { $gt : 5 } , b : 3 } );
+assert.eq( "QueryOptimizerCursor", x.stats.cursor );
+assert.eq( t.find( { a : { $gt : 5 } , b : 3 } ).count() , x.stats.n );
+x = d( "a" , { a : { $gt : 5 } } );
+assert.eq( 4 , x.stats.nscanned );
@@ -0,0 +1,30 @@
+// distinct with a query reads the index keys and not the documents when the index covers both the
+// query and the key, whether the plan is raced or taken from the plan cache.
+
+t = db.jstests_distinct_index3;
+t.drop();
+
+t.ensureIndex( { a:1, b:1 } );
+for( i = 0; i < 1000; ++i ) {
+    t.save( { a:i % 10, b:i % 20, c:i } );
+}
+
+function check( query, key, expected, coveredObjects ) {
+    res = db.runCommand( { distinct:t.getName(), key:key, query:query } );
+    assert.commandWorked( res );
+    assert.eq( expected, res.values.sort( function( x, y ) { return x - y; } ) );
+    if ( coveredObjects != null ) {
+        assert.eq( coveredObjects, res.stats.nscannedObjects, tojson( res.stats ) );
+    }
+}
+
+// The first run races the index plan against a table scan and records it.
+check( { a:{ $gt:5 }, b:{ $gt:5 } }, "b", [ 6, 7, 8, 9, 16, 17, 18, 19 ] );
+// The cached plan is then used, reading only index keys.
+check( { a:{ $gt:5 }, b:{ $gt:5 } }, "b", [ 6, 7, 8, 9, 16, 17, 18, 19 ], 0 );
+check( { a:{ $gt:5 }, b:{ $gt:5 } }, "a", [ 6, 7, 8, 9 ], 0 );
+
+// A field outside the index must be read from the documents.
+res = db.runCommand( { distinct:t.getName(), key:"c", query:{ a:9, b:19 } } );
+assert.eq( 50, res.values.length );
+assert.lt( 0, res.stats.nscannedObjects );
@@ -0,0 +1,36 @@
+/* getlasterror j:true asks the commit thread to commit right away rather than waiting
+   out journalCommitInterval
+*/
+
+var path = "/data/db/jrequest";
+var conn = startMongodEmpty("--port", 30001, "--dbpath", path, "--dur", "--journalCommitInterval", 300);
+var d = conn.getDB("test");
+
+var n = 50;
+for ( var i = 0; i < n; i++ ) {
+    d.foo.insert({ _id: i, x: "abc" });
+    var e = d.runCommand({ getlasterror: 1, j: true });
+    assert( e.ok && e.err == null, tojson( e ) );
+}
+
+// stats are for the last complete interval (3 seconds), so keep asking for commits until one is
+// covered entirely.  waiting out the interval would allow at most 3000 / 300 commits in it.
+var start = new Date();
+while ( new Date() - start < 7000 ) {
+    d.foo.insert({ _id: n++, x: "abc" });
+    d.runCommand({ getlasterror: 1, j: true });
+}
+var dur = d.serverStatus().dur;
+printjson( dur );
+assert.gt( dur.requestedCommits, 3000 / 300, "j:true waited for the commit interval" );
+assert.lte( dur.requestedCommits, dur.commits );
+assert( dur.timeMs.compress != null, "no compress time" );
+assert( dur.timeMs.dataFileWriterWait != null, "no dataFileWriterWait time" );
+
+// everything acknowledged is in the journal
+stopMongod(30001, /*signal*/9);
+conn = startMongodNoReset("--port", 30002, "--dbpath", path, "--dur");
+assert.eq( n, conn.getDB("test").foo.count() );
+stopMongod(30002);
+
+print( "jrequest.js SUCCESS" );
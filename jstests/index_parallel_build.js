@@ -0,0 +1,40 @@
+// foreground builds over enough documents extract and sort keys on several threads
+
+var t = db.index_parallel_build;
+t.drop();
+
+var N = 30000;
+for ( var i = 0; i < N; i++ ) {
+    t.insert({ _id: i, a: ( i * 7919 ) % 5000, b: [ i % 3, 3 + i % 5 ], c: i, d: [ 1, 2 ] });
+}
+assert.eq( null, db.getLastError() );
+
+t.ensureIndex({ a: 1 });
+assert.eq( null, db.getLastError() );
+t.ensureIndex({ b: -1, a: 1 });
+assert.eq( null, db.getLastError() );
+assert( t.validate( true ).valid );
+
+// keys come out of the merge in order, none lost or repeated
+assert.eq( N, t.find().hint({ a: 1 }).itcount() );
+assert.eq( N * 2, t.find().hint({ b: -1, a: 1 }).itcount() );
+assert( t.find({ b: 4 }).hint({ b: -1, a: 1 }).explain().isMultiKey );
+var prev = -1;
+t.find( {}, { _id: 0, a: 1 } ).hint({ a: 1 }).forEach( function( x ) {
+    assert.lte( prev, x.a );
+    prev = x.a;
+});
+assert.eq( N / 5000, t.find({ a: 42 }).hint({ a: 1 }).itcount() );
+
+// a unique build still sees duplicates found by different threads
+t.ensureIndex({ a: 1, x: 1 }, { unique: true });
+assert.eq( 11000, db.getLastErrorObj().code );
+t.ensureIndex({ c: 1 }, { unique: true });
+assert.eq( null, db.getLastError() );
+
+// an error from a key extracting thread fails the build
+t.ensureIndex({ b: 1, d: 1 });
+assert.eq( 10088, db.getLastErrorObj().code );
+assert.eq( 4, t.getIndexes().length );
+
+t.drop();
@@ -0,0 +1,81 @@
+// v:2 indexes store the leading key elements a bucket's keys share only once
+
+var t = db.index_prefix_compressed;
+t.drop();
+
+// short enough for the compact key format, longer strings are kept as bson
+var pad = new Array( 11 ).join( "shared key prefix " );
+function key( i ) {
+    return { a: "/accounts/" + ( i % 4 ) + "/" + pad, b: i % 50, c: "order" + i };
+}
+
+t.ensureIndex({ a: 1, b: 1, c: 1 }, { v: 2 });
+t.ensureIndex({ a: 1, b: 1, c: -1 }, { v: 1, name: "plain" });
+assert.eq( null, db.getLastError() );
+assert.eq( 2, db.system.indexes.findOne({ ns: t.getFullName(), name: "a_1_b_1_c_1" }).v );
+
+// random inserts and deletes, with plenty of duplicates of the leading fields
+Random.setRandomSeed();
+var present = {};
+for ( var i = 0; i < 4000; i++ ) {
+    var x = Random.randInt( 3000 );
+    var k = key( x );
+    k._id = x;
+    t.save( k );
+    present[ x ] = true;
+    if ( i % 3 == 0 ) {
+        var y = Random.randInt( 3000 );
+        t.remove({ _id: y });
+        delete present[ y ];
+    }
+}
+assert.eq( null, db.getLastError() );
+var n = Object.keySet( present ).length;
+assert.eq( n, t.count() );
+
+var v = t.validate( true );
+assert( v.valid, tojson( v ) );
+
+var sizes = t.stats().indexSizes;
+assert.lt( sizes[ "a_1_b_1_c_1" ] * 2, sizes[ "plain" ], tojson( sizes ) );
+
+// the compressed index answers queries like the plain one
+function check() {
+    var hint = { a: 1, b: 1, c: 1 };
+    assert.eq( n, t.find().hint( hint ).itcount() );
+    for ( var r = 0; r < 4; r++ ) {
+        var a = key( r ).a;
+        assert.eq( t.find({ a: a }).hint( "plain" ).itcount(), t.find({ a: a }).hint( hint ).itcount() );
+        assert.eq( t.find({ a: a, b: 7 }).hint( "plain" ).itcount(), t.find({ a: a, b: 7 }).hint( hint ).itcount() );
+    }
+    var all = t.find( {}, { _id: 0, a: 1, b: 1, c: 1 } ).hint( hint ).toArray();
+    for ( var i = 1; i < all.length; i++ ) {
+        var l = all[ i - 1 ], r = all[ i ];
+        assert( l.a < r.a || ( l.a == r.a && ( l.b < r.b || ( l.b == r.b && l.c <= r.c ) ) ), tojson( [ l, r ] ) );
+    }
+}
+check();
+
+// a unique v:2 index still finds duplicates
+t.ensureIndex({ c: 1 }, { v: 2, unique: true });
+assert.eq( null, db.getLastError() );
+t.insert({ _id: 99999, c: t.findOne().c });
+assert.eq( 11000, db.getLastErrorObj().code );
+t.dropIndex({ c: 1 });
+
+// reIndex keeps v:2, and converts on request
+assert.commandWorked( t.reIndex() );
+assert.eq( 2, db.system.indexes.findOne({ ns: t.getFullName(), name: "a_1_b_1_c_1" }).v );
+assert.commandWorked( db.runCommand({ reIndex: t.getName(), v: 2 }) );
+db.system.indexes.find({ ns: t.getFullName() }).forEach( function( ix ) {
+    assert.eq( 2, ix.v, tojson( ix ) );
+});
+assert( t.validate( true ).valid );
+check();
+assert.commandFailed( db.runCommand({ reIndex: t.getName(), v: 3 }) );
+
+assert.commandWorked( db.runCommand({ reIndex: t.getName(), v: 1 }) );
+assert.eq( 1, db.system.indexes.findOne({ ns: t.getFullName(), name: "a_1_b_1_c_1" }).v );
+check();
+
+t.drop();
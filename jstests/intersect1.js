@@ -0,0 +1,57 @@
+// A query with an equality on the fields of two indexes may intersect the documents the two
+// index scans find.
+
+t = db.jstests_intersect1;
+t.drop();
+
+t.ensureIndex( {a:1} );
+t.ensureIndex( {b:1} );
+for( i = 0; i < 1000; ++i ) {
+    t.save( {_id:i, a:i % 10, b:Math.floor( i / 10 ) % 10, c:i % 2} );
+}
+
+function ids( cursor ) {
+    return cursor.toArray().map( function( d ) { return d._id; } ).sort( function( x, y ) {
+        return x - y;
+    } );
+}
+
+// The intersection is raced against the single index plans and wins, scanning fewer keys.
+explain = t.find( {a:1, b:1} ).explain( true );
+assert.eq( 10, explain.n );
+assert( /^IntersectionCursor/.test( explain.cursor ), tojson( explain ) );
+assert.gt( 100, explain.nscanned );
+assert.eq( 10, explain.nscannedObjects );
+assert.eq( 2, explain.indexBounds.length );
+assert( explain.allPlans.some( function( p ) { return p.cursor == "BtreeCursor a_1"; } ) );
+
+assert.eq( [ 11, 111, 211, 311, 411, 511, 611, 711, 811, 911 ], ids( t.find( {a:1, b:1} ) ) );
+// Further predicates are checked against the documents.
+assert.eq( [ 11, 111, 211, 311, 411, 511, 611, 711, 811, 911 ],
+          ids( t.find( {a:1, b:1, c:1} ) ) );
+assert.eq( 0, t.find( {a:1, b:1, c:0} ).itcount() );
+// No document has both keys.
+assert.eq( 0, t.find( {a:1, b:20} ).itcount() );
+
+// The winning plan is cached and used again.
+explain = t.find( {a:2, b:3} ).explain( true );
+assert( /^IntersectionCursor/.test( explain.oldPlan.cursor ), tojson( explain ) );
+assert.eq( [ 32, 132, 232, 332, 432, 532, 632, 732, 832, 932 ], ids( t.find( {a:2, b:3} ) ) );
+
+// Ranges over more than one key aren't intersected.
+explain = t.find( {a:{$gt:8}, b:{$gt:8}} ).explain( true );
+explain.allPlans.forEach( function( p ) { assert( !/^IntersectionCursor/.test( p.cursor ) ); } );
+assert.eq( 10, explain.n );
+
+// Nor are queries with a sort.
+explain = t.find( {a:1, b:1} ).sort( {c:1} ).explain( true );
+explain.allPlans.forEach( function( p ) { assert( !/^IntersectionCursor/.test( p.cursor ) ); } );
+
+// A removed document is no longer found.
+t.remove( {_id:111} );
+assert.eq( [ 11, 211, 311, 411, 511, 611, 711, 811, 911 ], ids( t.find( {a:1, b:1} ) ) );
+
+// Dropping an index drops the cached intersection.
+t.dropIndex( {b:1} );
+assert.eq( [ 11, 211, 311, 411, 511, 611, 711, 811, 911 ], ids( t.find( {a:1, b:1} ) ) );
+assert.eq( "BtreeCursor a_1", t.find( {a:1, b:1} ).explain().cursor );
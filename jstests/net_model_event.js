@@ -0,0 +1,45 @@
+// mongod servicing connections with --netModel event: requests from many connections are
+// run by a small worker pool, and each connection keeps its own lastError
+// (--netModel exists only on linux)
+
+if ( db.hostInfo().os.type == "Linux" ) {
+    var conn = MongoRunner.runMongod({ netModel: 'event', netWorkers: 2 });
+    var testDB = conn.getDB( 'netModelEvent' );
+    var coll = testDB.foo;
+
+    for ( var i = 0; i < 100; i++ ) {
+        coll.insert({ _id: i });
+    }
+    assert.eq( null, testDB.getLastError() );
+    assert.eq( 100, coll.count() );
+
+    // a cursor spanning several getMores
+    assert.eq( 100, coll.find().batchSize( 7 ).itcount() );
+
+    // more connections than workers, interleaved
+    var others = [];
+    for ( var i = 0; i < 8; i++ ) {
+        others.push( new Mongo( conn.host ).getDB( 'netModelEvent' ) );
+    }
+    others.forEach( function( db, i ) {
+        db.foo.insert({ _id: i }); // duplicate key
+    });
+    others.forEach( function( db, i ) {
+        db.foo.insert({ _id: 1000 + i });
+    });
+    others.forEach( function( db, i ) {
+        // the last op on this connection succeeded, regardless of what the others did
+        assert.eq( null, db.getLastError() );
+        db.foo.insert({ _id: i });
+    });
+    others.forEach( function( db, i ) {
+        assert.eq( 11000, db.getLastErrorObj().code );
+    });
+    assert.eq( 108, coll.count() );
+
+    var status = testDB.adminCommand({ serverStatus: 1 });
+    assert( status.ok, tojson( status ) );
+    assert.lte( 9, status.connections.current, tojson( status.connections ) );
+
+    MongoRunner.stopMongod( conn );
+}
@@ -0,0 +1,113 @@
+// The planCache command lists the cached query plans with their use counts, and pins and unpins
+// them.  Pinned plans survive writes; with queryCacheWriteLimit 0 no plans are dropped for writes.
+
+t = db.jstests_plancache;
+t.drop();
+
+t.ensureIndex( { a:1 } );
+t.ensureIndex( { b:1 } );
+for( i = 0; i < 100; ++i ) {
+    t.save( { a:i, b:i % 2, c:i } );
+}
+
+function planCache( extra ) {
+    var cmd = { planCache:t.getName() };
+    for( f in extra ) {
+        cmd[ f ] = extra[ f ];
+    }
+    var res = db.runCommand( cmd );
+    assert.commandWorked( res );
+    return res;
+}
+
+function cachedPlan( queryFields ) {
+    var plans = planCache().plans.filter( function( p ) {
+                                              return friendlyEqual( Object.keySet( p.query ),
+                                                                    queryFields );
+                                          } );
+    return plans.length ? plans[ 0 ] : null;
+}
+
+// The plan raced for { a, b } is recorded, then used.
+t.find( { a:5, b:1 } ).itcount();
+var plan = cachedPlan( [ "a", "b" ] );
+assert.eq( { a:1 }, plan.index );
+assert.eq( 0, plan.hits );
+assert( !plan.pinned );
+t.find( { a:7, b:1 } ).itcount();
+t.find( { a:9, b:1 } ).itcount();
+assert.lte( 2, cachedPlan( [ "a", "b" ] ).hits );
+
+// explain shows the cached plan's counts
+var oldPlan = t.find( { a:5, b:1 } ).explain( true ).oldPlan;
+assert.eq( "BtreeCursor a_1", oldPlan.cursor );
+assert.eq( false, oldPlan.pinned );
+assert.lte( 2, oldPlan.hits );
+
+// Pin the worse index for the pattern; it is used from then on.
+planCache( { pin:{ a:5, b:1 }, index:{ b:1 } } );
+plan = cachedPlan( [ "a", "b" ] );
+assert.eq( { b:1 }, plan.index );
+assert( plan.pinned );
+assert.eq( 1, t.find( { a:5, b:1 } ).itcount() );
+oldPlan = t.find( { a:5, b:1 } ).explain( true ).oldPlan;
+assert.eq( "BtreeCursor b_1", oldPlan.cursor );
+assert( oldPlan.pinned );
+// its nscanned doesn't cause a replan, and racing other plans doesn't replace it
+t.find( { a:9, b:1 } ).itcount();
+assert.eq( { b:1 }, cachedPlan( [ "a", "b" ] ).index );
+assert.eq( 0, cachedPlan( [ "a", "b" ] ).replans );
+
+// An index that doesn't help can't be pinned.
+assert.commandFailed( db.runCommand( { planCache:t.getName(), pin:{ c:1 }, index:{ a:1 } } ) );
+assert.commandFailed( db.runCommand( { planCache:t.getName(), pin:{ a:1 }, index:{ d:1 } } ) );
+
+// After queryCacheWriteLimit writes the unpinned plans are dropped, the pinned ones stay.
+t.find( { a:5 } ).itcount();
+assert( cachedPlan( [ "a" ] ) );
+for( i = 100; i < 200; ++i ) {
+    t.save( { a:i, b:i % 2, c:i } );
+}
+assert( !cachedPlan( [ "a" ] ) );
+assert( cachedPlan( [ "a", "b" ] ).pinned );
+
+// With a limit of 0 writes don't drop plans.
+var was = db.adminCommand( { setParameter:1, queryCacheWriteLimit:0 } ).was;
+assert.eq( 100, was );
+t.find( { a:5 } ).itcount();
+for( i = 200; i < 400; ++i ) {
+    t.save( { a:i, b:i % 2, c:i } );
+}
+assert( cachedPlan( [ "a" ] ) );
+db.adminCommand( { setParameter:1, queryCacheWriteLimit:was } );
+
+// Unpinning drops the plan, so the next query races the plans again.
+planCache( { unpin:{ a:5, b:1 } } );
+assert( !cachedPlan( [ "a", "b" ] ) );
+t.find( { a:5, b:1 } ).itcount();
+assert.eq( { a:1 }, cachedPlan( [ "a", "b" ] ).index );
+
+// A pinned plan that fails isn't unpinned to retry the query with other plans: here the in
+// memory sort of the pinned { a:1 } plan runs out of memory where { b:1 } would sort by index.
+t2 = db.jstests_plancache2;
+t2.drop();
+t2.ensureIndex( { a:1 } );
+t2.ensureIndex( { b:1 } );
+big = new Array( 1000000 ).toString();
+for( i = 0; i < 40; ++i ) {
+    t2.save( { a:i, b:i, s:big } );
+}
+assert.commandWorked( db.runCommand( { planCache:t2.getName(), pin:{ a:{ $gte:0 } },
+                                       sort:{ b:1 }, index:{ a:1 } } ) );
+assert.throws( function() { t2.find( { a:{ $gte:0 } } ).sort( { b:1 } ).itcount(); } );
+assert( db.getLastError().match( /too much data for sort\(\) with no index/ ) );
+var plans = db.runCommand( { planCache:t2.getName() } ).plans;
+assert.eq( 1, plans.length );
+assert.eq( { a:1 }, plans[ 0 ].index );
+assert( plans[ 0 ].pinned );
+t2.drop();
+
+// Clearing drops everything.
+assert.eq( 0, planCache( { clear:true } ).plans.length );
+
+assert.commandFailed( db.runCommand( { planCache:"jstests_plancache_missing" } ) );
@@ -0,0 +1,57 @@
+/* secondaries apply the oplog in batches across a pool of writer threads.
+ *
+ * Write interleaved inserts, updates and removes to several collections in two dbs, plus a
+ * command and an index build mid-stream (those are applied in a batch of their own), then
+ * check the secondary ends up with exactly the primary's data and that minvalid was advanced.
+ */
+
+var replTest = new ReplSetTest({ name: 'multiApply', nodes: 2 });
+var nodes = replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var colls = [];
+["a", "b"].forEach(function(dbname) {
+    for (var i = 0; i < 4; i++) {
+        colls.push(master.getDB(dbname).getCollection("c" + i));
+    }
+});
+
+for (var i = 0; i < 2000; i++) {
+    var c = colls[i % colls.length];
+    c.insert({ _id: i, x: i });
+    if (i % 3 == 0) {
+        c.update({ _id: i }, { $inc: { x: 1 }, $set: { y: i } });
+    }
+    if (i % 7 == 0) {
+        c.remove({ _id: i });
+    }
+    if (i == 1000) {
+        colls[0].ensureIndex({ y: 1 });
+        master.getDB("a").runCommand({ create: "capped", capped: true, size: 10000 });
+    }
+}
+master.getDB("a").getLastError();
+
+replTest.awaitReplication();
+
+var slave = replTest.liveNodes.slaves[0];
+slave.setSlaveOk();
+
+colls.forEach(function(c) {
+    var sc = slave.getDB(c.getDB().getName()).getCollection(c.getName());
+    assert.eq(c.count(), sc.count(), "count differs on " + c.getFullName());
+    c.find().forEach(function(doc) {
+        assert.eq(doc, sc.findOne({ _id: doc._id }), "doc differs on " + c.getFullName());
+    });
+});
+assert.eq(2, slave.getDB("a").system.indexes.find({ ns: "a.c0" }).count(), "index not built");
+assert(slave.getDB("a").capped.isCapped(), "create command not applied");
+
+var minvalid = slave.getDB("local").replset.minvalid.findOne();
+assert(minvalid, "minvalid not set");
+var last = slave.getDB("local").oplog.rs.find().sort({ $natural: -1 }).limit(1).next();
+assert(minvalid.ts.t < last.ts.t || (minvalid.ts.t == last.ts.t && minvalid.ts.i <= last.ts.i),
+       "minvalid past our last op");
+
+replTest.stopSet();
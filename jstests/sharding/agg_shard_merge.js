@@ -0,0 +1,77 @@
+// a sharded $group can be finished on the shards (aggregationShardMerge) - results must not change
+
+s = new ShardingTest( "agg_shard_merge" , 2 , 0 , 1 );
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+db = s.getDB( "test" );
+
+var N = 20000;
+for ( var i = 0; i < N; i++ ) {
+    db.data.insert( { _id : i , g : i % 1000 , v : i % 17 , s : "x" + ( i % 5 ) } );
+}
+// numerically equal keys of different types on both shards are one group
+db.data.insert( { _id : -1 , g : 1.0 , v : 1 , s : "y" } );
+db.data.insert( { _id : N + 1 , g : NumberLong( 1 ) , v : 1 , s : "y" } );
+db.getLastError();
+
+s.adminCommand( { split : "test.data" , middle : { _id : N / 2 } } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : 0 } , to : s.getOther( s.getServer( "test" ) ).name } );
+assert.eq( 1 , s.config.chunks.count( { shard : "shard0000" } ) );
+assert.eq( 1 , s.config.chunks.count( { shard : "shard0001" } ) );
+
+var admin = s.getDB( "admin" );
+function setShardMerge( b ) {
+    var res = admin.runCommand( { setParameter : 1 , aggregationShardMerge : b } );
+    assert.commandWorked( res );
+    return res.was;
+}
+
+function agg( pipeline ) {
+    var res = db.runCommand( { aggregate : "data" , pipeline : pipeline } );
+    assert.commandWorked( res );
+    // which of the equal keys names the group, and the order of arrays, depend on the shards' timing
+    res.result.forEach( function( d ) {
+        if ( d._id instanceof NumberLong ) d._id = d._id.toNumber();
+        if ( d.set ) d.set.sort();
+        if ( d.all ) d.all.sort();
+    } );
+    return res.result;
+}
+
+var group = { $group : { _id : "$g" , n : { $sum : 1 } , total : { $sum : "$v" } , avg : { $avg : "$v" } ,
+                         lo : { $min : "$v" } , hi : { $max : "$v" } , set : { $addToSet : "$s" } } };
+var pipelines = [ [ group , { $sort : { _id : 1 } } ] ,
+                  [ { $match : { v : { $gt : 3 } } } , group , { $match : { n : { $gt : 10 } } } , { $sort : { total : -1 , _id : 1 } } ] ,
+                  [ { $group : { _id : { $mod : [ "$g" , 7 ] } , all : { $push : "$v" } } } , { $sort : { _id : 1 } } ] ,
+                  [ group , { $group : { _id : null , groups : { $sum : 1 } } } ] ];
+
+assert.eq( false , setShardMerge( false ) , "default" );
+var inMongos = pipelines.map( agg );
+assert.eq( 1000 , inMongos[ 0 ].length );
+assert.eq( 22 , inMongos[ 0 ][ 1 ].n );
+
+assert.eq( false , setShardMerge( true ) );
+pipelines.forEach( function( p , i ) {
+    assert.eq( inMongos[ i ] , agg( p ) , tojson( p ) );
+} );
+
+// a shard splits up its partial groups by the hash of their _id, each group in exactly one partition
+var shardDB = s.shard0.getDB( "test" );
+var res = shardDB.runCommand( { aggregate : "data" , pipeline : [ group ] , fromRouter : true , mergePartitions : 3 } );
+assert.commandWorked( res );
+assert.eq( 3 , res.partitions.length );
+var ids = {};
+var nPartial = 0;
+res.partitions.forEach( function( partition ) {
+    partition.forEach( function( d ) {
+        assert( !ids[ tojson( d._id ) ] , "group in two partitions: " + tojson( d._id ) );
+        ids[ tojson( d._id ) ] = true;
+        nPartial++;
+    } );
+} );
+assert.lt( 0 , nPartial );
+assert.commandFailed( shardDB.runCommand( { aggregate : "data" , pipeline : [ group ] , mergePartitions : 0 } ) );
+
+s.stop();
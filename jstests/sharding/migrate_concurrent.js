@@ -0,0 +1,56 @@
+// the balancer runs migrations at once when they involve disjoint shards, chunks of the same collection included
+
+s = new ShardingTest( "migrate_concurrent" , 4 , 0 , 1 , { chunksize : 1 } );
+s.stopBalancer();
+
+var big = new Array( 5000 ).join( "x" );
+var N = 2000;
+
+s.adminCommand( { enablesharding : "conc" } );
+if ( s.getServer( "conc" ).name != "shard0000" )
+    s.adminCommand( { moveprimary : "conc" , to : "shard0000" } );
+s.adminCommand( { shardcollection : "conc.data" , key : { _id : 1 } } );
+
+var coll = s.getDB( "conc" ).data;
+for ( var i = 0; i < N; i++ )
+    coll.insert( { _id : i , big : big } );
+assert.eq( null , coll.getDB().getLastError() );
+
+for ( var i = 50; i < N; i += 50 )
+    s.adminCommand( { split : coll.getFullName() , middle : { _id : i } } );
+
+// two loaded shards, two empty ones
+for ( var i = N / 2; i < N; i += 50 )
+    assert.commandWorked( s.adminCommand( { movechunk : coll.getFullName() , find : { _id : i } , to : "shard0001" } ) );
+assert.eq( 20 , s.config.chunks.count( { ns : coll.getFullName() , shard : "shard0000" } ) );
+assert.eq( 20 , s.config.chunks.count( { ns : coll.getFullName() , shard : "shard0001" } ) );
+
+s.config.settings.update( { _id : "balancer" } , { $set : { maxConcurrentMigrations : 2 } } , true );
+var balanceStart = new Date();
+s.startBalancer();
+
+assert.soon( function() {
+    var x = s.chunkDiff( "data" , "conc" );
+    print( "chunk diff: " + x );
+    return x < 2;
+} , "no balance happened" , 8 * 60 * 1000 , 2000 );
+
+s.stopBalancer();
+
+// the data made it across
+assert.eq( N , coll.find().itcount() );
+assert.eq( N , coll.count() );
+
+// some migration from one donor started while one from the other donor was in progress
+var overlapped = false;
+s.config.changelog.find( { what : "moveChunk.commit" , ns : coll.getFullName() , "details.from" : "shard0000" ,
+                           time : { $gte : balanceStart } } ).forEach( function( commit ) {
+    var start = s.config.changelog.find( { what : "moveChunk.start" , ns : coll.getFullName() ,
+                                           "details.min" : commit.details.min } ).sort( { time : -1 } ).next();
+    if ( s.config.changelog.count( { what : "moveChunk.start" , ns : coll.getFullName() , "details.from" : "shard0001" ,
+                                     time : { $gte : start.time , $lte : commit.time } } ) > 0 )
+        overlapped = true;
+} );
+assert( overlapped , "migrations of the collection ran one at a time" );
+
+s.stop();
@@ -0,0 +1,57 @@
+// a shard that receives a chunk of a collection while it is donating another one of the same
+// collection still owns the received chunk once both moves are done
+
+s = new ShardingTest( "migrate_receive_while_donating" , 3 , 0 , 1 , { chunksize : 200 } );
+s.stopBalancer();
+
+db = s.getDB( "test" );
+s.adminCommand( { enablesharding : "test" } );
+if ( s.getServer( "test" ).name != "shard0000" )
+    s.adminCommand( { moveprimary : "test" , to : "shard0000" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+// a large chunk [ minKey , 0 ) on shard0000, whose transfer takes a while, and a small one
+// [ 0 , maxKey ) on shard0001
+var pad = new Array( 500 ).join( "x" );
+var N = 100000;
+for ( var i = -N; i < 0; i++ )
+    db.data.insert( { _id : i , pad : pad } );
+for ( var i = 0; i < 100; i++ )
+    db.data.insert( { _id : i , pad : pad } );
+assert.eq( null , db.getLastError() );
+
+s.adminCommand( { split : "test.data" , middle : { _id : 0 } } );
+assert.commandWorked( s.adminCommand( { movechunk : "test.data" , find : { _id : 0 } , to : "shard0001" } ) );
+
+// shard0000 donates the large chunk to shard0002...
+var join = startParallelShell(
+    "assert.commandWorked( db.adminCommand( { movechunk : 'test.data' , find : { _id : -1 } , to : 'shard0002' } ) );" );
+
+assert.soon( function() {
+    return s.config.changelog.count( { what : "moveChunk.start" , ns : "test.data" , "details.to" : "shard0002" } ) > 0;
+} , "large chunk move didn't start" , 60 * 1000 , 100 );
+
+// ...and receives the small one meanwhile
+assert.soon( function() {
+    var res = s.adminCommand( { movechunk : "test.data" , find : { _id : 0 } , to : "shard0000" } );
+    printjson( res );
+    return res.ok;
+} , "small chunk move failed" , 60 * 1000 , 500 );
+
+join();
+
+var start = s.config.changelog.findOne( { what : "moveChunk.start" , "details.to" : "shard0002" } );
+var commit = s.config.changelog.findOne( { what : "moveChunk.commit" , "details.to" : "shard0002" } );
+var received = s.config.changelog.findOne( { what : "moveChunk.commit" , "details.to" : "shard0000" } );
+assert( start.time <= received.time && received.time <= commit.time ,
+        "the small chunk wasn't received during the large one's transfer" );
+
+assert.eq( 1 , s.config.chunks.count( { ns : "test.data" , shard : "shard0000" } ) );
+assert.eq( 1 , s.config.chunks.count( { ns : "test.data" , shard : "shard0002" } ) );
+
+// the received documents are still owned, and seen through mongos
+assert.eq( 100 , db.data.find( { _id : { $gte : 0 } } ).itcount() );
+assert.eq( N + 100 , db.data.find().itcount() );
+assert.eq( N + 100 , db.data.count() );
+
+s.stop();
@@ -0,0 +1,64 @@
+// mongos keeps getMores in flight on each shard cursor (shardReadAhead) - results must not change
+
+s = new ShardingTest( "read_ahead" , 2 , 0 , 1 );
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+db = s.getDB( "test" );
+
+// several 4MB getMore batches per shard
+var N = 12000;
+var pad = new Array( 1000 ).join( "x" );
+for ( var i = 0; i < N; i++ ) {
+    db.data.insert( { _id : i , x : ( i * 7 ) % N , pad : pad } );
+}
+db.getLastError();
+
+s.adminCommand( { split : "test.data" , middle : { _id : N / 2 } } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : 0 } , to : s.getOther( s.getServer( "test" ) ).name } );
+assert.eq( 1 , s.config.chunks.count( { shard : "shard0000" } ) );
+assert.eq( 1 , s.config.chunks.count( { shard : "shard0001" } ) );
+
+var admin = s.getDB( "admin" );
+function setReadAhead( n ) {
+    var res = admin.runCommand( { setParameter : 1 , shardReadAhead : n } );
+    assert.commandWorked( res );
+    return res.was;
+}
+
+function check( n ) {
+    setReadAhead( n );
+
+    // merge sorted
+    var last = -1;
+    var count = 0;
+    db.data.find( {} , { pad : 0 } ).sort( { x : 1 } ).forEach( function( z ) {
+        assert.lt( last , z.x , "out of order with shardReadAhead " + n );
+        last = z.x;
+        count++;
+    } );
+    assert.eq( N , count , "sorted count with shardReadAhead " + n );
+
+    // unsorted
+    assert.eq( N , db.data.find().itcount() , "count with shardReadAhead " + n );
+
+    // cursors closed with batches still in flight leave usable connections behind
+    for ( var j = 0; j < 5; j++ ) {
+        var c = db.data.find().sort( { x : -1 } );
+        for ( var k = 0; k < 300; k++ )
+            c.next();
+        c.close();
+    }
+    assert.eq( N , db.data.find( { x : { $gte : 0 } } ).sort( { x : 1 } ).itcount() );
+}
+
+assert.eq( 0 , setReadAhead( 0 ) , "default" );
+check( 0 );
+check( 1 );
+check( 4 );
+
+assert.commandFailed( admin.runCommand( { setParameter : 1 , shardReadAhead : -1 } ) );
+assert.commandFailed( admin.runCommand( { setParameter : 1 , shardReadAhead : 17 } ) );
+
+s.stop();
@@ -0,0 +1,65 @@
+// mongos returns shard connections to the pool after each request (releaseConnectionsAfterResponse)
+// - shard connections must not grow with client connections, and getLastError must still see
+// the client's own writes
+
+s = new ShardingTest( "release_connections" , 2 , 0 , 1 );
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+db = s.getDB( "test" );
+
+var N = 100;
+for ( var i = 0; i < N; i++ ) {
+    db.data.insert( { _id : i } );
+}
+db.getLastError();
+
+s.adminCommand( { split : "test.data" , middle : { _id : N / 2 } } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : 0 } , to : s.getOther( s.getServer( "test" ) ).name } );
+
+var admin = s.getDB( "admin" );
+var res = admin.runCommand( { setParameter : 1 , releaseConnectionsAfterResponse : true } );
+assert.commandWorked( res );
+assert.eq( false , res.was , "default" );
+
+function shardConnections() {
+    return s.shard0.getDB( "admin" ).serverStatus().connections.current +
+           s.shard1.getDB( "admin" ).serverStatus().connections.current;
+}
+
+// many clients each reading from both shards share a few shard connections
+var before = shardConnections();
+var clients = [];
+for ( var i = 0; i < 30; i++ ) {
+    var conn = new Mongo( s.s.host );
+    assert.eq( N , conn.getDB( "test" ).data.find().itcount() );
+    clients.push( conn );
+}
+assert.gt( 10 , shardConnections() - before , "shard connections grew with clients" );
+
+// a client's write error is reported to it, though other clients use the shards in between
+var a = clients[ 0 ].getDB( "test" );
+var b = clients[ 1 ].getDB( "test" );
+a.data.insert( { _id : 1 } );
+b.data.insert( { _id : N + 1 } );
+assert.eq( N + 1 , b.data.find().itcount() );
+assert.eq( 11000 , a.getLastErrorObj().code , "write error lost" );
+assert.isnull( b.getLastError() );
+
+// a client that only read has no error to report
+var c = clients[ 2 ].getDB( "test" );
+assert.eq( N + 1 , c.data.find().itcount() );
+a.data.insert( { _id : 2 } );
+assert.isnull( c.getLastError() );
+assert.eq( 11000 , a.getLastErrorObj().code );
+
+// updates on both shards are counted by getLastError
+b.data.update( {} , { $set : { x : 1 } } , false , true );
+c.data.find().itcount();
+assert.eq( N + 1 , b.getLastErrorObj().n );
+assert.eq( N + 1 , c.data.count( { x : 1 } ) );
+
+admin.runCommand( { setParameter : 1 , releaseConnectionsAfterResponse : false } );
+
+s.stop();
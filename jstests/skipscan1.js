@@ -0,0 +1,45 @@
+// A query that doesn't constrain the leading field of a compound index, and has no helpful index,
+// may skip through the index: for each value of the leading field the scan jumps to the queried
+// range of the later field.
+
+t = db.jstests_skipscan1;
+t.drop();
+
+t.ensureIndex( {a:1, b:1} );
+for( i = 0; i < 1000; ++i ) {
+    t.save( {a:i % 5, b:Math.floor( i / 5 ), c:i} );
+}
+
+explain = t.find( {b:7} ).explain( true );
+assert.eq( 5, explain.n );
+assert.eq( "BtreeCursor a_1_b_1", explain.cursor, tojson( explain ) );
+assert.gt( 30, explain.nscanned );
+assert.eq( 2, explain.allPlans.length );
+assert.eq( [ 35, 36, 37, 38, 39 ],
+          t.find( {b:7} ).toArray().map( function( d ) { return d.c; } ).sort( function( x, y ) {
+              return x - y;
+          } ) );
+
+// A range on the later field is skipped through as well.
+explain = t.find( {b:{$gte:198}} ).explain();
+assert.eq( 10, explain.n );
+assert.eq( "BtreeCursor a_1_b_1", explain.cursor );
+assert.gt( 40, explain.nscanned );
+
+// The skip scan is cached like any other plan.
+explain = t.find( {b:8} ).explain( true );
+assert.eq( "BtreeCursor a_1_b_1", explain.oldPlan.cursor, tojson( explain ) );
+assert.eq( 5, t.find( {b:8} ).itcount() );
+
+// A query on fields outside the index scans the table.
+assert.eq( "BasicCursor", t.find( {c:7} ).explain().cursor );
+
+// It isn't considered when another index is helpful.
+t.ensureIndex( {c:1, b:1} );
+explain = t.find( {c:{$gte:0}, b:7} ).explain( true );
+explain.allPlans.forEach( function( p ) { assert.neq( "BtreeCursor a_1_b_1", p.cursor ); } );
+assert.eq( 5, explain.n );
+
+// Nor for a sort the index doesn't provide.
+t.dropIndex( {c:1, b:1} );
+assert.eq( "BasicCursor", t.find( {b:7} ).sort( {c:1} ).explain().cursor );
@@ -0,0 +1,33 @@
+// With zeroCopyReplyMinBytes set, getMore replies send large documents straight from the data
+// files; the documents returned are the same.
+
+t = db.jstests_zerocopyreply;
+t.drop();
+
+big = new Array( 3000 ).toString();
+for( i = 0; i < 500; ++i ) {
+    t.save( i % 3 ? { _id:i, s:big + i } : { _id:i } );
+}
+
+function check() {
+    var n = 0;
+    t.find().sort( { _id:1 } ).batchSize( 50 ).forEach( function( d ) {
+                                                            assert.eq( n, d._id );
+                                                            if ( n % 3 ) {
+                                                                assert.eq( big + n, d.s );
+                                                            }
+                                                            ++n;
+                                                        } );
+    assert.eq( 500, n );
+    // in large batches too
+    assert.eq( 500, t.find().itcount() );
+}
+
+var was = db.adminCommand( { setParameter:1, zeroCopyReplyMinBytes:1024 } ).was;
+assert.eq( 0, was );
+assert.eq( 1024, db.adminCommand( { getParameter:1, zeroCopyReplyMinBytes:1 } ).zeroCopyReplyMinBytes );
+check();
+
+assert.commandFailed( db.adminCommand( { setParameter:1, zeroCopyReplyMinBytes:-1 } ) );
+db.adminCommand( { setParameter:1, zeroCopyReplyMinBytes:was } );
+check();
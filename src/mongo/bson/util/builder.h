@@ -147,6 +147,15 @@ namespace mongo {
         /* assume ownership of the buffer - you must then free() it */
         void decouple() { data = 0; }
 
+        /* take ownership of buf, bufSize bytes from the Allocator, in place of the current buffer.
+           the builder is left empty. */
+        void adopt( char *buf, int bufSize ) {
+            kill();
+            data = buf;
+            size = bufSize;
+            l = 0;
+        }
+
         void appendUChar(unsigned char j) {
             *((unsigned char*)grow(sizeof(unsigned char))) = j;
         }
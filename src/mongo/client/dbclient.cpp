@@ -23,6 +23,7 @@
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/client/syncclusterconnection.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/dbmessage.h"
 #include "mongo/db/json.h"
 #include "mongo/db/namespace-inl.h"
 #include "mongo/db/namespacestring.h"
@@ -688,6 +689,24 @@ namespace mongo {
         }
 #endif
 
+        if ( cmdLine.networkCompression ) {
+            // A server that can't compress ignores the field, and its replies stay uncompressed.
+            try {
+                BSONObj info;
+                BSONObj cmd = BSON( "isMaster" << 1 << "compression" << BSON_ARRAY( "snappy" ) );
+                if ( DBClientWithCommands::runCommand( "admin", cmd, info ) &&
+                     info[ "compression" ].type() == Array ) {
+                    p->setCompressed( true );
+                }
+            }
+            catch ( SocketException& e ) {
+                errmsg = str::stream() << "couldn't connect to server " << _server.toString()
+                                       << causedBy( e );
+                _failed = true;
+                return false;
+            }
+        }
+
         return true;
     }
 
@@ -707,6 +726,7 @@ namespace mongo {
     void DBClientConnection::_checkConnection() {
         if ( !_failed )
             return;
+        _failPipelined();
         if ( lastReconnectTry && time(0)-lastReconnectTry < 2 ) {
             // we wait a little before reconnect attempt to avoid constant hammering.
             // but we throw we don't want to try to use a connection in a bad state
@@ -1087,6 +1107,7 @@ namespace mongo {
     }
 
     bool DBClientConnection::recv( Message &m ) {
+        _receiveAllPipelined();
         return port().recv(m);
     }
 
@@ -1096,6 +1117,7 @@ namespace mongo {
                  it fails
         */
         checkConnection();
+        _receiveAllPipelined();
         try {
             if ( !port().call(toSend, response) ) {
                 _failed = true;
@@ -1112,6 +1134,119 @@ namespace mongo {
         return true;
     }
 
+    DBClientConnection::PipelinedReplyPtr DBClientConnection::sayPipelined( Message &toSend ) {
+        say( toSend );
+        PipelinedReplyPtr reply( new PipelinedReply( this, toSend.header()->id, 0 ) );
+        _pipelined.push_back( reply );
+        return reply;
+    }
+
+    DBClientConnection::PipelinedReplyPtr DBClientConnection::queryPipelined( const string &ns, Query query,
+            int nToReturn, int nToSkip, const BSONObj *fieldsToReturn, int queryOptions, int batchSize ) {
+        auto_ptr<DBClientCursor> c( new DBClientCursor( this, ns, query.obj, nToReturn, nToSkip,
+                                                        fieldsToReturn, queryOptions, batchSize ) );
+        Message toSend;
+        c->_assembleInit( toSend );
+        say( toSend );
+        PipelinedReplyPtr reply( new PipelinedReply( this, toSend.header()->id, c.release() ) );
+        _pipelined.push_back( reply );
+        return reply;
+    }
+
+    DBClientConnection::PipelinedReplyPtr DBClientConnection::runCommandPipelined( const string &dbname,
+            const BSONObj &cmd, int options ) {
+        Message toSend;
+        assembleRequest( dbname + ".$cmd", cmd, -1, 0, 0, options, toSend );
+        return sayPipelined( toSend );
+    }
+
+    void DBClientConnection::_receivePipelined() {
+        verify( !_pipelined.empty() );
+        Message m;
+        try {
+            if ( !port().recv( m ) ) {
+                _failed = true;
+                _failPipelined();
+                return;
+            }
+        }
+        catch( SocketException & ) {
+            _failed = true;
+            _failPipelined();
+            throw;
+        }
+
+        MSGID responseTo = m.header()->responseTo;
+        for( deque<PipelinedReplyPtr>::iterator i = _pipelined.begin(); i != _pipelined.end(); ++i ) {
+            if ( (*i)->_requestId == responseTo ) {
+                (*i)->_reply = m;
+                (*i)->_state = PipelinedReply::Received;
+                _pipelined.erase( i );
+                return;
+            }
+        }
+
+        // the reply to something else: we can no longer tell which reply is whose
+        _failed = true;
+        _failPipelined();
+        uasserted( 16424, str::stream() << "reply to unknown request " << responseTo
+                   << " on pipelined connection to " << getServerAddress() );
+    }
+
+    void DBClientConnection::_receiveAllPipelined() {
+        while( !_pipelined.empty() ) {
+            _receivePipelined();
+        }
+    }
+
+    void DBClientConnection::_failPipelined() {
+        for( deque<PipelinedReplyPtr>::iterator i = _pipelined.begin(); i != _pipelined.end(); ++i ) {
+            (*i)->_state = PipelinedReply::Failed;
+        }
+        _pipelined.clear();
+    }
+
+    void DBClientConnection::_pipelinedCursorReceived( DBClientCursor &cursor, Message &reply ) {
+        cursor.getMessage()->reset();
+        *cursor.getMessage() = reply;
+        cursor.dataReceived();
+    }
+
+    DBClientConnection::PipelinedReply::PipelinedReply( DBClientConnection *conn, MSGID requestId,
+                                                        DBClientCursor *cursor ) :
+        _conn( conn ),
+        _requestId( requestId ),
+        _state( InFlight ),
+        _cursor( cursor ) {
+    }
+
+    DBClientConnection::PipelinedReply::~PipelinedReply() {
+    }
+
+    Message& DBClientConnection::PipelinedReply::get() {
+        // the connection fails every request still in flight before it goes away
+        while( _state == InFlight ) {
+            _conn->_receivePipelined();
+        }
+        uassert( 16425, "connection failed before the reply to a pipelined request",
+                 _state == Received );
+        return _reply;
+    }
+
+    auto_ptr<DBClientCursor> DBClientConnection::PipelinedReply::cursor() {
+        uassert( 16426, "no cursor for this pipelined request", _cursor.get() );
+        get();
+        _pipelinedCursorReceived( *_cursor, _reply );
+        return _cursor;
+    }
+
+    bool DBClientConnection::PipelinedReply::commandResult( BSONObj &info ) {
+        QueryResult *qr = (QueryResult*)get().singleData();
+        uassert( 16427, "no result in the reply to a pipelined command", qr->nReturned == 1 );
+        info = BSONObj( qr->data() ).getOwned();
+        return info["ok"].trueValue();
+    }
+
     BSONElement getErrField(const BSONObj& o) {
         BSONElement first = o.firstElement();
         if( strcmp(first.fieldName(), "$err") == 0 )
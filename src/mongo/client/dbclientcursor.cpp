@@ -123,14 +123,14 @@ namespace mongo {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
+
+        if ( _inFlight ) {
+            _receiveReadAhead();
+            return;
+        }
 
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        _assembleGetMore( toSend );
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -151,6 +151,90 @@ namespace mongo {
         }
     }
 
+    void DBClientCursor::_assembleGetMore( Message& toSend ) {
+        BufBuilder b;
+        b.appendNum(opts);
+        b.appendStr(ns);
+        b.appendNum(nextBatchSize());
+        b.appendNum(cursorId);
+        toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
+    void DBClientCursor::setReadAhead( int nBatches ) {
+        // the size of a getMore with a limit depends on what came back before it
+        if ( _scopedHost.empty() || haveLimit ||
+             ( opts & ( QueryOption_CursorTailable | QueryOption_Exhaust ) ) )
+            return;
+        _readAhead = nBatches;
+        _sendReadAhead();
+    }
+
+    /** top up the getMores in flight.  the server answers them in order, each with the batch after
+        the last one's. */
+    void DBClientCursor::_sendReadAhead() {
+        if ( cursorId == 0 || _inFlight >= _readAhead )
+            return;
+        if ( ! _readAheadConn )
+            _readAheadConn = ScopedDbConnection::getScopedDbConnection( _scopedHost );
+        while ( _inFlight < _readAhead ) {
+            Message toSend;
+            _assembleGetMore( toSend );
+            _readAheadConn->get()->say( toSend );
+            _inFlight++;
+        }
+    }
+
+    void DBClientCursor::_receiveReadAhead() {
+        verify( _readAheadConn && _inFlight > 0 );
+        auto_ptr<Message> response(new Message());
+        bool ok = false;
+        try {
+            ok = _readAheadConn->get()->recv( *response );
+        }
+        catch ( SocketException& ) {
+        }
+        if ( ! ok ) {
+            // the connection is no good for the rest of them
+            _inFlight = 0;
+            delete _readAheadConn;
+            _readAheadConn = 0;
+            uasserted( 16408, "getMore read ahead: no response from " + _scopedHost );
+        }
+        _inFlight--;
+
+        _client = _readAheadConn->get();
+        batch.m = response;
+        try {
+            dataReceived();
+        }
+        catch ( ... ) {
+            _client = 0;
+            throw;
+        }
+        _client = 0;
+
+        if ( cursorId == 0 )
+            _endReadAhead(); // the rest will only say the cursor is gone
+        else
+            _sendReadAhead();
+    }
+
+    /** receive and drop the replies we no longer want, and give back the connection */
+    void DBClientCursor::_endReadAhead() {
+        if ( ! _readAheadConn )
+            return;
+        scoped_ptr<ScopedDbConnection> conn( _readAheadConn );
+        _readAheadConn = 0;
+        int n = _inFlight;
+        _inFlight = 0;
+        for ( ; n > 0; n-- ) {
+            Message m;
+            if ( ! conn->get()->recv( m ) )
+                return; // not done(), so it is closed rather than pooled
+        }
+        conn->done();
+    }
+
     /** with QueryOption_Exhaust, the server just blasts data at us (marked at end with cursorid==0). */
     void DBClientCursor::exhaustReceiveMore() {
         verify( cursorId && batch.pos == batch.nReturned );
@@ -314,6 +398,8 @@ namespace mongo {
 
         DESTRUCTOR_GUARD (
 
+        _endReadAhead();
+
         if ( cursorId && _ownCursor && ! inShutdown() ) {
             BufBuilder b;
             b.appendNum( (int)0 ); // reserved
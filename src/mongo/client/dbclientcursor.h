@@ -140,7 +140,10 @@ namespace mongo {
             batchSize(bs==1?2:bs),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _readAhead( 0 ),
+            _inFlight( 0 ),
+            _readAheadConn( 0 ) {
             _finishConsInit();
         }
 
@@ -151,7 +154,10 @@ namespace mongo {
             haveLimit( _nToReturn > 0 && !(options & QueryOption_CursorTailable)),
             opts( options ),
             cursorId(_cursorId),
-            _ownCursor( true ) {
+            _ownCursor( true ),
+            _readAhead( 0 ),
+            _inFlight( 0 ),
+            _readAheadConn( 0 ) {
             _finishConsInit();
         }
 
@@ -166,6 +172,12 @@ namespace mongo {
 
         void attach( AScopedConnection * conn );
 
+        /** keep up to nBatches getMores in flight on a connection of our own, so that the next
+            batches are on their way while this one is consumed.  for cursors that are attach()ed,
+            have no limit and are neither tailable nor exhaust; others ignore it.
+        */
+        void setReadAhead( int nBatches );
+
         string originalHost() const { return _originalHost; }
 
         Message* getMessage(){ return batch.m.get(); }
@@ -223,12 +235,20 @@ namespace mongo {
         string _scopedHost;
         string _lazyHost;
         bool wasError;
+        int _readAhead;                     // see setReadAhead()
+        int _inFlight;                      // getMores sent on _readAheadConn and not yet received
+        ScopedDbConnection* _readAheadConn;
 
         void dataReceived() { bool retry; string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, string& lazyHost );
         void requestMore();
         void exhaustReceiveMore(); // for exhaust
 
+        void _assembleGetMore( Message& toSend );
+        void _sendReadAhead();
+        void _receiveReadAhead();
+        void _endReadAhead();
+
         // Don't call from a virtual function
         void _assertIfNull() const { uassert(13348, "connection died", this); }
 
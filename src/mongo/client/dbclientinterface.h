@@ -22,6 +22,8 @@
 
 #include "pch.h"
 
+#include <deque>
+
 #include "mongo/db/jsobj.h"
 #include "mongo/client/authlevel.h"
 #include "mongo/util/net/message.h"
@@ -999,6 +1001,7 @@ namespace mongo {
         }
 
         virtual ~DBClientConnection() {
+            _failPipelined();
             _numConnections--;
         }
 
@@ -1060,6 +1063,29 @@ namespace mongo {
 
         virtual bool runCommand(const string &dbname, const BSONObj& cmd, BSONObj &info, int options=0);
 
+        class PipelinedReply;
+        typedef boost::shared_ptr<PipelinedReply> PipelinedReplyPtr;
+
+        /**
+         * Send 'toSend' without waiting for its reply, so that any number of requests may be in
+         * flight on the connection at once.  Replies are matched to their requests by responseTo
+         * as they are read, and may be waited for in any order.  Anything else on the connection
+         * that reads a reply - call(), recv(), a cursor's getMore - first reads those in flight.
+         * Don't send pipelined requests while a lazy query (DBClientCursor::initLazy()) is
+         * waiting for its reply.
+         */
+        PipelinedReplyPtr sayPipelined( Message &toSend );
+
+        /** Send a query without waiting for its reply; see sayPipelined() and PipelinedReply::cursor(). */
+        PipelinedReplyPtr queryPipelined( const string &ns, Query query, int nToReturn = 0, int nToSkip = 0,
+                                          const BSONObj *fieldsToReturn = 0, int queryOptions = 0, int batchSize = 0 );
+
+        /** Send a command without waiting for its reply; see sayPipelined() and PipelinedReply::commandResult(). */
+        PipelinedReplyPtr runCommandPipelined( const string &dbname, const BSONObj &cmd, int options = 0 );
+
+        /** @return the number of pipelined requests whose replies haven't been read yet. */
+        int numPipelined() const { return _pipelined.size(); }
+
         /**
            @return true if this connection is currently in a failed state.  When autoreconnect is on,
                    a connection will transition back to an ok state after reconnecting.
@@ -1127,6 +1153,64 @@ namespace mongo {
         static SSLManager* sslManager();
         static SSLManager* _sslManager;
 #endif
+
+    private:
+        friend class PipelinedReply;
+
+        deque< PipelinedReplyPtr > _pipelined; // sent with sayPipelined(), in order, replies not read yet
+
+        /** Read the next reply and complete the request it answers. */
+        void _receivePipelined();
+        void _receiveAllPipelined();
+        /** No more replies will be read on this socket: fail the requests still waiting for one. */
+        void _failPipelined();
+        static void _pipelinedCursorReceived( DBClientCursor &cursor, Message &reply );
+    };
+
+    /**
+     * The reply to a request sent with DBClientConnection::sayPipelined(), completed when the
+     * reply is read from the connection - by get() or by anything else that reads a reply.
+     */
+    class DBClientConnection::PipelinedReply : boost::noncopyable {
+    public:
+        ~PipelinedReply();
+
+        /** @return true if the reply has been read, or the connection failed before it was. */
+        bool ready() const { return _state != InFlight; }
+
+        /** @return the id of the request, which the reply gives as its responseTo. */
+        MSGID requestId() const { return _requestId; }
+
+        /**
+         * Wait for the reply, reading any replies to requests sent before it.  Asserts if the
+         * connection fails first.
+         */
+        Message& get();
+
+        /**
+         * For queryPipelined(): wait for the reply and return a cursor over the results, which
+         * gets any more of them from the connection.  Once only; a query's cursor that isn't taken
+         * is left to time out at the server.
+         */
+        auto_ptr<DBClientCursor> cursor();
+
+        /**
+         * For runCommandPipelined(): wait for the reply and put the command's result in 'info'.
+         * @return true if the command succeeded.
+         */
+        bool commandResult( BSONObj &info );
+
+    private:
+        friend class DBClientConnection;
+        enum State { InFlight, Received, Failed };
+
+        PipelinedReply( DBClientConnection *conn, MSGID requestId, DBClientCursor *cursor );
+
+        DBClientConnection *_conn;
+        MSGID _requestId;
+        State _state;
+        Message _reply;
+        auto_ptr<DBClientCursor> _cursor; // for queryPipelined(), until cursor() takes it
     };
 
     /** pings server to check if it's up
@@ -277,6 +277,45 @@ int main( int argc, const char **argv ) {
         
     }
 
+    {
+        // pipelined requests: several in flight at once, their replies waited for in any order
+        const char * ns = "test.pipelined";
+        conn.dropCollection( ns );
+        for ( int i = 0; i < 300; i++ ) {
+            conn.insert( ns , BSON( "i" << i ) );
+        }
+
+        DBClientConnection::PipelinedReplyPtr all = conn.queryPipelined( ns , Query().sort( "i" ) , 0 , 0 , 0 , 0 , 50 );
+        DBClientConnection::PipelinedReplyPtr count = conn.runCommandPipelined( "test" , BSON( "count" << "pipelined" ) );
+        DBClientConnection::PipelinedReplyPtr one = conn.queryPipelined( ns , QUERY( "i" << 7 ) , 1 );
+        verify( conn.numPipelined() == 3 );
+
+        // the last reply is read after the ones before it
+        auto_ptr<DBClientCursor> c = one->cursor();
+        verify( count->ready() && all->ready() );
+        verify( conn.numPipelined() == 0 );
+        verify( c->next()["i"].number() == 7 );
+
+        BSONObj res;
+        verify( count->commandResult( res ) );
+        verify( res["n"].number() == 300 );
+
+        // the cursor gets the rest of the results from the connection
+        c = all->cursor();
+        int n = 0;
+        while ( c->more() ) {
+            verify( c->next()["i"].number() == n );
+            n++;
+        }
+        verify( n == 300 );
+
+        // anything else that reads a reply reads the replies in flight first
+        DBClientConnection::PipelinedReplyPtr again = conn.runCommandPipelined( "test" , BSON( "count" << "pipelined" ) );
+        verify( conn.count( ns ) == 300 );
+        verify( again->ready() );
+        verify( again->commandResult( res ) );
+    }
+
     cout << "client test finished!" << endl;
     return EXIT_SUCCESS;
 }
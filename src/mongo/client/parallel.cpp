@@ -19,6 +19,7 @@
 #include "pch.h"
 #include "parallel.h"
 #include "connpool.h"
+#include "../db/cmdline.h"
 #include "../db/dbmessage.h"
 #include "../s/util.h"
 #include "../s/shard.h"
@@ -1088,6 +1089,11 @@ namespace mongo {
                     // Finalize state
                     state->cursor->attach( state->conn.get() ); // Closes connection for us
 
+                    // Have the next batches on their way before the merge needs them.  Not with
+                    // a batch size, which may well be a limit too.
+                    if( _qSpec.ntoreturn() == 0 )
+                        state->cursor->setReadAhead( cmdLine.shardReadAhead );
+
                     log( pc ) << "finished on shard " << shard << ", current connection state is " << mdata.toBSON() << endl;
                 }
             }
@@ -1434,6 +1440,8 @@ namespace mongo {
                 try {
                     _cursors[i].raw()->attach( conns[i].get() ); // this calls done on conn
                     _checkCursor( _cursors[i].raw() );
+                    if( _batchSize == 0 )
+                        _cursors[i].raw()->setReadAhead( cmdLine.shardReadAhead );
 
                     finishedQueries++;
                 }
@@ -36,6 +36,7 @@ namespace mongo {
 
     BOOST_STATIC_ASSERT( Record::HeaderSize == 16 );
     BOOST_STATIC_ASSERT( Record::HeaderSize + BtreeData_V1::BucketSize == 8192 );
+    BOOST_STATIC_ASSERT( Record::HeaderSize + BtreeData_V2::BucketSize == 8192 );
 
     NOINLINE_DECL void checkFailed(unsigned line) {
         static time_t last;
@@ -204,7 +205,8 @@ namespace mongo {
             wassert( foo >= 0 && this->n < Size() );
             foo = this->emptySize;
             wassert( foo >= 0 && this->emptySize < V::BucketSize );
-            wassert( this->topSize >= this->n && this->topSize <= V::BucketSize );
+            // keys equal to the prefix of a prefix compressed bucket take no storage of their own
+            wassert( ( V::PrefixCompressed || this->topSize >= this->n ) && this->topSize <= V::BucketSize );
         }
 
         // this is very slow so don't do often
@@ -217,9 +219,9 @@ namespace mongo {
         DEV {
             // slow:
             for ( int i = 0; i < this->n-1; i++ ) {
-                Key k1 = keyNode(i).key;
-                Key k2 = keyNode(i+1).key;
-                int z = k1.woCompare(k2, order); //OK
+                KeyNode k1 = keyNode(i);
+                KeyNode k2 = keyNode(i+1);
+                int z = k1.key.woCompare(k2.key, order); //OK
                 if ( z > 0 ) {
                     out() << "ERROR: btree key order corrupt.  Keys:" << endl;
                     if ( ++nDumped < 5 ) {
@@ -244,9 +246,9 @@ namespace mongo {
         else {
             //faster:
             if ( this->n > 1 ) {
-                Key k1 = keyNode(0).key;
-                Key k2 = keyNode(this->n-1).key;
-                int z = k1.woCompare(k2, order);
+                KeyNode k1 = keyNode(0);
+                KeyNode k2 = keyNode(this->n-1);
+                int z = k1.key.woCompare(k2.key, order);
                 //wassert( z <= 0 );
                 if ( z > 0 ) {
                     problem() << "btree keys out of order" << '\n';
@@ -321,13 +323,12 @@ namespace mongo {
      *  does not bother returning that value.
      */
     template< class V >
-    void BucketBasics<V>::popBack(DiskLoc& recLoc, Key &key) {
+    void BucketBasics<V>::popBack(DiskLoc& recLoc) {
         massert( 10282 ,  "n==0 in btree popBack()", this->n > 0 );
         verify( k(this->n-1).isUsed() ); // no unused skipping in this function at this point - btreebuilder doesn't require that
         KeyNode kn = keyNode(this->n-1);
         recLoc = kn.recordLoc;
-        key.assign(kn.key);
-        int keysize = kn.key.dataSize();
+        int keysize = kn.key.dataSize() - this->_prefixSize();
 
         massert( 10283 , "rchild not null in btree popBack()", this->nextChild.isNull());
 
@@ -335,20 +336,40 @@ namespace mongo {
         this->nextChild = kn.prevChildBucket;
 
         this->n--;
-        // This is risky because the key we are returning points to this unalloc'ed memory,
-        // and we are assuming that the last key points to the last allocated
+        // We are assuming that the last key points to the last allocated
         // bson region.
         this->emptySize += sizeof(_KeyNode);
         _unalloc(keysize);
     }
 
+    template< class V >
+    int BucketBasics<V>::storedSize(const Key& key) const {
+        int p = this->_prefixSize();
+        int sz = key.dataSize();
+        if ( p && ( sz < p || memcmp( key.data(), prefix(), p ) != 0 ) )
+            return -1;
+        return sz - p;
+    }
+
+    template< class V >
+    void BucketBasics<V>::_storeKey(int i, const Key& key) {
+        int sz = storedSize( key );
+        verify( sz >= 0 );
+        _KeyNode &kn = k( i );
+        kn.setKeyDataOfs( (short) _alloc( sz ) );
+        memcpy( dataAt( kn.keyDataOfs() ), key.data() + this->_prefixSize(), sz );
+    }
+
     /** add a key.  must be > all existing.  be careful to set next ptr right. */
     template< class V >
     bool BucketBasics<V>::_pushBack(const DiskLoc recordLoc, const Key& key, const Ordering &order, const DiskLoc prevChild) {
-        int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
-        if ( bytesNeeded > this->emptySize )
+        if ( V::PrefixCompressed && !fits( key ) ) {
+            // repacking may shorten the prefix enough for key to fit
+            int zeropos = 0;
+            _packReadyForMod( order, zeropos, &key );
+        }
+        if ( !fits( key ) )
             return false;
-        verify( bytesNeeded <= this->emptySize );
         if( this->n ) {
             const KeyNode klast = keyNode(this->n-1);
             if(  klast.key.woCompare(key, order) > 0 ) { 
@@ -363,10 +384,7 @@ namespace mongo {
         _KeyNode& kn = k(this->n++);
         kn.prevChildBucket = prevChild;
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs( (short) _alloc(key.dataSize()) );
-        short ofs = kn.keyDataOfs();
-        char *p = dataAt(ofs);
-        memcpy(p, key.data(), key.dataSize());
+        _storeKey( this->n - 1, key );
 
         return true;
     }
@@ -383,12 +401,12 @@ namespace mongo {
     bool BucketBasics<V>::basicInsert(const DiskLoc thisLoc, int &keypos, const DiskLoc recordLoc, const Key& key, const Ordering &order) const {
         check( this->n < 1024 );
         check( keypos >= 0 && keypos <= this->n );
-        int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
-        if ( bytesNeeded > this->emptySize ) {
-            _pack(thisLoc, order, keypos);
-            if ( bytesNeeded > this->emptySize )
+        if ( !fits( key ) ) {
+            _pack(thisLoc, order, keypos, &key);
+            if ( !fits( key ) )
                 return false;
         }
+        const int stored = storedSize( key );
 
         BucketBasics *b;
         {
@@ -415,10 +433,10 @@ namespace mongo {
         _KeyNode& kn = b->k(keypos);
         kn.prevChildBucket.Null();
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs((short) b->_alloc(key.dataSize()) );
+        kn.setKeyDataOfs((short) b->_alloc(stored) );
         char *p = b->dataAt(kn.keyDataOfs());
-        getDur().declareWriteIntent(p, key.dataSize());
-        memcpy(p, key.data(), key.dataSize());
+        getDur().declareWriteIntent(p, stored);
+        memcpy(p, key.data() + this->_prefixSize(), stored);
         return true;
     }
 
@@ -433,7 +451,8 @@ namespace mongo {
 
     template< class V >
     int BucketBasics<V>::packedDataSize( int refPos ) const {
-        if ( this->flags & Packed ) {
+        // for a prefix compressed bucket, the size its keys take anywhere else
+        if ( ( this->flags & Packed ) && !V::PrefixCompressed ) {
 	  return V::BucketSize - this->emptySize - headerSize();
         }
         int size = 0;
@@ -451,8 +470,8 @@ namespace mongo {
      * full and then we repack it.
      */
     template< class V >
-    void BucketBasics<V>::_pack(const DiskLoc thisLoc, const Ordering &order, int &refPos) const {
-        if ( this->flags & Packed )
+    void BucketBasics<V>::_pack(const DiskLoc thisLoc, const Ordering &order, int &refPos, const Key *adding) const {
+        if ( ( this->flags & Packed ) && !( V::PrefixCompressed && adding ) )
             return;
 
         VERIFYTHISLOC
@@ -462,17 +481,41 @@ namespace mongo {
                  declaration anyway within the group commit interval, in which case we would just be adding
                  code and complexity without benefit.
         */
-        thisLoc.btreemod<V>()->_packReadyForMod(order, refPos);
+        thisLoc.btreemod<V>()->_packReadyForMod(order, refPos, adding);
     }
 
     /** version when write intent already declared */
     template< class V >
-    void BucketBasics<V>::_packReadyForMod( const Ordering &order, int &refPos ) {
+    void BucketBasics<V>::_packReadyForMod( const Ordering &order, int &refPos, const Key *adding ) {
         assertWritable();
 
-        if ( this->flags & Packed )
+        // a prefix compressed bucket's prefix is only as long as its keys had in common when it
+        // was last packed, so we pack it again whenever a key doesn't fit
+        if ( ( this->flags & Packed ) && !( V::PrefixCompressed && adding ) )
             return;
 
+        if ( V::PrefixCompressed ) {
+            int i = 0;
+            for ( int j = 0; j < this->n; j++ ) {
+                if( mayDropKey( j, refPos ) ) {
+                    continue; // key is unused and has no children - drop it
+                }
+                if( i != j ) {
+                    if ( refPos == j ) {
+                        refPos = i; // i < j so j will never be refPos again
+                    }
+                    k( i ) = k( j );
+                }
+                ++i;
+            }
+            if ( refPos == this->n ) {
+                refPos = i;
+            }
+            this->n = i;
+            _packPrefixed( order, adding );
+            return;
+        }
+
         int tdz = totalDataSize();
         char temp[V::BucketSize];
         int ofs = tdz;
@@ -517,6 +560,65 @@ namespace mongo {
         assertValid( order );
     }
 
+    /**
+     * The prefix is the longest run of whole leading elements all the keys share, and also
+     * 'adding' if the bucket then has room for it.
+     */
+    template< class V >
+    void BucketBasics<V>::_packPrefixed( const Ordering &order, const Key *adding ) {
+        const int KNS = sizeof( _KeyNode );
+        int tdz = totalDataSize();
+        char first[V::KeyMax];
+        int firstSize = 0;
+        int p = 0;
+        int keysSize = 0;
+        if ( this->n ) {
+            KeyNode kn = keyNode( 0 );
+            firstSize = kn.key.dataSize();
+            memcpy( first, kn.key.data(), firstSize );
+            p = firstSize;
+            keysSize = firstSize;
+        }
+        for ( int i = 1; i < this->n; i++ ) {
+            KeyNode kn = keyNode( i );
+            p = KeyV1::commonPrefixSize( first, kn.key.data(), p );
+            keysSize += kn.key.dataSize();
+        }
+        if ( adding && this->n ) {
+            int withAdding = KeyV1::commonPrefixSize( first, adding->data(), p );
+            int needed = withAdding + ( keysSize + adding->dataSize() - ( this->n + 1 ) * withAdding ) +
+                         ( this->n + 1 ) * KNS;
+            if ( needed <= tdz )
+                p = withAdding;
+        }
+
+        // the keys are expanded from the old layout into temp, and only then copied back
+        char temp[V::BucketSize];
+        int ofs = tdz - p;
+        memcpy( temp + ofs, first, p );
+        for ( int i = 0; i < this->n; i++ ) {
+            KeyNode kn = keyNode( i );
+            int sz = kn.key.dataSize() - p;
+            ofs -= sz;
+            memcpy( temp + ofs, kn.key.data() + p, sz );
+            k( i ).setKeyDataOfsSavingUse( ofs );
+        }
+        int dataUsed = tdz - ofs;
+        memcpy( this->data + ofs, temp + ofs, dataUsed );
+
+        this->_setPrefixSize( p );
+        this->topSize = dataUsed;
+        this->emptySize = tdz - dataUsed - this->n * KNS;
+        {
+            int foo = this->emptySize;
+            verify( foo >= 0 );
+        }
+
+        setPacked();
+
+        assertValid( order );
+    }
+
     template< class V >
     inline void BucketBasics<V>::truncateTo(int N, const Ordering &order, int &refPos) {
         verify( Lock::somethingWriteLocked() );
@@ -553,7 +655,8 @@ namespace mongo {
         // TODO I think we only want to do the 90% split on the rhs node of the tree.
         int rightSizeLimit = ( this->topSize + sizeof( _KeyNode ) * this->n ) / ( keypos == this->n ? 10 : 2 );
         for( int i = this->n - 1; i > -1; --i ) {
-            rightSize += keyNode( i ).key.dataSize() + sizeof( _KeyNode );
+            // the size as stored here, like topSize
+            rightSize += keyNode( i ).key.dataSize() - this->_prefixSize() + sizeof( _KeyNode );
             if ( rightSize > rightSizeLimit ) {
                 split = i;
                 break;
@@ -585,10 +688,7 @@ namespace mongo {
         _KeyNode &kn = k( i );
         kn.recordLoc = recordLoc;
         kn.prevChildBucket = prevChildBucket;
-        short ofs = (short) _alloc( key.dataSize() );
-        kn.setKeyDataOfs( ofs );
-        char *p = dataAt( ofs );
-        memcpy( p, key.data(), key.dataSize() );
+        _storeKey( i, key );
     }
 
     template< class V >
@@ -688,7 +788,7 @@ namespace mongo {
                 const BtreeBucket *bucket = b.btree<V>();
                 const _KeyNode& kn = bucket->k(pos);
                 if ( kn.isUsed() )
-                    return bucket->keyAt(pos).woEqual(key);
+                    return bucket->keyNode(pos).key.woEqual(key);
             b = bucket->advance(b, pos, 1, "BtreeBucket<V>::exists");
         }
         return false;
@@ -708,7 +808,7 @@ namespace mongo {
             const BtreeBucket *bucket = b.btree<V>();
             const _KeyNode& kn = bucket->k(pos);
             if ( kn.isUsed() ) {
-                if( bucket->keyAt(pos).woEqual(key) )
+                if( bucket->keyNode(pos).key.woEqual(key) )
                     return kn.recordLoc != self;
                 break;
             }
@@ -759,8 +859,8 @@ namespace mongo {
             m = h;
         }
         while ( l <= h ) {
-            KeyNode M = this->keyNode(m);
-            int x = key.woCompare(M.key, order);
+            const _KeyNode& M = k(m);
+            int x = this->compareKey(key, m, order);
             if ( x == 0 ) {
                 if( assertIfDup ) {
                     if( k(m).isUnused() ) {
@@ -803,8 +903,8 @@ namespace mongo {
         // not found
         pos = l;
         if ( pos != this->n ) {
-            Key keyatpos = keyNode(pos).key;
-            wassert( key.woCompare(keyatpos, order) <= 0 );
+            KeyNode keyatpos = keyNode(pos);
+            wassert( key.woCompare(keyatpos.key, order) <= 0 );
             if ( pos > 0 ) {
                 if( !( keyNode(pos-1).key.woCompare(key, order) <= 0 ) ) {
                     DEV {
@@ -1185,6 +1285,25 @@ namespace mongo {
         }
     }
 
+    template< class V >
+    void BtreeBucket<V>::doRotateIntoEmptyChild( const DiskLoc thisLoc, int leftIndex, IndexDetails &id, const Ordering &order ) {
+        DiskLoc lchild = this->childForPos( leftIndex );
+        DiskLoc rchild = this->childForPos( leftIndex + 1 );
+        int zeropos = 0;
+        BtreeBucket *l = lchild.btreemod<V>();
+        l->_packReadyForMod( order, zeropos );
+        BtreeBucket *r = rchild.btreemod<V>();
+        r->_packReadyForMod( order, zeropos );
+        // the children can't be merged, so the nonempty one has at least two keys
+        if ( l->n == 0 ) {
+            doBalanceRightToLeft( thisLoc, leftIndex, 1, l, lchild, r, rchild, id, order );
+        }
+        else {
+            verify( r->n == 0 );
+            doBalanceLeftToRight( thisLoc, leftIndex, l->n - 1, l, lchild, r, rchild, id, order );
+        }
+    }
+
     template< class V >
     bool BtreeBucket<V>::mayBalanceWithNeighbors( const DiskLoc thisLoc, IndexDetails &id, const Ordering &order ) const {
         if ( this->parent.isNull() ) { // we are root, there are no neighbors
@@ -1202,6 +1321,26 @@ namespace mongo {
         bool mayBalanceRight = ( ( parentIdx < p->n ) && !p->childForPos( parentIdx + 1 ).isNull() );
         bool mayBalanceLeft = ( ( parentIdx > 0 ) && !p->childForPos( parentIdx - 1 ).isNull() );
 
+        if ( V::PrefixCompressed ) {
+            // Balancing moves keys by their expanded size, which a prefix
+            // compressed neighbor may not have room for.  So we merge when the
+            // expanded keys fit, and otherwise only keep this bucket from being
+            // left empty.
+            if ( mayBalanceRight && p->canMergeChildren( this->parent, parentIdx ) ) {
+                BTREEMOD(this->parent)->doMergeChildren( this->parent, parentIdx, id, order );
+                return true;
+            }
+            if ( mayBalanceLeft && p->canMergeChildren( this->parent, parentIdx - 1 ) ) {
+                BTREEMOD(this->parent)->doMergeChildren( this->parent, parentIdx - 1, id, order );
+                return true;
+            }
+            if ( this->n > 0 || !( mayBalanceRight || mayBalanceLeft ) ) {
+                return false;
+            }
+            BTREEMOD(this->parent)->doRotateIntoEmptyChild( this->parent, mayBalanceRight ? parentIdx : parentIdx - 1, id, order );
+            return true;
+        }
+
         // Balance if possible on one side - we merge only if absolutely necessary
         // to preserve btree bucket utilization constraints since that's a more
         // heavy duty operation (especially if we must re-split later).
@@ -1947,8 +2086,10 @@ namespace mongo {
 
     template class BucketBasics<V0>;
     template class BucketBasics<V1>;
+    template class BucketBasics<V2>;
     template class BtreeBucket<V0>;
     template class BtreeBucket<V1>;
+    template class BtreeBucket<V2>;
     template struct __KeyNode<DiskLoc>;
     template struct __KeyNode<DiskLoc56Bit>;
 
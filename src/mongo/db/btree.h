@@ -182,6 +182,10 @@ namespace mongo {
         static const int KeyMax = OldBucketSize / 10;
         // A sentinel value sometimes used to identify a deallocated bucket.
         static const int INVALID_N_SENTINEL = -1;
+        enum { PrefixCompressed = 0 };
+    protected:
+        int _prefixSize() const { return 0; }
+        void _setPrefixSize(int s) { dassert( s == 0 ); }
     };
 
     // a a a ofs ofs ofs ofs
@@ -290,10 +294,70 @@ namespace mongo {
         char data[4];
 
         void _init() { }
+    public:
+        enum { PrefixCompressed = 0 };
+    protected:
+        int _prefixSize() const { return 0; }
+        void _setPrefixSize(int s) { dassert( s == 0 ); }
+    };
+
+    /**
+     * Version 2 buckets have the same key format as version 1, plus prefix compression: the
+     * leading whole key elements all the keys in a bucket have in common are stored once, at
+     * the end of the body, and each key's bson storage holds only the rest of the key.
+     *
+     * The header is the version 1 header followed by a 2 byte prefixSize, so the body starts
+     * 2 bytes later than in a version 1 bucket of the same BucketSize.
+     *
+     * |hhhh|kkkkkkk--------bbbbbbbbbbbuuubbbuubbbpppp|
+     * p = common key prefix, prefixSize bytes, counted in topSize
+     *
+     * The prefix is computed when the bucket is packed.  A key that doesn't start with the
+     * prefix can only be added after a pack that shortens the prefix to cover it.  Lookups
+     * compare against the prefix and the rest of the key in place; KeyNode expands a key into
+     * a buffer of its own, without allocating, only when it is asked for one.
+     */
+    class BtreeData_V2 {
+    public:
+        typedef DiskLoc56Bit Loc;
+        typedef __KeyNode<Loc> _KeyNode;
+        typedef KeyV1 Key;
+        typedef KeyV1Owned KeyOwned;
+        enum { BucketSize = 8192-16 }; // leave room for Record header
+        static const int KeyMax = 1024;
+        static const unsigned short INVALID_N_SENTINEL = 0xffff;
+        enum { PrefixCompressed = 1 };
+    protected:
+        /** Parent bucket of this bucket, which isNull() for the root bucket. */
+        Loc parent;
+        /** Given that there are n keys, this is the n index child. */
+        Loc nextChild;
+
+        unsigned short flags;
+
+        /** basicInsert() assumes the next three members are consecutive and in this order: */
+
+        /** Size of the empty region. */
+        unsigned short emptySize;
+        /** Size used for bson storage, including storage of old keys and of the prefix. */
+        unsigned short topSize;
+        /* Number of keys in the bucket. */
+        unsigned short n;
+
+        /** Size of the common key prefix, at the end of the body. */
+        unsigned short prefixSize;
+
+        /* Beginning of the bucket's body */
+        char data[4];
+
+        void _init() { prefixSize = 0; }
+        int _prefixSize() const { return prefixSize; }
+        void _setPrefixSize(int s) { prefixSize = (unsigned short) s; }
     };
 
     typedef BtreeData_V0 V0;
     typedef BtreeData_V1 V1;
+    typedef BtreeData_V2 V2;
 
     /**
      * This class adds functionality to BtreeData for managing a single bucket.
@@ -341,13 +405,24 @@ namespace mongo {
         class KeyNode {
         public:
             KeyNode(const BucketBasics<Version>& bb, const _KeyNode &k);
+            KeyNode(const KeyNode& r);
             const Loc& prevChildBucket;
             const Loc& recordLoc;
-            /* Points to the bson key storage for a _KeyNode */
+            /* Points to the bson key storage for a _KeyNode, or to _buf when the bucket is
+               prefix compressed */
             Key key;
+        private:
+            /** the expanded key of a prefix compressed bucket */
+            char _buf[ Version::PrefixCompressed ? Version::KeyMax : 1 ];
         };
         friend class KeyNode;
 
+        /**
+         * @return key.woCompare() against the key at index i.  Keys of a prefix compressed
+         * bucket are compared in place rather than expanded as keyNode(i) would.
+         */
+        int compareKey(const Key& key, int i, const Ordering &order) const;
+
         /** Assert write intent declared for this bucket already. */
         void assertWritable();
 
@@ -419,15 +494,8 @@ namespace mongo {
         }
 
         /**
-         * This is a special purpose function used by BtreeBuilder.  The
-         * interface is quite dangerous if you're not careful.  The bson key
-         * returned here points to bucket memory that has been invalidated but
-         * not yet reclaimed.
-         *
-         * TODO Maybe this could be replaced with two functions, one which
-         * returns the last key without deleting it and another which simply
-         * deletes the last key.  Then the caller would have enough control to
-         * ensure proper memory integrity.
+         * This is a special purpose function used by BtreeBuilder, which reads
+         * the last key with keyNode() before removing it here.
          *
          * Preconditions:
          *  - bucket is not empty
@@ -435,10 +503,9 @@ namespace mongo {
          *  - nextChild isNull()
          *  - _unalloc will work correctly as used - see code
          * Postconditions:
-         *  - The last key of the bucket is removed, and its key and recLoc are
-         *    returned.  As mentioned above, the key points to unallocated memory.
+         *  - The last key of the bucket is removed, and its recLoc is returned.
          */
-        void popBack(DiskLoc& recLoc, Key &key);
+        void popBack(DiskLoc& recLoc);
 
         /**
          * Preconditions:
@@ -477,6 +544,8 @@ namespace mongo {
          * Pack the bucket to reclaim space from invalidated memory.
          * @refPos is an index in the bucket which may be updated if we
          *  delete keys from the bucket
+         * @adding a key about to be added, which the prefix of a prefix
+         *  compressed bucket is computed to cover if it then fits
          * This function may cast away const and perform a write.
          * Preconditions: none
          * Postconditions:
@@ -486,9 +555,23 @@ namespace mongo {
          *  - If refPos is the index of an existing key, it will be updated to that
          *    key's new index if the key is moved.
          */
-        void _pack(const DiskLoc thisLoc, const Ordering &order, int &refPos) const;
+        void _pack(const DiskLoc thisLoc, const Ordering &order, int &refPos, const Key *adding = 0) const;
         /** Pack when already writable */
-        void _packReadyForMod(const Ordering &order, int &refPos);
+        void _packReadyForMod(const Ordering &order, int &refPos, const Key *adding = 0);
+        /** _packReadyForMod() for prefix compressed buckets, after unused keys are dropped */
+        void _packPrefixed(const Ordering &order, const Key *adding);
+
+        /** @return the common key prefix of a prefix compressed bucket */
+        const char * prefix() const { return this->data + totalDataSize() - this->_prefixSize(); }
+        /** @return bytes of bson storage key needs in this bucket, -1 if it doesn't start with the prefix */
+        int storedSize(const Key& key) const;
+        /** @return true if key can be added without packing */
+        bool fits(const Key& key) const {
+            int sz = storedSize( key );
+            return sz >= 0 && sz + int( sizeof( _KeyNode ) ) <= this->emptySize;
+        }
+        /** copy the stored part of key to the bson storage of k(i), which must have room */
+        void _storeKey(int i, const Key& key);
 
         /** @return the size the bucket's body would have if we were to call pack() */
         int packedDataSize( int refPos ) const;
@@ -818,6 +901,18 @@ namespace mongo {
          *    The tree head may change.
          */
         void doBalanceChildren( const DiskLoc thisLoc, int leftIndex, IndexDetails &id, const Ordering &order );
+
+        /**
+         * Preconditions:
+         *  - 0 <= leftIndex < n
+         *  - Exactly one of the leftIndex child and leftIndex + 1 child is
+         *    empty, and the two cannot be merged.
+         * Postconditions:
+         *  - The separator key moves down into the empty child, and the
+         *    adjacent key of the other child replaces it.  The tree head may
+         *    change.
+         */
+        void doRotateIntoEmptyChild( const DiskLoc thisLoc, int leftIndex, IndexDetails &id, const Ordering &order );
         
         /**
          * Preconditions:
@@ -899,12 +994,6 @@ namespace mongo {
          */
         int indexInParent( const DiskLoc &thisLoc ) const;        
 
-    public:
-        Key keyAt(int i) const {
-            if( i >= this->n ) 
-                return Key();
-            return Key(this->data + k(i).keyDataOfs());
-        }
     protected:
 
         /**
@@ -1042,6 +1131,20 @@ namespace mongo {
 
         virtual bool ok() { return !bucket.isNull(); }
         virtual bool advance();
+        /**
+         * Skip ahead, within the current key, to the first entry whose record is at or past loc
+         * in the direction of the cursor; entries with equal keys are ordered by record.  Used to
+         * intersect cursors over a single key.
+         * @return ok()
+         */
+        bool skipToLoc( const DiskLoc &loc );
+        /**
+         * Skip ahead to the first entry whose first 'prefixLen' key fields differ from those of
+         * the current key, jumping over the entries in between with a single btree descent.
+         * Used by distinct to visit each value of an index's leading field once.
+         * @return ok()
+         */
+        bool advancePastPrefix( int prefixLen );
         virtual void noteLocation(); // updates keyAtKeyOfs...
         virtual void checkLocation() = 0;
         virtual bool supportGetMore() { return true; }
@@ -1125,6 +1228,8 @@ namespace mongo {
         bool skipOutOfRangeKeysAndCheckEnd();
         void skipAndCheck();
         void checkEnd();
+        /** After the cursor has moved, skip unused and out of range keys and count the key. */
+        void checkMoved();
 
         /** selective audits on construction */
         void audit();
@@ -1181,6 +1286,31 @@ namespace mongo {
     BucketBasics<V>::KeyNode::KeyNode(const BucketBasics<V>& bb, const _KeyNode &k) :
         prevChildBucket(k.prevChildBucket),
         recordLoc(k.recordLoc), key(bb.data+k.keyDataOfs())
-    { }
+    {
+        if ( bb._prefixSize() ) {
+            dassert( V::PrefixCompressed );
+            KeyV1::expand( bb.prefix(), bb._prefixSize(), bb.data + k.keyDataOfs(), _buf );
+            key.assign( Key( _buf ) );
+        }
+    }
+
+    template< class V >
+    BucketBasics<V>::KeyNode::KeyNode(const KeyNode& r) :
+        prevChildBucket(r.prevChildBucket),
+        recordLoc(r.recordLoc), key(r.key)
+    {
+        if ( r.key.data() == r._buf ) {
+            memcpy( _buf, r._buf, r.key.dataSize() );
+            key.assign( Key( _buf ) );
+        }
+    }
+
+    template< class V >
+    int BucketBasics<V>::compareKey(const Key& key, int i, const Ordering &order) const {
+        const _KeyNode& kn = k(i);
+        if ( this->_prefixSize() && key.isCompactFormat() )
+            return key.woCompare( prefix(), this->_prefixSize(), this->data + kn.keyDataOfs(), order );
+        return key.woCompare( KeyNode( *this, kn ).key, order );
+    }
 
 } // namespace mongo;
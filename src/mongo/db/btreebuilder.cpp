@@ -114,9 +114,9 @@ namespace mongo {
                 }
 
                 BtreeBucket<V> *x = xloc.btreemod<V>();
-                Key k;
+                KeyOwned k( x->keyNode( x->getN() - 1 ).key );
                 DiskLoc r;
-                x->popBack(r,k);
+                x->popBack(r);
                 bool keepX = ( x->n != 0 );
                 DiskLoc keepLoc = keepX ? xloc : x->nextChild;
 
@@ -180,5 +180,6 @@ namespace mongo {
 
     template class BtreeBuilder<V0>;
     template class BtreeBuilder<V1>;
+    template class BtreeBuilder<V2>;
 
 }
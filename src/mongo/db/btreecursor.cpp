@@ -51,7 +51,7 @@ namespace mongo {
 
         virtual DiskLoc currLoc() { 
             if( bucket.isNull() ) return DiskLoc();
-            return currKeyNode().recordLoc;
+            return keyNode(keyOfs).recordLoc;
         }
 
         virtual BSONObj keyAt(int ofs) const { 
@@ -71,7 +71,7 @@ namespace mongo {
         }
 
         virtual bool curKeyHasChild() { 
-            return !currKeyNode().prevChildBucket.isNull();
+            return !keyNode(keyOfs).prevChildBucket.isNull();
         }
 
         bool skipUnusedKeys() {
@@ -176,17 +176,11 @@ namespace mongo {
         const _KeyNode& keyNode(int keyOfs) const { 
             return bucket.btree<V>()->k(keyOfs);
         }
-
-    private:
-        const KeyNode currKeyNode() const {
-            verify( !bucket.isNull() );
-            const BtreeBucket<V> *b = bucket.btree<V>();
-            return b->keyNode(keyOfs);
-        }
     };
 
     template class BtreeCursorImpl<V0>;
     template class BtreeCursorImpl<V1>;
+    template class BtreeCursorImpl<V2>;
 
     BtreeCursor* BtreeCursor::make(
         NamespaceDetails *_d, const IndexDetails& _id,
@@ -208,6 +202,9 @@ namespace mongo {
         
         if( v == 1 ) 
             return new BtreeCursorImpl<V1>( nsd , idxNo , indexDetails );
+
+        if( v == 2 ) 
+            return new BtreeCursorImpl<V2>( nsd , idxNo , indexDetails );
         
         if( v == 0 ) 
             return new BtreeCursorImpl<V0>( nsd , idxNo , indexDetails );
@@ -361,6 +358,11 @@ namespace mongo {
         
         bucket = _advance(bucket, keyOfs, _direction, "BtreeCursor::advance");
         
+        checkMoved();
+        return ok();
+    }
+
+    void BtreeCursor::checkMoved() {
         if ( !_independentFieldRanges ) {
             skipUnusedKeys();
             checkEnd();
@@ -371,6 +373,40 @@ namespace mongo {
         else {
             skipAndCheck();
         }
+    }
+
+    bool BtreeCursor::skipToLoc( const DiskLoc &loc ) {
+        if ( bucket.isNull() )
+            return false;
+        if ( currLoc().compare( loc ) * _direction >= 0 )
+            return true;
+
+        BSONObj key = currKey().getOwned();
+        bucket = _locate( key, loc );
+
+        checkMoved();
+        return ok();
+    }
+
+    bool BtreeCursor::advancePastPrefix( int prefixLen ) {
+        killCurrentOp.checkForInterrupt();
+        if ( bucket.isNull() )
+            return false;
+
+        BSONObj key = currKey().getOwned();
+        verify( prefixLen > 0 && prefixLen <= key.nFields() );
+        // Only the prefix is compared when skipping past it, but the end key vectors must still
+        // have an entry for each field.
+        vector<BSONElement> elements;
+        key.elems( elements );
+        vector<const BSONElement *> keyEnd;
+        for( vector<BSONElement>::const_iterator i = elements.begin(); i != elements.end(); ++i ) {
+            keyEnd.push_back( &*i );
+        }
+        vector<bool> keyEndInclusive( elements.size(), true );
+        advanceTo( key, prefixLen, true, keyEnd, keyEndInclusive );
+
+        checkMoved();
         return ok();
     }
 
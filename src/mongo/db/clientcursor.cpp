@@ -34,6 +34,7 @@
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/db/scanandorder.h"
 #include "pagefault.h"
+#include "ops/query.h"
 
 namespace mongo {
 
@@ -422,13 +423,17 @@ namespace mongo {
         return b.obj();
     }
     
-    void ClientCursor::fillQueryResultFromObj( BufBuilder &b ) const {
+    void ClientCursor::fillQueryResultFromObj( BufBuilder &b, GatheredReply *gathered ) const {
         const Projection::KeyOnly *keyFieldsOnly = c()->keyFieldsOnly();
         if ( keyFieldsOnly ) {
             mongo::fillQueryResultFromObj( b, 0, keyFieldsOnly->hydrate( c()->currKey() ) );
         }
         else {
             DiskLoc loc = c()->currLoc();
+            if ( gathered && !fields && !( pq && pq->showDiskLoc() ) &&
+                 gathered->reference( b.len(), c()->current(), loc ) ) {
+                return;
+            }
             mongo::fillQueryResultFromObj( b, fields.get(), c()->current(),
                                           ( ( pq && pq->showDiskLoc() ) ? &loc : 0 ) );
         }
@@ -477,8 +482,12 @@ namespace mongo {
             return 0;
         }
         else if ( need == MaybeCovered ) {
-            // TODO
-            return 0;
+            // The record is needed unless the matcher can decide from the index key alone.
+            CoveredIndexMatcher *matcher = c()->matcher();
+            if ( !c()->indexKeyPattern().isEmpty() && !c()->isMultiKey() &&
+                 ( !matcher || !matcher->needRecord() ) ) {
+                return 0;
+            }
         }
         else if ( need == WillNeed ) {
             // no-op
@@ -499,7 +508,8 @@ namespace mongo {
         return rec;
     }
 
-    bool ClientCursor::yieldSometimes( RecordNeeds need, bool *yielded ) {
+    bool ClientCursor::yieldSometimes( RecordNeeds need, bool *yielded,
+                                      const boost::function<void()> &beforeYield ) {
         if ( yielded ) {
             *yielded = false;   
         }
@@ -510,6 +520,9 @@ namespace mongo {
                 if ( yielded ) {
                     *yielded = true;   
                 }
+                if ( beforeYield ) {
+                    beforeYield();
+                }
                 return yield( suggestYieldMicros() , rec );
             }
             return true;
@@ -520,6 +533,9 @@ namespace mongo {
             if ( yielded ) {
                 *yielded = true;   
             }
+            if ( beforeYield ) {
+                beforeYield();
+            }
             return yield( micros , _recordForYield( need ) );
         }
         return true;
@@ -46,6 +46,7 @@ namespace mongo {
     static const CursorId INVALID_CURSOR_ID = -1; // But see SERVER-5726.
     class Cursor; /* internal server cursor base class */
     class ClientCursor;
+    class GatheredReply;
     class ParsedQuery;
 
     struct ByLocKey {
@@ -214,9 +215,11 @@ namespace mongo {
          * @param needRecord whether or not the next record has to be read from disk for sure
          *                   if this is true, will yield of next record isn't in memory
          * @param yielded true if a yield occurred, and potentially if a yield did not occur
+         * @param beforeYield called just before the lock is released, if it is
          * @return same as yield()
          */
-        bool yieldSometimes( RecordNeeds need, bool *yielded = 0 );
+        bool yieldSometimes( RecordNeeds need, bool *yielded = 0,
+                             const boost::function<void()> &beforeYield = boost::function<void()>() );
 
         static int suggestYieldMicros();
         static void staticYield( int micros , const StringData& ns , Record * rec );
@@ -287,7 +290,11 @@ namespace mongo {
         */
         BSONObj extractFields(const BSONObj &pattern , bool fillWithNull = false) ;
         
-        void fillQueryResultFromObj( BufBuilder &b ) const;
+        /**
+         * Append the current document to a reply, projected as the query asks.
+         * @param gathered if set, a whole document may be left in place in it instead.
+         */
+        void fillQueryResultFromObj( BufBuilder &b, GatheredReply *gathered = 0 ) const;
         
         bool currentIsDup() { return _c->getsetdup( _c->currLoc() ); }
 
@@ -83,8 +83,9 @@ namespace mongo {
             if ( e.eoo() )
                 break;
 
-            // for now, skip the "v" field so that v:0 indexes will be upgraded to v:1
-            if ( string("v") == e.fieldName() ) {
+            // for now, skip the "v" field so that v:0 indexes will be upgraded to v:1.  v:2
+            // (prefix compressed) indexes are kept as they are.
+            if ( string("v") == e.fieldName() && e.numberInt() != 2 ) {
                 continue;
             }
 
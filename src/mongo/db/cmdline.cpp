@@ -70,7 +70,12 @@ namespace mongo {
         ("port", po::value<int>(&cmdLine.port), portInfoBuilder.str().c_str())
         ("bind_ip", po::value<string>(&cmdLine.bind_ip), "comma separated list of ip addresses to listen on - all local ips by default")
         ("maxConns",po::value<int>(), maxConnInfoBuilder.str().c_str())
+#ifdef __linux__
+        ("netModel", po::value<string>(), "how connections are serviced: 'thread' (a thread each, default) or 'event' (one epoll thread and a pool of workers)")
+        ("netWorkers", po::value<int>(&cmdLine.netWorkers), "number of worker threads for --netModel event (default 64)")
+#endif
         ("objcheck", "inspect client data for validity on receipt")
+        ("networkCompression", "compress messages with snappy on connections to and from servers that also use networkCompression")
         ("logpath", po::value<string>() , "log file to send write to instead of stdout - has to be a file, not directory" )
         ("logappend" , "append to logpath instead of over-writing" )
         ("pidfilepath", po::value<string>(), "full path to pidfile (if not set, no pidfile is created)")
@@ -259,10 +264,30 @@ namespace mongo {
             connTicketHolder.resize( newSize );
         }
 
+        if ( params.count( "netModel" ) ) {
+            string model = params["netModel"].as<string>();
+            if ( model == "event" ) {
+                cmdLine.netModelEvent = true;
+            }
+            else if ( model != "thread" ) {
+                out() << "netModel must be 'thread' or 'event'" << endl;
+                ::_exit( EXIT_BADOPTIONS );
+            }
+        }
+
+        if ( cmdLine.netWorkers < 1 ) {
+            out() << "netWorkers has to be at least 1" << endl;
+            ::_exit( EXIT_BADOPTIONS );
+        }
+
         if (params.count("objcheck")) {
             cmdLine.objcheck = true;
         }
 
+        if (params.count("networkCompression")) {
+            cmdLine.networkCompression = true;
+        }
+
         if (params.count("bind_ip")) {
             // passing in wildcard is the same as default behavior; remove and warn
             if ( cmdLine.bind_ip ==  "0.0.0.0" ) {
@@ -55,6 +55,8 @@ namespace mongo {
         bool isDefaultPort() const { return port == DefaultDBPort; }
 
         string bind_ip;        // --bind_ip
+        bool netModelEvent;    // --netModel event: epoll loop and worker pool instead of a thread per connection
+        int netWorkers;        // --netWorkers worker threads for --netModel event
         bool rest;             // --rest
         bool jsonp;            // --jsonp
 
@@ -83,6 +85,8 @@ namespace mongo {
         bool quota;            // --quota
         int quotaFiles;        // --quotaFiles
         bool cpu;              // --cpu show cpu time periodically
+        int indexBuildThreads; // --indexBuildThreads threads extracting and sorting keys for foreground index builds, 0 = by core count
+        int replWriterThreads; // --replWriterThreads threads applying (and as many prefetching) replicated ops, 0 = by core count
 
         bool dur;                       // --dur durability (now --journal)
         unsigned journalCommitInterval; // group/batch commit interval ms
@@ -102,11 +106,17 @@ namespace mongo {
         int durOptions;          // --durOptions <n> for debugging
 
         bool objcheck;         // --objcheck
+        bool networkCompression; // --networkCompression
 
         long long oplogSize;   // --oplogSize
         int defaultProfile;    // --profile
         int slowMS;            // --time in ms that is "slow"
         int defaultLocalThresholdMillis;    // --localThreshold in ms to consider a node local
+        int shardReadAhead;    // --shardReadAhead getMore batches to keep in flight per shard cursor, 0 = off
+        bool aggregationShardMerge; // mongos: a sharded pipeline's leading $group is finished on the shards
+        int queryCacheWriteLimit; // writes to a collection after which its unpinned cached plans are dropped, 0 = never
+        int zeroCopyReplyMinBytes; // getMore replies send documents this large from the data files, under the read lock, 0 = never
+        bool releaseConnectionsAfterResponse; // mongos: shard connections go back to the shared pool after each request
         int pretouch;          // --pretouch for replication application (experimental)
         bool moveParanoia;     // for move chunk paranoia
         double syncdelay;      // seconds between fsyncs
@@ -132,6 +142,10 @@ namespace mongo {
         
         static void launchOk();
 
+        enum { MaxShardReadAhead = 16 };
+        /** @return true if n is an allowed shardReadAhead, for both --shardReadAhead and setParameter */
+        static bool shardReadAheadOk( int n ) { return n >= 0 && n <= MaxShardReadAhead; }
+
         static void addGlobalOptions( boost::program_options::options_description& general ,
                                       boost::program_options::options_description& hidden );
 
@@ -154,11 +168,12 @@ namespace mongo {
 
     // todo move to cmdline.cpp?
     inline CmdLine::CmdLine() :
-        port(DefaultDBPort), rest(false), jsonp(false), quiet(false),
+        port(DefaultDBPort), netModelEvent(false), netWorkers(64),
+        rest(false), jsonp(false), quiet(false),
         noTableScan(false), prealloc(true), preallocj(true), smallfiles(sizeof(int*) == 4),
-        configsvr(false), quota(false), quotaFiles(8), cpu(false),
-        durOptions(0), objcheck(false), oplogSize(0), defaultProfile(0),
-        slowMS(100), defaultLocalThresholdMillis(10), pretouch(0), moveParanoia( true ),
+        configsvr(false), quota(false), quotaFiles(8), cpu(false), indexBuildThreads(0), replWriterThreads(0),
+        durOptions(0), objcheck(false), networkCompression(false), oplogSize(0), defaultProfile(0),
+        slowMS(100), defaultLocalThresholdMillis(10), shardReadAhead(0), aggregationShardMerge(false), queryCacheWriteLimit(100), zeroCopyReplyMinBytes(0), releaseConnectionsAfterResponse(false), pretouch(0), moveParanoia( true ),
         syncdelay(60), noUnixSocket(false), doFork(0), socket("/tmp") 
     {
         started = time(0);
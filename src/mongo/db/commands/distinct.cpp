@@ -18,7 +18,9 @@
 //#include "pch.h"
 #include "../commands.h"
 #include "../instance.h"
+#include "../btree.h"
 #include "../clientcursor.h"
+#include "../queryutil.h"
 #include "../../util/timer.h"
 
 namespace mongo {
@@ -61,9 +63,22 @@ namespace mongo {
                 return true;
             }
 
+            // Asking for just the key lets a plan whose index has the key take it from there.
+            BSONObj keyFields = key == "_id" ? BSON( "_id" << 1 ) : BSON( key << 1 << "_id" << 0 );
+
             shared_ptr<Cursor> cursor;
-            if ( ! query.isEmpty() ) {
-                cursor = NamespaceDetailsTransient::getCursor(ns.c_str() , query , BSONObj() );
+            // An index led by the key keeps the entries for each value together, so once a value
+            // is found the rest of its entries are skipped.
+            BtreeCursor *distinctCursor = distinctIndexCursor( ns, d, key, query );
+            if ( distinctCursor ) {
+                cursor.reset( distinctCursor );
+            }
+            else if ( ! query.isEmpty() ) {
+                shared_ptr<const ParsedQuery> pq( new ParsedQuery( ns.c_str(), 0, 0, 0, query,
+                                                                  keyFields ) );
+                cursor = NamespaceDetailsTransient::getCursor( ns.c_str(), query, BSONObj(),
+                                                              QueryPlanSelectionPolicy::any(), 0,
+                                                              pq );
             }
             else {
 
@@ -99,13 +114,29 @@ namespace mongo {
             while ( cursor->ok() ) {
                 nscanned++;
                 bool loadedRecord = false;
+                bool skipValue = false;
 
                 if ( cursor->currentMatches( &md ) && !cursor->getsetdup( cursor->currLoc() ) ) {
                     n++;
 
                     BSONObj holder;
                     BSONElementSet temp;
-                    loadedRecord = ! cc->getFieldsDotted( key , temp, holder );
+                    const Projection::KeyOnly *keyFieldsOnly = cursor->keyFieldsOnly();
+                    if ( distinctCursor ) {
+                        holder = cursor->currKey();
+                        temp.insert( holder.firstElement() );
+                    }
+                    else if ( keyFieldsOnly ) {
+                        holder = keyFieldsOnly->hydrate( cursor->currKey() );
+                        holder.getFieldsDotted( key, temp );
+                    }
+                    // A null key may be a missing field, which has no value.
+                    if ( temp.empty() || temp.begin()->isNull() ) {
+                        temp.clear();
+                        loadedRecord = ! cc->getFieldsDotted( key , temp, holder );
+                    }
+                    // A missing field doesn't have the value of the null entries that follow.
+                    skipValue = distinctCursor && ! temp.empty();
 
                     for ( BSONElementSet::iterator i=temp.begin(); i!=temp.end(); ++i ) {
                         BSONElement e = *i;
@@ -126,9 +157,13 @@ namespace mongo {
                 if ( loadedRecord || md.hasLoadedRecord() )
                     nscannedObjects++;
 
-                cursor->advance();
+                if ( skipValue )
+                    distinctCursor->advancePastPrefix( 1 );
+                else
+                    cursor->advance();
 
-                if (!cc->yieldSometimes( ClientCursor::MaybeCovered )) {
+                if (!cc->yieldSometimes( loadedRecord ? ClientCursor::WillNeed :
+                                         ClientCursor::MaybeCovered )) {
                     cc.release();
                     break;
                 }
@@ -153,6 +188,49 @@ namespace mongo {
             return true;
         }
 
+    private:
+        /** @return true if each field of 'query' is a field of 'keyPattern'. */
+        static bool queryFieldsInIndex( const BSONObj &query, const BSONObj &keyPattern ) {
+            BSONObjIterator i( query );
+            while ( i.more() ) {
+                BSONElement e = i.next();
+                // $or, $where and the like may need fields the index doesn't have
+                if ( e.fieldName()[ 0 ] == '$' || ! keyPattern.hasField( e.fieldName() ) )
+                    return false;
+            }
+            return true;
+        }
+
+        /**
+         * @return a cursor over a non multikey btree index whose first field is 'key', bounded
+         * and matched by 'query', or 0 if there is none.  With a query that doesn't bound the
+         * key, or that has fields outside the index, the query optimizer's choice of index is
+         * used instead: another index may bound the query much more tightly.
+         */
+        static BtreeCursor *distinctIndexCursor( const string &ns, NamespaceDetails *d,
+                                                 const string &key, const BSONObj &query ) {
+            FieldRangeSet frs( ns.c_str(), query, true, true );
+            if ( ! query.isEmpty() && frs.range( key.c_str() ).universal() )
+                return 0;
+            NamespaceDetails::IndexIterator i = d->ii();
+            while ( i.more() ) {
+                int idxNo = i.pos();
+                IndexDetails &idx = i.next();
+                if ( d->isMultikey( idxNo ) || idx.getSpec().getType() ||
+                     ! str::equals( idx.keyPattern().firstElementFieldName(), key.c_str() ) ||
+                     ! queryFieldsInIndex( query, idx.keyPattern() ) )
+                    continue;
+                shared_ptr<FieldRangeVector> frv( new FieldRangeVector( frs, idx.getSpec(), 1 ) );
+                BtreeCursor *cursor = BtreeCursor::make( d, idxNo, idx, frv, 0, 1 );
+                if ( ! query.isEmpty() ) {
+                    cursor->setMatcher( shared_ptr<CoveredIndexMatcher>
+                                       ( new CoveredIndexMatcher( query, idx.keyPattern() ) ) );
+                }
+                return cursor;
+            }
+            return 0;
+        }
+
     } distinctCmd;
 
 }
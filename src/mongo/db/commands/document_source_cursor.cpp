@@ -35,6 +35,35 @@ namespace mongo {
         pCursor.reset();
     }
 
+    void DocumentSourceCursor::prepareToYield() {
+        /* nothing to do if the cursor was released */
+        if (!pClientCursor)
+            return;
+
+        /* as for a query's ClientCursor at the end of a batch */
+        if (pCursor->supportYields())
+            verify(pClientCursor->prepareToYield(yieldData));
+        else
+            pCursor->noteLocation();
+    }
+
+    void DocumentSourceCursor::recoverFromYield() {
+        if (!pClientCursor)
+            return;
+
+        if (pCursor->supportYields()) {
+            if (!ClientCursor::recoverFromYield(yieldData)) {
+                /* the ClientCursor is gone already */
+                pClientCursor.release();
+                pCursor.reset();
+                uasserted(16411,
+                    "collection or database disappeared while the aggregation cursor was idle");
+            }
+        }
+        else
+            pCursor->checkLocation();
+    }
+
     bool DocumentSourceCursor::eof() {
         /* if we haven't gotten the first one yet, do so now */
         if (!pCurrent.get())
@@ -65,12 +94,12 @@ namespace mongo {
     void DocumentSourceCursor::advanceAndYield() {
         pCursor->advance();
         /*
-          TODO ask for index key pattern in order to determine which index
-          was used for this particular document; that will allow us to
-          sometimes use ClientCursor::MaybeCovered.
-          See https://jira.mongodb.org/browse/SERVER-5224 .
+          If the next document can be made without its record, the record
+          is only needed if the matcher can't decide using the index key.
         */
-        bool cursorOk = pClientCursor->yieldSometimes(ClientCursor::WillNeed);
+        bool cursorOk = pClientCursor->yieldSometimes(
+            (pCursor->ok() && !needRecord()) ?
+            ClientCursor::MaybeCovered : ClientCursor::WillNeed);
         if (!cursorOk) {
             uassert(16028,
                     "collection or database disappeared when cursor yielded",
@@ -78,16 +107,47 @@ namespace mongo {
         }
     }
 
+    bool DocumentSourceCursor::needRecord() {
+        /* if the fields used aren't known, it's all needed */
+        if (!pProjection)
+            return true;
+
+        /* if no fields are used, the documents are empty */
+        if (pProjection->isEmpty())
+            return false;
+
+        /*
+          A missing field has a null key, and would come out as a null
+          field, so null keys need the record to tell the two apart.
+        */
+        if (!pCursor->keyFieldsOnly())
+            return true;
+        BSONObjIterator keyIterator(pCursor->currKey());
+        while(keyIterator.more()) {
+            if (keyIterator.next().isNull())
+                return true;
+        }
+        return false;
+    }
+
     void DocumentSourceCursor::findNext() {
         /* standard cursor usage pattern */
-        while(pCursor->ok()) {
+        while(pCursor && pCursor->ok()) {
             CoveredIndexMatcher *pCIM; // save intermediate result
             if ((!(pCIM = pCursor->matcher()) ||
                  pCIM->matchesCurrent(pCursor.get())) &&
                 !pCursor->getsetdup(pCursor->currLoc())) {
 
-                /* grab the matching document */
-                BSONObj documentObj(pCursor->current());
+                /*
+                  grab the matching document; if the pipeline's fields are
+                  all in the index key, make it from that
+                */
+                BSONObj documentObj;
+                if (needRecord())
+                    documentObj = pCursor->current();
+                else if (!pProjection->isEmpty())
+                    documentObj = pCursor->keyFieldsOnly()->hydrate(
+                        pCursor->currKey());
                 pCurrent = Document::createFromBsonObj(
                     &documentObj, NULL /* LATER pDependencies.get()*/);
                 advanceAndYield();
@@ -130,7 +190,9 @@ namespace mongo {
             Query query(queryBuilder.obj());
 
             DBDirectClient directClient;
-            BSONObj explainResult(directClient.findOne(ns, query));
+            BSONObj explainResult(directClient.findOne(ns, query,
+                (pProjection && !pProjection->isEmpty()) ?
+                pProjection.get() : NULL));
 
             pBuilder->append("cursor", explainResult);
         }
@@ -172,6 +234,11 @@ namespace mongo {
         pSort = pBsonObj;
     }
 
+    void DocumentSourceCursor::setProjection(
+        const shared_ptr<BSONObj> &pBsonObj) {
+        pProjection = pBsonObj;
+    }
+
     void DocumentSourceCursor::addBsonDependency(
         const shared_ptr<BSONObj> &pBsonObj) {
         bsonDependencies.push_back(pBsonObj);
@@ -33,6 +33,15 @@ namespace mongo {
     const char Pipeline::pipelineName[] = "pipeline";
     const char Pipeline::explainName[] = "explain";
     const char Pipeline::fromRouterName[] = "fromRouter";
+    const char Pipeline::allowDiskUseName[] = "allowDiskUse";
+    const char Pipeline::cursorName[] = "cursor";
+    const char Pipeline::batchSizeName[] = "batchSize";
+    const char Pipeline::cursorIdName[] = "id";
+    const char Pipeline::cursorNsName[] = "ns";
+    const char Pipeline::firstBatchName[] = "firstBatch";
+    const char Pipeline::mergeInputName[] = "mergeInput";
+    const char Pipeline::mergePartitionsName[] = "mergePartitions";
+    const char Pipeline::partitionsName[] = "partitions";
     const char Pipeline::splitMongodPipelineName[] = "splitMongodPipeline";
     const char Pipeline::serverPipelineName[] = "serverPipeline";
     const char Pipeline::mongosPipelineName[] = "mongosPipeline";
@@ -44,6 +53,10 @@ namespace mongo {
         collectionName(),
         sourceVector(),
         explain(false),
+        cursor(false),
+        batchSize(101),
+        mergeInput(),
+        mergePartitions(0),
         splitMongodPipeline(false),
         pCtx(pTheCtx) {
     }
@@ -68,10 +81,8 @@ namespace mongo {
          DocumentSourceLimit::createFromBson},
         {DocumentSourceMatch::matchName,
          DocumentSourceMatch::createFromBson},
-#ifdef LATER /* https://jira.mongodb.org/browse/SERVER-3253 */
         {DocumentSourceOut::outName,
          DocumentSourceOut::createFromBson},
-#endif
         {DocumentSourceProject::projectName,
          DocumentSourceProject::createFromBson},
         {DocumentSourceSkip::skipName,
@@ -124,6 +135,58 @@ namespace mongo {
                 continue;
             }
 
+            /* may $sort and $group spill to disk? */
+            if (!strcmp(pFieldName, allowDiskUseName)) {
+                pCtx->setAllowDiskUse(cmdElement.trueValue());
+                continue;
+            }
+
+            /* should the result come back through a cursor? */
+            if (!strcmp(pFieldName, cursorName)) {
+                uassert(16409, str::stream() << "the " << cursorName <<
+                        " option must be an object",
+                        cmdElement.type() == Object);
+                pPipeline->cursor = true;
+
+                BSONElement batchSizeElement(
+                    cmdElement.Obj()[batchSizeName]);
+                if (!batchSizeElement.eoo()) {
+                    uassert(16410, str::stream() << batchSizeName <<
+                            " must be a non-negative number",
+                            batchSizeElement.isNumber() &&
+                            batchSizeElement.numberLong() >= 0);
+                    pPipeline->batchSize = batchSizeElement.numberLong();
+                }
+                continue;
+            }
+
+            /*
+              A merge sent by mongos carries the partial results to merge,
+              and merges them as mongos would have.
+            */
+            if (!strcmp(pFieldName, mergeInputName)) {
+                uassert(16421, str::stream() << "the " << mergeInputName <<
+                        " option must be an array",
+                        cmdElement.type() == Array);
+                pPipeline->mergeInput = cmdElement;
+                pCtx->setInRouter(true);
+                continue;
+            }
+
+            /*
+              mongos asks for the partial groups to be split up by the hash
+              of their _id when it will have them merged on the shards.
+            */
+            if (!strcmp(pFieldName, mergePartitionsName)) {
+                uassert(16429, str::stream() << "the " <<
+                        mergePartitionsName <<
+                        " option must be a positive number",
+                        cmdElement.isNumber() &&
+                        (cmdElement.numberInt() > 0));
+                pPipeline->mergePartitions = cmdElement.numberInt();
+                continue;
+            }
+
             /* check for debug options */
             if (!strcmp(pFieldName, splitMongodPipelineName)) {
                 pPipeline->splitMongodPipeline = true;
@@ -191,6 +254,18 @@ namespace mongo {
         if (!pSourceVector->size())
             return pPipeline;
 
+        /* the output is written once everything else is done */
+        for(size_t srcn = pSourceVector->size(), srci = 0;
+            srci < srcn - 1; ++srci) {
+            uassert(16414, str::stream() << DocumentSourceOut::outName <<
+                    " can only be the final stage in the pipeline",
+                    !dynamic_cast<DocumentSourceOut *>(
+                        pSourceVector->at(srci).get()));
+        }
+        uassert(16415, str::stream() << DocumentSourceOut::outName <<
+                " can't be used with the " << cursorName << " option",
+                !(pPipeline->cursor && pPipeline->getOutput()));
+
         /*
           Move filters up where possible.
 
@@ -317,6 +392,38 @@ namespace mongo {
         return pShardPipeline;
     }
 
+    bool Pipeline::startsWithGroup() const {
+        return !sourceVector.empty() &&
+            dynamic_cast<DocumentSourceGroup *>(sourceVector.front().get());
+    }
+
+    intrusive_ptr<Pipeline> Pipeline::splitForShardMerge() {
+        if (!startsWithGroup())
+            return intrusive_ptr<Pipeline>();
+
+        /*
+          The shards are to produce finished groups, so the merge mustn't
+          be sent as coming from the router; that would make them partial.
+         */
+        intrusive_ptr<ExpressionContext> pMergeCtx(pCtx->clone());
+        pMergeCtx->setInRouter(false);
+        pMergeCtx->setInShard(false);
+
+        intrusive_ptr<Pipeline> pMergePipeline(new Pipeline(pMergeCtx));
+        pMergePipeline->collectionName = collectionName;
+        pMergePipeline->sourceVector.push_back(sourceVector.front());
+        sourceVector.erase(sourceVector.begin());
+
+        return pMergePipeline;
+    }
+
+    intrusive_ptr<DocumentSourceOut> Pipeline::getOutput() const {
+        if (sourceVector.empty())
+            return intrusive_ptr<DocumentSourceOut>();
+
+        return dynamic_cast<DocumentSourceOut *>(sourceVector.back().get());
+    }
+
     bool Pipeline::getInitialQuery(BSONObjBuilder *pQueryBuilder) const
     {
         if (!sourceVector.size())
@@ -361,10 +468,14 @@ namespace mongo {
         if ((btemp = pCtx->getInRouter())) {
             pBuilder->append(fromRouterName, btemp);
         }
+
+        if ((btemp = pCtx->getAllowDiskUse())) {
+            pBuilder->append(allowDiskUseName, btemp);
+        }
     }
 
-    bool Pipeline::run(BSONObjBuilder &result, string &errmsg,
-                       const intrusive_ptr<DocumentSource> &pInputSource) {
+    intrusive_ptr<DocumentSource> Pipeline::connectSources(
+        const intrusive_ptr<DocumentSource> &pInputSource) {
         /*
           Analyze dependency information.
 
@@ -382,14 +493,21 @@ namespace mongo {
         pInputSource->manageDependencies(pTracker);
         
         /* chain together the sources we found */
-        DocumentSource *pSource = pInputSource.get();
+        intrusive_ptr<DocumentSource> pSource(pInputSource);
         for(SourceVector::iterator iter(sourceVector.begin()),
                 listEnd(sourceVector.end()); iter != listEnd; ++iter) {
             intrusive_ptr<DocumentSource> pTemp(*iter);
-            pTemp->setSource(pSource);
-            pSource = pTemp.get();
+            pTemp->setSource(pSource.get());
+            pSource = pTemp;
         }
-        /* pSource is left pointing at the last source in the chain */
+
+        return pSource;
+    }
+
+    bool Pipeline::run(BSONObjBuilder &result, string &errmsg,
+                       const intrusive_ptr<DocumentSource> &pInputSource) {
+        /* pSource is the last source in the chain */
+        intrusive_ptr<DocumentSource> pSource(connectSources(pInputSource));
 
         /*
           Iterate through the resulting documents, and add them to the result.
@@ -408,6 +526,32 @@ namespace mongo {
                     writeExplainMongos(result, pInputSource);
                 }
             }
+            else if (mergePartitions) {
+                /* the same hash the merging $group uses for its _ids */
+                vector<boost::shared_ptr<BSONArrayBuilder> > partitions;
+                for(int i = 0; i < mergePartitions; ++i)
+                    partitions.push_back(boost::shared_ptr<BSONArrayBuilder>(
+                                             new BSONArrayBuilder()));
+                for(bool hasDocument = !pSource->eof(); hasDocument;
+                    hasDocument = pSource->advance()) {
+                    intrusive_ptr<Document> pDocument(pSource->getCurrent());
+                    intrusive_ptr<const Value> pId(
+                        pDocument->getValue(Document::idName));
+                    if (!pId.get() || (pId->getType() == Undefined))
+                        pId = Value::getNull();
+
+                    BSONObjBuilder documentBuilder;
+                    pDocument->toBson(&documentBuilder);
+                    partitions[Value::Hash()(pId) % mergePartitions]->append(
+                        documentBuilder.done());
+                }
+
+                BSONArrayBuilder partitionsArray(
+                    result.subarrayStart(partitionsName));
+                for(int i = 0; i < mergePartitions; ++i)
+                    partitionsArray.append(partitions[i]->arr());
+                partitionsArray.done();
+            }
             else
             {
                 BSONArrayBuilder resultArray; // where we'll stash the results
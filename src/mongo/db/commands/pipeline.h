@@ -27,6 +27,7 @@ namespace mongo {
     class BSONObj;
     class BSONObjBuilder;
     class DocumentSource;
+    class DocumentSourceOut;
     class DocumentSourceProject;
     class Expression;
     class ExpressionContext;
@@ -70,6 +71,27 @@ namespace mongo {
         */
         intrusive_ptr<Pipeline> splitForSharded();
 
+        /**
+          @returns true if the first stage of the pipeline is a $group
+         */
+        bool startsWithGroup() const;
+
+        /**
+          If the merging Pipeline obtained from splitForSharded() starts
+          with a $group, take that $group off into a Pipeline of its own.
+          That can then be sent to shards along with a partition of the
+          partial groups, to do that part of the merge there.  The result
+          is sent to the shards with toBson(), with the partition added as
+          the mergeInputName array.
+
+          This permanently alters this pipeline, which is left with the
+          rest of the merging operation.
+
+          @returns the $group Pipeline, or a NULL reference if this doesn't
+            start with a $group
+        */
+        intrusive_ptr<Pipeline> splitForShardMerge();
+
         /**
            If the pipeline starts with a $match, dump its BSON predicate
            specification to the supplied builder and return true.
@@ -80,6 +102,13 @@ namespace mongo {
          */
         bool getInitialQuery(BSONObjBuilder *pQueryBuilder) const;
 
+        /**
+           If the pipeline ends with a $out, return it.
+
+           @returns the $out, or a NULL reference if there isn't one
+         */
+        intrusive_ptr<DocumentSourceOut> getOutput() const;
+
         /**
           Write the Pipeline as a BSONObj command.  This should be the
           inverse of parseCommand().
@@ -104,6 +133,19 @@ namespace mongo {
         bool run(BSONObjBuilder &result, string &errmsg,
                  const intrusive_ptr<DocumentSource> &pSource);
 
+        /**
+          Analyze the dependencies of the pipeline's sources, and chain
+          them together behind the given source, ready to be iterated.
+          run() does this first.
+
+          @param pInputSource the document source to use at the head of the
+            chain
+          @returns the last source in the chain, whose output is the
+            pipeline's result
+        */
+        intrusive_ptr<DocumentSource> connectSources(
+            const intrusive_ptr<DocumentSource> &pInputSource);
+
         /**
           Debugging:  should the processing pipeline be split within
           mongod, simulating the real mongos/mongod split?  This is determined
@@ -124,11 +166,67 @@ namespace mongo {
          */
         bool isExplain() const;
 
+        /**
+          Ask if this is a merge sent by mongos, to be run over documents
+          in the command rather than over the collection.
+
+          @returns true if this is a merge
+         */
+        bool isMerge() const;
+
+        /**
+          For a merge, get the array of documents to run over.  This
+          refers to the command object the pipeline was parsed from.
+
+          @returns the mergeInputName array element
+         */
+        BSONElement getMergeInput() const;
+
+        /**
+          Ask if the result should be returned through a cursor, rather than
+          as one array.  This is determined by the cursor field of the
+          "aggregate" command, as in { cursor : { batchSize : n } }.
+
+          Only mongod keeps such a cursor open; mongos returns all of the
+          result in the first batch.
+
+          @returns true if the result is to be returned through a cursor
+         */
+        bool isCursorCommand() const;
+
+        /**
+          @returns the number of documents to return in the first batch of
+            a cursor result
+         */
+        long long getBatchSize() const;
+
         /**
           The aggregation command name.
          */
         static const char commandName[];
 
+        /**
+          Names used in the reply to a cursor command.
+         */
+        static const char cursorName[];
+        static const char cursorIdName[];
+        static const char cursorNsName[];
+        static const char firstBatchName[];
+
+        /**
+          The field of a merge command holding the documents to merge.
+         */
+        static const char mergeInputName[];
+
+        /**
+          The field of a sharded command asking for the results to be
+          split up by a hash of their _id, for a merge on the shards; the
+          reply then has the partitionsName array of arrays in place of
+          the result array.
+         */
+        static const char mergePartitionsName[];
+        static const char partitionsName[];
+
         /*
           PipelineD is a "sister" class that has additional functionality
           for the Pipeline.  It exists because of linkage requirements.
@@ -144,6 +242,8 @@ namespace mongo {
         static const char pipelineName[];
         static const char explainName[];
         static const char fromRouterName[];
+        static const char allowDiskUseName[];
+        static const char batchSizeName[];
         static const char splitMongodPipelineName[];
         static const char serverPipelineName[];
         static const char mongosPipelineName[];
@@ -194,6 +294,10 @@ namespace mongo {
         typedef vector<intrusive_ptr<DocumentSource> > SourceVector;
         SourceVector sourceVector;
         bool explain;
+        bool cursor;
+        long long batchSize;
+        BSONElement mergeInput;
+        int mergePartitions;
 
         bool splitMongodPipeline;
         intrusive_ptr<ExpressionContext> pCtx;
@@ -221,6 +325,22 @@ namespace mongo {
         return explain;
     }
 
+    inline bool Pipeline::isMerge() const {
+        return !mergeInput.eoo();
+    }
+
+    inline BSONElement Pipeline::getMergeInput() const {
+        return mergeInput;
+    }
+
+    inline bool Pipeline::isCursorCommand() const {
+        return cursor;
+    }
+
+    inline long long Pipeline::getBatchSize() const {
+        return batchSize;
+    }
+
 } // namespace mongo
 
 
@@ -18,7 +18,10 @@
 
 #include "db/commands/pipeline.h"
 #include "db/commands/pipeline_d.h"
+#include "db/clientcursor.h"
 #include "db/cursor.h"
+#include "db/dur.h"
+#include "db/instance.h"
 #include "db/interrupt_status_mongod.h"
 #include "db/pdfile.h"
 #include "db/pipeline/accumulator.h"
@@ -26,9 +29,64 @@
 #include "db/pipeline/document_source.h"
 #include "db/pipeline/expression.h"
 #include "db/pipeline/expression_context.h"
+#include "db/queryutil.h"
+#include "db/replutil.h"
 
 namespace mongo {
 
+    /*
+      Presents the output of a pipeline as a Cursor, so that a ClientCursor
+      can hold on to the pipeline between the batches of a cursor result,
+      and getMore can pull the rest of them through it.
+
+      The pipeline's own input cursor yields as it goes, so this doesn't.
+      Between batches, it notes and checks the input cursor's location,
+      through the noteLocation() and checkLocation() calls that getMore
+      makes on cursors that don't yield.
+     */
+    class PipelineCursor :
+        public Cursor {
+    public:
+        PipelineCursor(const intrusive_ptr<Pipeline> &pPipeline,
+                       const intrusive_ptr<DocumentSourceCursor> &pInput);
+
+        virtual bool ok() { return !pOutput->eof(); }
+        virtual Record *_current() { verify(false); return 0; }
+        virtual BSONObj current();
+        virtual DiskLoc currLoc() { return DiskLoc(); }
+        virtual DiskLoc refLoc() { return DiskLoc(); }
+        virtual bool advance() { return pOutput->advance(); }
+        virtual bool supportGetMore() { return true; }
+        virtual bool supportYields() { return false; }
+        virtual void noteLocation() { pInput->prepareToYield(); }
+        virtual void checkLocation() { pInput->recoverFromYield(); }
+        virtual bool getsetdup(DiskLoc loc) { return false; }
+        virtual bool isMultiKey() const { return false; }
+        virtual bool modifiedKeys() const { return false; }
+        virtual long long nscanned() { return 0; }
+        virtual string toString() { return "PipelineCursor"; }
+
+    private:
+        /* the pipeline owns all of the sources after the input */
+        intrusive_ptr<Pipeline> pPipeline;
+        intrusive_ptr<DocumentSourceCursor> pInput;
+        intrusive_ptr<DocumentSource> pOutput;
+    };
+
+    PipelineCursor::PipelineCursor(
+        const intrusive_ptr<Pipeline> &pThePipeline,
+        const intrusive_ptr<DocumentSourceCursor> &pTheInput):
+        pPipeline(pThePipeline),
+        pInput(pTheInput),
+        pOutput(pThePipeline->connectSources(pTheInput)) {
+    }
+
+    BSONObj PipelineCursor::current() {
+        BSONObjBuilder documentBuilder;
+        pOutput->getCurrent()->toBson(&documentBuilder);
+        return documentBuilder.obj();
+    }
+
     /** mongodb "commands" (sent via db.$cmd.findOne(...))
         subclass to make a command.  define a singleton object for it.
         */
@@ -107,8 +165,40 @@ namespace mongo {
             const string &ns, const string &db,
             intrusive_ptr<Pipeline> &pPipeline,
             intrusive_ptr<ExpressionContext> &pCtx);
+
+        /*
+          For a cursor command, the first batch is returned in the reply,
+          as { cursor : { id : <cursorid>, ns : <ns>, firstBatch : [...] } },
+          and the pipeline is left in a ClientCursor for getMore to pull
+          the rest from.  The cursor id is zero if there is no more.
+
+          This is called from runExecute(), with the READ lock held.
+         */
+        bool runCursor(
+            BSONObjBuilder &result, const string &ns,
+            intrusive_ptr<Pipeline> &pPipeline,
+            intrusive_ptr<DocumentSourceCursor> &pSource);
+
+        /*
+          For a pipeline that ends with a $out, the lock isn't held for the
+          whole run.  Batches of the result are pulled under a READ lock on
+          the input, and inserted into a temporary collection under a WRITE
+          lock, with the input cursor's position saved in between.  Once
+          the pipeline is exhausted, the temporary collection is renamed
+          over the output collection, which keeps its indexes.
+         */
+        bool runOut(
+            BSONObjBuilder &result, string &errmsg,
+            const string &ns, const string &db,
+            intrusive_ptr<Pipeline> &pPipeline,
+            intrusive_ptr<ExpressionContext> &pCtx);
+
+        /* distinguishes the temporary collections of concurrent $outs */
+        static AtomicUInt outNumber;
     };
 
+    AtomicUInt PipelineCommand::outNumber;
+
     // self-registering singleton static instance
     static PipelineCommand pipelineCommand;
 
@@ -189,9 +279,57 @@ namespace mongo {
 
         intrusive_ptr<DocumentSourceCursor> pSource(
             PipelineD::prepareCursorSource(pPipeline, db, pCtx));
+
+        /* the debugging split always returns the result in one array */
+        if (pPipeline->isCursorCommand() &&
+            !pPipeline->getSplitMongodPipeline())
+            return runCursor(result, ns, pPipeline, pSource);
+
         return executePipeline(result, errmsg, ns, pPipeline, pSource, pCtx);
     }
 
+    bool PipelineCommand::runCursor(
+        BSONObjBuilder &result, const string &ns,
+        intrusive_ptr<Pipeline> &pPipeline,
+        intrusive_ptr<DocumentSourceCursor> &pSource) {
+
+        shared_ptr<Cursor> pCursor(new PipelineCursor(pPipeline, pSource));
+
+        /* this also makes dropping the collection kill the cursor */
+        ClientCursor *pClientCursor = new ClientCursor(0, pCursor, ns);
+        ClientCursor::Holder holder(pClientCursor);
+
+        /* fill the first batch as a query's would be */
+        const long long batchSize = pPipeline->getBatchSize();
+        BSONArrayBuilder firstBatch;
+        for(long long n = 0; (n < batchSize) && pCursor->ok(); ++n) {
+            firstBatch.append(pCursor->current());
+            pCursor->advance();
+
+            if (firstBatch.len() > MaxBytesToReturnToClientAtOnce)
+                break;
+        }
+
+        /*
+          An empty first batch was asked for without running the pipeline,
+          so there may well be more.
+        */
+        CursorId cursorId = 0;
+        if ((batchSize == 0) || pCursor->ok()) {
+            pCursor->noteLocation();
+            cursorId = pClientCursor->cursorid();
+            holder.release();
+        }
+
+        BSONObjBuilder cursorBuilder(result.subobjStart(Pipeline::cursorName));
+        cursorBuilder.append(Pipeline::cursorIdName, cursorId);
+        cursorBuilder.append(Pipeline::cursorNsName, ns);
+        cursorBuilder.append(Pipeline::firstBatchName, firstBatch.arr());
+        cursorBuilder.done();
+
+        return true;
+    }
+
     bool PipelineCommand::executePipeline(
         BSONObjBuilder &result, string &errmsg, const string &ns,
         intrusive_ptr<Pipeline> &pPipeline,
@@ -240,6 +378,8 @@ namespace mongo {
         /* on the shard servers, create the local pipeline */
         intrusive_ptr<ExpressionContext> pShardCtx(
             ExpressionContext::create(&InterruptStatusMongod::status));
+        pShardCtx->setSpillSorterFactory(PipelineD::createSpillSorter,
+                                         PipelineD::spillBytes);
         intrusive_ptr<Pipeline> pShardPipeline(
             Pipeline::parseCommand(errmsg, shardBson, pShardCtx));
         if (!pShardPipeline.get()) {
@@ -283,6 +423,8 @@ namespace mongo {
 
         intrusive_ptr<ExpressionContext> pCtx(
             ExpressionContext::create(&InterruptStatusMongod::status));
+        pCtx->setSpillSorterFactory(PipelineD::createSpillSorter,
+                                    PipelineD::spillBytes);
 
         /* try to parse the command; if this fails, then we didn't run */
         intrusive_ptr<Pipeline> pPipeline(
@@ -292,10 +434,153 @@ namespace mongo {
 
         string ns(parseNs(db, cmdObj));
 
+        /*
+          A merge for mongos doesn't read the collection at all, so it
+          doesn't need a lock.
+        */
+        if (pPipeline->isMerge()) {
+            BSONElement mergeInput(pPipeline->getMergeInput());
+            intrusive_ptr<DocumentSource> pSource(
+                DocumentSourceBsonArray::create(&mergeInput, pCtx));
+            return pPipeline->run(result, errmsg, pSource);
+        }
+
         if (pPipeline->isExplain())
             return runExplain(result, errmsg, ns, db, pPipeline, pCtx);
+        else if (pPipeline->getOutput())
+            return runOut(result, errmsg, ns, db, pPipeline, pCtx);
         else
             return runExecute(result, errmsg, ns, db, pPipeline, pCtx);
     }
 
+    bool PipelineCommand::runOut(
+        BSONObjBuilder &result, string &errmsg,
+        const string &ns, const string &db,
+        intrusive_ptr<Pipeline> &pPipeline,
+        intrusive_ptr<ExpressionContext> &pCtx) {
+
+        uassert(16416, str::stream() << DocumentSourceOut::outName <<
+                " can't be used in a pipeline sent by mongos",
+                !pCtx->getInShard());
+
+        const string outNs(db + "." +
+                           pPipeline->getOutput()->getOutputCollection());
+        const string tempNs(str::stream() << db << ".tmp.agg_out." <<
+                            outNumber++);
+        uassert(16417, str::stream() << "not master, can't write to " <<
+                outNs, isMasterNs(outNs.c_str()));
+
+        DBDirectClient client;
+
+        /* create the temporary collection, with the output's indexes */
+        client.dropCollection(tempNs);
+        {
+            Client::WriteContext ctx(tempNs);
+            string createErrmsg;
+            uassert(16418, str::stream() << "couldn't create " << tempNs <<
+                    ": " << createErrmsg,
+                    userCreateNS(tempNs.c_str(), BSON("temp" << true),
+                                 createErrmsg, true));
+        }
+
+        intrusive_ptr<DocumentSourceCursor> pInput;
+        long long nOut = 0;
+        try {
+            auto_ptr<DBClientCursor> indexes(client.getIndexes(outNs));
+            const string tempIndexesNs(
+                Namespace(tempNs.c_str()).getSisterNS("system.indexes"));
+            while(indexes->more()) {
+                BSONObj index(indexes->next());
+
+                BSONObjBuilder indexBuilder;
+                indexBuilder.append("ns", tempNs);
+                for(BSONObjIterator i(index); i.more(); ) {
+                    BSONElement e(i.next());
+                    if (str::equals(e.fieldName(), "_id") ||
+                        str::equals(e.fieldName(), "ns"))
+                        continue;
+                    indexBuilder.append(e);
+                }
+
+                Client::WriteContext ctx(tempNs);
+                theDataFileMgr.insertAndLog(tempIndexesNs.c_str(),
+                                            indexBuilder.done(), false);
+            }
+
+            intrusive_ptr<DocumentSource> pOutput;
+            vector<BSONObj> batch;
+            for(bool more = true; more; ) {
+                {
+                    scoped_ptr<Lock::GlobalRead> lk;
+                    if (lockGlobally())
+                        lk.reset(new Lock::GlobalRead());
+                    Client::ReadContext ctx(ns, dbpath, requiresAuth());
+
+                    if (!pInput) {
+                        pInput = PipelineD::prepareCursorSource(
+                            pPipeline, db, pCtx);
+                        pOutput = pPipeline->connectSources(pInput);
+                    }
+                    else
+                        pInput->recoverFromYield();
+
+                    size_t batchBytes = 0;
+                    more = !pOutput->eof();
+                    while(more && (batchBytes <
+                                   (size_t)MaxBytesToReturnToClientAtOnce)) {
+                        BSONObjBuilder documentBuilder;
+                        pOutput->getCurrent()->toBson(&documentBuilder);
+                        batch.push_back(documentBuilder.obj());
+                        batchBytes += batch.back().objsize();
+
+                        more = pOutput->advance();
+                    }
+
+                    if (more)
+                        pInput->prepareToYield();
+                    else
+                        pInput->releaseCursor();
+                }
+
+                Client::WriteContext ctx(tempNs);
+                for(vector<BSONObj>::const_iterator i(batch.begin());
+                    i != batch.end(); ++i) {
+                    theDataFileMgr.insertAndLog(tempNs.c_str(), *i, false);
+                    getDur().commitIfNeeded();
+                }
+                nOut += batch.size();
+                batch.clear();
+            }
+
+            /* as for map/reduce, so nobody sees the output missing */
+            Lock::GlobalWrite lk;
+            client.dropCollection(outNs);
+            BSONObj info;
+            uassert(16419, str::stream() << "rename of " << tempNs <<
+                    " to " << outNs << " failed: " << info,
+                    client.runCommand("admin",
+                                      BSON("renameCollection" << tempNs <<
+                                           "to" << outNs <<
+                                           "stayTemp" << false),
+                                      info));
+        }
+        catch(...) {
+            if (pInput)
+                pInput->releaseCursor();
+
+            try {
+                client.dropCollection(tempNs);
+            }
+            catch(std::exception &e) {
+                error() << "couldn't clean up after " <<
+                    DocumentSourceOut::outName << ": " << e.what() << endl;
+            }
+            throw;
+        }
+
+        result.append("outputNs", outNs);
+        result.append("n", nOut);
+        return true;
+    }
+
 } // namespace mongo
@@ -19,11 +19,81 @@
 #include "db/commands/pipeline_d.h"
 
 #include "db/cursor.h"
+#include "db/extsort.h"
+#include "db/pipeline/dependency_tracker.h"
+#include "db/pipeline/document.h"
 #include "db/pipeline/document_source.h"
+#include "db/pipeline/spill_sorter.h"
+#include "db/queryutil.h"
 
 
 namespace mongo {
 
+    namespace {
+        /*
+          Find the fields a pipeline uses from the collection, as a projection
+          for them.
+
+          These are only known if the pipeline begins with sources that pass
+          documents on, such as $sort or $unwind, followed by one that makes
+          new documents from some of their fields alone, such as $project or
+          $group.  If no fields are used, the projection is empty.
+
+          @param sources the pipeline's sources
+          @param pProjection set to the projection
+          @returns whether the fields used are known
+         */
+        bool getProjection(
+            const vector<intrusive_ptr<DocumentSource> > &sources,
+            BSONObj *pProjection) {
+            intrusive_ptr<DependencyTracker> pTracker(new DependencyTracker());
+            vector<intrusive_ptr<DocumentSource> >::const_iterator iter(
+                sources.begin());
+            for(; iter != sources.end(); ++iter) {
+                DocumentSource::GetDepsReturn status =
+                    (*iter)->getDependencies(pTracker);
+                if (status == DocumentSource::NOT_SUPPORTED)
+                    return false;
+                if (status == DocumentSource::EXHAUSTIVE)
+                    break;
+            }
+
+            /* if the documents reach the end of the pipeline, all is needed */
+            if (iter == sources.end())
+                return false;
+
+            set<string> paths;
+            pTracker->getPaths(&paths);
+
+            /* a path within one that is already included adds nothing */
+            vector<string> included;
+            bool includeId = false;
+            for(set<string>::const_iterator i(paths.begin());
+                    i != paths.end(); ++i) {
+                bool within = false;
+                for(size_t j = 0; j < included.size(); ++j) {
+                    if (str::startsWith(*i, included[j] + "."))
+                        within = true;
+                }
+                if (within)
+                    continue;
+
+                included.push_back(*i);
+                if ((*i == Document::idName) ||
+                    str::startsWith(*i, Document::idName + "."))
+                    includeId = true;
+            }
+
+            BSONObjBuilder projectionBuilder;
+            for(size_t j = 0; j < included.size(); ++j)
+                projectionBuilder.append(included[j], 1);
+            if (!includeId && !included.empty())
+                projectionBuilder.append(Document::idName, 0);
+            *pProjection = projectionBuilder.obj();
+            return true;
+        }
+    }
+
     intrusive_ptr<DocumentSourceCursor> PipelineD::prepareCursorSource(
         const intrusive_ptr<Pipeline> &pPipeline,
         const string &dbName,
@@ -79,6 +149,29 @@ namespace mongo {
         /* get the full "namespace" name */
         string fullName(dbName + "." + pPipeline->getCollectionName());
 
+        /*
+          Find the fields the pipeline uses.  When an index has all of them,
+          the query optimizer will note that the documents can be made from
+          its keys, so the records needn't be read at all.
+
+          The ParsedQuery that carries the projection to the query optimizer
+          refers to its namespace rather than copying it, so the namespace
+          is kept in an object that lives as long as the cursor.
+         */
+        shared_ptr<BSONObj> pProjection;
+        shared_ptr<BSONObj> pNsObj;
+        shared_ptr<const ParsedQuery> pParsedQuery;
+        BSONObj projection;
+        if (getProjection(*pSources, &projection)) {
+            pProjection.reset(new BSONObj(projection));
+            if (!projection.isEmpty()) {
+                pNsObj.reset(new BSONObj(BSON("ns" << fullName)));
+                pParsedQuery.reset(new ParsedQuery(
+                    pNsObj->firstElement().valuestr(), 0, 0, 0,
+                    *pQueryObj, *pProjection));
+            }
+        }
+
         /* for debugging purposes, show what the query and sort are */
         DEV {
             (log() << "\n---- query BSON\n" <<
@@ -115,7 +208,8 @@ namespace mongo {
             /* try to create the cursor with the query and the sort */
             shared_ptr<Cursor> pSortedCursor(
                 pCursor = NamespaceDetailsTransient::getCursor(
-                    fullName.c_str(), *pQueryObj, *pSortObj));
+                    fullName.c_str(), *pQueryObj, *pSortObj,
+                    QueryPlanSelectionPolicy::any(), NULL, pParsedQuery));
 
             if (pSortedCursor.get()) {
                 /* success:  remove the sort from the pipeline */
@@ -130,7 +224,8 @@ namespace mongo {
             /* try to create the cursor without the sort */
             shared_ptr<Cursor> pUnsortedCursor(
                 pCursor = NamespaceDetailsTransient::getCursor(
-                    fullName.c_str(), *pQueryObj));
+                    fullName.c_str(), *pQueryObj, BSONObj(),
+                    QueryPlanSelectionPolicy::any(), NULL, pParsedQuery));
 
             pCursor = pUnsortedCursor;
         }
@@ -151,8 +246,51 @@ namespace mongo {
         pSource->setQuery(pQueryObj);
         if (initSort)
             pSource->setSort(pSortObj);
+        if (pProjection)
+            pSource->setProjection(pProjection);
+        if (pNsObj)
+            pSource->addBsonDependency(pNsObj);
 
         return pSource;
     }
 
+    size_t PipelineD::spillBytes = 100 * 1024 * 1024;
+
+    namespace {
+        /* spills to dbpath/_tmp like an index build's external sort */
+        class SpillSorterD :
+            public SpillSorter {
+        public:
+            SpillSorterD(const BSONObj &order, size_t maxMemory):
+                sorter(*IndexDetails::iis[1], order, (long)maxMemory) {
+            }
+
+            virtual void add(const BSONObj &key) {
+                sorter.add(key, DiskLoc());
+            }
+
+            virtual void sort() {
+                sorter.sort();
+                pIterator = sorter.iterator();
+            }
+
+            virtual bool more() {
+                return pIterator->more();
+            }
+
+            virtual BSONObj next() {
+                return pIterator->next().first;
+            }
+
+        private:
+            BSONObjExternalSorter sorter;
+            auto_ptr<BSONObjExternalSorter::Iterator> pIterator;
+        };
+    }
+
+    SpillSorter *PipelineD::createSpillSorter(
+        const BSONObj &order, size_t maxMemory) {
+        return new SpillSorterD(order, maxMemory);
+    }
+
 } // namespace mongo
@@ -20,7 +20,9 @@
 
 namespace mongo {
     class DocumentSourceCursor;
+    class ExpressionContext;
     class Pipeline;
+    class SpillSorter;
 
     /*
       PipelineD is an extension of the Pipeline class, but with additional
@@ -55,6 +57,20 @@ namespace mongo {
             const string &dbName,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
+        /**
+           The SpillSorter::Factory mongod supplies to pipelines; the sorter
+           spills runs to dbpath/_tmp with a BSONObjExternalSorter.
+         */
+        static SpillSorter *createSpillSorter(const BSONObj &order,
+                                              size_t maxMemory);
+
+        /**
+           How much a $sort or $group may hold in memory before spilling,
+           when its pipeline allows disk use.  Set with the
+           aggregationSpillBytes parameter.
+         */
+        static size_t spillBytes;
+
     private:
         PipelineD(); // does not exist:  prevent instantiation
     };
@@ -99,6 +99,15 @@ namespace mongo {
                         unsigned sz = objOld.objsize();
 
                         oldObjSize += sz;
+
+                        // this also compresses records written before the flag was set
+                        const char* stored = objOld.objdata();
+                        string compressed;
+                        if ( d->isUserFlagSet( NamespaceDetails::Flag_Compressed ) &&
+                                CompressedRecord::compress( objOld, &compressed ) ) {
+                            stored = compressed.data();
+                            sz = compressed.size();
+                        }
                         oldObjSizeWithPadding += recOld->netLength();
 
                         unsigned lenWHdr = sz + Record::HeaderSize;
@@ -117,7 +126,7 @@ namespace mongo {
                         datasize += recNew->netLength();
                         recNew = (Record *) getDur().writingPtr(recNew, lenWHdr);
                         addRecordToRecListInExtent(recNew, loc);
-                        memcpy(recNew->data(), objOld.objdata(), sz);
+                        memcpy(recNew->data(), stored, sz);
 
                         {
                             // extract keys for all indexes we will be rebuilding
@@ -207,7 +216,8 @@ namespace mongo {
                 BSONObj::iterator i(idx.info.obj());
                 while( i.more() ) { 
                     BSONElement e = i.next();
-                    if( !str::equals(e.fieldName(), "v") && !str::equals(e.fieldName(), "background") ) {
+                    // v:0 indexes are rebuilt in the default format, v:2 (prefix compressed) ones are kept
+                    if( str::equals(e.fieldName(), "v") ? e.numberInt() == 2 : !str::equals(e.fieldName(), "background") ) {
                         b.append(e);
                     }
                 }
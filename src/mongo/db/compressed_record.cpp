@@ -0,0 +1,67 @@
+// @file compressed_record.cpp
+
+/**
+*    Copyright (C) 2012 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pch.h"
+
+#include "mongo/db/compressed_record.h"
+
+#include "mongo/util/compress.h"
+#include "mongo/util/mongoutils/str.h"
+
+namespace mongo {
+
+    using namespace mongoutils;
+
+    bool CompressedRecord::compress( const BSONObj& obj, string* out ) {
+        const int size = obj.objsize();
+        if ( size < 128 )
+            return false; // not enough to gain over the header and the decompression
+
+        out->resize( HeaderSize + maxCompressedLength( size ) );
+        char* p = &(*out)[0];
+        size_t compressedSize;
+        rawCompress( obj.objdata(), size, p + HeaderSize, &compressedSize );
+        if ( HeaderSize + compressedSize > (size_t) ( size - size / 8 ) ) {
+            out->clear();
+            return false;
+        }
+
+        reinterpret_cast<int*>( p )[0] = -size;
+        reinterpret_cast<int*>( p )[1] = (int) compressedSize;
+        out->resize( HeaderSize + compressedSize );
+        return true;
+    }
+
+    BSONObj CompressedRecord::uncompress( const char* data ) {
+        const int size = -reinterpret_cast<const int*>( data )[0];
+        const int compressedSize = reinterpret_cast<const int*>( data )[1];
+        massert( 16405, str::stream() << "corrupt compressed record, sizes " << size << ' ' << compressedSize,
+                 size > 0 && size <= BSONObjMaxInternalSize && compressedSize > 0 );
+
+        // same layout BSONObjBuilder::obj() hands over: a refcount then the object
+        BSONObj::Holder* h = static_cast<BSONObj::Holder*>( malloc( sizeof( unsigned ) + size ) );
+        verify( h );
+        h->zero();
+        if ( ! rawUncompress( data + HeaderSize, compressedSize, h->data ) ) {
+            free( h );
+            msgasserted( 16406, "corrupt compressed record, snappy uncompress failed" );
+        }
+        return BSONObj( h );
+    }
+
+}
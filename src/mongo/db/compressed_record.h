@@ -0,0 +1,53 @@
+// @file compressed_record.h
+
+/**
+*    Copyright (C) 2012 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * documents in a collection with NamespaceDetails::Flag_Compressed are stored snappy
+     * compressed when that saves enough to be worth it.  the data() of such a record is
+     *
+     *   int  -objsize       negative, so never a valid bson length -- this is the per record flag
+     *   int  compressedSize
+     *   char compressed[compressedSize]
+     *
+     * so compressed and plain records coexist in an extent (the flag can be turned on and off
+     * with collMod) and BSONObj::make() tells them apart.
+     *
+     * a compressed record can't be modified in place: the update paths rewrite it instead.
+     */
+    class CompressedRecord {
+    public:
+        enum { HeaderSize = 8 };
+
+        static bool isCompressed( const char* data ) {
+            return *reinterpret_cast<const int*>( data ) < 0;
+        }
+
+        /** @return true and fill out with the record data for obj, if compressing saves 1/8th or more */
+        static bool compress( const BSONObj& obj, string* out );
+
+        /** @return an owned copy of the document in compressed record data */
+        static BSONObj uncompress( const char* data );
+    };
+
+}
@@ -24,6 +24,8 @@
 #include "../util/concurrency/mapsf.h"
 #include "../util/assert_util.h"
 #include "client.h"
+#include "database.h"
+#include "databaseholder.h"
 #include "namespacestring.h"
 #include "d_globals.h"
 #include "mongomutex.h"
@@ -94,6 +96,11 @@ namespace mongo {
     */
     static mapsf<string,WrapperForRWLock*> dblocks;
 
+    /* ns->lock for Lock::CollectionWrite.  like dblocks, never deleted; a dropped collection's
+       lock lingers and is reused if the collection is recreated.
+    */
+    static mapsf<string,WrapperForRWLock*> collectionlocks;
+
     /* we don't want to touch dblocks too much as a mutex is involved.  thus party for that, 
        this is here...
     */
@@ -227,6 +234,15 @@ namespace mongo {
             }
         }
         result.append("locks", b.obj());
+
+        BSONObjBuilder c;
+        {
+            mapsf<string,WrapperForRWLock*>::ref r(collectionlocks);
+            for( map<string,WrapperForRWLock*>::const_iterator i = r.r.begin(); i != r.r.end(); i++ ) {
+                c.append(i->first, i->second->stats.report());
+            }
+        }
+        result.append("collectionLocks", c.obj());
     }
 
     int Lock::isLocked() {
@@ -285,6 +301,20 @@ namespace mongo {
             msgasserted(16105, str::stream() << "expected to be write locked for " << ns);
         }
     }
+    bool Lock::isCollectionWriteLocked(const StringData& ns) {
+        WrapperForRWLock *k = lockState().collectionLock();
+        return k && k->name() == ns.data();
+    }
+    void Lock::assertWholeDBWriteLocked(const StringData& ns) {
+        LockState &ls = lockState();
+        // a CollectionWrite holds its db in the intent mode only
+        bool collectionOnly = ls.threadState() == 'w' && ls.collectionLock() && 
+                              ls.otherName() == nsToDatabase(ns.data());
+        if( collectionOnly || !Lock::isWriteLocked(ns) ) {
+            ls.dump();
+            msgasserted(16401, str::stream() << "expected the whole db to be write locked for " << ns);
+        }
+    }
     bool Lock::dbLevelLockingEnabled() {
         return DB_LEVEL_LOCKING_ENABLED;
     }
@@ -482,6 +512,7 @@ namespace mongo {
             // nested. if/when we do temprelease with DBWrite we will need to increment here
             // (so we can not release or assert if nested).
             massert(16106, str::stream() << "internal error tried to lock two databases at the same time. old:" << ls.otherName() << " new:" << db , db == ls.otherName() );
+            massert(16433, str::stream() << "can't lock db " << db << " while holding just its collection " << ls.collectionLock()->name(), ls.collectionLock() == 0 );
             return;
         }
 
@@ -520,6 +551,7 @@ namespace mongo {
         _locked_W=false;
         _locked_w=false; 
         _weLocked=0;
+        _collectionLocked=0;
 
         LockState& ls = lockState();
         massert( 16186 , "can't get a DBWrite while having a read lock" , ! ls.hasAnyReadLock() );
@@ -536,6 +568,8 @@ namespace mongo {
                 _locked_W = true;
                 return;
             } 
+            if( !nested && _collection && lockCollection(db) )
+                return;
             if( !nested )
                 lockOther(db);
             lockTop(ls);
@@ -572,7 +606,12 @@ namespace mongo {
         }
     }
 
-    Lock::DBWrite::DBWrite( const StringData& ns ) : _what(ns.data()), _nested(false) {
+    Lock::DBWrite::DBWrite( const StringData& ns ) : _what(ns.data()), _nested(false), _collection(false) {
+        lockDB( _what );
+    }
+
+    Lock::DBWrite::DBWrite( const StringData& ns, bool collection ) : 
+        _what(ns.data()), _nested(false), _collection(collection) {
         lockDB( _what );
     }
 
@@ -588,13 +627,20 @@ namespace mongo {
     }
 
     void Lock::DBWrite::unlockDB() {
+        if( _collectionLocked ) {
+            lockState().unlockedCollection();
+            _collectionLocked->unlock();
+        }
         if( _weLocked ) {
             if ( _nested )
                 lockState().unlockedNestable();
             else
                 lockState().unlockedOther();
     
-            _weLocked->unlock();
+            if( _collectionLocked )
+                _weLocked->unlock_intent();
+            else
+                _weLocked->unlock();
         }
         if( _locked_w ) {
             if (DB_LEVEL_LOCKING_ENABLED) {
@@ -607,6 +653,7 @@ namespace mongo {
             qlk.unlock_W();
         }
         _weLocked = 0;
+        _collectionLocked = 0;
         _locked_W = _locked_w = false;
     }
     void Lock::DBRead::unlockDB() {
@@ -686,6 +733,71 @@ namespace mongo {
         _weLocked = ls.otherLock();
     }
 
+    /** @return true if ns is an existing collection of an open database.  we hold the db in the
+        intent mode at least, so neither can be created or dropped while we look. */
+    static bool collectionExists(const string& ns) {
+        Database *db = dbHolderUnchecked().get(ns, dbpath);
+        return db && db->namespaceIndex.details(ns.c_str());
+    }
+
+    /** lock the db of a CollectionWrite in the intent mode, its collection, then the top.
+        @return false, holding nothing, if the whole db has to be locked instead */
+    bool Lock::DBWrite::lockCollection(const string& db) {
+        fassert( 16430, !db.empty() );
+        LockState& ls = lockState();
+
+        if( ls.collectionLock() ) {
+            // nested. what we hold covers this collection only
+            massert(16431, str::stream() << "can't lock collection " << _what << " while holding collection " << ls.collectionLock()->name(), 
+                    ls.collectionLock()->name() == _what);
+            return true;
+        }
+        if( ls.otherCount() || ls.nestableCount() ) {
+            // nested in a db lock of ours, which lockOther checks and covers
+            return false;
+        }
+        if( NamespaceString::special(_what.c_str()) || nsToDatabase(_what.c_str()) == _what ) {
+            return false;
+        }
+
+        if( db != ls.otherName() )
+        {
+            mapsf<string,WrapperForRWLock*>::ref r(dblocks);
+            WrapperForRWLock*& lock = r[db];
+            if( lock == 0 )
+                lock = new WrapperForRWLock(db.c_str());
+            ls.lockedOther( db , 1 , lock );
+        }
+        else { 
+            DEV OCCASIONALLY { dassert( dblocks.get(db) == ls.otherLock() ); }
+            ls.lockedOther(1);
+        }
+        fassert(16432,_weLocked==0);
+        ls.otherLock()->lock_intent();
+        _weLocked = ls.otherLock();
+
+        WrapperForRWLock *c;
+        {
+            mapsf<string,WrapperForRWLock*>::ref r(collectionlocks);
+            WrapperForRWLock*& lock = r[_what];
+            if( lock == 0 )
+                lock = new WrapperForRWLock(_what.c_str());
+            c = lock;
+        }
+        c->lock();
+        ls.lockedCollection( c );
+        _collectionLocked = c;
+
+        // after the top, as looking in the .ns file needs it
+        lockTop(ls);
+
+        if( !collectionExists(_what) ) {
+            unlockDB();
+            return false;
+        }
+        return true;
+    }
+
     Lock::DBWrite::UpgradeToExclusive::UpgradeToExclusive() {
         fassert( 16187, lockState().threadState() == 'w' );
         _gotUpgrade = qlk.w_to_X();
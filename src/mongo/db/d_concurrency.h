@@ -47,6 +47,8 @@ namespace mongo {
         static bool atLeastReadLocked(const StringData& ns); // true if this db is locked
         static void assertAtLeastReadLocked(const StringData& ns);
         static void assertWriteLocked(const StringData& ns);
+        static bool isCollectionWriteLocked(const StringData& ns); // true if a CollectionWrite holds exactly this collection
+        static void assertWholeDBWriteLocked(const StringData& ns); // as assertWriteLocked, but a CollectionWrite of the db isn't enough
 
         static bool dbLevelLockingEnabled(); 
 
@@ -127,12 +129,14 @@ namespace mongo {
              *   1) lockDB
              *      a) lockTop
              *      b) lockNestable or lockOther
+             *      (or lockCollection, for a CollectionWrite)
              *   2) unlockDB
              */
 
             void lockTop(LockState&);
             void lockNestable(Nestable db);
             void lockOther(const string& db);
+            bool lockCollection(const string& db);
             void lockDB(const string& ns);
             void unlockDB();
 
@@ -140,6 +144,8 @@ namespace mongo {
             void tempRelease();
             void relock();
 
+            DBWrite(const StringData& ns, bool collection);
+
         public:
             DBWrite(const StringData& dbOrNs);
             virtual ~DBWrite();
@@ -158,8 +164,31 @@ namespace mongo {
             bool _locked_w;
             bool _locked_W;
             WrapperForRWLock *_weLocked;
+            WrapperForRWLock *_collectionLocked; // if set, _weLocked is held in the intent mode
             const string _what;
             bool _nested;
+            const bool _collection; // a CollectionWrite
+        };
+
+        /** lock one collection for writing.  its database is locked in the intent mode ('w'), 
+            which writers of the db's other collections share and readers and DBWrite exclude,
+            and the collection exclusively beneath that.  the order is db, collection, then the 
+            global 'w' -- so a thread never waits on a collection lock while counted in 'w', which
+            UpgradeToExclusive (commitIfNeeded) would wait on forever.
+
+            the whole db is locked instead, as by DBWrite, when the db isn't open, the collection
+            doesn't exist yet, or it is a system, $ or local/admin namespace: opening a db and 
+            adding or removing namespaces aren't safe to do next to other writers of the db.  
+            extent and datafile allocation is, under Database's extent mutex; write intents are 
+            per thread already (see dur::ThreadLocalIntents).  isCollectionWriteLocked() tells
+            which you got.
+
+            nested, only the same collection may be locked again.  TempRelease releases and 
+            relocks the lot.  stats are reported per collection in serverStatus.collectionLocks.
+            */
+        class CollectionWrite : public DBWrite {
+        public:
+            CollectionWrite(const StringData& ns) : DBWrite(ns, true) { }
         };
 
         // lock this database for reading. do not shared_lock globally first, that is handledin herein. 
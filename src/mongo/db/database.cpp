@@ -59,9 +59,10 @@ namespace mongo {
     }
 
     Database::Database(const char *nm, bool& newDb, const string& _path )
-        : name(nm), path(_path), namespaceIndex( path, name ),
+        : name(nm), path(_path), _extentMutex("extent"), namespaceIndex( path, name ),
           profileName(name + ".system.profile")
     {
+        _files.reserve( DiskLoc::MaxFiles );
         try {
             {
                 // check db name is valid
@@ -350,6 +351,7 @@ namespace mongo {
 
 
     Extent* Database::allocExtent( const char *ns, int size, bool capped, bool enforceQuota ) {
+        SimpleMutex::scoped_lock lk(_extentMutex);
         // todo: when profiling, these may be worth logging into profile collection
         bool fromFreeList = true;
         Extent *e = DataFileMgr::allocFromFreeList( ns, size, capped );
@@ -131,8 +131,14 @@ namespace mongo {
         // must be in the dbLock when touching this (and write locked when writing to of course)
         // however during Database object construction we aren't, which is ok as it isn't yet visible
         //   to others and we are in the dbholder lock then.
+        // reserved for DiskLoc::MaxFiles up front so adding a file never moves it: a 
+        //   Lock::CollectionWrite writer adds files while writers of other collections read it.
         vector<MongoDataFile*> _files;
 
+        // held by allocExtent, as writers of different collections (Lock::CollectionWrite) 
+        // allocate extents and datafiles of the db at the same time
+        SimpleMutex _extentMutex;
+
     public: // this should be private later
 
         NamespaceIndex namespaceIndex;
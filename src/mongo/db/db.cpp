@@ -42,6 +42,7 @@
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/snapshots.h"
 #include "mongo/db/ttl.h"
+#include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/background.h"
@@ -189,6 +190,7 @@ namespace mongo {
                 lastError.startRequest( m , le );
 
                 DbResponse dbresponse;
+                dbresponse.gatherPort = port;
                 try {
                     assembleResponse( m, dbresponse, port->remote() );
                 }
@@ -198,7 +200,9 @@ namespace mongo {
                 }
 
                 if ( dbresponse.response ) {
-                    port->reply(m, *dbresponse.response, dbresponse.responseTo);
+                    if ( !dbresponse.replied ) {
+                        port->reply(m, *dbresponse.response, dbresponse.responseTo);
+                    }
                     if( dbresponse.exhaust ) {
                         MsgData *header = dbresponse.response->header();
                         QueryResult *qr = (QueryResult *) header;
@@ -234,6 +238,39 @@ namespace mongo {
             globalScriptEngine->threadDone();
         }
 
+        class ConnectionState : public ConnectionThreadState {
+        public:
+            ConnectionState() : client(0), sharded(0) {}
+            virtual ~ConnectionState() {
+                // disconnected() has shut the client down by now
+                delete sharded;
+                delete client;
+            }
+            Client *client;
+            ShardedConnectionInfo *sharded;
+        };
+
+        virtual ConnectionThreadState* newConnectionThreadState() {
+            return new ConnectionState();
+        }
+
+        virtual void detach( ConnectionThreadState* s ) {
+            ConnectionState *cs = static_cast<ConnectionState*>( s );
+            verify( cs->client == 0 );
+            cs->client = currentClient.release();
+            cs->sharded = ShardedConnectionInfo::release();
+        }
+
+        virtual void attach( ConnectionThreadState* s ) {
+            ConnectionState *cs = static_cast<ConnectionState*>( s );
+            verify( currentClient.get() == 0 );
+            currentClient.reset( cs->client );
+            if( cs->sharded )
+                ShardedConnectionInfo::set( cs->sharded );
+            cs->client = 0;
+            cs->sharded = 0;
+        }
+
     };
 
     void listen(int port) {
@@ -636,6 +673,7 @@ static int mongoDbMain(int argc, char* argv[]) {
     ("dbpath", po::value<string>() , dbpathBuilder.str().c_str())
     ("diaglog", po::value<int>(), "0=off 1=W 2=R 3=both 7=W+some reads")
     ("directoryperdb", "each database will be stored in a separate directory")
+    ("indexBuildThreads", po::value<int>(&cmdLine.indexBuildThreads), "threads extracting and sorting keys for foreground index builds (default: one per core, at most 8)")
     ("ipv6", "enable IPv6 support (disabled by default)")
     ("journal", "enable journaling")
     ("journalCommitInterval", po::value<unsigned>(), "how often to group/batch commit (ms)")
@@ -683,6 +721,7 @@ static int mongoDbMain(int argc, char* argv[]) {
 
     rs_options.add_options()
     ("replSet", po::value<string>(), "arg is <setname>[/<optionalseedhostlist>]")
+    ("replWriterThreads", po::value<int>(&cmdLine.replWriterThreads), "threads applying replicated ops, and as many prefetching them (default: two per core, 4 to 16)")
     ;
 
     sharding_options.add_options()
@@ -940,6 +979,14 @@ static int mongoDbMain(int argc, char* argv[]) {
         if (params.count("only")) {
             cmdLine.only = params["only"].as<string>().c_str();
         }
+        if ( cmdLine.indexBuildThreads < 0 ) {
+            out() << "bad --indexBuildThreads arg" << endl;
+            dbexit( EXIT_BADOPTIONS );
+        }
+        if ( cmdLine.replWriterThreads < 0 ) {
+            out() << "bad --replWriterThreads arg" << endl;
+            dbexit( EXIT_BADOPTIONS );
+        }
         if( params.count("nssize") ) {
             int x = params["nssize"].as<int>();
             if (x <= 0 || x > (0x7fffffff/1024/1024)) {
@@ -50,6 +50,7 @@
 #include "dur_stats.h"
 #include "../server.h"
 #include "mongo/db/index_update.h"
+#include "mongo/db/commands/pipeline_d.h"
 
 namespace mongo {
 
@@ -65,6 +66,18 @@ namespace mongo {
             dur::setAgeOutJournalFiles(r);
             return true;
         }
+        e = cmdObj["aggregationSpillBytes"];
+        if( !e.eoo() ) {
+            long long x = e.numberLong();
+            if( x <= 0 ) {
+                errmsg = "aggregationSpillBytes must be positive";
+                return false;
+            }
+            result.append("was", (long long) PipelineD::spillBytes);
+            PipelineD::spillBytes = (size_t) x;
+            log() << "setParameter aggregationSpillBytes=" << x << endl;
+            return true;
+        }
         return false;
     }
 
@@ -581,6 +594,16 @@ namespace mongo {
             {
                 BSONObjBuilder bb( result.subobjStart( "network" ) );
                 networkCounter.append( bb );
+                {
+                    BSONObjBuilder cb( bb.subobjStart( "compression" ) );
+                    Message::appendCompressionStats( cb );
+                    cb.done();
+                }
+                {
+                    BSONObjBuilder pb( bb.subobjStart( "buffers" ) );
+                    MessageBufferPool::appendStats( pb );
+                    pb.done();
+                }
                 bb.done();
             }
 
@@ -856,7 +879,8 @@ namespace mongo {
         virtual bool slaveOk() const { return true; }    // can reindex on a secondary
         virtual LockType locktype() const { return WRITE; }
         virtual void help( stringstream& help ) const {
-            help << "re-index a collection";
+            help << "re-index a collection\n"
+                 "{ reIndex : <collection>, v : <n> } rebuilds the indexes as index version n, e.g. 2 for prefix compressed";
         }
         CmdReIndex() : Command("reIndex") { }
         bool run(const string& dbname , BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool /*fromRepl*/) {
@@ -873,11 +897,28 @@ namespace mongo {
                 return false;
             }
 
+            int v = -1;
+            if ( jsobj.hasField( "v" ) ) {
+                v = jsobj["v"].numberInt();
+                if ( ! IndexDetails::isASupportedIndexVersionNumber( v ) ) {
+                    errmsg = str::stream() << "unsupported index version " << jsobj["v"].toString( false );
+                    return false;
+                }
+            }
+
             list<BSONObj> all;
             auto_ptr<DBClientCursor> i = db.query( dbname + ".system.indexes" , BSON( "ns" << toDeleteNs ) , 0 , 0 , 0 , QueryOption_SlaveOk );
             BSONObjBuilder b;
             while ( i->more() ) {
-                BSONObj o = i->next().removeField("v").getOwned();
+                BSONObj old = i->next();
+                // unless told otherwise, v:2 (prefix compressed) indexes stay that way and
+                // the others are rebuilt in the default format
+                int ov = v >= 0 ? v : ( old["v"].numberInt() == 2 ? 2 : -1 );
+                BSONObjBuilder ob;
+                ob.appendElements( old.removeField("v") );
+                if ( ov >= 0 )
+                    ob.append( "v", ov );
+                BSONObj o = ob.obj();
                 b.append( BSONObjBuilder::numStr( all.size() ) , o );
                 all.push_back( o );
             }
@@ -1372,6 +1413,21 @@ namespace mongo {
                 }
                 
             }
+
+            if ( jsobj["compressed"].type() ) {
+                // affects documents written from now on, compact rewrites the rest
+                result.appendBool( "compressed_old" , nsd->isUserFlagSet( NamespaceDetails::Flag_Compressed ) );
+                if ( jsobj["compressed"].trueValue() ) {
+                    if ( nsd->isCapped() || NamespaceString( ns ).isSystem() ) {
+                        errmsg = "capped and system collections can't be compressed";
+                        return false;
+                    }
+                    nsd->setUserFlag( NamespaceDetails::Flag_Compressed );
+                }
+                else {
+                    nsd->clearUserFlag( NamespaceDetails::Flag_Compressed );
+                }
+            }
             
             if ( oldFlags != nsd->userFlags() ) {
                 nsd->syncUserFlags( ns );
@@ -1381,6 +1437,69 @@ namespace mongo {
         }
     } collectionModCommand;
 
+    class CmdPlanCache : public Command {
+    public:
+        CmdPlanCache() : Command( "planCache" ) {}
+        virtual bool slaveOk() const { return true; }
+        virtual LockType locktype() const { return READ; }
+        virtual void help( stringstream& help ) const {
+            help << "list the query plans cached for a collection, with their use counts\n"
+                 "{ planCache : <collection> }\n"
+                 "{ planCache : <collection>, pin : <query>, sort : <sort>, index : <key pattern> } "
+                 "always use the index (or $natural) for queries like this one\n"
+                 "{ planCache : <collection>, unpin : <query>, sort : <sort> }\n"
+                 "{ planCache : <collection>, clear : true } drop all the cached plans";
+        }
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            string ns = dbname + "." + jsobj.firstElement().valuestr();
+            Client::Context ctx( ns );
+            NamespaceDetails *d = nsdetails( ns.c_str() );
+            if ( ! d ) {
+                errmsg = "ns not found";
+                return false;
+            }
+
+            BSONObj sort = jsobj.getObjectField( "sort" );
+            if ( jsobj["pin"].type() == Object ) {
+                BSONObj query = jsobj["pin"].embeddedObject();
+                BSONObj index = jsobj.getObjectField( "index" );
+                int idxNo = -1;
+                if ( index.isEmpty() || !str::equals( index.firstElementFieldName(), "$natural" ) ) {
+                    idxNo = d->findIndexByKeyPattern( index );
+                    if ( idxNo < 0 ) {
+                        errmsg = "index not found";
+                        return false;
+                    }
+                }
+
+                FieldRangeSetPair frsp( ns.c_str(), query );
+                scoped_ptr<QueryPlan> plan( QueryPlan::make( d, idxNo, frsp, 0, query, sort ) );
+                if ( ( plan->utility() == QueryPlan::Unhelpful && !plan->skipScan() ) ||
+                     plan->utility() == QueryPlan::Disallowed ) {
+                    errmsg = "the index can't be used for the query";
+                    return false;
+                }
+
+                bool scanAndOrder = plan->scanAndOrderRequired();
+                CachedQueryPlan pinned( plan->indexKey(), 0,
+                                        CandidatePlanCharacter( !scanAndOrder, scanAndOrder ), true );
+                QueryUtilIndexed::pinIndexForPatterns( frsp, sort, pinned );
+            }
+            else if ( jsobj["unpin"].type() == Object ) {
+                FieldRangeSetPair frsp( ns.c_str(), jsobj["unpin"].embeddedObject() );
+                QueryUtilIndexed::clearIndexesForPatterns( frsp, sort );
+            }
+            else if ( jsobj["clear"].trueValue() ) {
+                SimpleMutex::scoped_lock lk( NamespaceDetailsTransient::_qcMutex );
+                NamespaceDetailsTransient::get_inlock( ns.c_str() ).clearQueryCache();
+            }
+
+            SimpleMutex::scoped_lock lk( NamespaceDetailsTransient::_qcMutex );
+            NamespaceDetailsTransient::get_inlock( ns.c_str() ).appendQueryCacheInfo( result );
+            return true;
+        }
+    } cmdPlanCache;
+
     class DBStats : public Command {
     public:
         DBStats() : Command( "dbStats", false, "dbstats" ) {}
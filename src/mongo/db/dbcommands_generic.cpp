@@ -134,6 +134,11 @@ namespace mongo {
             help << "{ getParameter:1, notablescan:1 }\n";
             help << "supported so far:\n";
             help << "  quiet\n";
+            help << "  shardReadAhead\n";
+            help << "  aggregationShardMerge\n";
+            help << "  queryCacheWriteLimit\n";
+            help << "  zeroCopyReplyMinBytes\n";
+            help << "  releaseConnectionsAfterResponse\n";
             help << "  notablescan\n";
             help << "  logLevel\n";
             help << "  syncdelay\n";
@@ -150,6 +155,18 @@ namespace mongo {
             if( all || cmdObj.hasElement("notablescan") ) {
                 result.append("notablescan", cmdLine.noTableScan);
             }
+            if( all || cmdObj.hasElement("aggregationShardMerge") ) {
+                result.append("aggregationShardMerge", cmdLine.aggregationShardMerge);
+            }
+            if( all || cmdObj.hasElement("queryCacheWriteLimit") ) {
+                result.append("queryCacheWriteLimit", cmdLine.queryCacheWriteLimit);
+            }
+            if( all || cmdObj.hasElement("zeroCopyReplyMinBytes") ) {
+                result.append("zeroCopyReplyMinBytes", cmdLine.zeroCopyReplyMinBytes);
+            }
+            if( all || cmdObj.hasElement("releaseConnectionsAfterResponse") ) {
+                result.append("releaseConnectionsAfterResponse", cmdLine.releaseConnectionsAfterResponse);
+            }
             if( all || cmdObj.hasElement("logLevel") ) {
                 result.append("logLevel", logLevel);
             }
@@ -181,10 +198,16 @@ namespace mongo {
             help << "set administrative option(s)\n";
             help << "{ setParameter:1, <param>:<value> }\n";
             help << "supported so far:\n";
+            help << "  aggregationSpillBytes\n";
             help << "  journalCommitInterval\n";
             help << "  logLevel\n";
             help << "  notablescan\n";
             help << "  quiet\n";
+            help << "  shardReadAhead\n";
+            help << "  aggregationShardMerge\n";
+            help << "  queryCacheWriteLimit\n";
+            help << "  zeroCopyReplyMinBytes\n";
+            help << "  releaseConnectionsAfterResponse\n";
             help << "  syncdelay\n";
         }
         bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
@@ -214,6 +237,51 @@ namespace mongo {
                 cmdLine.quiet = cmdObj["quiet"].Bool();
                 s++;
             }
+            if( cmdObj.hasElement("shardReadAhead") ) {
+                int x = cmdObj["shardReadAhead"].numberInt();
+                if( !CmdLine::shardReadAheadOk(x) ) {
+                    errmsg = str::stream() << "shardReadAhead must be between 0 and " << (int) CmdLine::MaxShardReadAhead;
+                    return false;
+                }
+                if( s == 0 )
+                    result.append("was", cmdLine.shardReadAhead );
+                cmdLine.shardReadAhead = x;
+                s++;
+            }
+            if( cmdObj.hasElement("aggregationShardMerge") ) {
+                if( s == 0 )
+                    result.append("was", cmdLine.aggregationShardMerge );
+                cmdLine.aggregationShardMerge = cmdObj["aggregationShardMerge"].trueValue();
+                s++;
+            }
+            if( cmdObj.hasElement("queryCacheWriteLimit") ) {
+                int x = cmdObj["queryCacheWriteLimit"].numberInt();
+                if( x < 0 ) {
+                    errmsg = "queryCacheWriteLimit must be non-negative";
+                    return false;
+                }
+                if( s == 0 )
+                    result.append("was", cmdLine.queryCacheWriteLimit );
+                cmdLine.queryCacheWriteLimit = x;
+                s++;
+            }
+            if( cmdObj.hasElement("zeroCopyReplyMinBytes") ) {
+                int x = cmdObj["zeroCopyReplyMinBytes"].numberInt();
+                if( x < 0 ) {
+                    errmsg = "zeroCopyReplyMinBytes must be non-negative";
+                    return false;
+                }
+                if( s == 0 )
+                    result.append("was", cmdLine.zeroCopyReplyMinBytes );
+                cmdLine.zeroCopyReplyMinBytes = x;
+                s++;
+            }
+            if( cmdObj.hasElement("releaseConnectionsAfterResponse") ) {
+                if( s == 0 )
+                    result.append("was", cmdLine.releaseConnectionsAfterResponse );
+                cmdLine.releaseConnectionsAfterResponse = cmdObj["releaseConnectionsAfterResponse"].trueValue();
+                s++;
+            }
             if( cmdObj.hasElement("syncdelay") ) {
                 verify( !cmdLine.isMongos() );
                 if( s == 0 )
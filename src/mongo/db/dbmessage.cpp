@@ -60,7 +60,7 @@ namespace mongo {
                       int nReturned, int startingFrom,
                       long long cursorId 
                       ) {
-        BufBuilder b(32768);
+        PooledBufBuilder b(sizeof(QueryResult) + size);
         b.skip(sizeof(QueryResult));
         b.appendBuf(data, size);
         QueryResult *qr = (QueryResult *) b.buf();
@@ -70,8 +70,10 @@ namespace mongo {
         qr->cursorId = cursorId;
         qr->startingFrom = startingFrom;
         qr->nReturned = nReturned;
+        int capacity = b.getSize();
         b.decouple();
-        Message resp(qr, true);
+        Message resp;
+        resp.setData(qr, true, capacity);
         p->reply(requestMsg, resp, requestMsg.header()->id);
     }
 
@@ -91,12 +93,13 @@ namespace mongo {
     }
 
     void replyToQuery( int queryResultFlags, Message& response, const BSONObj& resultObj ) {
-        BufBuilder bufBuilder;
+        PooledBufBuilder bufBuilder( sizeof( QueryResult ) + resultObj.objsize() );
         bufBuilder.skip( sizeof( QueryResult ));
         bufBuilder.appendBuf( reinterpret_cast< void *>(
                 const_cast< char* >( resultObj.objdata() )), resultObj.objsize() );
 
         QueryResult* queryResult = reinterpret_cast< QueryResult* >( bufBuilder.buf() );
+        int capacity = bufBuilder.getSize();
         bufBuilder.decouple();
 
         queryResult->_resultFlags() = queryResultFlags;
@@ -106,7 +109,7 @@ namespace mongo {
         queryResult->startingFrom = 0;
         queryResult->nReturned = 1;
 
-        response.setData( queryResult, true ); // transport will free
+        response.setData( queryResult, true, capacity ); // transport will free
     }
 
 }
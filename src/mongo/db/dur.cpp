@@ -45,9 +45,10 @@
        commitJob.reset()
      UNLOCK dbMutex                                     // now other threads can write
        WRITETOJOURNAL()
-       WRITETODATAFILES()
+       wait for the data file writer to finish the previous commit
+       hand off WRITETODATAFILES() to the data file writer // which takes its own READLOCK mmmutex
      UNLOCK mmmutex
-     UNLOCK groupCommitMutex
+     UNLOCK groupCommitMutex                            // the next commit can start while the data files are written
 
      on the next write lock acquisition for dbMutex:    // see MongoMutex::_acquiredWriteLock()
        REMAPPRIVATEVIEW()
@@ -113,7 +114,7 @@ namespace mongo {
                         string _CSVHeader();
 
         string Stats::S::_CSVHeader() { 
-            return "cmts  jrnMB\twrDFMB\tcIWLk\tearly\tprpLgB  wrToJ\twrToDF\trmpPrVw";
+            return "cmts  jrnMB\twrDFMB\tcIWLk\tearly\tprpLgB  wrToJ\twrToDF\trmpPrVw\tcmprs\tdfWait\tjReq\tjReqMs";
         }
 
         string Stats::S::_asCSV() { 
@@ -128,7 +129,11 @@ namespace mongo {
                 (unsigned) (_prepLogBufferMicros/1000) << '\t' << 
                 (unsigned) (_writeToJournalMicros/1000) << '\t' << 
                 (unsigned) (_writeToDataFilesMicros/1000) << '\t' << 
-                (unsigned) (_remapPrivateViewMicros/1000);
+                (unsigned) (_remapPrivateViewMicros/1000) << '\t' << 
+                (unsigned) (_compressMicros/1000) << '\t' << 
+                (unsigned) (_dataFileWriterWaitMicros/1000) << '\t' << 
+                _requestedCommits << '\t' << 
+                (unsigned) (_requestedCommitMicros/1000);
             return ss.str();
         }
 
@@ -142,12 +147,16 @@ namespace mongo {
                        "compression" << _journaledBytes / (_uncompressedBytes+1.0) <<
                        "commitsInWriteLock" << _commitsInWriteLock <<
                        "earlyCommits" << _earlyCommits << 
+                       "requestedCommits" << _requestedCommits << 
                        "timeMs" <<
                        BSON( "dt" << _dtMillis <<
                              "prepLogBuffer" << (unsigned) (_prepLogBufferMicros/1000) <<
+                             "compress" << (unsigned) (_compressMicros/1000) <<
                              "writeToJournal" << (unsigned) (_writeToJournalMicros/1000) <<
                              "writeToDataFiles" << (unsigned) (_writeToDataFilesMicros/1000) <<
-                             "remapPrivateView" << (unsigned) (_remapPrivateViewMicros/1000)
+                             "dataFileWriterWait" << (unsigned) (_dataFileWriterWaitMicros/1000) <<
+                             "remapPrivateView" << (unsigned) (_remapPrivateViewMicros/1000) <<
+                             "requestedCommits" << (unsigned) (_requestedCommitMicros/1000)
                            );
             /*int r = getAgeOutJournalFiles();
             if( r == -1 )
@@ -208,7 +217,10 @@ namespace mongo {
         }
 
         bool DurableImpl::awaitCommit() {
-            commitJob._notify.awaitBeyondNow();
+            // same as _notify.awaitBeyondNow(), but with the commit thread woken up in between
+            NotifyAll::When w = commitJob._notify.now();
+            commitJob.requestCommit();
+            commitJob._notify.waitFor(w);
             return true;
         }
 
@@ -535,10 +547,130 @@ namespace mongo {
         // below.  however we don't truly do that so that we don't have to 
         // reallocate, and more importantly regrow it, on every single commit.
         static AlignedBuilder __theBuilder(4 * 1024 * 1024);
+        // _groupCommitWithLimitedLocks alternates between the two, as the data file writer may
+        // still be reading the one it used last time.
+        static AlignedBuilder __theBuilder2(4 * 1024 * 1024);
+
+        /** WRITETODATAFILES for the limited locks commits is done on this thread, so that the commit
+            thread can go on to prepare and journal the next commit meanwhile.  at most one commit is in
+            flight here, and they are applied in journal order.  anything that needs the data files
+            current (REMAPPRIVATEVIEW, a commit done start to finish, fsync lock) drain()s first.
+        */
+        class DataFileWriter : boost::noncopyable {
+        public:
+            DataFileWriter() : _m("DataFileWriter"), _ab(0), _started(false), _exited(false) { }
+
+            /** hand off a commit that is in the journal.  the caller holds LockMongoFilesShared; we
+                return once the writer thread has its own, so no file can close in between.  ab must
+                be left alone until the next drain(), the writer resets it when done.
+                once the writer thread has exited at shutdown, the final commits are written here.
+            */
+            void write(const JSectHeader& h, AlignedBuilder *ab) {
+                drain();
+                scoped_lock lk(_m);
+                if( _exited ) {
+                    _write(h, *ab);
+                    return;
+                }
+                _h = h;
+                _ab = ab;
+                _started = false;
+                _c.notify_all();
+                while( !_started )
+                    _c.wait(lk.boost());
+            }
+
+            /** wait for the commit in flight, if any, to reach the data files */
+            void drain() {
+                Timer t;
+                scoped_lock lk(_m);
+                if( _ab == 0 )
+                    return;
+                while( _ab )
+                    _c.wait(lk.boost());
+                stats.curr->_dataFileWriterWaitMicros += t.micros();
+            }
+
+            void run() {
+                Client::initThread("journal data file writer");
+                while( 1 ) {
+                    JSectHeader h;
+                    AlignedBuilder *ab;
+                    {
+                        scoped_lock lk(_m);
+                        while( _ab == 0 || _started ) {
+                            if( _ab == 0 && inShutdown() ) {
+                                // idle at shutdown; write() does any commits after this itself
+                                _exited = true;
+                                break;
+                            }
+                            boost::xtime xt;
+                            boost::xtime_get(&xt, boost::TIME_UTC);
+                            xt.nsec += 100 * 1000000;
+                            if( xt.nsec >= 1000000000 ) {
+                                xt.nsec -= 1000000000;
+                                xt.sec++;
+                            }
+                            _c.timed_wait(lk.boost(), xt);
+                        }
+                        if( _exited )
+                            break;
+                        h = _h;
+                        ab = _ab;
+                    }
+
+                    LockMongoFilesShared lkFiles;
+                    {
+                        scoped_lock lk(_m);
+                        _started = true;
+                        _c.notify_all();
+                    }
+
+                    _write(h, *ab);
+
+                    scoped_lock lk(_m);
+                    _ab = 0;
+                    _c.notify_all();
+                }
+                cc().shutdown();
+            }
+
+        private:
+            static void _write(const JSectHeader& h, AlignedBuilder& ab) {
+                try {
+                    unsigned abLen = ab.len();
+                    WRITETODATAFILES(h, ab);
+                    verify( abLen == ab.len() ); // a check that no one touched the builder while we were doing work
+                    ab.reset();
+                    return;
+                }
+                catch(DBException& e ) {
+                    log() << "dbexception in journal data file writer causing immediate shutdown: " << e.toString() << endl;
+                }
+                catch(std::exception& e) {
+                    log() << "exception in journal data file writer causing immediate shutdown: " << e.what() << endl;
+                }
+                mongoAbort("dur5");
+            }
+
+            mongo::mutex _m;
+            boost::condition _c;
+            JSectHeader _h;
+            AlignedBuilder *_ab; // the commit in flight; 0 when idle
+            bool _started;       // the writer has its LockMongoFilesShared
+            bool _exited;        // the writer thread has returned at shutdown
+        };
+
+        static DataFileWriter& dataFileWriter = *(new DataFileWriter()); // don't destroy, shutdown commits may still use it after its thread exits
+
+        static void dataFileWriterThread() {
+            dataFileWriter.run();
+        }
 
         static bool _groupCommitWithLimitedLocks() {
             unspoolWriteIntents(); // in case we were doing some writing ourself (likely impossible with limitedlocks version)
-            AlignedBuilder &ab = __theBuilder;
+            static AlignedBuilder *next = &__theBuilder;
+            AlignedBuilder &ab = *next;
 
             verify( ! Lock::isLocked() );
 
@@ -579,13 +711,12 @@ namespace mongo {
             // (ok to crash after that)
             commitJob.committingNotifyCommitted();
 
-            // note the higher-up-the-chain locking of filesLockedFsync is important here, 
-            // as we are not in Lock::GlobalRead anymore. private view readers won't see 
-            // anything as we do this, but external viewers of the datafiles will see them 
-            // mutating.
-            WRITETODATAFILES(h, ab);
-            verify( abLen == ab.len() ); // check again wasn't modded
-            ab.reset();
+            // the data files are written on the data file writer thread while we go on to the next
+            // commit, into the other builder.  this waits for the previous commit's data file writes.
+            // we are not in Lock::GlobalRead anymore: private view readers won't see anything as
+            // this is done, but external viewers of the datafiles will see them mutating.
+            dataFileWriter.write(h, &ab);
+            next = (next == &__theBuilder) ? &__theBuilder2 : &__theBuilder;
 
             // can't : d.dbMutex._remapPrivateViewRequested = true;
             // (writes have happened we released)
@@ -632,6 +763,9 @@ namespace mongo {
                 // (and we are only read locked in the dbMutex, so it could happen)
                 SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
 
+                // the previous commit's data file writes come first, and must be done before we remap
+                dataFileWriter.drain();
+
                 commitJob.commitingBegin();
 
                 if( !commitJob.hasWritten() ) {
@@ -790,14 +924,12 @@ namespace mongo {
                 try {
                     stats.rotate();
 
-                    // commit sooner if one or more getLastError j:true is pending
-                    sleepmillis(oneThird);
-                    for( unsigned i = 1; i <= 2; i++ ) {
-                        if( commitJob._notify.nWaiting() )
+                    // commit right away if a getLastError j:true is pending, or sooner if there is a lot to commit
+                    for( unsigned i = 1; i <= 3; i++ ) {
+                        if( commitJob.awaitCommitRequest(oneThird) )
                             break;
                         if( commitJob.bytes() > UncommittedBytesLimit / 2  )
                             break;
-                        sleepmillis(oneThird);
                     }
                                         
                     //DEV log() << "privateMapBytes=" << privateMapBytes << endl;
@@ -860,6 +992,7 @@ namespace mongo {
             preallocateFiles();
 
             boost::thread t(durThread);
+            boost::thread t2(dataFileWriterThread);
         }
 
         void DurableImpl::syncDataAndTruncateJournal() {
@@ -145,6 +145,46 @@ namespace mongo {
             assertLockedForCommitting();
             _commitNumber = _notify.now();
             stats.curr->_commits++;
+            {
+                // requests made before now are answered by this commit
+                scoped_lock lk(_requestMutex);
+                _committingRequestedAt = _requestedAt;
+                _requestedAt = 0;
+            }
+        }
+
+        void CommitJob::committingNotifyCommitted() { 
+            groupCommitMutex.dassertLocked();
+            _notify.notifyAll(_commitNumber); 
+            if( _committingRequestedAt ) {
+                stats.curr->_requestedCommits++;
+                stats.curr->_requestedCommitMicros += curTimeMicros64() - _committingRequestedAt;
+                _committingRequestedAt = 0;
+            }
+        }
+
+        void CommitJob::requestCommit() { 
+            scoped_lock lk(_requestMutex);
+            if( _requestedAt == 0 ) {
+                _requestedAt = curTimeMicros64();
+                _requestCondition.notify_one();
+            }
+        }
+
+        bool CommitJob::awaitCommitRequest(unsigned millis) { 
+            scoped_lock lk(_requestMutex);
+            if( _requestedAt == 0 ) {
+                boost::xtime xt;
+                boost::xtime_get(&xt, boost::TIME_UTC);
+                xt.sec += millis / 1000;
+                xt.nsec += (millis % 1000) * 1000000;
+                if( xt.nsec >= 1000000000 ) {
+                    xt.nsec -= 1000000000;
+                    xt.sec++;
+                }
+                _requestCondition.timed_wait(lk.boost(), xt);
+            }
+            return _requestedAt != 0;
         }
 
         void CommitJob::_committingReset() {
@@ -157,9 +197,12 @@ namespace mongo {
 
         CommitJob::CommitJob() : 
             groupCommitMutex("groupCommit"),
-            _hasWritten(false)
+            _hasWritten(false),
+            _requestMutex("commitRequest")
         { 
             _commitNumber = 0;
+            _requestedAt = 0;
+            _committingRequestedAt = 0;
             _bytes = 0;
             _nSinceCommitIfNeededCall = 0;
         }
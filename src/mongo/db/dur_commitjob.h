@@ -156,10 +156,7 @@ namespace mongo {
             /** these called by the groupCommit code as it goes along */
             void commitingBegin();
             /** the commit code calls this when data reaches the journal (on disk) */
-            void committingNotifyCommitted() { 
-                groupCommitMutex.dassertLocked();
-                _notify.notifyAll(_commitNumber); 
-            }
+            void committingNotifyCommitted();
             /** we use the commitjob object over and over, calling reset() rather than reconstructing */
             void committingReset() {
                 groupCommitMutex.dassertLocked();
@@ -167,6 +164,15 @@ namespace mongo {
             }
 
         public:
+            /** getlasterror j:true calls this so that the commit thread commits now rather than at the end
+                of its interval. threadsafe.
+            */
+            void requestCommit();
+            /** for the commit thread: sleep until a commit is requested or millis elapse.
+                @return true if a commit was requested
+            */
+            bool awaitCommitRequest(unsigned millis);
+
             /** we check how much written and if it is getting to be a lot, we commit sooner. */
             size_t bytes() const { return _bytes; }
 
@@ -185,6 +191,10 @@ namespace mongo {
             NotifyAll::When _commitNumber;
             IntentsAndDurOps _intentsAndDurOps;
             size_t _bytes;
+            mongo::mutex _requestMutex;
+            boost::condition _requestCondition;
+            unsigned long long _requestedAt;    // curTimeMicros64() of the first requestCommit() since commitingBegin(), or 0
+            unsigned long long _committingRequestedAt; // _requestedAt as of the commit in progress
         public:
             NotifyAll _notify;                  // for getlasterror fsync:true acknowledgements
             unsigned _nSinceCommitIfNeededCall; // for asserts and debugging
@@ -700,7 +700,11 @@ namespace mongo {
             }
 
             size_t compressedLength = 0;
-            rawCompress(uncompressed.buf(), uncompressed.len(), b.cur(), &compressedLength);
+            {
+                Timer t;
+                rawCompress(uncompressed.buf(), uncompressed.len(), b.cur(), &compressedLength);
+                stats.curr->_compressMicros += t.micros();
+            }
             verify( compressedLength < 0xffffffff );
             verify( compressedLength < max );
             b.skip(compressedLength);
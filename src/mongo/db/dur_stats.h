@@ -5,6 +5,7 @@ namespace mongo {
 
         /** journaling stats.  the model here is that the commit thread is the only writer, and that reads are
             uncommon (from a serverStatus command and such).  Thus, there should not be multicore chatter overhead.
+            (the data file writer thread also adds to _writeToDataFiles*; a count lost to a rotate() is fine.)
         */
         struct Stats {
             Stats();
@@ -19,14 +20,18 @@ namespace mongo {
 
                 unsigned _commits;
                 unsigned _earlyCommits; // count of early commits from commitIfNeeded() or from getDur().commitNow()
+                unsigned _requestedCommits; // commits that getlasterror j:true asked for (see CommitJob::requestCommit())
                 unsigned long long _journaledBytes;
                 unsigned long long _uncompressedBytes;
                 unsigned long long _writeToDataFilesBytes;
 
                 unsigned long long _prepLogBufferMicros;
+                unsigned long long _compressMicros;         // part of _writeToJournalMicros
                 unsigned long long _writeToJournalMicros;
+                unsigned long long _dataFileWriterWaitMicros; // commit thread waiting on the previous commit's WRITETODATAFILES
                 unsigned long long _writeToDataFilesMicros;
                 unsigned long long _remapPrivateViewMicros;
+                unsigned long long _requestedCommitMicros;  // from the first request to the data being in the journal
 
                 // undesirable to be in write lock for the group commit (it can be done in a read lock), so good if we
                 // have visibility when this happens.  can happen for a couple reasons
@@ -29,33 +29,19 @@
 
 namespace mongo {
 
-    HLMutex BSONObjExternalSorter::_extSortMutex("s");
-    IndexInterface *BSONObjExternalSorter::extSortIdxInterface;
-    Ordering BSONObjExternalSorter::extSortOrder( Ordering::make(BSONObj()) );
-    unsigned long long BSONObjExternalSorter::_compares = 0;
     unsigned long long BSONObjExternalSorter::_uniqueNumber = 0;
     static SimpleMutex _uniqueNumberMutex( "uniqueNumberMutex" );
 
     /*static*/
     int BSONObjExternalSorter::_compare(IndexInterface& i, const Data& l, const Data& r, const Ordering& order) { 
-        RARELY killCurrentOp.checkForInterrupt();
-        _compares++;
+        // runs may be sorted on a helper thread, the owning operation checks for interrupts then
+        RARELY if ( haveClient() ) killCurrentOp.checkForInterrupt();
         int x = i.keyCompare(l.first, r.first, order);
         if ( x )
             return x;
         return l.second.compare( r.second );
     }
 
-    /*static*/
-    int BSONObjExternalSorter::extSortComp( const void *lv, const void *rv ) {
-        DEV RARELY {
-            _extSortMutex.dassertLocked(); // must be as we use a global var
-        }
-        Data * l = (Data*)lv;
-        Data * r = (Data*)rv;
-        return _compare(*extSortIdxInterface, *l, *r, extSortOrder);
-    };
-
     BSONObjExternalSorter::BSONObjExternalSorter( IndexInterface &i, const BSONObj & order , long maxFileSize )
         : _idxi(i), _order( order.getOwned() ) , _maxFilesize( maxFileSize ) ,
           _arraySize(1000000), _cur(0), _curSizeSoFar(0), _sorted(0) {
@@ -77,7 +63,6 @@ namespace mongo {
         log(1) << "external sort root: " << _root.string() << endl;
 
         create_directories( _root );
-        _compares = 0;
     }
 
     BSONObjExternalSorter::~BSONObjExternalSorter() {
@@ -90,12 +75,7 @@ namespace mongo {
     }
 
     void BSONObjExternalSorter::_sortInMem() {
-        // extSortComp needs to use glpbals
-        // qsort_r only seems available on bsd, which is what i really want to use
-        HLMutex::scoped_lock lk(_extSortMutex);
-        extSortIdxInterface = &_idxi;
-        extSortOrder = Ordering::make(_order);
-        _cur->sort( BSONObjExternalSorter::extSortComp );
+        _cur->sort( MyCmp( _idxi, _order ) );
     }
 
     void BSONObjExternalSorter::sort() {
@@ -105,7 +85,7 @@ namespace mongo {
 
         if ( _cur && _files.size() == 0 ) {
             _sortInMem();
-            log(1) << "\t\t not using file.  size:" << _curSizeSoFar << " _compares:" << _compares << endl;
+            log(1) << "\t\t not using file.  size:" << _curSizeSoFar << endl;
             return;
         }
 
@@ -184,71 +164,72 @@ namespace mongo {
 
     // ---------------------------------
 
-    BSONObjExternalSorter::Iterator::Iterator( BSONObjExternalSorter * sorter ) :
-        _cmp( sorter->_idxi, sorter->_order ) , _in( 0 ) {
-
-        for ( list<string>::iterator i=sorter->_files.begin(); i!=sorter->_files.end(); i++ ) {
-            _files.push_back( new FileIterator( *i ) );
-            _stash.push_back( pair<Data,bool>( Data( BSONObj() , DiskLoc() ) , false ) );
+    class BSONObjExternalSorter::Iterator::InMemoryIterator : public Run {
+    public:
+        InMemoryIterator( InMemory* in ) : _in( in ), _it( in->begin() ) {}
+        bool more() { return _it != _in->end(); }
+        Data next() {
+            Data d = *_it;
+            ++_it;
+            return d;
         }
+    private:
+        InMemory* _in;
+        InMemory::iterator _it;
+    };
 
-        if ( _files.size() == 0 && sorter->_cur ) {
-            _in = sorter->_cur;
-            _it = sorter->_cur->begin();
+    /*static*/
+    auto_ptr<BSONObjExternalSorter::Iterator> BSONObjExternalSorter::merge( const vector<BSONObjExternalSorter*>& sorters ) {
+        verify( ! sorters.empty() );
+        for ( unsigned i = 0; i < sorters.size(); i++ )
+            uassert( 10052 ,  "not sorted" , sorters[i]->_sorted );
+        return auto_ptr<Iterator>( new Iterator( sorters ) );
+    }
+
+    BSONObjExternalSorter::Iterator::Iterator( const vector<BSONObjExternalSorter*>& sorters ) :
+        _cmp( MyCmp( sorters[0]->_idxi, sorters[0]->_order ) ) {
+
+        for ( unsigned s = 0; s < sorters.size(); s++ ) {
+            BSONObjExternalSorter* sorter = sorters[s];
+            for ( list<string>::iterator i=sorter->_files.begin(); i!=sorter->_files.end(); i++ )
+                _runs.push_back( new FileIterator( *i ) );
+
+            if ( sorter->_files.size() == 0 && sorter->_cur )
+                _runs.push_back( new InMemoryIterator( sorter->_cur ) );
         }
+
+        _heap.reserve( _runs.size() );
+        for ( unsigned i = 0; i < _runs.size(); i++ )
+            _advance( i );
     }
 
     BSONObjExternalSorter::Iterator::~Iterator() {
-        for ( vector<FileIterator*>::iterator i=_files.begin(); i!=_files.end(); i++ )
+        for ( vector<Run*>::iterator i=_runs.begin(); i!=_runs.end(); i++ )
             delete *i;
-        _files.clear();
+        _runs.clear();
     }
 
-    bool BSONObjExternalSorter::Iterator::more() {
-
-        if ( _in )
-            return _it != _in->end();
+    void BSONObjExternalSorter::Iterator::_advance( unsigned run ) {
+        if ( ! _runs[run]->more() )
+            return;
+        Head h;
+        h.d = _runs[run]->next();
+        h.run = run;
+        _heap.push_back( h );
+        push_heap( _heap.begin(), _heap.end(), _cmp );
+    }
 
-        for ( vector<FileIterator*>::iterator i=_files.begin(); i!=_files.end(); i++ )
-            if ( (*i)->more() )
-                return true;
-        for ( vector< pair<Data,bool> >::iterator i=_stash.begin(); i!=_stash.end(); i++ )
-            if ( i->second )
-                return true;
-        return false;
+    bool BSONObjExternalSorter::Iterator::more() {
+        return ! _heap.empty();
     }
 
     BSONObjExternalSorter::Data BSONObjExternalSorter::Iterator::next() {
-
-        if ( _in ) {
-            Data& d = *_it;
-            ++_it;
-            return d;
-        }
-
-        Data best;
-        int slot = -1;
-
-        for ( unsigned i=0; i<_stash.size(); i++ ) {
-
-            if ( ! _stash[i].second ) {
-                if ( _files[i]->more() )
-                    _stash[i] = pair<Data,bool>( _files[i]->next() , true );
-                else
-                    continue;
-            }
-
-            if ( slot == -1 || _cmp( best , _stash[i].first ) == 0 ) {
-                best = _stash[i].first;
-                slot = i;
-            }
-
-        }
-
-        verify( slot >= 0 );
-        _stash[slot].second = false;
-
-        return best;
+        verify( ! _heap.empty() );
+        pop_heap( _heap.begin(), _heap.end(), _cmp );
+        Head best = _heap.back();
+        _heap.pop_back();
+        _advance( best.run );
+        return best.d;
     }
 
     // -----------------------------------
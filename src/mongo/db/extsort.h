@@ -39,27 +39,31 @@ namespace mongo {
         typedef pair<BSONObj,DiskLoc> Data;
  
     private:
-        static HLMutex _extSortMutex;
         IndexInterface& _idxi;
 
         static int _compare(IndexInterface& i, const Data& l, const Data& r, const Ordering& order);
 
+        /** no shared state, so sorters can sort their runs on separate threads */
         class MyCmp {
         public:
-            MyCmp( IndexInterface& i, BSONObj order = BSONObj() ) : _i(i), _order( Ordering::make(order) ) {}
+            MyCmp( IndexInterface& i, BSONObj order = BSONObj() ) : _i(&i), _order( Ordering::make(order) ) {}
             bool operator()( const Data &l, const Data &r ) const {
-                return _compare(_i, l, r, _order) < 0;
+                return _compare(*_i, l, r, _order) < 0;
             };
         private:
-            IndexInterface& _i;
-            const Ordering _order;
+            IndexInterface* _i;
+            Ordering _order;
         };
 
-        static IndexInterface *extSortIdxInterface;
-        static Ordering extSortOrder;
-        static int extSortComp( const void *lv, const void *rv );
+        /** a sorted run for the Iterator to merge */
+        class Run : boost::noncopyable {
+        public:
+            virtual ~Run() {}
+            virtual bool more() = 0;
+            virtual Data next() = 0;
+        };
 
-        class FileIterator : boost::noncopyable {
+        class FileIterator : public Run {
         public:
             FileIterator( string file );
             ~FileIterator();
@@ -75,22 +79,36 @@ namespace mongo {
 
         typedef FastArray<Data> InMemory;
 
+        /** k-way merge of the runs of one or more sorters */
         class Iterator : boost::noncopyable {
         public:
 
-            Iterator( BSONObjExternalSorter * sorter );
+            Iterator( const vector<BSONObjExternalSorter*>& sorters );
             ~Iterator();
             bool more();
             Data next();
 
         private:
-            MyCmp _cmp;
-            vector<FileIterator*> _files;
-            vector< pair<Data,bool> > _stash;
+            class InMemoryIterator;
+
+            struct Head {
+                Data d;
+                unsigned run;
+            };
+            /** orders the heap so the smallest head is on top */
+            class HeadCmp {
+            public:
+                HeadCmp( const MyCmp& cmp ) : _cmp( cmp ) {}
+                bool operator()( const Head& l, const Head& r ) const { return _cmp( r.d, l.d ); }
+            private:
+                MyCmp _cmp;
+            };
 
-            InMemory * _in;
-            InMemory::iterator _it;
+            void _advance( unsigned run );
 
+            HeadCmp _cmp;
+            vector<Run*> _runs;
+            vector<Head> _heap;
         };
 
         void add( const BSONObj& o , const DiskLoc & loc );
@@ -102,10 +120,15 @@ namespace mongo {
         void sort();
 
         auto_ptr<Iterator> iterator() {
-            uassert( 10052 ,  "not sorted" , _sorted );
-            return auto_ptr<Iterator>( new Iterator( this ) );
+            return merge( vector<BSONObjExternalSorter*>( 1, this ) );
         }
 
+        /**
+         * iterate the output of several sorters as one.  each must be sorted already, and all on
+         * the same IndexInterface and order.  they must outlive the iterator.
+         */
+        static auto_ptr<Iterator> merge( const vector<BSONObjExternalSorter*>& sorters );
+
         int numFiles() {
             return _files.size();
         }
@@ -135,7 +158,6 @@ namespace mongo {
         list<string> _files;
         bool _sorted;
 
-        static unsigned long long _compares;
         static unsigned long long _uniqueNumber;
     };
 }
@@ -219,7 +219,7 @@ namespace mongo {
                     it may not mean we can build the index version in question: we may not maintain building 
                     of indexes in old formats in the future.
         */
-        static bool isASupportedIndexVersionNumber(int v) { return (v&1)==v; } // v == 0 || v == 1
+        static bool isASupportedIndexVersionNumber(int v) { return v >= 0 && v <= 2; }
 
         /** @return the interface for this interface, which varies with the index version.
             used for backward compatibility of index versions/formats.
@@ -227,7 +227,7 @@ namespace mongo {
         IndexInterface& idxInterface() const { 
             int v = version();
             dassert( isASupportedIndexVersionNumber(v) );
-            return *iis[v&1];
+            return *iis[v];
         }
 
         static IndexInterface *iis[];
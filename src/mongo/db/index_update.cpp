@@ -28,6 +28,7 @@
 #include "mongo/db/namespace_details.h"
 #include "mongo/db/pdfile_private.h"
 #include "mongo/db/replutil.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/startup_test.h"
 
@@ -209,15 +210,149 @@ namespace mongo {
 
     SortPhaseOne *precalced = 0;
 
+    /**
+     * phase one of a foreground index build spread over helper threads.  the building thread
+     * walks the collection and deals the documents out in batches; each helper extracts keys into
+     * a sorter of its own, so runs are sorted and spilled to disk in parallel as well, and phase
+     * two merges the sorters.  the build's write lock keeps the documents in place until the
+     * helpers are done with them.
+     */
+    class ParallelSortPhaseOne : boost::noncopyable {
+    public:
+        ParallelSortPhaseOne( IndexDetails& idx, long long nrecords, int nThreads ) :
+            _spec( idx.getSpec() ), _nThreads( nThreads ), _phases( new SortPhaseOne[nThreads] ),
+            _filling( nThreads ), _working( nThreads ), _next( 0 ), _errMutex( "ParallelSortPhaseOne" ), _errCode( 0 ), _pool( nThreads ) {
+            for ( int i = 0; i < _nThreads; i++ ) {
+                // the helpers' in memory runs together use what one sorter would
+                _phases[i].sorter.reset( new BSONObjExternalSorter( idx.idxInterface(), idx.keyPattern(),
+                                                                    1024 * 1024 * 100 / _nThreads ) );
+                _phases[i].sorter->hintNumObjects( nrecords / _nThreads + 1 );
+                _filling[i].reserve( BatchSize );
+            }
+        }
+
+        /** o must stay valid until finish() */
+        void add( const BSONObj& o, const DiskLoc& loc ) {
+            _filling[_next].push_back( Doc( o, loc ) );
+            if ( _filling[_next].size() == BatchSize && ++_next == _nThreads )
+                _dispatch();
+        }
+
+        /** waits for the helpers and sorts; counts are totalled into total */
+        void finish( SortPhaseOne& total ) {
+            _dispatch();
+            _pool.join();
+            _rethrow();
+
+            for ( int i = 0; i < _nThreads; i++ )
+                _pool.schedule( &ParallelSortPhaseOne::_sort, this, i );
+            _pool.join();
+            _rethrow();
+
+            for ( int i = 0; i < _nThreads; i++ ) {
+                total.n += _phases[i].n;
+                total.nkeys += _phases[i].nkeys;
+                total.multi = total.multi || _phases[i].multi;
+            }
+        }
+
+        vector<BSONObjExternalSorter*> sorters() {
+            vector<BSONObjExternalSorter*> v;
+            for ( int i = 0; i < _nThreads; i++ )
+                v.push_back( _phases[i].sorter.get() );
+            return v;
+        }
+
+    private:
+        static const unsigned BatchSize = 1000;
+        typedef pair<BSONObj,DiskLoc> Doc;
+
+        /** hands the filled batches to the helpers, once they are done with the previous ones */
+        void _dispatch() {
+            _pool.join();
+            _rethrow();
+            killCurrentOp.checkForInterrupt();
+            _filling.swap( _working );
+            for ( int i = 0; i < _nThreads; i++ ) {
+                _filling[i].clear();
+                if ( !_working[i].empty() )
+                    _pool.schedule( &ParallelSortPhaseOne::_extract, this, i );
+            }
+            _next = 0;
+        }
+
+        static void _extract( ParallelSortPhaseOne* self, int i ) {
+            try {
+                const vector<Doc>& docs = self->_working[i];
+                for ( vector<Doc>::const_iterator d = docs.begin(); d != docs.end(); ++d )
+                    self->_phases[i].addKeys( self->_spec, d->first, d->second );
+            }
+            catch ( DBException& e ) {
+                self->_failed( e.getCode(), e.what() );
+            }
+            catch ( std::exception& e ) {
+                self->_failed( 16407, e.what() );
+            }
+        }
+
+        static void _sort( ParallelSortPhaseOne* self, int i ) {
+            try {
+                self->_phases[i].sorter->sort();
+            }
+            catch ( DBException& e ) {
+                self->_failed( e.getCode(), e.what() );
+            }
+            catch ( std::exception& e ) {
+                self->_failed( 16407, e.what() );
+            }
+        }
+
+        void _failed( int code, const string& msg ) {
+            scoped_lock lk( _errMutex );
+            if ( _errCode == 0 ) {
+                _errCode = code;
+                _errMsg = msg;
+            }
+        }
+
+        /** rethrows on the building thread what a helper ran into */
+        void _rethrow() {
+            scoped_lock lk( _errMutex );
+            if ( _errCode )
+                uasserted( _errCode, _errMsg );
+        }
+
+        const IndexSpec& _spec;
+        const int _nThreads;
+        scoped_array<SortPhaseOne> _phases;
+        vector< vector<Doc> > _filling;
+        vector< vector<Doc> > _working;     // only the helpers touch these while they run
+        int _next;                          // helper the batch being filled is for
+        mongo::mutex _errMutex;
+        int _errCode;
+        string _errMsg;
+        ThreadPool _pool;                   // last, so it is joined before the rest is destroyed
+    };
+
+    /** threads for a foreground build's phase one, 1 if it isn't worth spreading out */
+    static int indexBuildThreads( long long nrecords ) {
+        if ( nrecords < 10000 )
+            return 1;
+        int n = cmdLine.indexBuildThreads;
+        if ( n == 0 )
+            n = std::min( 8u, ProcessInfo().getNumCores() );
+        return std::max( n, 1 );
+    }
+
     template< class V >
-    void buildBottomUpPhases2And3(bool dupsAllowed, IndexDetails& idx, BSONObjExternalSorter& sorter, 
+    void buildBottomUpPhases2And3(bool dupsAllowed, IndexDetails& idx, const vector<BSONObjExternalSorter*>& sorters, 
         bool dropDups, set<DiskLoc> &dupsToDrop, CurOp * op, SortPhaseOne *phase1, ProgressMeterHolder &pm,
         Timer& t
         )
     {
         BtreeBuilder<V> btBuilder(dupsAllowed, idx);
         BSONObj keyLast;
-        auto_ptr<BSONObjExternalSorter::Iterator> i = sorter.iterator();
+        auto_ptr<BSONObjExternalSorter::Iterator> i = BSONObjExternalSorter::merge( sorters );
         verify( pm == op->setMessage( "index: (2/3) btree bottom up" , phase1->nkeys , 10 ) );
         while( i->more() ) {
             RARELY killCurrentOp.checkForInterrupt();
@@ -282,44 +417,67 @@ namespace mongo {
         ProgressMeterHolder pm( op->setMessage( "index: (1/3) external sort" , d->stats.nrecords , 10 ) );
         SortPhaseOne _ours;
         SortPhaseOne *phase1 = precalced;
+        scoped_ptr<ParallelSortPhaseOne> parallel;
         if( phase1 == 0 ) {
             phase1 = &_ours;
             SortPhaseOne& p1 = *phase1;
             shared_ptr<Cursor> c = theDataFileMgr.findAll(ns);
-            p1.sorter.reset( new BSONObjExternalSorter(idx.idxInterface(), order) );
-            p1.sorter->hintNumObjects( d->stats.nrecords );
+            int nThreads = indexBuildThreads( d->stats.nrecords );
+            if ( nThreads > 1 ) {
+                parallel.reset( new ParallelSortPhaseOne( idx, d->stats.nrecords, nThreads ) );
+                log(1) << "\t extracting and sorting keys on " << nThreads << " threads" << endl;
+            }
+            else {
+                p1.sorter.reset( new BSONObjExternalSorter(idx.idxInterface(), order) );
+                p1.sorter->hintNumObjects( d->stats.nrecords );
+            }
             const IndexSpec& spec = idx.getSpec();
+            unsigned long long n = 0;
             while ( c->ok() ) {
                 BSONObj o = c->current();
                 DiskLoc loc = c->currLoc();
-                p1.addKeys(spec, o, loc);
+                if ( parallel )
+                    parallel->add(o, loc);
+                else
+                    p1.addKeys(spec, o, loc);
                 c->advance();
                 pm.hit();
-                if ( logLevel > 1 && p1.n % 10000 == 0 ) {
+                if ( logLevel > 1 && ++n % 10000 == 0 ) {
                     printMemInfo( "\t iterating objects" );
                 }
             };
         }
         pm.finished();
 
-        BSONObjExternalSorter& sorter = *(phase1->sorter);
+        vector<BSONObjExternalSorter*> sorters;
+        if ( logLevel > 1 ) printMemInfo( "before final sort" );
+        if ( parallel ) {
+            parallel->finish( *phase1 );
+            sorters = parallel->sorters();
+        }
+        else {
+            phase1->sorter->sort();
+            sorters.push_back( phase1->sorter.get() );
+        }
+        if ( logLevel > 1 ) printMemInfo( "after final sort" );
 
         if( phase1->multi )
             d->setIndexIsMultikey(ns, idxNo);
 
-        if ( logLevel > 1 ) printMemInfo( "before final sort" );
-        phase1->sorter->sort();
-        if ( logLevel > 1 ) printMemInfo( "after final sort" );
-
-        log(t.seconds() > 5 ? 0 : 1) << "\t external sort used : " << sorter.numFiles() << " files " << " in " << t.seconds() << " secs" << endl;
+        int numFiles = 0;
+        for ( unsigned i = 0; i < sorters.size(); i++ )
+            numFiles += sorters[i]->numFiles();
+        log(t.seconds() > 5 ? 0 : 1) << "\t external sort used : " << numFiles << " files " << " in " << t.seconds() << " secs" << endl;
 
         set<DiskLoc> dupsToDrop;
 
         /* build index --- */
         if( idx.version() == 0 )
-            buildBottomUpPhases2And3<V0>(dupsAllowed, idx, sorter, dropDups, dupsToDrop, op, phase1, pm, t);
+            buildBottomUpPhases2And3<V0>(dupsAllowed, idx, sorters, dropDups, dupsToDrop, op, phase1, pm, t);
         else if( idx.version() == 1 ) 
-            buildBottomUpPhases2And3<V1>(dupsAllowed, idx, sorter, dropDups, dupsToDrop, op, phase1, pm, t);
+            buildBottomUpPhases2And3<V1>(dupsAllowed, idx, sorters, dropDups, dupsToDrop, op, phase1, pm, t);
+        else if( idx.version() == 2 ) 
+            buildBottomUpPhases2And3<V2>(dupsAllowed, idx, sorters, dropDups, dupsToDrop, op, phase1, pm, t);
         else
             verify(false);
 
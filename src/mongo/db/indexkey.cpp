@@ -406,7 +406,9 @@ namespace mongo {
                 g.getKeys( obj, keys );
                 break;
             }
-            case 1: {
+            case 1:
+            case 2: {
+                // v:2 differs from v:1 only in how buckets store the keys
                 KeyGeneratorV1 g( *this );
                 g.getKeys( obj, keys );
                 break;
@@ -558,7 +558,7 @@ namespace mongo {
         PageFaultRetryableSection s;
         while ( 1 ) {
             try {
-                Lock::DBWrite lk(ns);
+                Lock::CollectionWrite lk(ns);
                 
                 // void ReplSetImpl::relinquish() uses big write lock so 
                 // this is thus synchronized given our lock above.
@@ -596,7 +596,7 @@ namespace mongo {
         PageFaultRetryableSection s;
         while ( 1 ) {
             try {
-                Lock::DBWrite lk(ns);
+                Lock::CollectionWrite lk(ns);
                 
                 // writelock is used to synchronize stepdowns w/ writes
                 uassert( 10056 ,  "not master", isMasterNs( ns ) );
@@ -647,6 +647,12 @@ namespace mongo {
         bool exhaust = false;
         QueryResult* msgdata = 0;
         OpTime last;
+        scoped_ptr<GatheredReply> gathered;
+        int copiedLen = 0; // of a gathered reply, whose len counts the documents not in msgdata
+        if ( dbresponse.gatherPort && cmdLine.zeroCopyReplyMinBytes > 0 &&
+             dbresponse.gatherPort->canReplyGathered() ) {
+            gathered.reset( new GatheredReply( cmdLine.zeroCopyReplyMinBytes ) );
+        }
         while( 1 ) {
             try {
                 const NamespaceString nsString( ns );
@@ -666,7 +672,22 @@ namespace mongo {
 
                 // call this readlocked so state can't change
                 replVerifyReadsOk();
-                msgdata = processGetMore(ns, ntoreturn, cursorid, curop, pass, exhaust);
+                msgdata = processGetMore(ns, ntoreturn, cursorid, curop, pass, exhaust, gathered.get());
+
+                if ( msgdata && gathered && !gathered->empty() ) {
+                    // the documents left in the data files must be sent before the lock goes
+                    vector< pair< char *, int > > data;
+                    gathered->gather( msgdata, data );
+                    try {
+                        dbresponse.gatherPort->replyGathered( data, m.header()->id );
+                    }
+                    catch ( ... ) {
+                        free( msgdata );
+                        throw;
+                    }
+                    dbresponse.replied = true;
+                    copiedLen = msgdata->len - gathered->referencedBytes();
+                }
             }
             catch ( AssertionException& e ) {
                 ex.reset( new AssertionException( e.getInfo().msg, e.getCode() ) );
@@ -725,7 +746,7 @@ namespace mongo {
         }
 
         Message *resp = new Message();
-        resp->setData(msgdata, true);
+        resp->setData(msgdata, true, copiedLen);
         curop.debug().responseLength = resp->header()->dataLen();
         curop.debug().nreturned = msgdata->nReturned;
 
@@ -790,7 +811,7 @@ namespace mongo {
             multi.push_back( d.nextJsObj() );
         }
 
-        Lock::DBWrite lk(ns);
+        Lock::CollectionWrite lk(ns);
 
         // CONCURRENCY TODO: is being read locked in big log sufficient here?
         // writelock is used to synchronize stepdowns w/ writes
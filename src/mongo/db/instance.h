@@ -63,10 +63,17 @@ namespace mongo {
         Message *response;
         MSGID responseTo;
         const char *exhaust; /* points to ns if exhaust mode. 0=normal mode*/
-        DbResponse(Message *r, MSGID rt) : response(r), responseTo(rt), exhaust(0) { }
+        /* if set, a getMore may reply on this port before its read lock is released, sending large
+           documents straight from the data files (see zeroCopyReplyMinBytes) */
+        AbstractMessagingPort *gatherPort;
+        /* the response was sent on gatherPort already; response holds its header only, for exhaust */
+        bool replied;
+        DbResponse(Message *r, MSGID rt) : response(r), responseTo(rt), exhaust(0), gatherPort(0), replied(false) { }
         DbResponse() {
             response = 0;
             exhaust = 0;
+            gatherPort = 0;
+            replied = false;
         }
         ~DbResponse() { delete response; }
     };
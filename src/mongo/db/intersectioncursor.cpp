@@ -0,0 +1,134 @@
+// @file intersectioncursor.cpp - A cursor over the documents found by two index cursors.
+
+/**
+ *    Copyright (C) 2012 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pch.h"
+
+#include "mongo/db/intersectioncursor.h"
+
+#include "mongo/db/btree.h"
+#include "mongo/db/curop-inl.h"
+#include "mongo/db/matcher.h"
+
+namespace mongo {
+
+    IntersectionCursor::IntersectionCursor( BtreeCursor *first, BtreeCursor *second ) :
+        _first( first ),
+        _second( second ) {
+        intersect();
+    }
+
+    IntersectionCursor::~IntersectionCursor() {
+    }
+
+    void IntersectionCursor::intersect() {
+        while( _first->ok() && _second->ok() ) {
+            int cmp = _first->currLoc().compare( _second->currLoc() );
+            if ( cmp == 0 ) {
+                return;
+            }
+            killCurrentOp.checkForInterrupt();
+            if ( cmp < 0 ) {
+                _first->skipToLoc( _second->currLoc() );
+            }
+            else {
+                _second->skipToLoc( _first->currLoc() );
+            }
+        }
+    }
+
+    bool IntersectionCursor::ok() {
+        return _first->ok() && _second->ok();
+    }
+
+    Record* IntersectionCursor::_current() {
+        verify( ok() );
+        return _first->_current();
+    }
+
+    BSONObj IntersectionCursor::current() {
+        return BSONObj::make( _current() );
+    }
+
+    DiskLoc IntersectionCursor::currLoc() {
+        return ok() ? _first->currLoc() : DiskLoc();
+    }
+
+    bool IntersectionCursor::advance() {
+        if ( !ok() ) {
+            return false;
+        }
+        _first->advance();
+        intersect();
+        return ok();
+    }
+
+    BSONObj IntersectionCursor::currKey() const {
+        return _first->currKey();
+    }
+
+    DiskLoc IntersectionCursor::refLoc() {
+        return currLoc();
+    }
+
+    void IntersectionCursor::aboutToDeleteBucket( const DiskLoc &b ) {
+        _first->aboutToDeleteBucket( b );
+        _second->aboutToDeleteBucket( b );
+    }
+
+    BSONObj IntersectionCursor::indexKeyPattern() {
+        return _first->indexKeyPattern();
+    }
+
+    void IntersectionCursor::noteLocation() {
+        _first->noteLocation();
+        _second->noteLocation();
+    }
+
+    void IntersectionCursor::checkLocation() {
+        _first->checkLocation();
+        _second->checkLocation();
+        // A document either cursor was at may have been deleted, leaving them apart.
+        intersect();
+    }
+
+    string IntersectionCursor::toString() {
+        return string( "IntersectionCursor " ) + _first->toString() + ", " + _second->toString();
+    }
+
+    bool IntersectionCursor::getsetdup( DiskLoc loc ) {
+        // Both cursors scan a single key, so neither sees a document twice.
+        return false;
+    }
+
+    bool IntersectionCursor::isMultiKey() const {
+        return _first->isMultiKey() || _second->isMultiKey();
+    }
+
+    bool IntersectionCursor::modifiedKeys() const {
+        return _first->modifiedKeys() || _second->modifiedKeys();
+    }
+
+    BSONObj IntersectionCursor::prettyIndexBounds() const {
+        return BSON_ARRAY( _first->prettyIndexBounds() << _second->prettyIndexBounds() );
+    }
+
+    long long IntersectionCursor::nscanned() {
+        return _first->nscanned() + _second->nscanned();
+    }
+
+} // namespace mongo
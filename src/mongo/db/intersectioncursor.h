@@ -0,0 +1,83 @@
+// @file intersectioncursor.h - A cursor over the documents found by two index cursors.
+
+/**
+ *    Copyright (C) 2012 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "cursor.h"
+#include "diskloc.h"
+
+namespace mongo {
+
+    class BtreeCursor;
+
+    /**
+     * Iterates over the documents two BtreeCursors have in common.
+     *
+     * Each BtreeCursor must scan the entries of a single key in the forward direction, so that
+     * its entries come in DiskLoc order.  The cursors are merged by skipping whichever is behind
+     * to the other's DiskLoc, so only the keys between matches are examined and only documents in
+     * both indexes are returned.
+     *
+     * After advance() both cursors are at the current document.  The first cursor provides
+     * currKey() and indexKeyPattern(), so the matcher is a CoveredIndexMatcher for its index.
+     * Each BtreeCursor relocates itself after a yield, after which the two are merged again.
+     */
+    class IntersectionCursor : public Cursor {
+    public:
+        IntersectionCursor( BtreeCursor *first, BtreeCursor *second );
+        virtual ~IntersectionCursor();
+
+        virtual bool ok();
+        virtual Record* _current();
+        virtual BSONObj current();
+        virtual DiskLoc currLoc();
+        virtual bool advance();
+        virtual BSONObj currKey() const;
+        virtual DiskLoc refLoc();
+        virtual void aboutToDeleteBucket( const DiskLoc &b );
+        virtual BSONObj indexKeyPattern();
+        virtual bool supportGetMore() { return true; }
+        virtual void noteLocation();
+        virtual void checkLocation();
+        virtual bool supportYields() { return true; }
+        virtual string toString();
+        virtual bool getsetdup( DiskLoc loc );
+        virtual bool isMultiKey() const;
+        virtual bool modifiedKeys() const;
+        virtual BSONObj prettyIndexBounds() const;
+        virtual long long nscanned();
+
+        virtual CoveredIndexMatcher *matcher() const { return _matcher.get(); }
+        virtual shared_ptr<CoveredIndexMatcher> matcherPtr() const { return _matcher; }
+        virtual void setMatcher( shared_ptr<CoveredIndexMatcher> matcher ) { _matcher = matcher; }
+        virtual const Projection::KeyOnly *keyFieldsOnly() const { return _keyFieldsOnly.get(); }
+        virtual void setKeyFieldsOnly( const shared_ptr<Projection::KeyOnly> &keyFieldsOnly ) {
+            _keyFieldsOnly = keyFieldsOnly;
+        }
+
+    private:
+        /** Advance the cursors until they are at the same document, or one is exhausted. */
+        void intersect();
+
+        scoped_ptr<BtreeCursor> _first;
+        scoped_ptr<BtreeCursor> _second;
+        shared_ptr<CoveredIndexMatcher> _matcher;
+        shared_ptr<Projection::KeyOnly> _keyFieldsOnly;
+    };
+
+} // namespace mongo
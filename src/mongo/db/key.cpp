@@ -521,15 +521,15 @@ namespace mongo {
         return L.woCompare(R, order, /*considerfieldname*/false);
     }
 
-    int KeyV1::woCompare(const KeyV1& right, const Ordering &order) const {
-        const unsigned char *l = _keyData;
-        const unsigned char *r = right._keyData;
-
-        if( (*l|*r) == IsBSON ) // only can do this if cNOTUSED maintained
-            return compareHybrid(right, order);
-
+    /** compares compact format keys l and r.  if rPrefixEnd is set, r continues at rSuffix
+        once its elements reach rPrefixEnd. */
+    static int compareCompact(const unsigned char *l, const unsigned char *r,
+                              const unsigned char *rPrefixEnd, const unsigned char *rSuffix,
+                              const Ordering &order) {
         unsigned mask = 1;
         while( 1 ) { 
+            if( r == rPrefixEnd )
+                r = rSuffix;
             char lval = *l; 
             char rval = *r;
             {
@@ -555,6 +555,22 @@ namespace mongo {
         return 0;
     }
 
+    int KeyV1::woCompare(const KeyV1& right, const Ordering &order) const {
+        const unsigned char *l = _keyData;
+        const unsigned char *r = right._keyData;
+
+        if( (*l|*r) == IsBSON ) // only can do this if cNOTUSED maintained
+            return compareHybrid(right, order);
+
+        return compareCompact(l, r, 0, 0, order);
+    }
+
+    int KeyV1::woCompare(const char *prefix, int prefixSize, const char *suffix, const Ordering &order) const {
+        dassert( isCompactFormat() && prefixSize > 0 );
+        const unsigned char *r = (const unsigned char *) prefix;
+        return compareCompact(_keyData, r, r + prefixSize, (const unsigned char *) suffix, order);
+    }
+
     static unsigned sizes[] = {
         0,
         1, //cminkey=1,
@@ -604,6 +620,45 @@ namespace mongo {
         return p - _keyData;
     }
 
+    int KeyV1::commonPrefixSize(const char *a, const char *b, int limit) {
+        const unsigned char *l = (const unsigned char *) a;
+        const unsigned char *r = (const unsigned char *) b;
+        if( *l == IsBSON || *r == IsBSON )
+            return 0;
+
+        int common = 0;
+        while( common < limit ) {
+            // the type bytes (which include cHASMORE) and, for strings and bindata, the length
+            // bytes are checked first so we never compare past the end of r
+            if( l[common] != r[common] )
+                break;
+            unsigned sz = sizeOfElement(l + common);
+            if( sz > 1 && ( l[common+1] != r[common+1] || memcmp(l + common + 2, r + common + 2, sz - 2) ) )
+                break;
+            bool more = (l[common] & cHASMORE) != 0;
+            common += sz;
+            if( !more )
+                break;
+        }
+        return common;
+    }
+
+    int KeyV1::expand(const char *prefix, int prefixSize, const char *suffix, char *out) {
+        dassert( prefixSize > 0 );
+        memcpy(out, prefix, prefixSize);
+        int ofs = 0;
+        while( 1 ) {
+            const unsigned char *p = (const unsigned char *)
+                ( ofs < prefixSize ? out + ofs : suffix + ( ofs - prefixSize ) );
+            unsigned sz = sizeOfElement(p);
+            if( ofs >= prefixSize )
+                memcpy(out + ofs, p, sz);
+            ofs += sz;
+            if( (*p & cHASMORE) == 0 )
+                return ofs;
+        }
+    }
+
     bool KeyV1::woEqual(const KeyV1& right) const {
         const unsigned char *l = _keyData;
         const unsigned char *r = right._keyData;
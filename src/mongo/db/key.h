@@ -41,6 +41,11 @@ namespace mongo {
         BSONElement _firstElement() const { return _o.firstElement(); }
         bool isCompactFormat() const { return false; }
         bool woEqual(const KeyBson& r) const;
+        /** v:0 buckets are never prefix compressed, see KeyV1 */
+        int woCompare(const char *prefix, int prefixSize, const char *suffix, const Ordering &o) const {
+            verify(false);
+            return 0;
+        }
         void assign(const KeyBson& rhs) { *this = rhs; }
         bool isValid() const { return true; }
     private:
@@ -87,6 +92,22 @@ namespace mongo {
         bool isCompactFormat() const { return *_keyData != IsBSON; }
 
         bool isValid() const { return _keyData > (const unsigned char*)1; }
+
+        /* for prefix compressed (v:2) btree buckets, which store the leading bytes their keys
+           have in common once and only the remainder of each key */
+
+        /** @return the length of the common leading whole elements of the key data a and b, at
+                    most limit, which must fall on an element boundary of a.  0 for bson keys. */
+        static int commonPrefixSize(const char *a, const char *b, int limit);
+
+        /** writes the key stored as prefix + suffix to out, which must have room for KeyMax bytes.
+            @param prefixSize > 0 and from commonPrefixSize()
+            @return size of the key */
+        static int expand(const char *prefix, int prefixSize, const char *suffix, char *out);
+
+        /** woCompare() against the key stored as prefix + suffix, without expanding it.
+            this must be in compact format. */
+        int woCompare(const char *prefix, int prefixSize, const char *suffix, const Ordering &o) const;
     protected:
         enum { IsBSON = 0xff };
         const unsigned char *_keyData;
@@ -34,6 +34,7 @@ namespace mongo {
           _nestableCount(0), 
           _otherCount(0), 
           _otherLock(NULL),
+          _collectionLock(NULL),
           _scopedLk(NULL)
     {
     }
@@ -114,7 +115,15 @@ namespace mongo {
             if( k ) {
                 string s = ".";
                 s += k->name();
-                b.append(s, kind(_otherCount));
+                b.append(s, _collectionLock ? "w" : kind(_otherCount));
+            }
+        }
+        {
+            WrapperForRWLock *k = _collectionLock;
+            if( k ) {
+                string s = ".";
+                s += k->name();
+                b.append(s, "W");
             }
         }
         BSONObj o = b.obj();
@@ -141,6 +150,9 @@ namespace mongo {
             if( _otherCount ) {
                 ss << " otherdb:" << _otherName;
             }
+            if( _collectionLock ) {
+                ss << " collection:" << _collectionLock->name();
+            }
             if( _nestableCount ) {
                 ss << " nestableCount:" << _nestableCount << " which:";
                 if( _whichNestable == Lock::local ) 
@@ -204,5 +216,13 @@ namespace mongo {
         _otherLock = 0;
     }
 
+    void LockState::lockedCollection( WrapperForRWLock* lock ) {
+        fassert( 16400 , _collectionLock == 0 );
+        _collectionLock = lock;
+    }
+
+    void LockState::unlockedCollection() {
+        _collectionLock = 0;
+    }
 
 }
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "mongo/db/d_concurrency.h"
+#include "mongo/util/concurrency/qlock.h"
 
 namespace mongo {
 
@@ -71,6 +72,10 @@ namespace mongo {
         void lockedOther( const string& db , int type , WrapperForRWLock* lock );
         void lockedOther( int type );  // "same lock as last time" case 
         void unlockedOther();
+
+        WrapperForRWLock* collectionLock() const { return _collectionLock; }
+        void lockedCollection( WrapperForRWLock* lock );
+        void unlockedCollection();
         bool _batchWriter;
     private:
         unsigned _recursive;           // we allow recursively asking for a lock; we track that here
@@ -86,6 +91,10 @@ namespace mongo {
         string _otherName;             // which database are we locking and working with (besides local/admin) 
         WrapperForRWLock* _otherLock;  // so we don't have to check the map too often (the map has a mutex)
 
+        // collection level locking related -- when set, _otherLock is held in the intent mode ('w')
+        // and name() of this lock is the full ns
+        WrapperForRWLock* _collectionLock;
+
         // for temprelease
         // for the nonrecursive case. otherwise there would be many
         // the first lock goes here, which is ok since we can't yield recursive locks
@@ -93,16 +102,26 @@ namespace mongo {
         
     };
 
+    /** a database (or collection) lock.  a QLock so that besides the shared ('R') and exclusive
+        ('W') modes a db can be locked in the intent mode ('w'): Lock::CollectionWrite holders of
+        different collections share it, while readers and DBWrite exclude them.
+        QLock only makes way for a waiting W, so a waiting reader or intent writer holds 
+        _turnstile until it gets in -- otherwise a steady stream of the one would starve the other.
+        */
     class WrapperForRWLock : boost::noncopyable { 
-        SimpleRWLock r;
+        QLock q;
+        SimpleMutex _turnstile;
+        const string _name;
     public:
-        string name() const { return r.name; }
+        string name() const { return _name; }
         LockStat stats;
-        WrapperForRWLock(const char *name) : r(name) { }
-        void lock()          { LockStat::Acquiring a(stats,'W'); r.lock();          }
-        void lock_shared()   { LockStat::Acquiring a(stats,'R'); r.lock_shared();   }
-        void unlock()        { stats.unlocking('W');             r.unlock();        }
-        void unlock_shared() { stats.unlocking('R');             r.unlock_shared(); }
+        WrapperForRWLock(const char *name) : _turnstile(name), _name(name) { }
+        void lock()          { LockStat::Acquiring a(stats,'W'); q.lock_W(); }
+        void lock_shared()   { LockStat::Acquiring a(stats,'R'); SimpleMutex::scoped_lock lk(_turnstile); q.lock_R(); }
+        void lock_intent()   { LockStat::Acquiring a(stats,'w'); SimpleMutex::scoped_lock lk(_turnstile); q.lock_w(); }
+        void unlock()        { stats.unlocking('W');             q.unlock_W(); }
+        void unlock_shared() { stats.unlocking('R');             q.unlock_R(); }
+        void unlock_intent() { stats.unlocking('w');             q.unlock_w(); }
     };
 
 
@@ -146,7 +146,7 @@ namespace mongo {
     NOINLINE_DECL void NamespaceIndex::_init() {
         verify( !ht );
 
-        Lock::assertWriteLocked(database_);
+        Lock::assertWholeDBWriteLocked(database_);
 
         /* if someone manually deleted the datafiles for a database,
            we need to be sure to clear any cached info for the database in
@@ -454,7 +454,7 @@ namespace mongo {
     }
 
     void NamespaceIndex::kill_ns(const char *ns) {
-        Lock::assertWriteLocked(ns);
+        Lock::assertWholeDBWriteLocked(ns);
         if ( !ht )
             return;
         Namespace n(ns);
@@ -476,7 +476,7 @@ namespace mongo {
         add_ns( ns, details );
     }
     void NamespaceIndex::add_ns( const char *ns, const NamespaceDetails &details ) {
-        Lock::assertWriteLocked(ns);
+        Lock::assertWholeDBWriteLocked(ns);
         init();
         Namespace n(ns);
         uassert( 10081 , "too many namespaces/collections", ht->put(n, details));
@@ -484,7 +484,7 @@ namespace mongo {
 
     /* extra space for indexes when more than 10 */
     NamespaceDetails::Extra* NamespaceIndex::newExtra(const char *ns, int i, NamespaceDetails *d) {
-        Lock::assertWriteLocked(ns);
+        Lock::assertWholeDBWriteLocked(ns);
         verify( i >= 0 && i <= 1 );
         Namespace n(ns);
         Namespace extra(n.extraName(i).c_str()); // throws userexception if ns name too long
@@ -645,7 +645,7 @@ namespace mongo {
     // that is NOT handled here yet!  TODO
     // repair may not use nsdt though not sure.  anyway, requires work.
     NamespaceDetailsTransient::NamespaceDetailsTransient(Database *db, const char *ns) : 
-        _ns(ns), _keysComputed(false), _qcWriteCount() 
+        _ns(ns), _keysComputed(false), _qcWriteCount(), _qcMisses() 
     {
         dassert(db);
     }
@@ -653,6 +653,58 @@ namespace mongo {
     NamespaceDetailsTransient::~NamespaceDetailsTransient() { 
     }
 
+    void NamespaceDetailsTransient::clearUnpinnedQueryPlans() {
+        map<QueryPattern,CachedQueryPlan>::iterator i = _qcCache.begin();
+        while( i != _qcCache.end() ) {
+            if ( i->second.pinned() )
+                ++i;
+            else
+                _qcCache.erase( i++ );
+        }
+        _qcWriteCount = 0;
+    }
+
+    void NamespaceDetailsTransient::registerCachedQueryPlanForPattern( const QueryPattern &pattern,
+                                                                      const CachedQueryPlan &cachedQueryPlan ) {
+        CachedQueryPlan &cached = _qcCache[ pattern ];
+        if ( cached.pinned() && !cachedQueryPlan.pinned() && !cachedQueryPlan.indexKey().isEmpty() )
+            return;
+        CachedQueryPlan replaced = cached;
+        cached = cachedQueryPlan;
+        cached.inheritStats( replaced );
+    }
+
+    bool NamespaceDetailsTransient::noteCachedQueryPlanHit( const QueryPattern &pattern ) {
+        map<QueryPattern,CachedQueryPlan>::iterator i = _qcCache.find( pattern );
+        if ( i == _qcCache.end() || i->second.indexKey().isEmpty() )
+            return false;
+        i->second.noteHit();
+        return true;
+    }
+
+    bool NamespaceDetailsTransient::noteCachedQueryPlanReplan( const QueryPattern &pattern ) {
+        map<QueryPattern,CachedQueryPlan>::iterator i = _qcCache.find( pattern );
+        if ( i == _qcCache.end() || i->second.indexKey().isEmpty() )
+            return false;
+        i->second.noteReplan();
+        return true;
+    }
+
+    void NamespaceDetailsTransient::appendQueryCacheInfo( BSONObjBuilder &b ) const {
+        BSONArrayBuilder plans( b.subarrayStart( "plans" ) );
+        for( map<QueryPattern,CachedQueryPlan>::const_iterator i = _qcCache.begin(); i != _qcCache.end(); ++i ) {
+            if ( i->second.indexKey().isEmpty() )
+                continue;
+            BSONObjBuilder plan( plans.subobjStart() );
+            plan.appendElements( i->first.toBSON() );
+            plan.appendElements( i->second.toBSON() );
+            plan.done();
+        }
+        plans.done();
+        b.append( "misses", _qcMisses );
+        b.append( "writesSinceClear", _qcWriteCount );
+    }
+
     void NamespaceDetailsTransient::clearForPrefix(const char *prefix) {
         SimpleMutex::scoped_lock lk(_qcMutex);
         vector< string > found;
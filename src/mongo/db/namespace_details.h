@@ -20,6 +20,7 @@
 
 #include "pch.h"
 
+#include "mongo/db/cmdline.h"
 #include "mongo/db/d_concurrency.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/index.h"
@@ -190,7 +191,8 @@ namespace mongo {
         };
 
         enum UserFlags {
-            Flag_UsePowerOf2Sizes = 1 << 0
+            Flag_UsePowerOf2Sizes = 1 << 0,
+            Flag_Compressed = 1 << 1 // store new documents snappy compressed, see compressed_record.h
         };
 
         IndexDetails& idx(int idxNo, bool missingExpected = false );
@@ -537,8 +539,10 @@ namespace mongo {
         /* query cache (for query optimizer) ------------------------------------- */
     private:
         int _qcWriteCount;
+        long long _qcMisses;
         map<QueryPattern,CachedQueryPlan> _qcCache;
         static NamespaceDetailsTransient& make_inlock(const char *ns);
+        void clearUnpinnedQueryPlans();
     public:
         static SimpleMutex _qcMutex;
 
@@ -556,24 +560,36 @@ namespace mongo {
             return get_inlock(ns);
         }
 
+        /* clears pinned plans too, as the indexes they use may have changed */
         void clearQueryCache() {
             _qcCache.clear();
             _qcWriteCount = 0;
         }
-        /* you must notify the cache if you are doing writes, as query plan utility will change */
+        /* you must notify the cache if you are doing writes, as query plan utility will change.
+           after cmdLine.queryCacheWriteLimit writes the plans are dropped, except for pinned ones;
+           with a limit of 0 a plan is only replaced when it scans too much (see QueryPlanSet).
+        */
         void notifyOfWriteOp() {
-            if ( _qcCache.empty() )
+            if ( _qcCache.empty() || cmdLine.queryCacheWriteLimit == 0 )
                 return;
-            if ( ++_qcWriteCount >= 100 )
-                clearQueryCache();
+            if ( ++_qcWriteCount >= cmdLine.queryCacheWriteLimit )
+                clearUnpinnedQueryPlans();
         }
         CachedQueryPlan cachedQueryPlanForPattern( const QueryPattern &pattern ) {
-            return _qcCache[ pattern ];
+            map<QueryPattern,CachedQueryPlan>::const_iterator i = _qcCache.find( pattern );
+            if ( i == _qcCache.end() )
+                return CachedQueryPlan();
+            return i->second;
         }
+        /* a pinned plan is only replaced by another pinned plan, or an empty one (which unpins) */
         void registerCachedQueryPlanForPattern( const QueryPattern &pattern,
-                                               const CachedQueryPlan &cachedQueryPlan ) {
-            _qcCache[ pattern ] = cachedQueryPlan;
-        }
+                                               const CachedQueryPlan &cachedQueryPlan );
+        /* count a use of the plan cached for pattern, or a replan; false if there is none */
+        bool noteCachedQueryPlanHit( const QueryPattern &pattern );
+        bool noteCachedQueryPlanReplan( const QueryPattern &pattern );
+        void noteQueryCacheMiss() { ++_qcMisses; }
+        /* for the planCache command */
+        void appendQueryCacheInfo( BSONObjBuilder &b ) const;
 
     }; /* NamespaceDetailsTransient */
 
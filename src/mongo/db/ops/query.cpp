@@ -80,8 +80,75 @@ namespace mongo {
         return qr;
     }
 
-    QueryResult* processGetMore(const char *ns, int ntoreturn, long long cursorid , CurOp& curop, int pass, bool& exhaust ) {
+    GatheredReply::GatheredReply( int minBytes ) :
+        _minBytes( minBytes ),
+        _referencedBytes() {
+    }
+
+    bool GatheredReply::reference( int offset, const BSONObj &obj, const DiskLoc &loc ) {
+        if ( obj.objsize() < _minBytes || loc.isNull() ) {
+            return false;
+        }
+        // Only a document read straight from its record stays valid once 'obj' is gone.
+        if ( obj.objdata() != loc.rec()->data() ) {
+            return false;
+        }
+        _references.push_back( make_pair( offset, obj ) );
+        _referencedBytes += obj.objsize();
+        return true;
+    }
+
+    void GatheredReply::materialize( BufBuilder &b ) {
+        if ( _references.empty() ) {
+            return;
+        }
+        // Grow the buffer, then fill it from the end, moving each run back past the documents
+        // that precede it.
+        int runEnd = b.len();
+        b.skip( _referencedBytes );
+        char *buf = b.buf();
+        int end = b.len();
+        for( vector< pair< int, BSONObj > >::reverse_iterator i = _references.rbegin();
+             i != _references.rend(); ++i ) {
+            int run = runEnd - i->first;
+            end -= run;
+            memmove( buf + end, buf + i->first, run );
+            end -= i->second.objsize();
+            memcpy( buf + end, i->second.objdata(), i->second.objsize() );
+            runEnd = i->first;
+        }
+        verify( end == runEnd );
+        clear();
+    }
+
+    void GatheredReply::gather( QueryResult *qr, vector< pair< char *, int > > &data ) const {
+        char *buf = reinterpret_cast< char* >( qr );
+        int copied = qr->len - _referencedBytes;
+        int runStart = 0;
+        for( vector< pair< int, BSONObj > >::const_iterator i = _references.begin();
+             i != _references.end(); ++i ) {
+            if ( i->first > runStart ) {
+                data.push_back( make_pair( buf + runStart, i->first - runStart ) );
+            }
+            data.push_back( make_pair( const_cast< char* >( i->second.objdata() ),
+                                       i->second.objsize() ) );
+            runStart = i->first;
+        }
+        if ( copied > runStart ) {
+            data.push_back( make_pair( buf + runStart, copied - runStart ) );
+        }
+    }
+
+    void GatheredReply::clear() {
+        _references.clear();
+        _referencedBytes = 0;
+    }
+
+    QueryResult* processGetMore(const char *ns, int ntoreturn, long long cursorid , CurOp& curop, int pass, bool& exhaust, GatheredReply *gathered ) {
         exhaust = false;
+        if ( gathered ) {
+            gathered->clear();
+        }
         ClientCursor::Pin p(cursorid);
         ClientCursor *cc = p.c();
 
@@ -117,6 +184,12 @@ namespace mongo {
             // This manager may be stale, but it's the state of chunking when the cursor was created.
             ShardChunkManagerPtr manager = cc->getChunkManager();
 
+            // A yield may let the referenced documents change, so they're copied first.
+            boost::function<void()> beforeYield;
+            if ( gathered ) {
+                beforeYield = boost::bind( &GatheredReply::materialize, gathered, boost::ref( b ) );
+            }
+
             while ( 1 ) {
                 if ( !c->ok() ) {
                     if ( c->tailable() ) {
@@ -155,9 +228,10 @@ namespace mongo {
                         last = c->currLoc();
                         n++;
 
-                        cc->fillQueryResultFromObj( b );
+                        cc->fillQueryResultFromObj( b, gathered );
 
-                        if ( ( ntoreturn && n >= ntoreturn ) || b.len() > MaxBytesToReturnToClientAtOnce ) {
+                        int len = b.len() + ( gathered ? gathered->referencedBytes() : 0 );
+                        if ( ( ntoreturn && n >= ntoreturn ) || len > MaxBytesToReturnToClientAtOnce ) {
                             c->advance();
                             cc->incPos( n );
                             break;
@@ -167,7 +241,8 @@ namespace mongo {
                 c->advance();
 
                 if ( ! cc->yieldSometimes( ( c->ok() && c->keyFieldsOnly() ) ?
-                                          ClientCursor::DontNeed : ClientCursor::WillNeed ) ) {
+                                          ClientCursor::DontNeed : ClientCursor::WillNeed,
+                                          0, beforeYield ) ) {
                     ClientCursor::erase(cursorid);
                     cursorid = 0;
                     cc = 0;
@@ -190,7 +265,7 @@ namespace mongo {
         }
 
         QueryResult *qr = (QueryResult *) b.buf();
-        qr->len = b.len();
+        qr->len = b.len() + ( gathered ? gathered->referencedBytes() : 0 );
         qr->setOperation(opReply);
         qr->_resultFlags() = resultFlags;
         qr->cursorId = cursorid;
@@ -538,12 +613,12 @@ namespace mongo {
             }
             _builder->resetBuf();
             fillQueryResultFromObj( _buf, 0, explainInfo->bson() );
-            result.appendData( _buf.buf(), _buf.len() );
+            result.appendData( _buf.buf(), _buf.len(), _buf.getSize() );
             _buf.decouple();
             return 1;
         }
         if ( _buf.len() > 0 ) {
-            result.appendData( _buf.buf(), _buf.len() );
+            result.appendData( _buf.buf(), _buf.len(), _buf.getSize() );
             _buf.decouple();
         }
         return _builder->bufferedMatches();
@@ -814,7 +889,7 @@ namespace mongo {
             }
         }
         
-        BufBuilder bb(sizeof(QueryResult)+resObject.objsize()+32);
+        PooledBufBuilder bb(sizeof(QueryResult)+resObject.objsize()+32);
         bb.skip(sizeof(QueryResult));
         
         curop.debug().idhack = true;
@@ -824,6 +899,7 @@ namespace mongo {
         }
         auto_ptr< QueryResult > qr;
         qr.reset( (QueryResult *) bb.buf() );
+        int capacity = bb.getSize();
         bb.decouple();
         qr->setResultFlagsToOk();
         qr->len = bb.len();
@@ -833,7 +909,7 @@ namespace mongo {
         qr->cursorId = 0;
         qr->startingFrom = 0;
         qr->nReturned = n;
-        result.setData( qr.release(), true );
+        result.setData( qr.release(), true, capacity );
         return true;
     }
     
@@ -867,7 +943,7 @@ namespace mongo {
         // Run a command.
         
         if ( pq.couldBeCommand() ) {
-            BufBuilder bb;
+            PooledBufBuilder bb;
             bb.skip(sizeof(QueryResult));
             BSONObjBuilder cmdResBuf;
             if ( runCommands(ns, jsobj, curop, bb, cmdResBuf, false, queryOptions) ) {
@@ -877,6 +953,7 @@ namespace mongo {
 
                 auto_ptr< QueryResult > qr;
                 qr.reset( (QueryResult *) bb.buf() );
+                int capacity = bb.getSize();
                 bb.decouple();
                 qr->setResultFlagsToOk();
                 qr->len = bb.len();
@@ -885,7 +962,7 @@ namespace mongo {
                 qr->cursorId = 0;
                 qr->startingFrom = 0;
                 qr->nReturned = 1;
-                result.setData( qr.release(), true );
+                result.setData( qr.release(), true, capacity );
             }
             else {
                 uasserted(13530, "bad or malformed command request?");
@@ -33,8 +33,53 @@ namespace mongo {
     class ParsedQuery;
     class QueryOptimizerCursor;
     class QueryPlanSummary;
-    
-    QueryResult* processGetMore(const char *ns, int ntoreturn, long long cursorid , CurOp& op, int pass, bool& exhaust);
+
+    /**
+     * The documents of a getMore reply that are left in place in the data files rather than copied
+     * into the reply buffer, each recorded with the offset in the buffer it belongs at.  The reply
+     * is then sent from the buffer's runs and the records themselves, so large documents aren't
+     * copied on their way to the socket.
+     *
+     * The references are only valid while the read lock is held.  Before yielding, materialize()
+     * copies them into the buffer; otherwise the reply must be sent before the lock is released.
+     */
+    class GatheredReply : boost::noncopyable {
+    public:
+        /** @param minBytes documents smaller than this are copied, as copying is cheaper. */
+        GatheredReply( int minBytes );
+
+        /**
+         * Leave 'obj', the record at 'loc', in place to be sent after the first 'offset' bytes of
+         * the buffer.
+         * @return false if 'obj' should be copied instead, being small or not in the data files.
+         */
+        bool reference( int offset, const BSONObj &obj, const DiskLoc &loc );
+
+        bool empty() const { return _references.empty(); }
+        int referencedBytes() const { return _referencedBytes; }
+
+        /** Copy the referenced documents into 'b', the reply so far, and forget them. */
+        void materialize( BufBuilder &b );
+
+        /**
+         * Append to 'data' the runs of 'qr', a reply whose len includes the referenced documents,
+         * interleaved with the documents.
+         */
+        void gather( QueryResult *qr, vector< pair< char *, int > > &data ) const;
+
+        void clear();
+
+    private:
+        const int _minBytes;
+        vector< pair< int, BSONObj > > _references;
+        int _referencedBytes;
+    };
+
+    /**
+     * @param gathered if set, large documents may be left in place for the reply rather than
+     * copied into the returned QueryResult, whose len includes them.
+     */
+    QueryResult* processGetMore(const char *ns, int ntoreturn, long long cursorid , CurOp& op, int pass, bool& exhaust, GatheredReply *gathered = 0);
 
     const char * runQuery(Message& m, QueryMessage& q, CurOp& curop, Message &result);
 
@@ -287,7 +332,7 @@ namespace mongo {
         const ParsedQuery &_parsedQuery;
         shared_ptr<Cursor> _cursor;
         shared_ptr<QueryOptimizerCursor> _queryOptimizerCursor;
-        BufBuilder _buf;
+        PooledBufBuilder _buf;
         ShardChunkManagerPtr _chunkManager;
         shared_ptr<ExplainRecordingStrategy> _explain;
         shared_ptr<ResponseBuildStrategy> _builder;
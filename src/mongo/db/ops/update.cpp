@@ -87,7 +87,7 @@ namespace mongo {
             const BSONObj& onDisk = loc.obj();
             auto_ptr<ModSetState> mss = mods->prepare( onDisk );
 
-            if( mss->canApplyInPlace() ) {
+            if( mss->canApplyInPlace() && ! CompressedRecord::isCompressed( r->data() ) ) {
                 mss->applyModsInPlace(true);
                 DEBUGUPDATE( "\t\t\t updateById doing in place update" );
             }
@@ -353,7 +353,9 @@ namespace mongo {
 
                     auto_ptr<ModSetState> mss = useMods->prepare( onDisk );
 
-                    bool willAdvanceCursor = multi && c->ok() && ( modsIsIndexed || ! mss->canApplyInPlace() );
+                    // a compressed record is rewritten, onDisk is only a copy of it
+                    const bool inPlace = mss->canApplyInPlace() && ! CompressedRecord::isCompressed( r->data() );
+                    bool willAdvanceCursor = multi && c->ok() && ( modsIsIndexed || ! inPlace );
 
                     if ( willAdvanceCursor ) {
                         if ( cc.get() ) {
@@ -362,7 +364,7 @@ namespace mongo {
                         c->prepareToTouchEarlierIterate();
                     }
 
-                    if ( modsIsIndexed <= 0 && mss->canApplyInPlace() ) {
+                    if ( modsIsIndexed <= 0 && inPlace ) {
                         mss->applyModsInPlace( true );// const_cast<BSONObj&>(onDisk) );
 
                         DEBUGUPDATE( "\t\t\t doing in place update" );
@@ -267,6 +267,12 @@ namespace mongo {
             }
         }
 
+        const bool compressed = options["compressed"].trueValue();
+        if ( compressed && ( newCapped || NamespaceString( ns ).isSystem() ) ) {
+            err = "capped and system collections can't be compressed";
+            return false;
+        }
+
         // $nExtents just for debug/testing.
         BSONElement e = options.getField( "$nExtents" );
         Database *database = cc().database();
@@ -342,6 +348,10 @@ namespace mongo {
             d->replaceUserFlags( options["flags"].numberInt() );
         }
 
+        if ( compressed ) {
+            d->setUserFlag( NamespaceDetails::Flag_Compressed );
+        }
+
         return true;
     }
 
@@ -1076,7 +1086,16 @@ namespace mongo {
         uassert( 13596 , str::stream() << "cannot change _id of a document old:" << objOld << " new:" << objNew , ! changedId );
         dupCheck(changes, *d, dl);
 
-        if ( toupdate->netLength() < objNew.objsize() ) {
+        const char* stored = objNew.objdata();
+        int storedSize = objNew.objsize();
+        string compressed;
+        if ( d->isUserFlagSet( NamespaceDetails::Flag_Compressed ) &&
+                CompressedRecord::compress( objNew, &compressed ) ) {
+            stored = compressed.data();
+            storedSize = compressed.size();
+        }
+
+        if ( toupdate->netLength() < storedSize ) {
             // doesn't fit.  reallocate -----------------------------------------------------
             uassert( 10003 , "failing update: objects in a capped ns cannot grow", !(d && d->isCapped()));
             d->paddingTooSmall();
@@ -1136,8 +1155,7 @@ namespace mongo {
         }
 
         //  update in place
-        int sz = objNew.objsize();
-        memcpy(getDur().writingPtr(toupdate->data(), sz), objNew.objdata(), sz);
+        memcpy(getDur().writingPtr(toupdate->data(), storedSize), stored, storedSize);
         return dl;
     }
 
@@ -1198,10 +1216,10 @@ namespace mongo {
             strcpy(_id, "_id");
             verify( sizeof(IDToInsert_) == 17 );
         }
-    } idToInsert_;
+    };
     struct IDToInsert : public BSONElement {
-        IDToInsert() : BSONElement( ( char * )( &idToInsert_ ) ) {}
-    } idToInsert;
+        IDToInsert( IDToInsert_& id ) : BSONElement( ( char * )( &id ) ) {}
+    };
 #pragma pack()
 
     void DataFileMgr::insertAndLog( const char *ns, const BSONObj &o, bool god, bool fromMigrate ) {
@@ -1407,6 +1425,10 @@ namespace mongo {
             d = insert_newNamespace(ns, len, god);
         }
 
+        // per insert, as writers of other collections of the db may be inserting at the same time
+        IDToInsert_ idToInsert_;
+        IDToInsert idToInsert( idToInsert_ );
+
         NamespaceDetails *tableToIndex = 0;
 
         string tabletoidxns;
@@ -1445,6 +1467,25 @@ namespace mongo {
             BSONElementManipulator::lookForTimestamps( io );
         }
 
+        BSONObj uncompressed; // when compressing, the document we index
+        string compressed;
+        if ( !god && d->isUserFlagSet( NamespaceDetails::Flag_Compressed ) ) {
+            if ( addID ) {
+                BSONObjBuilder b( len );
+                b.append( idToInsert );
+                b.appendElements( BSONObj( (const char *) obuf ) );
+                uncompressed = b.obj();
+            }
+            else {
+                uncompressed = BSONObj( (const char *) obuf );
+            }
+            if ( CompressedRecord::compress( uncompressed, &compressed ) ) {
+                obuf = compressed.data();
+                len = compressed.size();
+                addID = 0;
+            }
+        }
+
         int lenWHdr = d->getRecordAllocationSize( len + Record::HeaderSize );
 
         // If the collection is capped, check if the new object will violate a unique index
@@ -1478,7 +1519,7 @@ namespace mongo {
             // add record to indexes using two step method so we can do the reading outside a write lock
             if ( d->nIndexes ) {
                 verify( obuf );
-                BSONObj obj((const char *) obuf);
+                BSONObj obj = compressed.empty() ? BSONObj((const char *) obuf) : uncompressed;
                 try {
                     indexRecordUsingTwoSteps(ns, d, obj, loc, true);
                 }
@@ -1530,7 +1571,7 @@ namespace mongo {
         /* add this record to our indexes */
         if ( !earlyIndex && d->nIndexes ) {
             try {
-                BSONObj obj(r->data());
+                BSONObj obj = BSONObj::make(r);
                 // not sure which of these is better -- either can be used.  oldIndexRecord may be faster, 
                 // but twosteps handles dup key errors more efficiently.
                 //oldIndexRecord(d, obj, loc);
@@ -26,6 +26,7 @@
 #pragma once
 
 #include "mongo/db/client.h"
+#include "mongo/db/compressed_record.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/jsobjmanipulator.h"
 #include "mongo/db/memconcept.h"
@@ -612,7 +613,10 @@ namespace mongo {
     void ensureHaveIdIndex(const char *ns);
 
     inline BSONObj BSONObj::make(const Record* r ) {
-        return BSONObj( r->data() );
+        const char* data = r->data();
+        if ( CompressedRecord::isCompressed( data ) )
+            return CompressedRecord::uncompress( data );
+        return BSONObj( data );
     }
     
 } // namespace mongo
@@ -245,10 +245,11 @@ namespace mongo {
         static intrusive_ptr<Accumulator> create(
             const intrusive_ptr<ExpressionContext> &pCtx);
 
-    private:
+        /* the names of the fields in a shard's partial result */
         static const char subTotalName[];
         static const char countName[];
 
+    private:
         AccumulatorAvg(const intrusive_ptr<ExpressionContext> &pCtx);
 
         mutable long long count;
@@ -56,4 +56,9 @@ namespace mongo {
         return true;
     }
 
+    void DependencyTracker::getPaths(set<string> *pPaths) const {
+        for(MapType::const_iterator i(map.begin()); i != map.end(); ++i)
+            pPaths->insert((*i).first);
+    }
+
 }
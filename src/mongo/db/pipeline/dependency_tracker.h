@@ -37,6 +37,13 @@ namespace mongo {
         bool getDependency(intrusive_ptr<const DocumentSource> *ppSource,
                            const string &fieldPath) const;
 
+        /**
+           Get the field paths that are depended on.
+
+           @param pPaths the paths are added to this
+         */
+        void getPaths(set<string> *pPaths) const;
+
     private:
         struct Tracker {
             Tracker(const string &fieldPath,
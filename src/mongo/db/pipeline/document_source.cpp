@@ -57,6 +57,11 @@ namespace mongo {
 #endif /* MONGO_LATER_SERVER_4644 */
     }
 
+    DocumentSource::GetDepsReturn DocumentSource::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        return NOT_SUPPORTED;
+    }
+
     bool DocumentSource::advance() {
         pExpCtx->checkForInterrupt(); // might not return
         return false;
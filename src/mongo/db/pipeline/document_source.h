@@ -18,6 +18,7 @@
 
 #include "pch.h"
 
+#include <boost/thread/thread.hpp>
 #include <boost/unordered_map.hpp>
 #include "util/intrusive_counter.h"
 #include "client/parallel.h"
@@ -27,6 +28,7 @@
 #include "db/pipeline/document.h"
 #include "db/pipeline/expression.h"
 #include "db/pipeline/value.h"
+#include "util/queue.h"
 #include "util/string_writer.h"
 
 namespace mongo {
@@ -39,6 +41,7 @@ namespace mongo {
     class ExpressionFieldPath;
     class ExpressionObject;
     class Matcher;
+    class SpillSorter;
 
     class DocumentSource :
         public IntrusiveCounterUnsigned,
@@ -156,6 +159,33 @@ namespace mongo {
         virtual void manageDependencies(
             const intrusive_ptr<DependencyTracker> &pTracker);
 
+        /**
+           How the fields a source uses relate to those used after it; see
+           getDependencies().
+         */
+        enum GetDepsReturn {
+            NOT_SUPPORTED, // the fields used can't be told
+            SEE_NEXT, // the sources that follow may use other fields too
+            EXHAUSTIVE // the documents produced are made from these fields
+        };
+
+        /**
+           Get the fields this source uses from the documents it is given.
+
+           A source that produces new documents from some fields of its input
+           (such as $project or $group) is EXHAUSTIVE:  the sources after it
+           can't need anything else from the input.  This is used to find the
+           fields a pipeline needs from a collection, so that they may be
+           read from an index instead.
+
+           The default implementation returns NOT_SUPPORTED.
+
+           @param pTracker the fields used are added to this
+           @returns whether the fields used by the following sources are needed
+         */
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
+
         /**
           Add the DocumentSource to the array builder.
 
@@ -271,25 +301,60 @@ namespace mongo {
         /* convenient shorthand for a commonly used type */
         typedef list<shared_ptr<Future::CommandResult> > FuturesList;
 
+        /*
+          A command for one shard.  It is run on a joiner thread of its own,
+          so it must get its connection there, and return the result once
+          it has joined it.
+         */
+        typedef boost::function<shared_ptr<Future::CommandResult> ()> Request;
+        typedef list<Request> RequestList;
+
         /**
-          Create a DocumentSource that wraps a list of Command::Futures.
+          Create a DocumentSource that runs a list of shard commands.
+
+          The results are consumed in the order in which they arrive, so
+          that the merge can start on the first shard's results while the
+          others are still working.
 
           @param errmsg place to write error messages to; must exist for the
             lifetime of the created DocumentSourceCommandFutures
-          @param pList the list of futures
+          @param requests the commands to run
           @param pExpCtx the expression context for the pipeline
           @returns the newly created DocumentSource
          */
         static intrusive_ptr<DocumentSourceCommandFutures> create(
-            string &errmsg, FuturesList *pList,
+            string &errmsg, const RequestList &requests,
+            const intrusive_ptr<ExpressionContext> &pExpCtx);
+
+        /**
+          Create a DocumentSource over results that have already arrived,
+          such as those taken from another one by nextArrived().
+         */
+        static intrusive_ptr<DocumentSourceCommandFutures> create(
+            string &errmsg, const FuturesList &results,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
+        /**
+          Take the next successful result as it arrives, rather than its
+          documents; don't mix this with eof() and advance().  Failures
+          are written to errmsg, and skipped.
+
+          @returns the result, or NULL if there are no more
+          @throws RecvStaleConfigException if a shard's config was stale
+         */
+        shared_ptr<Future::CommandResult> nextArrived();
+
+        /**
+          @returns true if any of the commands has failed so far
+         */
+        bool hasFailed() const;
+
     protected:
         // virtuals from DocumentSource
         virtual void sourceToBson(BSONObjBuilder *pBuilder, bool explain) const;
 
     private:
-        DocumentSourceCommandFutures(string &errmsg, FuturesList *pList,
+        DocumentSourceCommandFutures(string &errmsg, size_t nResults,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
         /**
@@ -301,11 +366,30 @@ namespace mongo {
          */
         void getNextDocument();
 
+        /*
+          A request's outcome:  its result, or what it threw instead.
+         */
+        struct Arrival {
+            shared_ptr<Future::CommandResult> pResult;
+            shared_ptr<RecvStaleConfigException> pStale;
+            string error;
+        };
+
+        /*
+          Run the given request on a joiner thread, and queue up what
+          came of it as arrived.
+         */
+        void runRequest(Request request);
+
         bool newSource; // set to true for the first item of a new source
         intrusive_ptr<DocumentSourceBsonArray> pBsonSource;
         intrusive_ptr<Document> pCurrent;
-        FuturesList::iterator iterator;
-        FuturesList::iterator listEnd;
+        shared_ptr<Future::CommandResult> pShardResult; // arrays refer to it
+        deque<BSONElement> arrays; // pShardResult's arrays still to read
+        size_t nPending; // requests that haven't been taken from arrived
+        BlockingQueue<Arrival> arrived;
+        boost::thread_group joiners;
+        bool failed;
         string &errmsg;
     };
 
@@ -369,12 +453,56 @@ namespace mongo {
          */
         void setSort(const shared_ptr<BSONObj> &pBsonObj);
 
+        /*
+          Record the fields the pipeline uses, as a projection, if they are
+          known.  An empty projection means no fields are used.
+
+          When the cursor's plan can make the documents from its index keys
+          the records aren't read; the projection is also used for explain.
+
+          @param pBsonObj the projection to record
+         */
+        void setProjection(const shared_ptr<BSONObj> &pBsonObj);
+
+        /**
+           Add a BSONObj dependency.
+
+           Some Cursor creation functions rely on BSON objects to specify
+           their query predicate or sort.  These often take a BSONObj
+           by reference for these, but do not copy it.  As a result, the
+           BSONObjs specified must outlive the Cursor.  In order to ensure
+           that, use this to preserve a pointer to the BSONObj here.
+
+           From the outside, you must also make sure the BSONObjBuilder
+           creates a lasting copy of the data, otherwise it will go away
+           when the builder goes out of scope.  Therefore, the typical usage
+           pattern for this is 
+           {
+               BSONObjBuilder builder;
+               // do stuff to the builder
+               shared_ptr<BSONObj> pBsonObj(new BSONObj(builder.obj()));
+               pDocumentSourceCursor->addBsonDependency(pBsonObj);
+           }
+
+           @param pBsonObj pointer to the BSON object to preserve
+         */
+        void addBsonDependency(const shared_ptr<BSONObj> &pBsonObj);
+
         /**
            Release the cursor, but without changing the other data.  This
            is used for the explain version of pipeline execution.
          */
         void releaseCursor();
 
+        /**
+           Save the cursor's position before the lock is released between
+           the batches of an aggregate command's cursor result, and restore
+           it once the lock is held again.  The restore throws if the
+           collection or database went away in the meantime.
+         */
+        void prepareToYield();
+        void recoverFromYield();
+
     protected:
         // virtuals from DocumentSource
         virtual void sourceToBson(BSONObjBuilder *pBuilder, bool explain) const;
@@ -396,6 +524,7 @@ namespace mongo {
          */
         shared_ptr<BSONObj> pQuery;
         shared_ptr<BSONObj> pSort;
+        shared_ptr<BSONObj> pProjection;
         vector<shared_ptr<BSONObj> > bsonDependencies;
         shared_ptr<Cursor> pCursor;
 
@@ -403,6 +532,7 @@ namespace mongo {
           In order to yield, we need a ClientCursor.
          */
         ClientCursor::Holder pClientCursor;
+        ClientCursor::YieldData yieldData;
 
         /*
           Advance the cursor, and yield sometimes.
@@ -413,6 +543,13 @@ namespace mongo {
          */
         void advanceAndYield();
 
+        /*
+          Does making the current document need its record?  Not if the
+          pipeline uses no fields, or if they can all be taken from the
+          index key.
+         */
+        bool needRecord();
+
         /*
           This document source hangs on to the dependency tracker when it
           gets it so that it can be used for selective reification of
@@ -420,31 +557,6 @@ namespace mongo {
           pipeline.
          */
         intrusive_ptr<DependencyTracker> pDependencies;
-
-        /**
-           (5/14/12 - moved this to private because it's not used atm)
-           Add a BSONObj dependency.
-
-           Some Cursor creation functions rely on BSON objects to specify
-           their query predicate or sort.  These often take a BSONObj
-           by reference for these, but do not copy it.  As a result, the
-           BSONObjs specified must outlive the Cursor.  In order to ensure
-           that, use this to preserve a pointer to the BSONObj here.
-
-           From the outside, you must also make sure the BSONObjBuilder
-           creates a lasting copy of the data, otherwise it will go away
-           when the builder goes out of scope.  Therefore, the typical usage
-           pattern for this is 
-           {
-               BSONObjBuilder builder;
-               // do stuff to the builder
-               shared_ptr<BSONObj> pBsonObj(new BSONObj(builder.obj()));
-               pDocumentSourceCursor->addBsonDependency(pBsonObj);
-           }
-
-           @param pBsonObj pointer to the BSON object to preserve
-         */
-        void addBsonDependency(const shared_ptr<BSONObj> &pBsonObj);
     };
 
 
@@ -569,6 +681,9 @@ namespace mongo {
         virtual bool advance();
         virtual const char *getSourceName() const;
         virtual intrusive_ptr<Document> getCurrent();
+        virtual void optimize();
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
 
         /**
           Create a new grouping DocumentSource.
@@ -651,10 +766,6 @@ namespace mongo {
 
         intrusive_ptr<Expression> pIdExpression;
 
-        typedef boost::unordered_map<intrusive_ptr<const Value>,
-            vector<intrusive_ptr<Accumulator> >, Value::Hash> GroupsType;
-        GroupsType groups;
-
         /*
           The field names for the result documents and the accumulator
           factories for the result documents.  The Expressions are the
@@ -672,12 +783,99 @@ namespace mongo {
             const intrusive_ptr<ExpressionContext> &)> vpAccumulatorFactory;
         vector<intrusive_ptr<Expression> > vpExpression;
 
+        /*
+          $sum, $avg, $min, $max, $first and $last are accumulated in place,
+          in an AccumulatorState in the group table, rather than by an
+          Accumulator made for each group.  vAccumulatorOp parallels the
+          vectors above; NotInline is for the others ($push, $addToSet),
+          for which the state holds an Accumulator from the factory.
+         */
+        enum AccumulatorOp {
+            NotInline, Sum, Avg, Min, Max, First, Last
+        };
+        vector<AccumulatorOp> vAccumulatorOp;
+
+        struct AccumulatorState {
+            BSONType totalType; // $sum and $avg
+            long long longTotal;
+            double doubleTotal;
+            long long count; // $avg
+            intrusive_ptr<const Value> pValue; // $min, $max, $first, $last
+            intrusive_ptr<Accumulator> pAccumulator; // NotInline
+        };
+
+        /*
+          The groups, in the order they were first seen, and their
+          accumulator states, vFieldName.size() to a group, in the same
+          order.  Keeping them in two flat vectors saves allocating a map
+          node and a vector of accumulators for each group.
+         */
+        struct Group {
+            size_t hash;
+            intrusive_ptr<const Value> pId;
+        };
+        vector<Group> groups;
+        vector<AccumulatorState> states;
+
+        /*
+          The groups are looked up in an open addressing hash table with
+          linear probing.  Each slot holds a group's index in groups plus
+          one, or zero if it is empty.  The number of slots is a power of
+          two, and the table is doubled when it becomes half full.
+         */
+        vector<size_t> slots;
+        static const size_t initialSlots = 1024;
+
+        /*
+          Find the group with the given _id, adding it (with fresh
+          accumulator states) if there isn't one yet.
+
+          @param pId the _id
+          @returns the index of the group in groups
+         */
+        size_t findGroup(const intrusive_ptr<const Value> &pId);
+        void growSlots();
+        void clearGroups();
+
+        /* the context used by the accumulators of the groups */
+        intrusive_ptr<ExpressionContext> pGroupCtx;
+
+        void accumulate(size_t i, AccumulatorState *pState,
+                        const intrusive_ptr<Document> &pDocument);
+        intrusive_ptr<const Value> getStateValue(
+            size_t i, const AccumulatorState &state) const;
+        static intrusive_ptr<const Value> getSumValue(
+            const AccumulatorState &state);
 
+        intrusive_ptr<Document> makeDocument(size_t group);
         intrusive_ptr<Document> makeDocument(
-            const GroupsType::iterator &rIter);
+            const intrusive_ptr<const Value> &pId,
+            const vector<intrusive_ptr<Accumulator> > &accumulators);
 
-        GroupsType::iterator groupsIterator;
+        size_t groupsPosition; // the group pCurrent was made from
         intrusive_ptr<Document> pCurrent;
+
+        /*
+          If the pipeline allows disk use, groups are spilled once they take
+          more than the context's spill bytes; the sorter is made by the
+          first spill, so nothing touches the disk before then.  A spill
+          writes each group's partial result (as a shard would send it to
+          mongos) to the sorter, keyed by _id and the spill number; at the
+          end, the partial results for each _id are read back together and
+          combined by accumulators that merge them, as mongos does.
+
+          The accumulators for the groups use pSpillCtx, so their partial
+          results can be had by setting it in shard while spilling.
+         */
+        boost::scoped_ptr<SpillSorter> pSorter;
+        intrusive_ptr<ExpressionContext> pSpillCtx;
+        intrusive_ptr<ExpressionContext> pMergeCtx;
+        size_t memUsed;
+        int nSpills;
+        BSONObj nextSpilled; // next partial result to merge, empty at the end
+
+        void spill();
+        intrusive_ptr<Document> mergeSpilled();
     };
 
 
@@ -741,19 +939,28 @@ namespace mongo {
         virtual intrusive_ptr<Document> getCurrent();
 
         /**
-          Create a document source for output and pass-through.
+          Create a document source for output, from { $out : <collection> }.
 
-          This can be put anywhere in a pipeline and will store content as
-          well as pass it on.
+          This must be the last stage of a pipeline.  It passes the
+          documents on unchanged; the command running the pipeline writes
+          them to a temporary collection in batches, and then renames that
+          over the output collection, which lives in the same database as
+          the input.  Only mongod can do that (see PipelineCommand).
 
           @param pBsonElement the raw BSON specification for the source
           @param pExpCtx the expression context for the pipeline
           @returns the newly created document source
         */
-        static intrusive_ptr<DocumentSourceOut> createFromBson(
+        static intrusive_ptr<DocumentSource> createFromBson(
             BSONElement *pBsonElement,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
 
+        /**
+          @returns the name of the collection to write to, without the
+            database name
+         */
+        string getOutputCollection() const;
+
         static const char outName[];
 
     protected:
@@ -761,8 +968,10 @@ namespace mongo {
         virtual void sourceToBson(BSONObjBuilder *pBuilder, bool explain) const;
 
     private:
-        DocumentSourceOut(BSONElement *pBsonElement,
+        DocumentSourceOut(const string &outputCollection,
             const intrusive_ptr<ExpressionContext> &pExpCtx);
+
+        string outputCollection;
     };
 
     
@@ -778,6 +987,8 @@ namespace mongo {
         virtual void optimize();
         virtual void manageDependencies(
             const intrusive_ptr<DependencyTracker> &pTracker);
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
 
         /**
           Create a new DocumentSource that can implement projection.
@@ -899,6 +1110,37 @@ namespace mongo {
             const intrusive_ptr<DependencyTracker> &pTracker;
             const DocumentSourceProject *pThis;
         };
+
+        /*
+          Utility object used by getDependencies().
+
+          Adds the included paths to a DependencyTracker, and notes whether
+          any paths are excluded.
+         */
+        class DependencyAdder :
+            public ExpressionObject::PathSink {
+        public:
+            // virtuals from PathSink
+            virtual void path(const string &path, bool include);
+
+            /*
+              Constructor.
+
+              @param pTracker reference to the smart pointer to the
+                DependencyTracker to add paths to
+              @param pThis the projection that is making this request
+             */
+            DependencyAdder(
+                const intrusive_ptr<DependencyTracker> &pTracker,
+                const DocumentSourceProject *pThis);
+
+            /* true if some path other than _id is excluded */
+            bool excluded;
+
+        private:
+            const intrusive_ptr<DependencyTracker> &pTracker;
+            const DocumentSourceProject *pThis;
+        };
     };
 
 
@@ -913,11 +1155,19 @@ namespace mongo {
         virtual intrusive_ptr<Document> getCurrent();
         virtual void manageDependencies(
             const intrusive_ptr<DependencyTracker> &pTracker);
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
+        virtual void addToBsonArray(BSONArrayBuilder *pBuilder,
+            bool explain = false) const;
+
         /*
+          Absorb a following $limit, so that only that many documents are
+          kept while sorting.
+
           TODO
           Adjacent sorts should reduce to the last sort.
+         */
         virtual bool coalesce(const intrusive_ptr<DocumentSource> &pNextSource);
-        */
 
         /**
           Create a new sorting DocumentSource.
@@ -983,6 +1233,14 @@ namespace mongo {
         bool populated;
         long long count;
 
+        /*
+          The limit absorbed from a following $limit, or zero if there is
+          none.  With a limit, populate() keeps only the first documents in
+          sort order in a heap as it goes, rather than all of them.
+         */
+        long long limit;
+        void populateTopK();
+
         /* these two parallel each other */
         typedef vector<intrusive_ptr<ExpressionFieldPath> > SortPaths;
         SortPaths vSortKey;
@@ -1024,6 +1282,20 @@ namespace mongo {
 
         VectorType::iterator docIterator;
         intrusive_ptr<Document> pCurrent;
+
+        /*
+          If the pipeline allows disk use, and the documents outgrow the
+          context's spill bytes, they are sorted by a SpillSorter instead of
+          in the vector above.  Each is added with its sort key values and
+          input position in front of it, and they are read back one at a
+          time.
+         */
+        boost::scoped_ptr<SpillSorter> pSorter;
+        void populateSpilled();
+        void sortDocuments();
+        void addToSorter(const intrusive_ptr<Document> &pDocument,
+                         long long position);
+        intrusive_ptr<Document> nextSpilled();
     };
 
 
@@ -1037,6 +1309,10 @@ namespace mongo {
         virtual intrusive_ptr<Document> getCurrent();
         virtual const char *getSourceName() const;
         virtual bool coalesce(const intrusive_ptr<DocumentSource> &pNextSource);
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
+
+        long long getLimit() const;
 
         /**
           Create a new limiting DocumentSource.
@@ -1088,6 +1364,8 @@ namespace mongo {
         virtual intrusive_ptr<Document> getCurrent();
         virtual const char *getSourceName() const;
         virtual bool coalesce(const intrusive_ptr<DocumentSource> &pNextSource);
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
 
         /**
           Create a new skipping DocumentSource.
@@ -1145,6 +1423,8 @@ namespace mongo {
         virtual intrusive_ptr<Document> getCurrent();
         virtual void manageDependencies(
             const intrusive_ptr<DependencyTracker> &pTracker);
+        virtual GetDepsReturn getDependencies(
+            const intrusive_ptr<DependencyTracker> &pTracker) const;
 
         /**
           Create a new DocumentSource that can implement unwind.
@@ -1236,7 +1516,19 @@ namespace mongo {
     inline int DocumentSource::getPipelineStep() const {
         return step;
     }
+
+    inline bool DocumentSourceCommandFutures::hasFailed() const {
+        return failed;
+    }
     
+    inline string DocumentSourceOut::getOutputCollection() const {
+        return outputCollection;
+    }
+
+    inline long long DocumentSourceLimit::getLimit() const {
+        return limit;
+    }
+
     inline void DocumentSourceGroup::setIdExpression(
         const intrusive_ptr<Expression> &pExpression) {
         pIdExpression = pExpression;
@@ -1254,6 +1546,14 @@ namespace mongo {
         pThis(pT) {
     }
 
+    inline DocumentSourceProject::DependencyAdder::DependencyAdder(
+        const intrusive_ptr<DependencyTracker> &pTrack,
+        const DocumentSourceProject *pT):
+        excluded(false),
+        pTracker(pTrack),
+        pThis(pT) {
+    }
+
     inline void DocumentSourceUnwind::resetArray() {
         pNoUnwindDocument.reset();
         pUnwindArray.reset();
@@ -21,6 +21,8 @@
 namespace mongo {
 
     DocumentSourceCommandFutures::~DocumentSourceCommandFutures() {
+        /* the joiners refer to this */
+        joiners.join_all();
     }
 
     bool DocumentSourceCommandFutures::eof() {
@@ -60,69 +62,145 @@ namespace mongo {
     }
 
     DocumentSourceCommandFutures::DocumentSourceCommandFutures(
-        string &theErrmsg, FuturesList *pList,
+        string &theErrmsg, size_t nResults,
         const intrusive_ptr<ExpressionContext> &pExpCtx):
         DocumentSource(pExpCtx),
         newSource(false),
         pBsonSource(),
         pCurrent(),
-        iterator(pList->begin()),
-        listEnd(pList->end()),
+        pShardResult(),
+        arrays(),
+        nPending(nResults),
+        arrived(),
+        joiners(),
+        failed(false),
         errmsg(theErrmsg) {
     }
 
+    void DocumentSourceCommandFutures::runRequest(Request request) {
+        Arrival arrival;
+        try {
+            arrival.pResult = request();
+        }
+        catch(RecvStaleConfigException &e) {
+            /* this has to reach the command, so it can be retried */
+            arrival.pStale.reset(new RecvStaleConfigException(e));
+        }
+        catch(std::exception &e) {
+            arrival.error = e.what();
+        }
+
+        arrived.push(arrival);
+    }
+
+    intrusive_ptr<DocumentSourceCommandFutures>
+    DocumentSourceCommandFutures::create(
+        string &errmsg, const RequestList &requests,
+        const intrusive_ptr<ExpressionContext> &pExpCtx) {
+        intrusive_ptr<DocumentSourceCommandFutures> pSource(
+            new DocumentSourceCommandFutures(
+                errmsg, requests.size(), pExpCtx));
+
+        for(RequestList::const_iterator i(requests.begin()),
+                listEnd(requests.end()); i != listEnd; ++i) {
+            pSource->joiners.create_thread(
+                boost::bind(&DocumentSourceCommandFutures::runRequest,
+                            pSource.get(), *i));
+        }
+        return pSource;
+    }
+
     intrusive_ptr<DocumentSourceCommandFutures>
     DocumentSourceCommandFutures::create(
-        string &errmsg, FuturesList *pList,
+        string &errmsg, const FuturesList &results,
         const intrusive_ptr<ExpressionContext> &pExpCtx) {
         intrusive_ptr<DocumentSourceCommandFutures> pSource(
-            new DocumentSourceCommandFutures(errmsg, pList, pExpCtx));
+            new DocumentSourceCommandFutures(
+                errmsg, results.size(), pExpCtx));
+
+        /* these are already done, so there's nothing to wait for */
+        for(FuturesList::const_iterator i(results.begin()),
+                listEnd(results.end()); i != listEnd; ++i) {
+            Arrival arrival;
+            arrival.pResult = *i;
+            pSource->arrived.push(arrival);
+        }
         return pSource;
     }
 
+    shared_ptr<Future::CommandResult>
+    DocumentSourceCommandFutures::nextArrived() {
+        while(nPending) {
+            /* grab whichever command result arrives next */
+            Arrival arrival(arrived.blockingPop());
+            --nPending;
+
+            if (arrival.pStale)
+                throw *arrival.pStale;
+
+            if (!arrival.pResult) {
+                error() << "sharded pipeline failed: " << arrival.error <<
+                    endl;
+                errmsg += "-- mongod pipeline failed: ";
+                errmsg += arrival.error;
+                failed = true;
+                continue;
+            }
+
+            if (!arrival.pResult->ok()) {
+                error() << "sharded pipeline failed on shard: " <<
+                    arrival.pResult->getServer() << " error: " <<
+                    arrival.pResult->result() << endl;
+                errmsg += "-- mongod pipeline failed: ";
+                errmsg += arrival.pResult->result().toString();
+                failed = true;
+                continue;
+            }
+
+            return arrival.pResult;
+        }
+
+        return shared_ptr<Future::CommandResult>();
+    }
+
     void DocumentSourceCommandFutures::getNextDocument() {
         while(true) {
             if (!pBsonSource.get()) {
-                /* if there aren't any more futures, we're done */
-                if (iterator == listEnd) {
-                    pCurrent.reset();
-                    return;
-                }
-
-                /* grab the next command result */
-                shared_ptr<Future::CommandResult> pResult(*iterator);
-                ++iterator;
-
-                /* try to wait for it */
-                if (!pResult->join()) {
-                    error() << "sharded pipeline failed on shard: " <<
-                        pResult->getServer() << " error: " <<
-                        pResult->result() << endl;
-                    errmsg += "-- mongod pipeline failed: ";
-                    errmsg += pResult->result().toString();
+                if (arrays.empty()) {
+                    /* if there aren't any more results, we're done */
+                    pShardResult = nextArrived();
+                    if (!pShardResult) {
+                        pCurrent.reset();
+                        return;
+                    }
 
-                    /* move on to the next command future */
+                    /*
+                      Grab the result array out of the shard server's
+                      response, or the arrays it was split up into for a
+                      merge on the shards.
+                    */
+                    BSONObj shardResult(pShardResult->result());
+                    BSONElement resultElement(shardResult["result"]);
+                    if (resultElement.type() == Array)
+                        arrays.push_back(resultElement);
+                    BSONElement partitionsElement(shardResult["partitions"]);
+                    if (partitionsElement.type() == Array) {
+                        BSONObjIterator partitionIterator(
+                            partitionsElement.embeddedObject());
+                        while(partitionIterator.more())
+                            arrays.push_back(partitionIterator.next());
+                    }
                     continue;
                 }
 
-                /* grab the result array out of the shard server's response */
-                BSONObj shardResult(pResult->result());
-                BSONObjIterator objIterator(shardResult);
-                while(objIterator.more()) {
-                    BSONElement element(objIterator.next());
-                    const char *pFieldName = element.fieldName();
-
-                    /* find the result array and quit this loop */
-                    if (strcmp(pFieldName, "result") == 0) {
-                        pBsonSource = DocumentSourceBsonArray::create(
-                            &element, pExpCtx);
-                        newSource = true;
-                        break;
-                    }
-                }
+                BSONElement element(arrays.front());
+                arrays.pop_front();
+                pBsonSource = DocumentSourceBsonArray::create(
+                    &element, pExpCtx);
+                newSource = true;
             }
 
-            /* if we're done with this shard's results, try the next */
+            /* if we're done with this array, try the next */
             if (pBsonSource->eof() ||
                 (!newSource && !pBsonSource->advance())) {
                 pBsonSource.reset();
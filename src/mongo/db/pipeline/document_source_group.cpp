@@ -23,6 +23,7 @@
 #include "db/pipeline/document.h"
 #include "db/pipeline/expression.h"
 #include "db/pipeline/expression_context.h"
+#include "db/pipeline/spill_sorter.h"
 #include "db/pipeline/value.h"
 
 namespace mongo {
@@ -39,7 +40,10 @@ namespace mongo {
         if (!populated)
             populate();
 
-        return (groupsIterator == groups.end());
+        if (nSpills)
+            return !pCurrent;
+
+        return (groupsPosition >= groups.size());
     }
 
     bool DocumentSourceGroup::advance() {
@@ -48,18 +52,44 @@ namespace mongo {
         if (!populated)
             populate();
 
-        verify(groupsIterator != groups.end());
+        if (nSpills) {
+            verify(pCurrent);
+            pCurrent = mergeSpilled();
+            return pCurrent.get() != NULL;
+        }
+
+        verify(groupsPosition < groups.size());
 
-        ++groupsIterator;
-        if (groupsIterator == groups.end()) {
+        ++groupsPosition;
+        if (groupsPosition == groups.size()) {
             pCurrent.reset();
             return false;
         }
 
-        pCurrent = makeDocument(groupsIterator);
+        pCurrent = makeDocument(groupsPosition);
         return true;
     }
 
+    void DocumentSourceGroup::optimize() {
+        pIdExpression = pIdExpression->optimize();
+
+        const size_t n = vpExpression.size();
+        for(size_t i = 0; i < n; ++i)
+            vpExpression[i] = vpExpression[i]->optimize();
+    }
+
+    DocumentSource::GetDepsReturn DocumentSourceGroup::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        /* the groups are made from the _id and the accumulated fields alone */
+        pIdExpression->addDependencies(pTracker, this);
+
+        const size_t n = vpExpression.size();
+        for(size_t i = 0; i < n; ++i)
+            vpExpression[i]->addDependencies(pTracker, this);
+
+        return EXHAUSTIVE;
+    }
+
     intrusive_ptr<Document> DocumentSourceGroup::getCurrent() {
         if (!populated)
             populate();
@@ -97,10 +127,16 @@ namespace mongo {
         DocumentSource(pExpCtx),
         populated(false),
         pIdExpression(),
-        groups(),
         vFieldName(),
         vpAccumulatorFactory(),
-        vpExpression() {
+        vpExpression(),
+        vAccumulatorOp(),
+        groups(),
+        states(),
+        slots(),
+        groupsPosition(0),
+        memUsed(0),
+        nSpills(0) {
     }
 
     void DocumentSourceGroup::addAccumulator(
@@ -292,6 +328,50 @@ namespace mongo {
     }
 
     void DocumentSourceGroup::populate() {
+        const size_t nAccumulators = vpAccumulatorFactory.size();
+
+        /* the sorter itself isn't made until the first spill */
+        const bool canSpill = pExpCtx->canSpill();
+        pGroupCtx = pExpCtx;
+        bool chargeDocuments = false;
+        if (canSpill) {
+            pSpillCtx = pExpCtx->clone();
+            pGroupCtx = pSpillCtx;
+
+            /*
+              What $push and $addToSet collect isn't measured, so for those
+              charge whole documents, which is an upper bound.
+            */
+            for(size_t i = 0; i < nAccumulators; ++i) {
+                if ((vpAccumulatorFactory[i] == AccumulatorPush::create) ||
+                    (vpAccumulatorFactory[i] == AccumulatorAddToSet::create))
+                    chargeDocuments = true;
+            }
+        }
+
+        /* pick out the accumulators that can be kept in the group table */
+        vAccumulatorOp.clear();
+        for(size_t i = 0; i < nAccumulators; ++i) {
+            AccumulatorOp op = NotInline;
+            if (vpAccumulatorFactory[i] == AccumulatorSum::create)
+                op = Sum;
+            else if (vpAccumulatorFactory[i] == AccumulatorAvg::create)
+                op = Avg;
+            else if (vpAccumulatorFactory[i] == AccumulatorMinMax::createMin)
+                op = Min;
+            else if (vpAccumulatorFactory[i] == AccumulatorMinMax::createMax)
+                op = Max;
+            else if (vpAccumulatorFactory[i] == AccumulatorFirst::create)
+                op = First;
+            else if (vpAccumulatorFactory[i] == AccumulatorLast::create)
+                op = Last;
+            vAccumulatorOp.push_back(op);
+        }
+
+        slots.assign(initialSlots, 0);
+        groups.reserve(initialSlots / 2);
+        states.reserve(initialSlots / 2 * nAccumulators);
+
         for(bool hasNext = !pSource->eof(); hasNext;
                 hasNext = pSource->advance()) {
             intrusive_ptr<Document> pDocument(pSource->getCurrent());
@@ -303,66 +383,355 @@ namespace mongo {
             if (pId->getType() == Undefined)
                 pId = Value::getNull();
 
-            /*
-              Look for the _id value in the map; if it's not there, add a
-              new entry with a blank accumulator.
-            */
-            vector<intrusive_ptr<Accumulator> > *pGroup;
-            GroupsType::iterator it(groups.find(pId));
-            if (it != groups.end()) {
-                /* point at the existing accumulators */
-                pGroup = &it->second;
+            /* tickle all the accumulators for the group we found */
+            AccumulatorState *pStates =
+                &states[findGroup(pId) * nAccumulators];
+            for(size_t i = 0; i < nAccumulators; ++i)
+                accumulate(i, &pStates[i], pDocument);
+
+            if (canSpill) {
+                if (chargeDocuments)
+                    memUsed += pDocument->getApproximateSize();
+                if (memUsed > pExpCtx->getSpillBytes())
+                    spill();
             }
-            else {
-                /* insert a new group into the map */
-                groups.insert(it,
-                              pair<intrusive_ptr<const Value>,
-                              vector<intrusive_ptr<Accumulator> > >(
-                                  pId, vector<intrusive_ptr<Accumulator> >()));
-
-                /* find the accumulator vector (the map value) */
-                it = groups.find(pId);
-                pGroup = &it->second;
-
-                /* add the accumulators */
-                const size_t n = vpAccumulatorFactory.size();
-                pGroup->reserve(n);
-                for(size_t i = 0; i < n; ++i) {
-                    intrusive_ptr<Accumulator> pAccumulator(
-                        (*vpAccumulatorFactory[i])(pExpCtx));
-                    pAccumulator->addOperand(vpExpression[i]);
-                    pGroup->push_back(pAccumulator);
+        }
+
+        if (nSpills) {
+            /* spill the rest too, then merge everything from the sorter */
+            spill();
+            pSorter->sort();
+
+            pMergeCtx = pExpCtx->clone();
+            pMergeCtx->setInRouter(true);
+
+            nextSpilled = pSorter->more() ? pSorter->next() : BSONObj();
+            pCurrent = mergeSpilled();
+            populated = true;
+            return;
+        }
+
+        /* the groups come out in the order they were first seen */
+        groupsPosition = 0;
+        if (!groups.empty())
+            pCurrent = makeDocument(groupsPosition);
+        populated = true;
+    }
+
+    size_t DocumentSourceGroup::findGroup(
+        const intrusive_ptr<const Value> &pId) {
+        const size_t hash = Value::Hash()(pId);
+        const size_t mask = slots.size() - 1;
+
+        size_t slot = hash & mask;
+        for(; slots[slot]; slot = (slot + 1) & mask) {
+            const Group &group = groups[slots[slot] - 1];
+            if ((group.hash == hash) &&
+                (Value::compare(group.pId, pId) == 0))
+                return slots[slot] - 1;
+        }
+
+        /* add a new group with blank accumulators */
+        const size_t index = groups.size();
+        Group group;
+        group.hash = hash;
+        group.pId = pId;
+        groups.push_back(group);
+        slots[slot] = index + 1;
+
+        const size_t nAccumulators = vAccumulatorOp.size();
+        AccumulatorState state;
+        state.totalType = NumberInt;
+        state.longTotal = 0;
+        state.doubleTotal = 0;
+        state.count = 0;
+        for(size_t i = 0; i < nAccumulators; ++i) {
+            if (vAccumulatorOp[i] == NotInline) {
+                state.pAccumulator = (*vpAccumulatorFactory[i])(pGroupCtx);
+                state.pAccumulator->addOperand(vpExpression[i]);
+            }
+            states.push_back(state);
+            state.pAccumulator.reset();
+        }
+
+        /* roughly, the key, the group, its slots and its states */
+        memUsed += pId->getApproximateSize() + sizeof(Group) +
+            2 * sizeof(size_t) + nAccumulators * sizeof(AccumulatorState);
+
+        if (groups.size() * 2 > slots.size())
+            growSlots();
+
+        return index;
+    }
+
+    void DocumentSourceGroup::growSlots() {
+        slots.assign(slots.size() * 2, 0);
+        const size_t mask = slots.size() - 1;
+
+        /* the hashes are kept, so the _ids needn't be hashed again */
+        const size_t n = groups.size();
+        for(size_t i = 0; i < n; ++i) {
+            size_t slot = groups[i].hash & mask;
+            while(slots[slot])
+                slot = (slot + 1) & mask;
+            slots[slot] = i + 1;
+        }
+    }
+
+    void DocumentSourceGroup::clearGroups() {
+        groups.clear();
+        states.clear();
+        std::fill(slots.begin(), slots.end(), 0);
+    }
+
+    void DocumentSourceGroup::accumulate(
+        size_t i, AccumulatorState *pState,
+        const intrusive_ptr<Document> &pDocument) {
+        const AccumulatorOp op = vAccumulatorOp[i];
+        if (op == NotInline) {
+            pState->pAccumulator->evaluate(pDocument);
+            return;
+        }
+
+        /* $first doesn't need to look at anything after the first */
+        if ((op == First) && pState->pValue)
+            return;
+
+        intrusive_ptr<const Value> prhs(vpExpression[i]->evaluate(pDocument));
+
+        switch(op) {
+        case Avg:
+            if (pGroupCtx->getInRouter()) {
+                /* a partial result from a shard, or a spill */
+                verify(prhs->getType() == Object);
+                intrusive_ptr<Document> pShardDoc(prhs->getDocument());
+
+                intrusive_ptr<const Value> pSubTotal(
+                    pShardDoc->getValue(AccumulatorAvg::subTotalName));
+                verify(pSubTotal.get());
+                BSONType subTotalType = pSubTotal->getType();
+                if ((pState->totalType == NumberLong) ||
+                    (subTotalType == NumberLong))
+                    pState->totalType = NumberLong;
+                if ((pState->totalType == NumberDouble) ||
+                    (subTotalType == NumberDouble))
+                    pState->totalType = NumberDouble;
+
+                if (subTotalType == NumberInt) {
+                    int v = pSubTotal->getInt();
+                    pState->longTotal += v;
+                    pState->doubleTotal += v;
+                }
+                else if (subTotalType == NumberLong) {
+                    long long v = pSubTotal->getLong();
+                    pState->longTotal += v;
+                    pState->doubleTotal += v;
+                }
+                else {
+                    pState->doubleTotal += pSubTotal->getDouble();
                 }
+
+                pState->count += pShardDoc->getValue(
+                    AccumulatorAvg::countName)->getLong();
+                break;
             }
 
-            /* point at the existing key */
-            // unneeded atm // pId = it.first;
+            ++pState->count;
+            /* fall through to sum it */
+
+        case Sum:
+            /* upgrade to the widest type required to hold the result */
+            pState->totalType = Value::getWidestNumeric(
+                pState->totalType, prhs->getType());
+
+            if (pState->totalType == NumberInt) {
+                int v = prhs->coerceToInt();
+                pState->longTotal += v;
+                pState->doubleTotal += v;
+            }
+            else if (pState->totalType == NumberLong) {
+                long long v = prhs->coerceToLong();
+                pState->longTotal += v;
+                pState->doubleTotal += v;
+            }
+            else { /* (totalType == NumberDouble) */
+                pState->doubleTotal += prhs->coerceToDouble();
+            }
+            break;
+
+        case Min:
+        case Max:
+            if (!pState->pValue ||
+                (Value::compare(pState->pValue, prhs) *
+                 (op == Min ? 1 : -1) > 0))
+                pState->pValue = prhs;
+            break;
+
+        case First:
+        case Last:
+            pState->pValue = prhs;
+            break;
+
+        case NotInline:
+            verify(false);
+        }
+    }
+
+    intrusive_ptr<const Value> DocumentSourceGroup::getStateValue(
+        size_t i, const AccumulatorState &state) const {
+        switch(vAccumulatorOp[i]) {
+        case NotInline:
+            return state.pAccumulator->getValue();
+
+        case Avg:
+            if (!pGroupCtx->getInShard()) {
+                double avg = 0;
+                if (state.count) {
+                    if (state.totalType != NumberDouble)
+                        avg = static_cast<double>(
+                            state.longTotal / state.count);
+                    else
+                        avg = state.doubleTotal / state.count;
+                }
+
+                return Value::createDouble(avg);
+            }
+            else {
+                intrusive_ptr<Document> pDocument(Document::create());
+                pDocument->addField(AccumulatorAvg::subTotalName,
+                                    getSumValue(state));
+                pDocument->addField(AccumulatorAvg::countName,
+                                    Value::createLong(state.count));
+                return Value::createDocument(pDocument);
+            }
+
+        case Sum:
+            return getSumValue(state);
+
+        case Min:
+        case Max:
+        case First:
+        case Last:
+            return state.pValue;
+        }
+
+        verify(false);
+        return intrusive_ptr<const Value>();
+    }
+
+    intrusive_ptr<const Value> DocumentSourceGroup::getSumValue(
+        const AccumulatorState &state) {
+        if (state.totalType == NumberInt)
+            return Value::createInt((int)state.longTotal);
+        if (state.totalType == NumberLong)
+            return Value::createLong(state.longTotal);
+        return Value::createDouble(state.doubleTotal);
+    }
+
+    void DocumentSourceGroup::spill() {
+        if (!pSorter) {
+            /* the spilled partial results are ordered by _id, then spill */
+            BSONObjBuilder orderBuilder;
+            orderBuilder.append("", 1);
+            orderBuilder.append("", 1);
+            orderBuilder.append("", 1);
+            pSorter.reset(pExpCtx->createSpillSorter(orderBuilder.done()));
+        }
+
+        /* have the accumulators give partial results, as in a shard */
+        const bool inShard = pSpillCtx->getInShard();
+        pSpillCtx->setInShard(true);
+
+        const size_t n = groups.size();
+        for(size_t i = 0; i < n; ++i) {
+            BSONObjBuilder keyBuilder;
+            groups[i].pId->addToBsonObj(&keyBuilder, "");
+            keyBuilder.append("", nSpills);
+
+            BSONObjBuilder partialBuilder(keyBuilder.subobjStart(""));
+            makeDocument(i)->toBson(&partialBuilder);
+            partialBuilder.done();
+
+            pSorter->add(keyBuilder.done());
+        }
+
+        pSpillCtx->setInShard(inShard);
+        clearGroups();
+        memUsed = 0;
+        ++nSpills;
+    }
+
+    intrusive_ptr<Document> DocumentSourceGroup::mergeSpilled() {
+        if (nextSpilled.isEmpty())
+            return intrusive_ptr<Document>();
+
+        /* accumulators that combine the partial results, as in mongos */
+        const size_t n = vFieldName.size();
+        vector<intrusive_ptr<Accumulator> > accumulators;
+        accumulators.reserve(n);
+        for(size_t i = 0; i < n; ++i) {
+            intrusive_ptr<Accumulator> pAccumulator(
+                (*vpAccumulatorFactory[i])(pMergeCtx));
+            pAccumulator->addOperand(
+                ExpressionFieldPath::create(vFieldName[i]));
+            accumulators.push_back(pAccumulator);
+        }
+
+        /*
+          Everything spilled for this _id is adjacent, in spill order, so
+          $first and $last still see the groups in input order.
+        */
+        BSONObj first(nextSpilled);
+        BSONElement idElement(first.firstElement());
+        do {
+            BSONObjIterator keyIterator(nextSpilled);
+            keyIterator.next(); // _id
+            keyIterator.next(); // spill number
+            BSONObj partial(keyIterator.next().Obj());
+            intrusive_ptr<Document> pPartial(
+                Document::createFromBsonObj(&partial));
 
-            /* tickle all the accumulators for the group we found */
-            const size_t n = pGroup->size();
             for(size_t i = 0; i < n; ++i)
-                (*pGroup)[i]->evaluate(pDocument);
+                accumulators[i]->evaluate(pPartial);
+
+            nextSpilled = pSorter->more() ? pSorter->next() : BSONObj();
+        } while (!nextSpilled.isEmpty() &&
+                 (nextSpilled.firstElement().woCompare(idElement, false) == 0));
+
+        return makeDocument(Value::createFromBsonElement(&idElement),
+                            accumulators);
+    }
+
+    intrusive_ptr<Document> DocumentSourceGroup::makeDocument(size_t group) {
+        const size_t n = vFieldName.size();
+        intrusive_ptr<Document> pResult(Document::create(1 + n));
+
+        /* add the _id field */
+        pResult->addField(Document::idName, groups[group].pId);
+
+        /* add the rest of the fields */
+        const AccumulatorState *pStates = &states[group * n];
+        for(size_t i = 0; i < n; ++i) {
+            intrusive_ptr<const Value> pValue(getStateValue(i, pStates[i]));
+            if (pValue->getType() != Undefined)
+                pResult->addField(vFieldName[i], pValue);
         }
 
-        /* start the group iterator */
-        groupsIterator = groups.begin();
-        if (groupsIterator != groups.end())
-            pCurrent = makeDocument(groupsIterator);
-        populated = true;
+        return pResult;
     }
 
     intrusive_ptr<Document> DocumentSourceGroup::makeDocument(
-        const GroupsType::iterator &rIter) {
-        vector<intrusive_ptr<Accumulator> > *pGroup = &rIter->second;
+        const intrusive_ptr<const Value> &pId,
+        const vector<intrusive_ptr<Accumulator> > &accumulators) {
         const size_t n = vFieldName.size();
         intrusive_ptr<Document> pResult(Document::create(1 + n));
 
         /* add the _id field */
-        pResult->addField(Document::idName, rIter->first);
+        pResult->addField(Document::idName, pId);
 
         /* add the rest of the fields */
         for(size_t i = 0; i < n; ++i) {
-            intrusive_ptr<const Value> pValue((*pGroup)[i]->getValue());
+            intrusive_ptr<const Value> pValue(accumulators[i]->getValue());
             if (pValue->getType() != Undefined)
                 pResult->addField(vFieldName[i], pValue);
         }
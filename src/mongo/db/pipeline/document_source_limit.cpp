@@ -56,6 +56,12 @@ namespace mongo {
         return true;
     }
 
+    DocumentSource::GetDepsReturn DocumentSourceLimit::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        /* this doesn't look at the documents it passes on */
+        return SEE_NEXT;
+    }
+
     bool DocumentSourceLimit::eof() {
         return pSource->eof() || count >= limit;
     }
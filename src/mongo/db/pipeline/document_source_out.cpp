@@ -18,6 +18,8 @@
 
 #include "db/pipeline/document_source.h"
 
+#include "util/mongoutils/str.h"
+
 
 namespace mongo {
 
@@ -45,23 +47,35 @@ namespace mongo {
     }
 
     DocumentSourceOut::DocumentSourceOut(
-        BSONElement *pBsonElement,
+        const string &theOutputCollection,
         const intrusive_ptr<ExpressionContext> &pExpCtx):
-        DocumentSource(pExpCtx) {
-        verify(false && "unimplemented");
+        DocumentSource(pExpCtx),
+        outputCollection(theOutputCollection) {
     }
 
-    intrusive_ptr<DocumentSourceOut> DocumentSourceOut::createFromBson(
+    intrusive_ptr<DocumentSource> DocumentSourceOut::createFromBson(
         BSONElement *pBsonElement,
         const intrusive_ptr<ExpressionContext> &pExpCtx) {
+        uassert(16412, str::stream() << outName <<
+                " must be given the name of a collection",
+                pBsonElement->type() == String);
+
+        string collection(pBsonElement->String());
+        uassert(16413, str::stream() << "invalid " << outName <<
+                " collection name \"" << collection << "\"",
+                !collection.empty() &&
+                (collection.find('$') == string::npos) &&
+                (collection[0] != '.') &&
+                !str::startsWith(collection, "system."));
+
         intrusive_ptr<DocumentSourceOut> pSource(
-            new DocumentSourceOut(pBsonElement, pExpCtx));
+            new DocumentSourceOut(collection, pExpCtx));
 
         return pSource;
     }
 
     void DocumentSourceOut::sourceToBson(
         BSONObjBuilder *pBuilder, bool explain) const {
-        verify(false); // CW TODO
+        pBuilder->append(outName, outputCollection);
     }
 }
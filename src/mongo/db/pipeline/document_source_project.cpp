@@ -286,4 +286,32 @@ IncludeExclude:
         pEO->addDependencies(pTracker, this);
     }
 
+    void DocumentSourceProject::DependencyAdder::path(
+        const string &path, bool include) {
+        if (include)
+            pTracker->addDependency(path, pThis);
+        else
+            excluded = true;
+    }
+
+    DocumentSource::GetDepsReturn DocumentSourceProject::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        /*
+          An exclusion passes on everything else, so nothing can be said
+          about what the following sources use.
+         */
+        DependencyAdder dependencyAdder(pTracker, this);
+        pEO->emitPaths(&dependencyAdder);
+        if (dependencyAdder.excluded)
+            return NOT_SUPPORTED;
+
+        /* computed fields use the fields their expressions refer to */
+        pEO->addDependencies(pTracker, this);
+
+        if (!excludeId)
+            pTracker->addDependency(Document::idName, this);
+
+        return EXHAUSTIVE;
+    }
+
 }
@@ -56,6 +56,12 @@ namespace mongo {
         return true;
     }
 
+    DocumentSource::GetDepsReturn DocumentSourceSkip::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        /* this doesn't look at the documents it passes on */
+        return SEE_NEXT;
+    }
+
     void DocumentSourceSkip::skipper() {
         if (count == 0) {
             while (!pSource->eof() && count++ < skip) {
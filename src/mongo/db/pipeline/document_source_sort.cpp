@@ -24,6 +24,7 @@
 #include "db/pipeline/document.h"
 #include "db/pipeline/expression.h"
 #include "db/pipeline/expression_context.h"
+#include "db/pipeline/spill_sorter.h"
 #include "db/pipeline/value.h"
 
 
@@ -41,6 +42,9 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (pSorter)
+            return !pCurrent;
+
         return (docIterator == documents.end());
     }
 
@@ -50,6 +54,15 @@ namespace mongo {
         if (!populated)
             populate();
 
+        if (pSorter) {
+            verify(pCurrent);
+            if (limit && (++count >= limit))
+                pCurrent.reset();
+            else
+                pCurrent = nextSpilled();
+            return pCurrent.get() != NULL;
+        }
+
         verify(docIterator != documents.end());
 
         ++docIterator;
@@ -77,6 +90,30 @@ namespace mongo {
         pBuilder->append(sortName, insides.done());
     }
 
+    void DocumentSourceSort::addToBsonArray(
+        BSONArrayBuilder *pBuilder, bool explain) const {
+        DocumentSource::addToBsonArray(pBuilder, explain);
+
+        /* give back the $limit we absorbed */
+        if (limit)
+            pBuilder->append(BSON(DocumentSourceLimit::limitName << limit));
+    }
+
+    bool DocumentSourceSort::coalesce(
+        const intrusive_ptr<DocumentSource> &pNextSource) {
+        DocumentSourceLimit *pLimit =
+            dynamic_cast<DocumentSourceLimit *>(pNextSource.get());
+
+        /* if it's not a $limit, we can't coalesce */
+        if (!pLimit)
+            return false;
+
+        /* a later $limit can only make it smaller */
+        if (!limit || (pLimit->getLimit() < limit))
+            limit = pLimit->getLimit();
+        return true;
+    }
+
     intrusive_ptr<DocumentSourceSort> DocumentSourceSort::create(
         const intrusive_ptr<ExpressionContext> &pExpCtx) {
         intrusive_ptr<DocumentSourceSort> pSource(
@@ -87,7 +124,9 @@ namespace mongo {
     DocumentSourceSort::DocumentSourceSort(
         const intrusive_ptr<ExpressionContext> &pExpCtx):
         DocumentSource(pExpCtx),
-        populated(false) {
+        populated(false),
+        count(0),
+        limit(0) {
     }
 
     void DocumentSourceSort::addKey(const string &fieldPath, bool ascending) {
@@ -152,6 +191,16 @@ namespace mongo {
         /* make sure we've got a sort key */
         verify(vSortKey.size());
 
+        if (pExpCtx->canSpill()) {
+            populateSpilled();
+            return;
+        }
+
+        if (limit) {
+            populateTopK();
+            return;
+        }
+
         /* track and warn about how much physical memory has been used */
         DocMemMonitor dmm(this);
 
@@ -164,10 +213,18 @@ namespace mongo {
             dmm.addToTotal(pDocument->getApproximateSize());
         }
 
+        sortDocuments();
+    }
+
+    void DocumentSourceSort::sortDocuments() {
         /* sort the list */
         Comparator comparator(this);
         sort(documents.begin(), documents.end(), comparator);
 
+        /* a $limit we absorbed */
+        if (limit && (documents.size() > (size_t)limit))
+            documents.resize(limit);
+
         /* start the sort iterator */
         docIterator = documents.begin();
 
@@ -176,6 +233,132 @@ namespace mongo {
         populated = true;
     }
 
+    void DocumentSourceSort::populateTopK() {
+        DocMemMonitor dmm(this);
+
+        /*
+          Keep the first limit documents seen so far in a heap with the
+          greatest of them on top.  A new document only goes in if it is
+          less than that one, which it then replaces.
+        */
+        Comparator comparator(this);
+        for(bool hasNext = !pSource->eof(); hasNext;
+            hasNext = pSource->advance()) {
+            intrusive_ptr<Document> pDocument(pSource->getCurrent());
+
+            if (documents.size() < (size_t)limit) {
+                documents.push_back(pDocument);
+                push_heap(documents.begin(), documents.end(), comparator);
+
+                dmm.addToTotal(pDocument->getApproximateSize());
+            }
+            else if (comparator(pDocument, documents.front())) {
+                pop_heap(documents.begin(), documents.end(), comparator);
+                documents.back() = pDocument;
+                push_heap(documents.begin(), documents.end(), comparator);
+            }
+        }
+
+        /* leaves the documents in order */
+        sort_heap(documents.begin(), documents.end(), comparator);
+
+        docIterator = documents.begin();
+
+        if (docIterator != documents.end())
+            pCurrent = *docIterator;
+        populated = true;
+    }
+
+    void DocumentSourceSort::populateSpilled() {
+        /*
+          Hold the documents in memory, as populate() does, until they take
+          more than the spill bytes; only then make the sorter, and move
+          them and everything after them to it.
+        */
+        long long position = 0;
+        size_t memUsed = 0;
+        for(bool hasNext = !pSource->eof(); hasNext;
+            hasNext = pSource->advance()) {
+            intrusive_ptr<Document> pDocument(pSource->getCurrent());
+
+            if (pSorter) {
+                addToSorter(pDocument, position++);
+                continue;
+            }
+
+            documents.push_back(pDocument);
+            memUsed += pDocument->getApproximateSize();
+            if (memUsed <= pExpCtx->getSpillBytes())
+                continue;
+
+            /* the sort key's values, then the input position, then the document */
+            BSONObjBuilder orderBuilder;
+            const size_t n = vSortKey.size();
+            for(size_t i = 0; i < n; ++i)
+                orderBuilder.append("", (vAscending[i] ? 1 : -1));
+            orderBuilder.append("", 1);
+            orderBuilder.append("", 1);
+            pSorter.reset(pExpCtx->createSpillSorter(orderBuilder.done()));
+
+            for(VectorType::iterator i(documents.begin());
+                i != documents.end(); ++i)
+                addToSorter(*i, position++);
+            documents.clear();
+        }
+
+        if (!pSorter) {
+            sortDocuments();
+            return;
+        }
+
+        pSorter->sort();
+        pCurrent = nextSpilled();
+        populated = true;
+    }
+
+    void DocumentSourceSort::addToSorter(
+        const intrusive_ptr<Document> &pDocument, long long position) {
+        BSONObjBuilder keyBuilder;
+        const size_t n = vSortKey.size();
+        for(size_t i = 0; i < n; ++i) {
+            intrusive_ptr<const Value> pValue(
+                vSortKey[i]->evaluate(pDocument));
+
+            /*
+              Missing fields sort first, as in compare(); undefined
+              does that in BSON order too.
+            */
+            if (pValue->getType() == Undefined)
+                keyBuilder.appendUndefined("");
+            else
+                pValue->addToBsonObj(&keyBuilder, "");
+        }
+
+        /* documents with equal keys keep their input order */
+        keyBuilder.append("", position);
+
+        BSONObjBuilder docBuilder(keyBuilder.subobjStart(""));
+        pDocument->toBson(&docBuilder);
+        docBuilder.done();
+
+        pSorter->add(keyBuilder.done());
+    }
+
+    intrusive_ptr<Document> DocumentSourceSort::nextSpilled() {
+        if (!pSorter->more())
+            return intrusive_ptr<Document>();
+
+        /* skip the sort key and the input position */
+        BSONObj key(pSorter->next());
+        BSONObjIterator keyIterator(key);
+        const size_t n = vSortKey.size();
+        for(size_t i = 0; i <= n; ++i)
+            keyIterator.next();
+
+        BSONObj document(keyIterator.next().Obj());
+        return Document::createFromBsonObj(&document);
+    }
+
     int DocumentSourceSort::compare(
         const intrusive_ptr<Document> &pL, const intrusive_ptr<Document> &pR) {
 
@@ -223,4 +406,13 @@ namespace mongo {
         }
     }
 
+    DocumentSource::GetDepsReturn DocumentSourceSort::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        for(SortPaths::const_iterator i(vSortKey.begin());
+                i != vSortKey.end(); ++i)
+            pTracker->addDependency((*i)->getFieldPath(false), this);
+
+        return SEE_NEXT;
+    }
+
 }
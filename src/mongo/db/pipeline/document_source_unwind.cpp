@@ -245,5 +245,11 @@ namespace mongo {
         const intrusive_ptr<DependencyTracker> &pTracker) {
         pTracker->addDependency(unwindPath.getPath(false), this);
     }
+
+    DocumentSource::GetDepsReturn DocumentSourceUnwind::getDependencies(
+        const intrusive_ptr<DependencyTracker> &pTracker) const {
+        pTracker->addDependency(unwindPath.getPath(false), this);
+        return SEE_NEXT;
+    }
     
 }
@@ -352,7 +352,7 @@ namespace mongo {
     }
 
     intrusive_ptr<Expression> ExpressionAdd::optimize() {
-        intrusive_ptr<Expression> pE(ExpressionNary::optimize());
+        intrusive_ptr<Expression> pE(ExpressionArithmetic::optimize());
         ExpressionAdd *pA = dynamic_cast<ExpressionAdd *>(pE.get());
         if (pA) {
             /* don't create a circular reference */
@@ -369,7 +369,7 @@ namespace mongo {
     }
 
     ExpressionAdd::ExpressionAdd():
-        ExpressionNary(),
+        ExpressionArithmetic(),
         useOriginal(false) {
     }
 
@@ -386,6 +386,10 @@ namespace mongo {
             return pAdd->evaluate(pDocument);
         }
 
+        intrusive_ptr<const Value> pResult;
+        if (evaluateProgram(pDocument, &pResult))
+            return pResult;
+
         for (size_t i = 0; i < n; ++i) {
             intrusive_ptr<const Value> pValue(
                 vpOperand[i]->evaluate(pDocument));
@@ -594,6 +598,305 @@ namespace mongo {
         return ExpressionAnd::create;
     }
 
+    /* ---------------------- ExpressionArithmetic ------------------------- */
+
+    ExpressionArithmetic::ExpressionArithmetic():
+        ExpressionNary(),
+        pProgram() {
+    }
+
+    ExpressionArithmetic::~ExpressionArithmetic() {
+    }
+
+    intrusive_ptr<Expression> ExpressionArithmetic::optimize() {
+        intrusive_ptr<Expression> pE(ExpressionNary::optimize());
+
+        /* the operands are final now, so the program can refer to them */
+        ExpressionArithmetic *pA =
+            dynamic_cast<ExpressionArithmetic *>(pE.get());
+        if (pA)
+            pA->pProgram.reset(ArithmeticProgram::compile(pA));
+
+        return pE;
+    }
+
+    bool ExpressionArithmetic::evaluateProgram(
+        const intrusive_ptr<Document> &pDocument,
+        intrusive_ptr<const Value> *pResult) const {
+        if (!pProgram)
+            return false;
+
+        return pProgram->evaluate(pDocument, pResult);
+    }
+
+    /* ----------------------- ArithmeticProgram --------------------------- */
+
+    ArithmeticProgram::ArithmeticProgram():
+        program() {
+    }
+
+    ArithmeticProgram *ArithmeticProgram::compile(
+        const ExpressionArithmetic *pExpression) {
+        auto_ptr<ArithmeticProgram> pProgram(new ArithmeticProgram());
+        size_t depth = 0;
+        if (!pProgram->compileExpression(pExpression, &depth))
+            return NULL;
+
+        return pProgram.release();
+    }
+
+    bool ArithmeticProgram::compileExpression(
+        const Expression *pExpression, size_t *pDepth) {
+        Instruction instruction;
+        instruction.nOperands = 0;
+        instruction.pOperand = NULL;
+        instruction.constant = makeEmpty(Undefined);
+
+        const ExpressionArithmetic *pArithmetic =
+            dynamic_cast<const ExpressionArithmetic *>(pExpression);
+        if (!pArithmetic) {
+            const ExpressionConstant *pConstant =
+                dynamic_cast<const ExpressionConstant *>(pExpression);
+            if (pConstant) {
+                /* a constant string or date is never going to work */
+                if (!toNumber(pConstant->getValue(), &instruction.constant))
+                    return false;
+                instruction.opCode = PUSH_CONSTANT;
+            }
+            else {
+                instruction.opCode = PUSH_OPERAND;
+                instruction.pOperand = pExpression;
+            }
+
+            if (++*pDepth > maxDepth)
+                return false;
+            program.push_back(instruction);
+            return true;
+        }
+
+        /* leave bad operand counts to the tree, which complains about them */
+        const size_t n = pArithmetic->vpOperand.size();
+        if (dynamic_cast<const ExpressionAdd *>(pArithmetic))
+            instruction.opCode = ADD;
+        else if (dynamic_cast<const ExpressionMultiply *>(pArithmetic))
+            instruction.opCode = MULTIPLY;
+        else {
+            if (n != 2)
+                return false;
+
+            if (dynamic_cast<const ExpressionSubtract *>(pArithmetic))
+                instruction.opCode = SUBTRACT;
+            else if (dynamic_cast<const ExpressionDivide *>(pArithmetic))
+                instruction.opCode = DIVIDE;
+            else if (dynamic_cast<const ExpressionMod *>(pArithmetic))
+                instruction.opCode = MOD;
+            else
+                return false;
+        }
+
+        for(size_t i = 0; i < n; ++i) {
+            if (!compileExpression(pArithmetic->vpOperand[i].get(), pDepth))
+                return false;
+        }
+
+        /* the operands come off the stack, and the result goes on */
+        *pDepth -= n;
+        if (++*pDepth > maxDepth)
+            return false;
+
+        instruction.nOperands = n;
+        program.push_back(instruction);
+        return true;
+    }
+
+    ArithmeticProgram::Number ArithmeticProgram::makeInt(long long value) {
+        /* narrowed, as Value::createInt((int)value) would be */
+        Number number;
+        number.type = NumberInt;
+        number.longValue = (int)value;
+        number.doubleValue = (double)(int)value;
+        return number;
+    }
+
+    ArithmeticProgram::Number ArithmeticProgram::makeLong(long long value) {
+        Number number;
+        number.type = NumberLong;
+        number.longValue = value;
+        number.doubleValue = (double)value;
+        return number;
+    }
+
+    ArithmeticProgram::Number ArithmeticProgram::makeDouble(double value) {
+        Number number;
+        number.type = NumberDouble;
+        number.longValue = (long long)value;
+        number.doubleValue = value;
+        return number;
+    }
+
+    ArithmeticProgram::Number ArithmeticProgram::makeEmpty(BSONType type) {
+        Number number;
+        number.type = type;
+        number.longValue = 0;
+        number.doubleValue = 0;
+        return number;
+    }
+
+    bool ArithmeticProgram::toNumber(
+        const intrusive_ptr<const Value> &pValue, Number *pNumber) {
+        switch(pValue->getType()) {
+        case NumberInt:
+            *pNumber = makeInt(pValue->getInt());
+            return true;
+
+        case NumberLong:
+            *pNumber = makeLong(pValue->getLong());
+            return true;
+
+        case NumberDouble:
+            *pNumber = makeDouble(pValue->getDouble());
+            return true;
+
+        case jstNULL:
+        case Undefined:
+            *pNumber = makeEmpty(pValue->getType());
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    bool ArithmeticProgram::evaluate(
+        const intrusive_ptr<Document> &pDocument,
+        intrusive_ptr<const Value> *pResult) const {
+        Number stack[maxDepth];
+        size_t depth = 0;
+
+        /*
+          Each operator does what its evaluate() does, on the coerced forms
+          of its operands, and narrows its result the same way.
+         */
+        for(vector<Instruction>::const_iterator iter(program.begin()),
+                listEnd(program.end()); iter != listEnd; ++iter) {
+            const Instruction &instruction = *iter;
+
+            if (instruction.opCode == PUSH_CONSTANT) {
+                stack[depth++] = instruction.constant;
+                continue;
+            }
+
+            if (instruction.opCode == PUSH_OPERAND) {
+                if (!toNumber(instruction.pOperand->evaluate(pDocument),
+                              &stack[depth]))
+                    return false;
+                ++depth;
+                continue;
+            }
+
+            const size_t n = instruction.nOperands;
+            depth -= n;
+            const Number *pOperands = &stack[depth];
+            Number result;
+
+            switch(instruction.opCode) {
+            case ADD:
+            case MULTIPLY: {
+                const bool add = (instruction.opCode == ADD);
+                double doubleTotal = add ? 0 : 1;
+                long long longTotal = add ? 0 : 1;
+                BSONType totalType = NumberInt;
+                for(size_t i = 0; i < n; ++i) {
+                    totalType = Value::getWidestNumeric(
+                        totalType, pOperands[i].type);
+                    if (add) {
+                        doubleTotal += pOperands[i].doubleValue;
+                        longTotal += pOperands[i].longValue;
+                    }
+                    else {
+                        doubleTotal *= pOperands[i].doubleValue;
+                        longTotal *= pOperands[i].longValue;
+                    }
+                }
+
+                if (totalType == NumberDouble)
+                    result = makeDouble(doubleTotal);
+                else if (totalType == NumberLong)
+                    result = makeLong(longTotal);
+                else
+                    result = makeInt(longTotal);
+                break;
+            }
+
+            case SUBTRACT: {
+                const Number &left = pOperands[0];
+                const Number &right = pOperands[1];
+                BSONType productType =
+                    Value::getWidestNumeric(right.type, left.type);
+                if (productType == NumberDouble)
+                    result = makeDouble(left.doubleValue - right.doubleValue);
+                else if (productType == NumberLong)
+                    result = makeLong(left.longValue - right.longValue);
+                else
+                    result = makeInt(left.longValue - right.longValue);
+                break;
+            }
+
+            case DIVIDE: {
+                const Number &left = pOperands[0];
+                const Number &right = pOperands[1];
+                if (right.doubleValue == 0)
+                    result = makeEmpty(Undefined);
+                else
+                    result = makeDouble(left.doubleValue / right.doubleValue);
+                break;
+            }
+
+            case MOD: {
+                const Number &left = pOperands[0];
+                const Number &right = pOperands[1];
+                BSONType productType =
+                    Value::getWidestNumeric(right.type, left.type);
+                if (right.longValue == 0)
+                    result = makeEmpty(Undefined);
+                else if (productType == NumberLong)
+                    result = makeLong(left.longValue % right.longValue);
+                else
+                    result = makeInt((int)left.longValue % right.longValue);
+                break;
+            }
+
+            default:
+                verify(false);
+                return false;
+            }
+
+            stack[depth++] = result;
+        }
+
+        verify(depth == 1);
+        const Number &result = stack[0];
+        switch(result.type) {
+        case NumberInt:
+            *pResult = Value::createInt((int)result.longValue);
+            break;
+
+        case NumberLong:
+            *pResult = Value::createLong(result.longValue);
+            break;
+
+        case NumberDouble:
+            *pResult = Value::createDouble(result.doubleValue);
+            break;
+
+        default:
+            *pResult = Value::getUndefined();
+            break;
+        }
+
+        return true;
+    }
+
     /* -------------------- ExpressionCoerceToBool ------------------------- */
 
     ExpressionCoerceToBool::~ExpressionCoerceToBool() {
@@ -1107,7 +1410,7 @@ namespace mongo {
     }
 
     ExpressionDivide::ExpressionDivide():
-        ExpressionNary() {
+        ExpressionArithmetic() {
     }
 
     void ExpressionDivide::addOperand(
@@ -1118,6 +1421,10 @@ namespace mongo {
 
     intrusive_ptr<const Value> ExpressionDivide::evaluate(
         const intrusive_ptr<Document> &pDocument) const {
+        intrusive_ptr<const Value> pResult;
+        if (evaluateProgram(pDocument, &pResult))
+            return pResult;
+
         checkArgCount(2);
         intrusive_ptr<const Value> pLeft(vpOperand[0]->evaluate(pDocument));
         intrusive_ptr<const Value> pRight(vpOperand[1]->evaluate(pDocument));
@@ -2240,7 +2547,7 @@ namespace mongo {
     }
 
     ExpressionMod::ExpressionMod():
-        ExpressionNary() {
+        ExpressionArithmetic() {
     }
 
     void ExpressionMod::addOperand(
@@ -2251,6 +2558,10 @@ namespace mongo {
 
     intrusive_ptr<const Value> ExpressionMod::evaluate(
         const intrusive_ptr<Document> &pDocument) const {
+        intrusive_ptr<const Value> pResult;
+        if (evaluateProgram(pDocument, &pResult))
+            return pResult;
+
         BSONType productType;
         checkArgCount(2);
         intrusive_ptr<const Value> pLeft(vpOperand[0]->evaluate(pDocument));
@@ -2315,11 +2626,15 @@ namespace mongo {
     }
 
     ExpressionMultiply::ExpressionMultiply():
-        ExpressionNary() {
+        ExpressionArithmetic() {
     }
 
     intrusive_ptr<const Value> ExpressionMultiply::evaluate(
         const intrusive_ptr<Document> &pDocument) const {
+        intrusive_ptr<const Value> pResult;
+        if (evaluateProgram(pDocument, &pResult))
+            return pResult;
+
         /*
           We'll try to return the narrowest possible result value.  To do that
           without creating intermediate Values, do the arithmetic for double
@@ -2925,7 +3240,7 @@ namespace mongo {
     }
 
     ExpressionSubtract::ExpressionSubtract():
-        ExpressionNary() {
+        ExpressionArithmetic() {
     }
 
     void ExpressionSubtract::addOperand(
@@ -2936,6 +3251,10 @@ namespace mongo {
 
     intrusive_ptr<const Value> ExpressionSubtract::evaluate(
         const intrusive_ptr<Document> &pDocument) const {
+        intrusive_ptr<const Value> pResult;
+        if (evaluateProgram(pDocument, &pResult))
+            return pResult;
+
         BSONType productType;
         checkArgCount(2);
         intrusive_ptr<const Value> pLeft(vpOperand[0]->evaluate(pDocument));
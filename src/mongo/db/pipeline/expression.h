@@ -18,6 +18,7 @@
 
 #include "pch.h"
 
+#include "bson/bsontypes.h"
 #include "db/pipeline/field_path.h"
 #include "util/intrusive_counter.h"
 #include "util/iterator.h"
@@ -25,6 +26,7 @@
 
 namespace mongo {
 
+    class ArithmeticProgram;
     class BSONArrayBuilder;
     class BSONElement;
     class BSONObjBuilder;
@@ -316,8 +318,130 @@ namespace mongo {
     };
 
 
-    class ExpressionAdd :
+    /*
+      Base for the arithmetic operators ($add, $subtract, $multiply,
+      $divide and $mod).
+
+      When one of these is optimized, the tree of arithmetic beneath it is
+      also compiled into an ArithmeticProgram.  evaluate() tries that first,
+      and only walks the tree if the program can't produce the result.
+     */
+    class ExpressionArithmetic :
         public ExpressionNary {
+    public:
+        // virtuals from Expression
+        virtual ~ExpressionArithmetic();
+        virtual intrusive_ptr<Expression> optimize();
+
+        friend class ArithmeticProgram;
+
+    protected:
+        ExpressionArithmetic();
+
+        /*
+          Evaluate the expression with its program, if it has one.
+
+          @param pDocument the document to evaluate against
+          @param pResult where to put the result
+          @returns true if the result was computed, false if the tree must
+            be walked instead
+         */
+        bool evaluateProgram(const intrusive_ptr<Document> &pDocument,
+                             intrusive_ptr<const Value> *pResult) const;
+
+    private:
+        scoped_ptr<const ArithmeticProgram> pProgram;
+    };
+
+
+    /*
+      A tree of arithmetic expressions flattened into postfix order, for
+      evaluation on a small stack of unboxed numbers.  The intermediate
+      results never become Values, so the only Value created is the
+      result's.
+
+      Any operand that isn't itself arithmetic is evaluated as usual, and
+      is expected to be a number, null or undefined.  Anything else (a
+      string to concatenate, a date to offset) makes evaluate() give up,
+      and the expression is evaluated as a tree, as before.  Otherwise the
+      results are exactly those of the tree, including the narrowing of
+      each intermediate to the type it would have had as a Value.
+     */
+    class ArithmeticProgram :
+        boost::noncopyable {
+    public:
+        /*
+          Compile the arithmetic at and below the given expression.
+
+          @param pExpression the root of the arithmetic
+          @returns the program, or NULL if the tree is unsuitable
+         */
+        static ArithmeticProgram *compile(
+            const ExpressionArithmetic *pExpression);
+
+        /*
+          Run the program.
+
+          @param pDocument the document to evaluate against
+          @param pResult where to put the result
+          @returns true if the result was computed, false if an operand
+            wasn't numeric
+         */
+        bool evaluate(const intrusive_ptr<Document> &pDocument,
+                      intrusive_ptr<const Value> *pResult) const;
+
+    private:
+        ArithmeticProgram();
+
+        /* an unboxed value, in all the forms its Value would coerce to */
+        struct Number {
+            BSONType type; // NumberInt, NumberLong, NumberDouble,
+                           // jstNULL or Undefined
+            long long longValue;
+            double doubleValue;
+        };
+
+        static Number makeInt(long long value);
+        static Number makeLong(long long value);
+        static Number makeDouble(double value);
+        static Number makeEmpty(BSONType type);
+
+        /*
+          Convert a Value to a Number.
+
+          @returns false if the value isn't numeric, null or undefined
+         */
+        static bool toNumber(const intrusive_ptr<const Value> &pValue,
+                             Number *pNumber);
+
+        enum OpCode {
+            PUSH_CONSTANT, PUSH_OPERAND, ADD, MULTIPLY, SUBTRACT, DIVIDE, MOD
+        };
+
+        struct Instruction {
+            OpCode opCode;
+            size_t nOperands; // for the operators
+            const Expression *pOperand; // for PUSH_OPERAND
+            Number constant; // for PUSH_CONSTANT
+        };
+
+        /*
+          Append the instructions for the given expression, tracking the
+          depth of the stack.
+
+          @returns false if the expression can't be compiled
+         */
+        bool compileExpression(const Expression *pExpression, size_t *pDepth);
+
+        /* deep enough for any sane expression, and cheap to put on the stack */
+        static const size_t maxDepth = 32;
+
+        vector<Instruction> program;
+    };
+
+
+    class ExpressionAdd :
+        public ExpressionArithmetic {
     public:
         // virtuals from Expression
         virtual ~ExpressionAdd();
@@ -553,7 +677,7 @@ namespace mongo {
 
 
     class ExpressionDivide :
-        public ExpressionNary {
+        public ExpressionArithmetic {
     public:
         // virtuals from ExpressionNary
         virtual ~ExpressionDivide();
@@ -843,7 +967,7 @@ namespace mongo {
 
 
     class ExpressionMod :
-        public ExpressionNary {
+        public ExpressionArithmetic {
     public:
         // virtuals from ExpressionNary
         virtual ~ExpressionMod();
@@ -860,7 +984,7 @@ namespace mongo {
     
 
     class ExpressionMultiply :
-        public ExpressionNary {
+        public ExpressionArithmetic {
     public:
         // virtuals from Expression
         virtual ~ExpressionMultiply();
@@ -1242,7 +1366,7 @@ namespace mongo {
 
 
     class ExpressionSubtract :
-        public ExpressionNary {
+        public ExpressionArithmetic {
     public:
         // virtuals from ExpressionNary
         virtual ~ExpressionSubtract();
@@ -27,6 +27,9 @@ namespace mongo {
     inline ExpressionContext::ExpressionContext(InterruptStatus *pS):
         inShard(false),
         inRouter(false),
+        allowDiskUse(false),
+        pSpillSorterFactory(NULL),
+        spillBytes(0),
         intCheckCounter(1),
         pStatus(pS) {
     }
@@ -45,4 +48,28 @@ namespace mongo {
         return new ExpressionContext(pStatus);
     }
 
+    ExpressionContext *ExpressionContext::clone() const {
+        ExpressionContext *pCtx = new ExpressionContext(pStatus);
+        pCtx->inShard = inShard;
+        pCtx->inRouter = inRouter;
+        pCtx->allowDiskUse = allowDiskUse;
+        pCtx->pSpillSorterFactory = pSpillSorterFactory;
+        pCtx->spillBytes = spillBytes;
+        return pCtx;
+    }
+
+    void ExpressionContext::setSpillSorterFactory(
+        SpillSorter::Factory factory, size_t spillBytes) {
+        pSpillSorterFactory = factory;
+        this->spillBytes = spillBytes;
+    }
+
+    SpillSorter *ExpressionContext::createSpillSorter(
+        const BSONObj &order) const {
+        if (!canSpill())
+            return NULL;
+
+        return (*pSpillSorterFactory)(order, spillBytes);
+    }
+
 }
@@ -18,6 +18,7 @@
 
 #include "pch.h"
 
+#include "db/pipeline/spill_sorter.h"
 #include "util/intrusive_counter.h"
 
 namespace mongo {
@@ -35,6 +36,45 @@ namespace mongo {
         bool getInShard() const;
         bool getInRouter() const;
 
+        /*
+          The allowDiskUse option of the aggregate command:  let $sort and
+          $group spill to disk rather than hold everything in memory.
+         */
+        void setAllowDiskUse(bool b);
+        bool getAllowDiskUse() const;
+
+        /*
+          Supply the sorter spilling stages use.  Only mongod can spill, so
+          without this stages always work in memory.
+
+          @param factory creates the sorters
+          @param spillBytes how much a stage may hold in memory before
+            spilling
+         */
+        void setSpillSorterFactory(SpillSorter::Factory factory,
+                                   size_t spillBytes);
+
+        /*
+          @param order the ordering of the key fields
+          @returns a new sorter for a stage to spill to, or NULL if this
+            pipeline doesn't spill; the caller owns it
+         */
+        SpillSorter *createSpillSorter(const BSONObj &order) const;
+
+        /*
+          @returns true if createSpillSorter() would return a sorter; stages
+            check this up front, and only create one when they first spill
+         */
+        bool canSpill() const;
+
+        size_t getSpillBytes() const;
+
+        /*
+          @returns a new context with the same settings, for stages that
+            need to vary them
+         */
+        ExpressionContext *clone() const;
+
         /**
            Used by a pipeline to check for interrupts so that killOp() works.
 
@@ -49,6 +89,9 @@ namespace mongo {
         
         bool inShard;
         bool inRouter;
+        bool allowDiskUse;
+        SpillSorter::Factory pSpillSorterFactory;
+        size_t spillBytes;
         unsigned intCheckCounter; // interrupt check counter
         InterruptStatus *const pStatus;
     };
@@ -75,4 +118,20 @@ namespace mongo {
         return inRouter;
     }
 
+    inline void ExpressionContext::setAllowDiskUse(bool b) {
+        allowDiskUse = b;
+    }
+
+    inline bool ExpressionContext::getAllowDiskUse() const {
+        return allowDiskUse;
+    }
+
+    inline bool ExpressionContext::canSpill() const {
+        return allowDiskUse && pSpillSorterFactory;
+    }
+
+    inline size_t ExpressionContext::getSpillBytes() const {
+        return spillBytes;
+    }
+
 };
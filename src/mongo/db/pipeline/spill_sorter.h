@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2012 10gen Inc.
+ *
+ * This program is free software: you can redistribute it and/or  modify
+ * it under the terms of the GNU Affero General Public License, version 3,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "pch.h"
+
+namespace mongo {
+
+    class BSONObj;
+
+    /*
+      A sort of BSONObj keys that spills sorted runs to disk and merges them
+      back, for the $sort and $group stages of pipelines that allow disk use.
+
+      The pipeline is built into mongos as well, which has nowhere to spill
+      to, so mongod supplies the implementation (see PipelineD) through the
+      ExpressionContext.
+     */
+    class SpillSorter :
+        boost::noncopyable {
+    public:
+        virtual ~SpillSorter() {};
+
+        /*
+          Add a key.  Keys compare as BSONObj::woCompare() does with the
+          sorter's order, ignoring field names.
+         */
+        virtual void add(const BSONObj &key) = 0;
+
+        /*
+          Call after adding all the keys, and before more() or next().
+         */
+        virtual void sort() = 0;
+
+        virtual bool more() = 0;
+
+        /*
+          Get the next key in order.  It stays valid until the sorter is
+          destroyed.
+         */
+        virtual BSONObj next() = 0;
+
+        /*
+          Create a sorter.
+
+          @param order the ordering of the key fields, as for an index
+          @param maxMemory how much to buffer before spilling a run
+         */
+        typedef SpillSorter *(*Factory)(const BSONObj &order,
+                                        size_t maxMemory);
+    };
+
+}
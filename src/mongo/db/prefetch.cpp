@@ -54,6 +54,10 @@ namespace mongo {
         DiskLoc unusedDl; // unused
         IndexInterface::IndexInserter inserter;
         NamespaceDetails *nsd = nsdetails(ns);
+        if ( !nsd ) {
+            // collection doesn't exist yet; nothing to page in
+            return;
+        }
 
         // includes all indexes, including ones
         // in the process of being built
@@ -21,6 +21,7 @@
 #include "db.h"
 #include "btree.h"
 #include "cmdline.h"
+#include "intersectioncursor.h"
 #include "../server.h"
 #include "pagefault.h"
 
@@ -124,7 +125,9 @@ namespace mongo {
         _utility( Helpful ),
         _special( special ),
         _type(0),
-        _startOrEndSpec() {
+        _startOrEndSpec(),
+        _singleKeyRange(),
+        _skipScan() {
     }
     
     void QueryPlan::init( const FieldRangeSetPair *originalFrsp,
@@ -262,9 +265,43 @@ doneCheckOrder:
             _utility = Disallowed;
         }
 
+        // The FieldRangeVectorIterator skips to the next value of the leading fields once a key is
+        // past the ranges of a later field, so a range on any field may bound the scan.
+        if ( _utility == Unhelpful && _order.isEmpty() && !_startOrEndSpec ) {
+            BSONObjIterator f( idxKey );
+            f.next();
+            while( f.more() ) {
+                if ( !_frs.range( f.next().fieldName() ).universal() ) {
+                    _skipScan = true;
+                    break;
+                }
+            }
+        }
+
         if ( _parsedQuery && _parsedQuery->getFields() && !_d->isMultikey( _idxNo ) ) { // Does not check modifiedKeys()
             _keyFieldsOnly.reset( _parsedQuery->getFields()->checkKey( _index->keyPattern() ) );
         }
+
+        // Entries with equal keys are ordered by DiskLoc, so a forward scan over one key returns
+        // its documents in DiskLoc order.
+        if ( _utility == Helpful && _order.isEmpty() && !_startOrEndSpec ) {
+            _singleKeyRange = true;
+            BSONObjIterator f( idxKey );
+            while( f.more() ) {
+                if ( !_frs.range( f.next().fieldName() ).equality() ) {
+                    _singleKeyRange = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    void QueryPlan::intersectWith( const shared_ptr<QueryPlan> &other ) {
+        verify( _singleKeyRange && other->singleKeyRange() );
+        verify( !_intersectPlan && !other->intersected() );
+        _intersectPlan = other;
+        // Neither index alone has all the queried fields.
+        _exactKeyMatch = false;
     }
 
     shared_ptr<Cursor> QueryPlan::newCursor( const DiskLoc &startLoc ) const {
@@ -298,13 +335,20 @@ doneCheckOrder:
         else if ( _index->getSpec().getType() ) {
             return shared_ptr<Cursor>( BtreeCursor::make( _d, _idxNo, *_index, _frv->startKey(), _frv->endKey(), true, _direction >= 0 ? 1 : -1 ) );
         }
+        else if ( _intersectPlan ) {
+            return shared_ptr<Cursor>( new IntersectionCursor( newBtreeCursor(),
+                                                              _intersectPlan->newBtreeCursor() ) );
+        }
         else {
-            return shared_ptr<Cursor>( BtreeCursor::make( _d, _idxNo, *_index, _frv,
-                                                         independentRangesSingleIntervalLimit(),
-                                                         _direction >= 0 ? 1 : -1 ) );
+            return shared_ptr<Cursor>( newBtreeCursor() );
         }
     }
 
+    BtreeCursor *QueryPlan::newBtreeCursor() const {
+        return BtreeCursor::make( _d, _idxNo, *_index, _frv, independentRangesSingleIntervalLimit(),
+                                 _direction >= 0 ? 1 : -1 );
+    }
+
     shared_ptr<Cursor> QueryPlan::newReverseCursor() const {
         if ( willScanTable() ) {
             int orderSpec = _order.getIntField( "$natural" );
@@ -319,6 +363,9 @@ doneCheckOrder:
     BSONObj QueryPlan::indexKey() const {
         if ( !_index )
             return BSON( "$natural" << 1 );
+        if ( _intersectPlan )
+            return BSON( "$intersect" << BSON_ARRAY( _index->keyPattern() <<
+                                                     _intersectPlan->indexKey() ) );
         return _index->keyPattern();
     }
 
@@ -425,7 +472,7 @@ doneCheckOrder:
     }
     
     bool QueryPlan::queryFiniteSetOrderSuffix() const {
-        if ( !indexed() ) {
+        if ( !indexed() || _intersectPlan ) {
             return false;
         }
         if ( !_frs.simpleFiniteSet() ) {
@@ -471,7 +518,9 @@ doneCheckOrder:
     
     shared_ptr<CoveredIndexMatcher> QueryPlan::matcher() const {
         if ( !_matcher ) {
-            _matcher.reset( new CoveredIndexMatcher( originalQuery(), indexKey() ) );
+            // An intersection's cursor provides the keys of its first index.
+            _matcher.reset( new CoveredIndexMatcher( originalQuery(),
+                                                    _index ? _index->keyPattern() : indexKey() ) );
         }
         return _matcher;
     }
@@ -479,6 +528,8 @@ doneCheckOrder:
     bool QueryPlan::isMultiKey() const {
         if ( _idxNo < 0 )
             return false;
+        if ( _intersectPlan && _intersectPlan->isMultiKey() )
+            return true;
         return _d->isMultikey( _idxNo );
     }
 
@@ -531,6 +582,7 @@ doneCheckOrder:
         verify( d );
         
         vector<shared_ptr<QueryPlan> > plans;
+        vector<shared_ptr<QueryPlan> > skipScanPlans;
         shared_ptr<QueryPlan> optimalPlan;
         shared_ptr<QueryPlan> specialPlan;
         for( int i = 0; i < d->nIndexes; ++i ) {
@@ -558,6 +610,11 @@ doneCheckOrder:
                         specialPlan = p;
                     }
                     break;
+                case QueryPlan::Unhelpful:
+                    if ( p->skipScan() ) {
+                        skipScanPlans.push_back( p );
+                    }
+                    break;
                 default:
                     break;
             }
@@ -583,9 +640,49 @@ doneCheckOrder:
             ++i ) {
             _qps.addCandidatePlan( *i );
         }        
+
+        addIntersectionPlans( d, plans );
+
+        // Rather than scan the table alone, race it against skipping through a few indexes whose
+        // leading fields aren't queried.
+        if ( plans.empty() ) {
+            const int maxSkipScanPlans = 2;
+            for( int i = 0; i < (int)skipScanPlans.size() && i < maxSkipScanPlans; ++i ) {
+                _qps.addCandidatePlan( skipScanPlans[ i ] );
+            }
+        }
         
         _qps.addCandidatePlan( newPlan( d, -1 ) );
     }
+
+    void QueryPlanGenerator::addIntersectionPlans( NamespaceDetails *d,
+                                                  const vector<shared_ptr<QueryPlan> > &plans ) {
+        // $or clauses are planned one at a time, and their plans are expected to use one index.
+        if ( !_qps.order().isEmpty() || _qps.originalQuery().hasField( "$or" ) ) {
+            return;
+        }
+        // Each intersection is a further plan to race, so only a few are tried.
+        const int maxIntersectionPlans = 3;
+        int added = 0;
+        for( vector<shared_ptr<QueryPlan> >::const_iterator i = plans.begin(); i != plans.end();
+            ++i ) {
+            if ( !(*i)->singleKeyRange() ) {
+                continue;
+            }
+            for( vector<shared_ptr<QueryPlan> >::const_iterator j = i + 1; j != plans.end();
+                ++j ) {
+                if ( !(*j)->singleKeyRange() ) {
+                    continue;
+                }
+                if ( added++ == maxIntersectionPlans ) {
+                    return;
+                }
+                shared_ptr<QueryPlan> p = newPlan( d, (*i)->idxNo() );
+                p->intersectWith( newPlan( d, (*j)->idxNo() ) );
+                _qps.addCandidatePlan( p );
+            }
+        }
+    }
     
     bool QueryPlanGenerator::addShortCircuitPlan( NamespaceDetails *d ) {
         return
@@ -675,6 +772,13 @@ doneCheckOrder:
         if ( str::equals( bestIndex.firstElementFieldName(), "$natural" ) ) {
             p = newPlan( d, -1 );
         }
+        else if ( str::equals( bestIndex.firstElementFieldName(), "$intersect" ) ) {
+            p = newIntersectionPlan( d, bestIndex.firstElement().embeddedObject() );
+            if ( !p ) {
+                // An index was dropped, or no longer scans a single key for this query.
+                return false;
+            }
+        }
         
         NamespaceDetails::IndexIterator i = d->ii();
         while( i.more() ) {
@@ -687,7 +791,7 @@ doneCheckOrder:
         
         massert( 10368 ,  "Unable to locate previously recorded index", p );
 
-        if ( p->utility() == QueryPlan::Unhelpful ||
+        if ( ( p->utility() == QueryPlan::Unhelpful && !p->skipScan() ) ||
             p->utility() == QueryPlan::Disallowed ) {
             return false;
         }
@@ -701,6 +805,7 @@ doneCheckOrder:
         }
 
         _qps.setCachedPlan( p, best );
+        QueryUtilIndexed::noteHitForPatterns( _qps.frsp(), _qps.order() );
         return true;
     }
 
@@ -715,6 +820,31 @@ doneCheckOrder:
         return ret;
     }
 
+    shared_ptr<QueryPlan> QueryPlanGenerator::newIntersectionPlan( NamespaceDetails *d,
+                                                                  const BSONObj &keyPatterns ) const {
+        shared_ptr<QueryPlan> plans[ 2 ];
+        BSONObjIterator i( keyPatterns );
+        for( int n = 0; n < 2; ++n ) {
+            if ( !i.more() ) {
+                return shared_ptr<QueryPlan>();
+            }
+            BSONElement keyPattern = i.next();
+            if ( keyPattern.type() != Object ) {
+                return shared_ptr<QueryPlan>();
+            }
+            int idxNo = d->findIndexByKeyPattern( keyPattern.embeddedObject() );
+            if ( idxNo < 0 ) {
+                return shared_ptr<QueryPlan>();
+            }
+            plans[ n ] = newPlan( d, idxNo );
+            if ( !plans[ n ]->singleKeyRange() ) {
+                return shared_ptr<QueryPlan>();
+            }
+        }
+        plans[ 0 ]->intersectWith( plans[ 1 ] );
+        return plans[ 0 ];
+    }
+
     bool QueryPlanGenerator::setUnindexedPlanIf( bool set, NamespaceDetails *d ) {
         if ( set ) {
             setSingleUnindexedPlan( d );
@@ -837,6 +967,7 @@ doneCheckOrder:
                                      const CachedQueryPlan &cachedPlan ) {
         verify( nPlans() == 0 );
         _usingCachedPlan = true;
+        _cachedPlan = cachedPlan;
         _oldNScanned = cachedPlan.nScanned();
         _cachedPlanCharacter = cachedPlan.planCharacter();
         pushPlan( plan );
@@ -863,8 +994,11 @@ doneCheckOrder:
     }
 
     bool QueryPlanSet::hasPossiblyExcludedPlans() const {
+        // A pinned plan excludes the others as a hint would, so it is neither replanned nor
+        // cleared for a retry: its errors go to the caller and the pin stays.
         return
             _usingCachedPlan &&
+            !_cachedPlan.pinned() &&
             ( nPlans() == 1 ) &&
             ( firstPlan()->utility() != QueryPlan::Optimal );
     }
@@ -1084,9 +1218,11 @@ doneCheckOrder:
         if ( op.error() ) {
             return holder._op;
         }
+        // A pinned plan is kept however much it scans (see hasPossiblyExcludedPlans()).
         if ( _plans.hasPossiblyExcludedPlans() &&
             op.nscanned() > _plans._oldNScanned * 10 ) {
             verify( _plans.nPlans() == 1 && _plans.firstPlan()->special().empty() );
+            QueryUtilIndexed::noteReplanForPatterns( *_plans._frsp, _plans._order );
             holder._offset = -op.nscanned();
             _plans.addFallbackPlans();
             PlanSet::iterator i = _plans._plans.begin();
@@ -1333,8 +1469,13 @@ doneCheckOrder:
         }
         QueryPlanSet::QueryPlanPtr plan = _currentQps->firstPlan();
         shared_ptr<Cursor> cursor = plan->newCursor();
+        const CachedQueryPlan &cachedPlan = _currentQps->cachedPlan();
         return BSON( "cursor" << cursor->toString()
-                    << "indexBounds" << cursor->prettyIndexBounds() );
+                    << "indexBounds" << cursor->prettyIndexBounds()
+                    << "nscanned" << cachedPlan.nScanned()
+                    << "hits" << cachedPlan.nHits()
+                    << "replans" << cachedPlan.nReplans()
+                    << "pinned" << cachedPlan.pinned() );
     }
     
     void MultiPlanScanner::clearIndexesForPatterns() const {
@@ -1633,8 +1774,34 @@ doneCheckOrder:
                 return cachedQueryPlan;
             }
         }
+        nsdt.noteQueryCacheMiss();
         return CachedQueryPlan();
     }
+
+    void QueryUtilIndexed::noteHitForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order ) {
+        SimpleMutex::scoped_lock lk(NamespaceDetailsTransient::_qcMutex);
+        NamespaceDetailsTransient &nsdt = NamespaceDetailsTransient::get_inlock( frsp.ns() );
+        if ( !nsdt.noteCachedQueryPlanHit( frsp._singleKey.pattern( order ) ) ) {
+            nsdt.noteCachedQueryPlanHit( frsp._multiKey.pattern( order ) );
+        }
+    }
+
+    void QueryUtilIndexed::noteReplanForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order ) {
+        SimpleMutex::scoped_lock lk(NamespaceDetailsTransient::_qcMutex);
+        NamespaceDetailsTransient &nsdt = NamespaceDetailsTransient::get_inlock( frsp.ns() );
+        if ( !nsdt.noteCachedQueryPlanReplan( frsp._singleKey.pattern( order ) ) ) {
+            nsdt.noteCachedQueryPlanReplan( frsp._multiKey.pattern( order ) );
+        }
+    }
+
+    void QueryUtilIndexed::pinIndexForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order,
+                                               const CachedQueryPlan &pinnedPlan ) {
+        verify( pinnedPlan.pinned() );
+        SimpleMutex::scoped_lock lk(NamespaceDetailsTransient::_qcMutex);
+        NamespaceDetailsTransient &nsdt = NamespaceDetailsTransient::get_inlock( frsp.ns() );
+        nsdt.registerCachedQueryPlanForPattern( frsp._singleKey.pattern( order ), pinnedPlan );
+        nsdt.registerCachedQueryPlanForPattern( frsp._multiKey.pattern( order ), pinnedPlan );
+    }
     
     bool QueryUtilIndexed::uselessOr( const OrRangeGenerator &org, NamespaceDetails *d, int hintIdx ) {
         for( list<FieldRangeSetPair>::const_iterator i = org._originalOrSets.begin(); i != org._originalOrSets.end(); ++i ) {
@@ -27,6 +27,7 @@
 
 namespace mongo {
 
+    class BtreeCursor;
     class IndexDetails;
     class IndexType;
     class QueryPlanSummary;
@@ -78,6 +79,25 @@ namespace mongo {
         bool willScanTable() const { return _idxNo < 0 && ( _utility != Impossible ); }
         /** @return 'special' attribute of the plan, which was either set explicitly or generated from the index. */
         const string &special() const { return _special; }
+        /**
+         * @return true if the plan scans the entries of a single key of its index, which are
+         * ordered by DiskLoc, so that it may be intersected with another such plan.
+         */
+        bool singleKeyRange() const { return _singleKeyRange; }
+        /**
+         * Make this plan return only the documents 'other' finds as well, by intersecting the
+         * DiskLocs of the two plans' index scans.  Both plans must be singleKeyRange().
+         */
+        void intersectWith( const shared_ptr<QueryPlan> &other );
+        /** @return true if the plan intersects two index scans. */
+        bool intersected() const { return _intersectPlan.get() != 0; }
+        /**
+         * @return true if the plan is Unhelpful only because the query doesn't constrain the
+         * first field of its index, while it does constrain a later one.  Its index scan skips
+         * over the keys outside the later fields' ranges for each value of the leading fields, so
+         * the plan is worth racing when no plan is Helpful.
+         */
+        bool skipScan() const { return _skipScan; }
                 
         /** @return a new cursor based on this QueryPlan's index and FieldRangeSet. */
         shared_ptr<Cursor> newCursor( const DiskLoc &startLoc = DiskLoc() ) const;
@@ -125,6 +145,7 @@ namespace mongo {
                   const BSONObj &startKey,
                   const BSONObj &endKey );
 
+        BtreeCursor *newBtreeCursor() const;
         void checkTableScanAllowed() const;
         int independentRangesSingleIntervalLimit() const;
         /** @return true when the plan's query may contains an $exists:false predicate. */
@@ -150,6 +171,9 @@ namespace mongo {
         string _special;
         IndexType * _type;
         bool _startOrEndSpec;
+        bool _singleKeyRange;
+        bool _skipScan;
+        shared_ptr<QueryPlan> _intersectPlan;
         shared_ptr<Projection::KeyOnly> _keyFieldsOnly;
         mutable shared_ptr<CoveredIndexMatcher> _matcher; // Lazy initialization.
     };
@@ -327,11 +351,20 @@ namespace mongo {
         bool addSpecialPlan( NamespaceDetails *d );
         void addStandardPlans( NamespaceDetails *d );
         bool addCachedPlan( NamespaceDetails *d );
+        /** Add plans intersecting pairs of the single key 'plans'. */
+        void addIntersectionPlans( NamespaceDetails *d,
+                                  const vector<shared_ptr<QueryPlan> > &plans );
         shared_ptr<QueryPlan> newPlan( NamespaceDetails *d,
                                       int idxNo,
                                       const BSONObj &min = BSONObj(),
                                       const BSONObj &max = BSONObj(),
                                       const string &special = "" ) const;
+        /**
+         * @return a plan intersecting the indexes in 'keyPatterns', as recorded by
+         * QueryPlan::indexKey(), or an empty pointer if the indexes can't be intersected.
+         */
+        shared_ptr<QueryPlan> newIntersectionPlan( NamespaceDetails *d,
+                                                  const BSONObj &keyPatterns ) const;
         bool setUnindexedPlanIf( bool set, NamespaceDetails *d );
         void setSingleUnindexedPlan( NamespaceDetails *d );
         void setHintedPlanForIndex( IndexDetails& id );
@@ -379,7 +412,12 @@ namespace mongo {
         
         /** @return true if a plan is selected based on previous success of this plan. */
         bool usingCachedPlan() const { return _usingCachedPlan; }
-        /** @return true if some candidate plans may have been excluded due to plan caching. */
+        /** @return the plan cache entry for the selected plan, if usingCachedPlan(). */
+        const CachedQueryPlan &cachedPlan() const { return _cachedPlan; }
+        /**
+         * @return true if some candidate plans may have been excluded due to plan caching, and
+         * may be tried instead.  Never true for a pinned plan.
+         */
         bool hasPossiblyExcludedPlans() const;
         /** @return a single plan that may work well for the specified query. */
         QueryPlanPtr getBestGuess() const;
@@ -485,6 +523,7 @@ namespace mongo {
         PlanSet _plans;
         bool _mayRecordPlan;
         bool _usingCachedPlan;
+        CachedQueryPlan _cachedPlan;
         CandidatePlanCharacter _cachedPlanCharacter;
         BSONObj _order;
         long long _oldNScanned;
@@ -723,6 +762,13 @@ namespace mongo {
         static void clearIndexesForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order );
         /** Return a recorded best index for the single or multi key pattern. */
         static CachedQueryPlan bestIndexForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order );        
+        /** Count a use of the plan bestIndexForPatterns() returns. */
+        static void noteHitForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order );
+        /** Count a replan of the plan bestIndexForPatterns() returns, as it scanned too much. */
+        static void noteReplanForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order );
+        /** Record a pinned plan for both the single and multi key patterns. */
+        static void pinIndexForPatterns( const FieldRangeSetPair &frsp, const BSONObj &order,
+                                        const CachedQueryPlan &pinnedPlan );
         static bool uselessOr( const OrRangeGenerator& org, NamespaceDetails *d, int hintIdx );
     };
     
@@ -80,11 +80,15 @@ namespace mongo {
     }
     
     string QueryPattern::toString() const {
+        return toBSON().toString();
+    }
+
+    BSONObj QueryPattern::toBSON() const {
         BSONObjBuilder b;
         for( map<string,Type>::const_iterator i = _fieldTypes.begin(); i != _fieldTypes.end(); ++i ) {
             b << i->first << typeToString( i->second );
         }
-        return BSON( "query" << b.done() << "sort" << _sort ).toString();
+        return BSON( "query" << b.done() << "sort" << _sort );
     }
     
     void QueryPattern::setSort( const BSONObj sort ) {
@@ -107,10 +111,18 @@ namespace mongo {
     }
     
     CachedQueryPlan::CachedQueryPlan( const BSONObj &indexKey, long long nScanned,
-                                     CandidatePlanCharacter planCharacter ) :
+                                     CandidatePlanCharacter planCharacter, bool pinned ) :
     _indexKey( indexKey ),
     _nScanned( nScanned ),
-    _planCharacter( planCharacter ) {
+    _planCharacter( planCharacter ),
+    _nHits(),
+    _nReplans(),
+    _pinned( pinned ) {
+    }
+
+    BSONObj CachedQueryPlan::toBSON() const {
+        return BSON( "index" << _indexKey << "nscanned" << _nScanned << "hits" << _nHits <<
+                     "replans" << _nReplans << "pinned" << _pinned );
     }
 
     
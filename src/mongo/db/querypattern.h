@@ -49,6 +49,8 @@ namespace mongo {
         bool operator!=( const QueryPattern &other ) const;
         /** for development / debugging */
         string toString() const;
+        /** @return { query: { <field>: <type>, ... }, sort: <sort> }, as listed by planCache. */
+        BSONObj toBSON() const;
     private:
         void setSort( const BSONObj sort );
         static BSONObj normalizeSort( const BSONObj &spec );
@@ -76,21 +78,44 @@ namespace mongo {
         bool _mayRunOutOfOrderPlan;
     };
 
-    /** Information about a query plan that ran successfully for a QueryPattern. */
+    /**
+     * Information about a query plan that ran successfully for a QueryPattern, and how it has
+     * fared since.  A pinned plan was chosen with the planCache command; it is used without
+     * checking its nscanned against other plans and isn't dropped after writes.
+     */
     class CachedQueryPlan {
     public:
         CachedQueryPlan() :
-        _nScanned() {
+        _nScanned(),
+        _nHits(),
+        _nReplans(),
+        _pinned() {
         }
         CachedQueryPlan( const BSONObj &indexKey, long long nScanned,
-                        CandidatePlanCharacter planCharacter );
+                        CandidatePlanCharacter planCharacter, bool pinned = false );
         BSONObj indexKey() const { return _indexKey; }
         long long nScanned() const { return _nScanned; }
         CandidatePlanCharacter planCharacter() const { return _planCharacter; }
+        /** @return the number of queries that have used this plan. */
+        long long nHits() const { return _nHits; }
+        /** @return the number of times this plan scanned too much and other plans were tried. */
+        long long nReplans() const { return _nReplans; }
+        bool pinned() const { return _pinned; }
+        void noteHit() { ++_nHits; }
+        void noteReplan() { ++_nReplans; }
+        /** Carry over the hit and replan counts of the plan this one replaces. */
+        void inheritStats( const CachedQueryPlan &replaced ) {
+            _nHits = replaced._nHits;
+            _nReplans = replaced._nReplans;
+        }
+        BSONObj toBSON() const;
     private:
         BSONObj _indexKey;
         long long _nScanned;
         CandidatePlanCharacter _planCharacter;
+        long long _nHits;
+        long long _nReplans;
+        bool _pinned;
     };
 
     inline bool QueryPattern::operator<( const QueryPattern &other ) const {
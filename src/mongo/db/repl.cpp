@@ -250,6 +250,7 @@ namespace mongo {
 
             result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
             result.appendDate("localTime", jsTime());
+            negotiateCompression( cc().port(), cmdObj, result );
             return true;
         }
     } cmdismaster;
@@ -324,6 +324,14 @@ namespace replset {
     }
 
     BSONObj* BackgroundSync::peek() {
+        if (!peekAt(0, &_currentOp)) {
+            return NULL;
+        }
+
+        return &_currentOp;
+    }
+
+    bool BackgroundSync::peekAt(size_t i, BSONObj* op) {
         {
             boost::unique_lock<boost::mutex> lock(_mutex);
 
@@ -333,11 +341,7 @@ namespace replset {
             }
         }
 
-        if (!_buffer.blockingPeek(_currentOp, 1)) {
-            return NULL;
-        }
-
-        return &_currentOp;
+        return _buffer.blockingPeekAt(i, *op, 1);
     }
 
     void BackgroundSync::consume() {
@@ -30,6 +30,8 @@ namespace replset {
     public:
         virtual ~BackgroundSyncInterface();
         virtual BSONObj* peek() = 0;
+        // copies the op 'i' places behind the head into 'op', waiting up to a second for it
+        virtual bool peekAt(size_t i, BSONObj* op) = 0;
         virtual void consume() = 0;
         virtual Member* getSyncTarget() = 0;
     };
@@ -116,6 +118,10 @@ namespace replset {
         // element.
         virtual BSONObj* peek();
 
+        // Copies the op 'i' places behind the head into 'op', without removing anything, so a
+        // batch can be gathered and only consumed once it has been applied.
+        virtual bool peekAt(size_t i, BSONObj* op);
+
         // called by sync thread when it has applied an op
         virtual void consume();
 
@@ -16,19 +16,37 @@
 
 #include "mongo/pch.h"
 
+#include "third_party/murmurhash3/MurmurHash3.h"
+
 #include "mongo/db/client.h"
 #include "mongo/db/commands/fsync.h"
+#include "mongo/db/dbhelpers.h"
+#include "mongo/db/prefetch.h"
 #include "mongo/db/repl.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/util/processinfo.h"
 
 namespace mongo {
 
     using namespace bson;
     extern unsigned replSetForceInitialSyncFailure;
 
-    replset::SyncTail::SyncTail(BackgroundSyncInterface *q) : Sync(""), _queue(q) {}
+    /** writers, and prefetchers: --replWriterThreads, or two per core between 4 and 16 */
+    static int replWriterThreads() {
+        int n = cmdLine.replWriterThreads;
+        if ( n == 0 )
+            n = std::max( 4u, std::min( 16u, 2 * ProcessInfo().getNumCores() ) );
+        return n;
+    }
+
+    replset::SyncTail::SyncTail(BackgroundSyncInterface *q) :
+        Sync(""), _queue(q),
+        _writerThreads(replWriterThreads()),
+        _writerPool(_writerThreads),
+        _prefetcherPool(_writerThreads)
+    {}
 
     replset::SyncTail::~SyncTail() {}
 
@@ -50,7 +68,8 @@ namespace mongo {
         }
     }
 
-    /* apply the log op that is in param o
+    /* apply the log op that is in param o.  takes the locks it needs, so may be called by the
+       writer pool threads.
        @return bool success (true) or failure (false)
     */
     bool replset::SyncTail::syncApply(const BSONObj &o) {
@@ -60,9 +79,20 @@ namespace mongo {
             return true;
         }
 
+        scoped_ptr<Lock::ScopedLock> lk;
+        if( str::contains(ns, ".$cmd") ) {
+            // a command may need a global write lock. so we will conservatively go ahead and grab one here. suboptimal. :-(
+            lk.reset( new Lock::GlobalWrite() );
+        }
+        else {
+            lk.reset( new Lock::DBWrite(ns) );
+        }
+
         Client::Context ctx(ns);
         ctx.getClient()->curop()->reset();
-        return !applyOperation_inlock(o);
+        bool ok = !applyOperation_inlock(o);
+        getDur().commitIfNeeded();
+        return ok;
     }
 
     /* initial oplog application, during initial sync, after cloning.
@@ -210,176 +240,273 @@ namespace mongo {
         return golive;
     }
 
-    class DontLockOnEverySingleOperation : boost::noncopyable { 
-        scoped_ptr<Lock::ScopedLock> lk;
-        scoped_ptr<SimpleMutex::scoped_lock> fsync;
-    public:
-        void reset() {
-            lk.reset();
-            fsync.reset();
-        }
-        void reset(const char *ns) { 
-            reset();
-            verify( !Lock::isLocked() );
-            fsync.reset( new SimpleMutex::scoped_lock(filesLockedFsync) );
-            if( ns == 0 ) {
-                lk.reset( new Lock::GlobalWrite() );
+    static void initializeWriterThread() {
+        if( !haveClient() ) {
+            Client::initThread("repl writer worker");
+            replLocalAuth();
+        }
+        // we run while the sync thread holds ParallelBatchWriterMode
+        Lock::ParallelBatchWriterMode::iAmABatchParticipant();
+    }
+
+    static void initializePrefetchThread() {
+        if( !haveClient() ) {
+            Client::initThread("repl prefetch worker");
+            replLocalAuth();
+        }
+    }
+
+    void replset::SyncTail::prefetchOp(const BSONObj& op) {
+        initializePrefetchThread();
+
+        const char *ns = op.getStringField("ns");
+        if( *ns == 0 || str::contains(ns, ".$cmd") ) {
+            return;
+        }
+
+        try {
+            Client::ReadContext ctx(ns);
+            prefetchPagesForReplicatedOp(op);
+        }
+        catch (const DBException& e) {
+            LOG(2) << "replSet ignoring exception in prefetchOp(): " << e.what() << rsLog;
+        }
+    }
+
+    void replset::SyncTail::applyOpsFromWriterVector(const std::vector<BSONObj>* ops, SyncTail* st) {
+        initializeWriterThread();
+
+        for( std::vector<BSONObj>::const_iterator i = ops->begin(); i != ops->end(); ++i ) {
+            try {
+                // as before batching, a failed update of a missing doc is not an error here;
+                // a later op in the oplog will have deleted it.
+                st->syncApply(*i);
+            }
+            catch (DBException& e) {
+                // the rest of this namespace's ops depend on this one, so we stop here.  the
+                // batch is still queued and minValid is past it, so it is applied again.
+                error() << "replSet writer worker caught exception: " << e.what()
+                        << " on: " << i->toString() << rsLog;
+                st->_writerFailures.fetchAndAdd(1);
+                return;
+            }
+        }
+    }
+
+    void replset::SyncTail::prefetchOps(const std::deque<BSONObj>& ops) {
+        verify( _prefetcherPool.tasks_remaining() == 0 );
+        for( std::deque<BSONObj>::const_iterator i = ops.begin(); i != ops.end(); ++i ) {
+            _prefetcherPool.schedule(&prefetchOp, *i);
+        }
+        _prefetcherPool.join();
+    }
+
+    /* ops on one namespace must go to the same writer so they are applied in oplog order.  we
+       don't split a collection's ops further (say by _id) as capped collections depend on
+       insertion order and a delete/insert pair could otherwise collide on a unique index.
+    */
+    void replset::SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops,
+                                              std::vector< std::vector<BSONObj> >* writerVectors) {
+        for( std::deque<BSONObj>::const_iterator i = ops.begin(); i != ops.end(); ++i ) {
+            const char *ns = i->getStringField("ns");
+            uint32_t hash = 0;
+            MurmurHash3_x86_32(ns, strlen(ns), 0, &hash);
+            (*writerVectors)[hash % writerVectors->size()].push_back(*i);
+        }
+    }
+
+    bool replset::SyncTail::multiApply(std::deque<BSONObj>& ops) {
+        // page in what the batch will touch before we block readers
+        prefetchOps(ops);
+
+        std::vector< std::vector<BSONObj> > writerVectors(_writerThreads);
+        fillWriterVectors(ops, &writerVectors);
+
+        // prevent writers from blocking readers during fsync
+        SimpleMutex::scoped_lock fsynclk(filesLockedFsync);
+
+        // stop all readers until we're done, so no one sees a partially applied batch
+        Lock::ParallelBatchWriterMode pbwm;
+
+        /* if we have become primary, we dont' want to apply things from elsewhere
+           anymore.  assumePrimary takes the global lock, which pbwm keeps out, so we are
+           safe as long as we check after locking above. */
+        if( theReplSet->isPrimary() ) {
+            return false;
+        }
+
+        // until the whole batch is applied and logged a restart must not consider us
+        // consistent: the writers apply it out of order across namespaces
+        setMinValid(ops.back());
+
+        verify( _writerPool.tasks_remaining() == 0 );
+        _writerFailures.store(0);
+        for( unsigned i = 0; i < writerVectors.size(); i++ ) {
+            if( !writerVectors[i].empty() ) {
+                _writerPool.schedule(&applyOpsFromWriterVector, &writerVectors[i], this);
+            }
+        }
+        _writerPool.join();
+        uassert(16428, "replSet error applying a batch of ops",
+                _writerFailures.load() == 0);
+        return true;
+    }
+
+    void replset::SyncTail::applyOpsToOplog(std::deque<BSONObj>* ops) {
+        // one lock for the whole batch; _logOpObjRS's own lock nests inside it
+        Lock::DBWrite lk("local");
+        while( !ops->empty() ) {
+            const BSONObj& op = ops->front();
+            // with repl sets we write the ops to our oplog too
+            _logOpObjRS(op);
+            ops->pop_front();
+        }
+        getDur().commitIfNeeded();
+    }
+
+    void replset::SyncTail::setMinValid(const BSONObj& lastOp) {
+        BSONObjBuilder b;
+        b.append(lastOp["ts"]);
+        Lock::DBWrite lk("local");
+        Helpers::putSingleton("local.replset.minvalid", b.obj());
+    }
+
+    bool replset::SyncTail::tryPeekAndWaitForMore(OpQueue* ops) {
+        // waits up to a second for the op after those already in the batch
+        BSONObj op;
+        if( !_queue->peekAt(ops->count(), &op) ) {
+            // nothing more for now; apply what we have, if anything
+            return !ops->empty();
+        }
+
+        const char *ns = op.getStringField("ns");
+        if( str::contains(ns, ".$cmd") || str::contains(ns, ".system.indexes") ) {
+            // commands and index builds are applied by themselves, in a batch of one
+            if( ops->empty() ) {
+                ops->push_back(op);
             }
-            else {
-                lk.reset( new Lock::DBWrite(ns) );
+            return true;
+        }
+
+        ops->push_back(op);
+        return false;
+    }
+
+    void replset::SyncTail::handleSlaveDelay(const BSONObj& lastOp) {
+        int sd = theReplSet->myConfig().slaveDelay;
+
+        // ignore slaveDelay if the box is still initializing. once
+        // it becomes secondary we can worry about it.
+        if( sd && theReplSet->isSecondary() ) {
+            const OpTime ts = lastOp["ts"]._opTime();
+            long long a = ts.getSecs();
+            long long b = time(0);
+            long long lag = b - a;
+            long long sleeptime = sd - lag;
+            if( sleeptime > 0 ) {
+                uassert(12000, "rs slaveDelay differential too big check clocks and systems", sleeptime < 0x40000000);
+                if( sleeptime < 60 ) {
+                    sleepsecs((int) sleeptime);
+                }
+                else {
+                    log() << "replSet slavedelay sleep long time: " << sleeptime << rsLog;
+                    // sleep(hours) would prevent reconfigs from taking effect & such!
+                    long long waitUntil = b + sleeptime;
+                    while( 1 ) {
+                        sleepsecs(6);
+                        if( time(0) >= waitUntil )
+                            break;
+
+                        if( theReplSet->myConfig().slaveDelay != sd ) // reconf
+                            break;
+                    }
+                }
             }
         }
-    };
+    }
 
     /* tail an oplog.  ok to return, will be re-called. */
     void replset::SyncTail::oplogApplication() {
         while( 1 ) {
+            OpQueue ops;
             verify( !Lock::isLocked() );
-            {
-                int count = 0;
-                Timer timeInWriteLock;
-                DontLockOnEverySingleOperation lk;
-                while( 1 ) {
-                    // occasionally check some things
-                    if (count-- <= 0 || time(0) % 10 == 0) {
-                        if (theReplSet->isPrimary()) {
-                            return;
-                        }
-
-                        // can we become secondary?
-                        // we have to check this before calling mgr, as we must be a secondary to
-                        // become primary
-                        if (!theReplSet->isSecondary()) {
-                            OpTime minvalid;
-                            theReplSet->tryToGoLiveAsASecondary(minvalid);
-                        }
-
-                        // normally msgCheckNewState gets called periodically, but in a single node repl set
-                        // there are no heartbeat threads, so we do it here to be sure.  this is relevant if the
-                        // singleton member has done a stepDown() and needs to come back up.
-                        if (theReplSet->config().members.size() == 1 &&
-                            theReplSet->myConfig().potentiallyHot()) {
-                            theReplSet->mgr->send(boost::bind(&Manager::msgCheckNewState, theReplSet->mgr));
-                            sleepsecs(1);
-                            return;
-                        }
-
-                        count = 200;
+
+            Timer batchTimer;
+            int lastTimeChecked = 0;
+
+            // gather a batch.  tryPeekAndWaitForMore returns true when we need to end it early.
+            // the ops stay queued until applied, so stopping here loses none of them.
+            while( !tryPeekAndWaitForMore(&ops) &&
+                   ops.getSize() < replBatchLimitBytes &&
+                   ops.count() < replBatchLimitOps ) {
+
+                if (theReplSet->isPrimary()) {
+                    return;
+                }
+
+                int now = batchTimer.seconds();
+
+                // apply what we have if we've been waiting a second or more
+                if (!ops.empty() && now > 0) {
+                    break;
+                }
+
+                // occasionally check some things
+                if (ops.empty() || now > lastTimeChecked) {
+                    lastTimeChecked = now;
+
+                    // can we become secondary?
+                    // we have to check this before calling mgr, as we must be a secondary to
+                    // become primary
+                    if (!theReplSet->isSecondary()) {
+                        OpTime minvalid;
+                        theReplSet->tryToGoLiveAsASecondary(minvalid);
                     }
 
-                    if( timeInWriteLock.micros() > 1000 ) {
-                        lk.reset();
-                        timeInWriteLock.reset();
+                    // normally msgCheckNewState gets called periodically, but in a single node repl set
+                    // there are no heartbeat threads, so we do it here to be sure.  this is relevant if the
+                    // singleton member has done a stepDown() and needs to come back up.
+                    if (theReplSet->config().members.size() == 1 &&
+                        theReplSet->myConfig().potentiallyHot()) {
+                        theReplSet->mgr->send(boost::bind(&Manager::msgCheckNewState, theReplSet->mgr));
+                        sleepsecs(1);
+                        return;
                     }
+                }
+            }
 
-                    {
-                        const BSONObj *next = peek();
+            if( ops.empty() ) {
+                continue;
+            }
 
-                        if (next == NULL) {
-                            bool golive = false;
+            const BSONObj& lastOp = ops.getDeque().back();
+            handleSlaveDelay(lastOp);
 
-                            if (!theReplSet->isSecondary()) {
-                                OpTime minvalid;
-                                golive = theReplSet->tryToGoLiveAsASecondary(minvalid);
-                            }
+            try {
+                if( !multiApply(ops.getDeque()) ) {
+                    log(0) << "replSet stopping syncTail we are now primary" << rsLog;
+                    return;
+                }
+            }
+            catch (DBException& e) {
+                // as when we applied one op at a time: the batch is still queued, and is
+                // applied again when we're next called
+                sethbmsg(str::stream() << "syncTail: " << e.toString());
+                sleepsecs(30);
+                return;
+            }
 
-                            if (!golive) {
-                                lk.reset();
-                                timeInWriteLock.reset();
-                                sleepsecs(1);
-                            }
+            std::vector<BSONObj> applied(ops.getDeque().begin(), ops.getDeque().end());
+            applyOpsToOplog(&ops.getDeque());
 
-                            break;
-                        }
-
-                        const BSONObj& o = *next;
-
-                        int sd = theReplSet->myConfig().slaveDelay;
-
-                        // ignore slaveDelay if the box is still initializing. once
-                        // it becomes secondary we can worry about it.
-                        if( sd && theReplSet->isSecondary() ) {
-                            const OpTime ts = o["ts"]._opTime();
-                            long long a = ts.getSecs();
-                            long long b = time(0);
-                            long long lag = b - a;
-                            long long sleeptime = sd - lag;
-                            if( sleeptime > 0 ) {
-                                lk.reset();
-                                uassert(12000, "rs slaveDelay differential too big check clocks and systems", sleeptime < 0x40000000);
-                                if( sleeptime < 60 ) {
-                                    sleepsecs((int) sleeptime);
-                                }
-                                else {
-                                    log() << "replSet slavedelay sleep long time: " << sleeptime << rsLog;
-                                    // sleep(hours) would prevent reconfigs from taking effect & such!
-                                    long long waitUntil = b + sleeptime;
-                                    while( 1 ) {
-                                        sleepsecs(6);
-                                        if( time(0) >= waitUntil )
-                                            break;
-
-                                        if( theReplSet->myConfig().slaveDelay != sd ) // reconf
-                                            break;
-                                    }
-                                }
-                            }
-                        } // endif slaveDelay
-
-                        const char *ns = o.getStringField("ns");
-                        if( ns ) {
-                            if ( strlen(ns) == 0 ) {
-                                // this is ugly
-                                // this is often a no-op
-                                // but can't be 100% sure
-                                lk.reset();
-                                verify( !Lock::isLocked() );
-                                lk.reset(0);
-                            }
-                            else if( str::contains(ns, ".$cmd") ) {
-                                // a command may need a global write lock. so we will conservatively go ahead and grab one here. suboptimal. :-(
-                                lk.reset();
-                                verify( !Lock::isLocked() );
-                                lk.reset(0);
-                            }
-                            else if( !Lock::isWriteLocked(ns) || Lock::isW() ) {
-                                // we don't relock on every single op to try to be faster. however if switching collections, we have to.
-                                // note here we must reset to 0 first to assure the old object is destructed before our new operator invocation.
-                                lk.reset();
-                                verify( !Lock::isLocked() );
-                                lk.reset(ns);
-                            }
-                        }
-
-                        try {
-                            /* if we have become primary, we dont' want to apply things from elsewhere
-                               anymore. assumePrimary is in the db lock so we are safe as long as
-                               we check after we locked above. */
-                            if( theReplSet->isPrimary() ) {
-                                log(0) << "replSet stopping syncTail we are now primary" << rsLog;
-                                return;
-                            }
-
-                            syncApply(o);
-                            _logOpObjRS(o);   // with repl sets we write the ops to our oplog too
-                            getDur().commitIfNeeded();
-
-                            // we don't want the catch to reference next after it's been freed
-                            next = NULL;
-                            consume();
-                        }
-                        catch (DBException& e) {
-                            sethbmsg(str::stream() << "syncTail: " << e.toString());
-                            if (next) {
-                                log() << "syncing: " << next->toString() << endl;
-                            }
-                            lk.reset();
-                            sleepsecs(30);
-                            return;
-                        }
-                    }
-                } // end while
-            } // end writelock scope
+            // now take the batch off the queue, unless the queue was cleared meanwhile (rollback)
+            for( size_t i = 0; i < applied.size(); i++ ) {
+                BSONObj next;
+                if( !_queue->peekAt(0, &next) || next.objdata() != applied[i].objdata() ) {
+                    break;
+                }
+                consume();
+            }
         }
     }
 
@@ -16,8 +16,13 @@
 
 #pragma once
 
+#include <deque>
+#include <vector>
+
 #include "mongo/db/oplog.h"
 #include "mongo/db/client.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
 namespace replset {
@@ -26,6 +31,15 @@ namespace replset {
 
     /**
      * "Normal" replica set syncing
+     *
+     * Ops are pulled off the BackgroundSync queue in batches.  Each batch is prefetched on a
+     * pool of threads (outside any lock), then applied by a pool of writer threads with the
+     * ops partitioned by namespace so ops on one collection are applied in oplog order.
+     * Readers are blocked (ParallelBatchWriterMode) while a batch is applied, and minValid is
+     * set to the batch's last op first, so a crash mid-batch leaves us RECOVERING until we have
+     * reapplied past it.  Finally the whole batch is written to our oplog, and only then taken
+     * off the queue: a batch that fails, or that we stop short of because we became primary,
+     * is still queued.
      */
     class SyncTail : public Sync {
         BackgroundSyncInterface* _queue;
@@ -36,6 +50,58 @@ namespace replset {
         void oplogApplication();
         BSONObj* peek();
         void consume();
+
+        class OpQueue {
+        public:
+            OpQueue() : _size(0) {}
+            size_t getSize() const { return _size; }
+            std::deque<BSONObj>& getDeque() { return _deque; }
+            void push_back(const BSONObj& op) {
+                _deque.push_back(op);
+                _size += op.objsize();
+            }
+            bool empty() const { return _deque.empty(); }
+            size_t count() const { return _deque.size(); }
+        private:
+            std::deque<BSONObj> _deque;
+            size_t _size;
+        };
+
+        /**
+         * copies the next op from the queue into a batch, leaving it queued.
+         * @return true if the batch should be applied now (e.g. a command must run by itself),
+         *         false if we may keep adding to it.
+         */
+        bool tryPeekAndWaitForMore(OpQueue* ops);
+
+        /** prefetch, then apply a batch of ops with the writer pool.  does not log them.
+            @return false if we became primary and so applied nothing
+            asserts if an op couldn't be applied, the rest of its namespace's ops having been
+            skipped */
+        bool multiApply(std::deque<BSONObj>& ops);
+
+        /** write a batch of applied ops to our oplog, advancing lastOpTimeWritten */
+        void applyOpsToOplog(std::deque<BSONObj>* ops);
+
+        // batches end at whichever of these limits is hit first
+        static const size_t replBatchLimitBytes = 100 * 1024 * 1024;
+        static const size_t replBatchLimitOps = 5000;
+
+    private:
+        void prefetchOps(const std::deque<BSONObj>& ops);
+        void fillWriterVectors(const std::deque<BSONObj>& ops,
+                               std::vector< std::vector<BSONObj> >* writerVectors);
+        void handleSlaveDelay(const BSONObj& lastOp);
+        void setMinValid(const BSONObj& lastOp);
+
+        // run on the pools' threads
+        static void prefetchOp(const BSONObj& op);
+        static void applyOpsFromWriterVector(const std::vector<BSONObj>* ops, SyncTail* st);
+
+        const int _writerThreads;           // --replWriterThreads, or by core count
+        AtomicUInt32 _writerFailures;       // writer vectors stopped by an error this batch
+        ThreadPool _writerPool;
+        ThreadPool _prefetcherPool;
     };
 
     /**
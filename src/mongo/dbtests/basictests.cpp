@@ -27,6 +27,7 @@
 #include "../util/paths.h"
 #include "../util/stringutils.h"
 #include "../util/compress.h"
+#include "../util/net/message.h"
 #include "../db/db.h"
 
 namespace BasicTests {
@@ -679,6 +680,125 @@ namespace BasicTests {
         }
     } ctest1;
 
+    /** Message buffers are reused by size class. */
+    class MessageBufferPoolReuse {
+    public:
+        void run() {
+            int capacity;
+            // empty the thread's 2KB slot
+            void *held = MessageBufferPool::allocate( 2000, &capacity );
+            void *p = MessageBufferPool::allocate( 3000, &capacity );
+            ASSERT_EQUALS( 4096, capacity );
+            long long threadBytes = stat( "threadCacheBytes" );
+            MessageBufferPool::release( p, capacity );
+            ASSERT_EQUALS( threadBytes + 4096, stat( "threadCacheBytes" ) );
+            // the thread's cached buffer comes back
+            void *q = MessageBufferPool::allocate( 2500, &capacity );
+            ASSERT_EQUALS( p, q );
+            ASSERT_EQUALS( 4096, capacity );
+            ASSERT_EQUALS( threadBytes, stat( "threadCacheBytes" ) );
+
+            // a buffer released with less than its size is kept in a smaller class
+            MessageBufferPool::release( q, 3000 );
+            q = MessageBufferPool::allocate( 1500, &capacity );
+            ASSERT_EQUALS( p, q );
+            ASSERT_EQUALS( 2048, capacity );
+            MessageBufferPool::release( q, capacity );
+            MessageBufferPool::release( held, 2048 );
+
+            // a buffer too small for a class isn't kept
+            long long freed = stat( "freed" );
+            MessageBufferPool::release( malloc( 100 ), 100 );
+            ASSERT_EQUALS( freed + 1, stat( "freed" ) );
+
+            // one too large for a class is allocated as asked, and may be free()d
+            void *big = MessageBufferPool::allocate( 5 * 1024 * 1024, &capacity );
+            ASSERT_EQUALS( 5 * 1024 * 1024, capacity );
+            free( big );
+
+            // a message's buffer goes back to the pool
+            Message m;
+            m.setData( dbQuery, string( 600, 'x' ).c_str(), 600 );
+            char *data = reinterpret_cast< char* >( m.singleData() );
+            m.reset();
+            Message n;
+            n.setData( dbQuery, "abc" );
+            ASSERT_EQUALS( data, reinterpret_cast< char* >( n.singleData() ) );
+
+            // a PooledBufBuilder's buffer too
+            char *built;
+            {
+                PooledBufBuilder b( 20000 );
+                ASSERT_EQUALS( 32768, b.getSize() );
+                built = b.buf();
+            }
+            PooledBufBuilder b( 17000 );
+            ASSERT_EQUALS( built, b.buf() );
+        }
+    private:
+        static long long stat( const char *name ) {
+            BSONObjBuilder b;
+            MessageBufferPool::appendStats( b );
+            return b.obj()[ name ].numberLong();
+        }
+    };
+
+    /** A message compressed for the wire decompresses to the original. */
+    class MessageCompression {
+    public:
+        void run() {
+            string data( 4000, 'x' );
+            Message m;
+            m.setData( dbQuery, data.c_str(), data.size() );
+            m.header()->id = 7;
+            m.header()->responseTo = 3;
+
+            Message compressed;
+            ASSERT( m.compress( compressed ) );
+            ASSERT_EQUALS( dbCompressed, compressed.operation() );
+            ASSERT( compressed.size() < m.size() );
+            ASSERT_EQUALS( 7U, (unsigned)compressed.header()->id );
+            ASSERT_EQUALS( 3U, (unsigned)compressed.header()->responseTo );
+
+            ASSERT( compressed.decompress() );
+            ASSERT_EQUALS( dbQuery, compressed.operation() );
+            ASSERT_EQUALS( m.size(), compressed.size() );
+            ASSERT_EQUALS( 7U, (unsigned)compressed.header()->id );
+            ASSERT_EQUALS( 3U, (unsigned)compressed.header()->responseTo );
+            ASSERT( memcmp( data.c_str(), compressed.singleData()->_data, data.size() ) == 0 );
+
+            // a message in several buffers
+            Message multi;
+            char *first = (char *)malloc( MsgDataHeaderSize + 100 );
+            memset( first, 'a', MsgDataHeaderSize + 100 );
+            multi.appendData( first, MsgDataHeaderSize + 100 );
+            multi.header()->setOperation( opReply );
+            char *second = (char *)malloc( 2000 );
+            memset( second, 'b', 2000 );
+            multi.appendData( second, 2000 );
+            Message multiCompressed;
+            ASSERT( multi.compress( multiCompressed ) );
+            ASSERT( multiCompressed.decompress() );
+            ASSERT_EQUALS( opReply, multiCompressed.operation() );
+            ASSERT_EQUALS( MsgDataHeaderSize + 2100, multiCompressed.size() );
+            ASSERT_EQUALS( 'a', multiCompressed.singleData()->_data[ 99 ] );
+            ASSERT_EQUALS( 'b', multiCompressed.singleData()->_data[ 100 ] );
+
+            // data that doesn't get smaller isn't compressed
+            Message small;
+            small.setData( dbQuery, "abc" );
+            Message notCompressed;
+            ASSERT( !small.compress( notCompressed ) );
+            ASSERT( notCompressed.empty() );
+
+            // an unknown compressor is rejected
+            Message bad;
+            ASSERT( m.compress( bad ) );
+            bad.singleData()->_data[ 8 ] = 2;
+            ASSERT( !bad.decompress() );
+        }
+    };
+
     /** Simple tests for log tees. */
     class LogTee {
     public:
@@ -764,6 +884,8 @@ namespace BasicTests {
             add< CmdLineParseConfigTest >();
 
             add< CompressionTest1 >();
+            add< MessageBufferPoolReuse >();
+            add< MessageCompression >();
 
             add< LogTee >();
         }
@@ -58,3 +58,21 @@ namespace BtreeTests1 {
 namespace BtreeTests2 {
  #include "btreetests.inl"
 }
+
+#undef BtreeBucket
+#undef btree
+#undef btreemod
+#undef Continuation
+#define BtreeBucket BtreeBucket<V2>
+#define btree btree<V2>
+#define btreemod btreemod<V2>
+#define Continuation IndexInsertionContinuationImpl<V2>
+#undef testName
+#define testName "btree2"
+#undef BTVERSION
+#define BTVERSION 2
+#undef TESTTWOSTEP
+#define TESTPREFIXCOMPRESSED 1
+namespace BtreeTests3 {
+ #include "btreetests.inl"
+}
@@ -1625,6 +1625,45 @@
         }
     };
 
+#if defined(TESTPREFIXCOMPRESSED)
+    /** Compound keys sharing a long leading element, so buckets store it once as their prefix. */
+    class PrefixCompressedCompoundKeys : public Base {
+    public:
+        void run() {
+            DBDirectClient c;
+            BSONObj pattern = BSON( "p" << 1 << "q" << 1 );
+            c.ensureIndex( ns(), pattern, false, "", false, false, BTVERSION );
+            string p = bigNumString( 0x1234, 400 );
+            for( int i = 0; i < 1000; ++i ) {
+                c.insert( ns(), BSON( "p" << p << "q" << i ) );
+            }
+            for( int i = 0; i < 1000; i += 2 ) {
+                c.remove( ns(), BSON( "p" << p << "q" << i ) );
+            }
+
+            IndexDetails& pq = nsdetails( ns() )->idx( 2 );
+            ASSERT_EQUALS( pattern, pq.keyPattern() );
+            ASSERT_EQUALS( 500, pq.head.btree()->fullValidate( pq.head, pattern, 0, true ) );
+
+            ASSERT( c.findOne( ns(), QUERY( "p" << p << "q" << 10 ).hint( pattern ) ).isEmpty() );
+            ASSERT( !c.findOne( ns(), QUERY( "p" << p << "q" << 11 ).hint( pattern ) ).isEmpty() );
+            ASSERT_EQUALS( 250U, c.count( ns(), BSON( "p" << p << "q" << GT << 499 ) ) );
+
+            auto_ptr<DBClientCursor> cursor = c.query( ns(), Query().hint( pattern ) );
+            int last = -1;
+            int n = 0;
+            while( cursor->more() ) {
+                int q = cursor->next()[ "q" ].numberInt();
+                ASSERT( q > last );
+                ASSERT_EQUALS( 1, q % 2 );
+                last = q;
+                ++n;
+            }
+            ASSERT_EQUALS( 500, n );
+        }
+    };
+#endif
+
     class All : public Suite {
     public:
         All() : Suite( testName ) {
@@ -1666,13 +1705,15 @@
             add< NoMergeBelowMarkLeft >();
             add< MergeSizeRightTooBig >();
             add< MergeSizeLeftTooBig >();
+            add< PackEmpty >();
+            add< PackedDataSizeEmpty >();
+#if !defined(TESTPREFIXCOMPRESSED)
+            // prefix compressed buckets merge or rotate a single key, but are not rebalanced
             add< BalanceOneLeftToRight >();
             add< BalanceOneRightToLeft >();
             add< BalanceThreeLeftToRight >();
             add< BalanceThreeRightToLeft >();
             add< BalanceSingleParentKey >();
-            add< PackEmpty >();
-            add< PackedDataSizeEmpty >();
             add< BalanceSingleParentKeyPackParent >();
             add< BalanceSplitParent >();
             add< EvenRebalanceLeft >();
@@ -1692,6 +1733,7 @@
             add< PreferBalanceLeft >();
             add< PreferBalanceRight >();
             add< RecursiveMergeThenBalance >();
+#endif
             add< MergeRightEmpty >();
             add< MergeMinRightEmpty >();
             add< MergeLeftEmpty >();
@@ -1710,5 +1752,8 @@
             add< DelInternalSplitPromoteLeft >();
             add< DelInternalSplitPromoteRight >();
             add< SignedZeroDuplication >();
+#if defined(TESTPREFIXCOMPRESSED)
+            add< PrefixCompressedCompoundKeys >();
+#endif
         }
     } myall;
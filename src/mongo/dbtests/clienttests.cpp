@@ -20,6 +20,8 @@
 #include "dbtests.h"
 #include "../db/d_concurrency.h"
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/db/dbmessage.h"
+#include "mongo/util/net/message_port.h"
 
 namespace ClientTests {
 
@@ -178,6 +180,162 @@ namespace ClientTests {
         }
     };
 
+#if !defined(_WIN32)
+    /**
+     * A DBClientConnection talking to a fake server over a socket pair, so that the server can
+     * answer pipelined requests out of order, or wrongly.
+     */
+    class PipelinedBase {
+    public:
+        PipelinedBase() {
+            int fds[ 2 ];
+            verify( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) == 0 );
+            SockAddr remote( "127.0.0.1", 0 );
+            _conn.setPort( new MessagingPort( fds[ 0 ], remote ) );
+            _server.reset( new MessagingPort( fds[ 1 ], remote ) );
+        }
+    protected:
+        class Connection : public DBClientConnection {
+        public:
+            void setPort( MessagingPort *port ) { p.reset( port ); }
+        };
+        /** The server reads the next request. */
+        void receive( Message &request ) {
+            ASSERT( _server->recv( request ) );
+        }
+        static BSONObj query( Message &request ) {
+            DbMessage d( request );
+            QueryMessage q( d );
+            return q.query.getOwned();
+        }
+        void reply( Message &request, BSONObj obj ) {
+            replyToQuery( 0, _server.get(), request, obj );
+        }
+        /** Asserts that r->get() fails with 'code'. */
+        static void assertGetFails( const DBClientConnection::PipelinedReplyPtr &r, int code ) {
+            bool threw = false;
+            try {
+                r->get();
+            }
+            catch( const UserException &e ) {
+                ASSERT_EQUALS( code, e.getCode() );
+                threw = true;
+            }
+            ASSERT( threw );
+        }
+        Connection _conn;
+        scoped_ptr<MessagingPort> _server;
+    };
+
+    /** Replies are matched to their requests by responseTo, whatever their order. */
+    class PipelinedOutOfOrder : public PipelinedBase {
+    public:
+        void run() {
+            DBClientConnection::PipelinedReplyPtr r[ 3 ];
+            for( int i = 0; i < 3; ++i ) {
+                r[ i ] = _conn.runCommandPipelined( "unittests", BSON( "ping" << 1 << "i" << i ) );
+            }
+            DBClientConnection::PipelinedReplyPtr q =
+                    _conn.queryPipelined( "unittests.pipelined", QUERY( "a" << 1 ) );
+            ASSERT_EQUALS( 4, _conn.numPipelined() );
+            ASSERT( !r[ 0 ]->ready() );
+
+            Message requests[ 4 ];
+            for( int i = 0; i < 4; ++i ) {
+                receive( requests[ i ] );
+            }
+            for( int i = 0; i < 3; ++i ) {
+                ASSERT_EQUALS( i, query( requests[ i ] )[ "i" ].number() );
+            }
+            ASSERT_EQUALS( 1, query( requests[ 3 ] )[ "a" ].number() );
+
+            // the server answers the last request first
+            reply( requests[ 3 ], BSON( "a" << 1 << "b" << 2 ) );
+            for( int i = 2; i >= 0; --i ) {
+                reply( requests[ i ], BSON( "ok" << 1 << "i" << i ) );
+            }
+
+            BSONObj info;
+            ASSERT( r[ 1 ]->commandResult( info ) );
+            ASSERT_EQUALS( 1, info[ "i" ].number() );
+            // the replies read before r[ 1 ]'s are kept for their own requests
+            ASSERT( q->ready() );
+            ASSERT( r[ 2 ]->ready() );
+            ASSERT( !r[ 0 ]->ready() );
+            ASSERT_EQUALS( 1, _conn.numPipelined() );
+
+            for( int i = 0; i < 3; ++i ) {
+                ASSERT_EQUALS( r[ i ]->requestId(), r[ i ]->get().header()->responseTo );
+                ASSERT( r[ i ]->commandResult( info ) );
+                ASSERT_EQUALS( i, info[ "i" ].number() );
+            }
+            ASSERT_EQUALS( 0, _conn.numPipelined() );
+
+            auto_ptr<DBClientCursor> c = q->cursor();
+            ASSERT_EQUALS( 2, c->next()[ "b" ].number() );
+            ASSERT( !c->more() );
+        }
+    };
+
+    /** A reply to no request in flight fails the connection and its requests. */
+    class PipelinedUnknownReply : public PipelinedBase {
+    public:
+        void run() {
+            DBClientConnection::PipelinedReplyPtr r = _conn.runCommandPipelined( "unittests", BSON( "ping" << 1 ) );
+            DBClientConnection::PipelinedReplyPtr s = _conn.runCommandPipelined( "unittests", BSON( "ping" << 1 ) );
+            Message request;
+            receive( request );
+            request.header()->id = s->requestId() + 1000;
+            reply( request, BSON( "ok" << 1 ) );
+
+            assertGetFails( r, 16424 );
+            ASSERT( _conn.isFailed() );
+            ASSERT( s->ready() );
+            assertGetFails( s, 16425 );
+            ASSERT_EQUALS( 0, _conn.numPipelined() );
+        }
+    };
+
+    /** Requests in flight when the connection closes fail. */
+    class PipelinedConnectionClosed : public PipelinedBase {
+    public:
+        void run() {
+            DBClientConnection::PipelinedReplyPtr r = _conn.runCommandPipelined( "unittests", BSON( "ping" << 1 ) );
+            _server->shutdown();
+            assertGetFails( r, 16425 );
+            ASSERT( _conn.isFailed() );
+        }
+    };
+
+    /** A command reply has no cursor, and must hold a result. */
+    class PipelinedBadReplies : public PipelinedBase {
+    public:
+        void run() {
+            DBClientConnection::PipelinedReplyPtr r = _conn.runCommandPipelined( "unittests", BSON( "ping" << 1 ) );
+            DBClientConnection::PipelinedReplyPtr s = _conn.runCommandPipelined( "unittests", BSON( "ping" << 1 ) );
+            Message requests[ 2 ];
+            receive( requests[ 0 ] );
+            receive( requests[ 1 ] );
+            reply( requests[ 0 ], BSON( "ok" << 1 ) );
+            replyToQuery( 0, _server.get(), requests[ 1 ], 0, 0, 0 );
+
+            ASSERT_THROWS( r->cursor(), UserException );
+            BSONObj info;
+            bool threw = false;
+            try {
+                s->commandResult( info );
+            }
+            catch( const UserException &e ) {
+                ASSERT_EQUALS( 16427, e.getCode() );
+                threw = true;
+            }
+            ASSERT( threw );
+            // a bad reply is still matched to its request
+            ASSERT( !_conn.isFailed() );
+        }
+    };
+#endif
+
     class All : public Suite {
     public:
         All() : Suite( "client" ) {
@@ -191,6 +349,12 @@ namespace ClientTests {
             add<PushBack>();
             add<Create>();
             add<ConnectionStringTests>();
+#if !defined(_WIN32)
+            add<PipelinedOutOfOrder>();
+            add<PipelinedUnknownReply>();
+            add<PipelinedConnectionClosed>();
+            add<PipelinedBadReplies>();
+#endif
         }
 
     } all;
@@ -283,6 +283,29 @@ namespace CursorTests {
             }
         };
 
+        /** advancePastPrefix() visits the first entry for each value of the key prefix. */
+        class AdvancePastPrefix : public Base {
+        public:
+            void run() {
+                IndexSpec idx( BSON( "a" << 1 << "b" << 1 ) );
+                _c.ensureIndex( ns(), idx.keyPattern );
+                for( int i = 0; i < 300; ++i ) {
+                    _c.insert( ns(), BSON( "a" << i % 5 << "b" << i ) );
+                }
+                FieldRangeSet frs( ns(), BSON( "b" << GTE << 10 ), true, true );
+                boost::shared_ptr<FieldRangeVector> frv( new FieldRangeVector( frs, idx, 1 ) );
+                Client::WriteContext ctx( ns() );
+                scoped_ptr<BtreeCursor> c( BtreeCursor::make( nsdetails( ns() ), nsdetails( ns() )->idx(1), frv, 1 ) );
+                for( int a = 0; a < 5; ++a ) {
+                    ASSERT( c->ok() );
+                    ASSERT_EQUALS( BSON( "" << a << "" << 10 + a ), c->currKey() );
+                    c->advancePastPrefix( 1 );
+                }
+                ASSERT( !c->ok() );
+                ASSERT( c->nscanned() < 50 );
+            }
+        };
+
     } // namespace BtreeCursor
     
     namespace ClientCursor {
@@ -514,6 +537,7 @@ namespace CursorTests {
             add<BtreeCursor::RangeEq>();
             add<BtreeCursor::RangeIn>();
             add<BtreeCursor::AbortImplicitScan>();
+            add<BtreeCursor::AdvancePastPrefix>();
             add<ClientCursor::HandleDelete>();
             add<ClientCursor::AboutToDelete>();
             add<ClientCursor::AboutToDeleteDuplicate>();
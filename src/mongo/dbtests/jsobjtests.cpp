@@ -31,6 +31,8 @@
 #include "../db/btree.h"
 #include "mongo/platform/float_utils.h"
 
+#include <boost/thread/thread.hpp>
+
 namespace JsobjTests {
 
     IndexInterface& indexInterfaceForTheseTests = (time(0)%2) ? *IndexDetails::iis[0] : *IndexDetails::iis[1];
@@ -1726,6 +1728,46 @@ namespace JsobjTests {
             }
         };
 
+        /** sorters filled and sorted on their own threads, merged by one iterator */
+        class Merge {
+        public:
+            void run() {
+                const int total = 30000;
+                BSONObjExternalSorter a( indexInterfaceForTheseTests, BSONObj() , 2000 );
+                BSONObjExternalSorter b( indexInterfaceForTheseTests, BSONObj() , 2000 );
+                BSONObjExternalSorter c( indexInterfaceForTheseTests );
+                boost::thread ta( boost::bind( fill, &a, 0 ) );
+                boost::thread tb( boost::bind( fill, &b, 1 ) );
+                ta.join();
+                tb.join();
+                fill( &c, 2 );
+                ASSERT( a.numFiles() > 2 );
+                ASSERT_EQUALS( 0 , c.numFiles() );
+
+                vector<BSONObjExternalSorter*> v;
+                v.push_back( &a );
+                v.push_back( &b );
+                v.push_back( &c );
+                auto_ptr<BSONObjExternalSorter::Iterator> i = BSONObjExternalSorter::merge( v );
+                int num = 0;
+                BSONObjExternalSorter::Data prev;
+                while ( i->more() ) {
+                    BSONObjExternalSorter::Data d = i->next();
+                    if ( num++ ) {
+                        int x = prev.first.woCompare( d.first );
+                        ASSERT( x < 0 || ( x == 0 && prev.second < d.second ) );
+                    }
+                    prev = d;
+                }
+                ASSERT_EQUALS( total , num );
+            }
+            static void fill( BSONObjExternalSorter* sorter, int which ) {
+                for ( int i = which; i < 30000; i += 3 )
+                    sorter->add( BSON( "x" << ( i * 7919 ) % 1000 ) , which , i );
+                sorter->sort();
+            }
+        };
+
         class D1 {
         public:
             void run() {
@@ -2332,6 +2374,7 @@ namespace JsobjTests {
             add< external_sort::ByDiskLock >();
             add< external_sort::Big1 >();
             add< external_sort::Big2 >();
+            add< external_sort::Merge >();
             add< external_sort::D1 >();
             add< CompatBSON >();
             add< CompareDottedFieldNamesTest >();
@@ -37,6 +37,8 @@ using namespace boost;
 const char *ns = "test.btreeperf";
 const char *db = "test";
 const char *index_collection = "btreeperf.$_id_";
+// A second index on the same keys, in prefix compressed (v:2) format.
+const char *v2_index_collection = "btreeperf.$_id_-1";
 
 // This random number generator has a much larger period than the default
 // generator and is half as fast as the default.  Given that we intend to
@@ -248,6 +250,28 @@ private:
     UniformInsertRangedUniformRemoveString _gen;
 };
 
+/**
+ * String Keys with long common prefixes, as with paths or composite identifiers
+ * Uniform Inserts
+ * Uniform Removes
+ */
+class UniformInsertUniformRemovePath : public InsertAndUniformRemoveStrategy< string > {
+public:
+    UniformInsertUniformRemovePath() :
+        _uniform_int( 0, 99999999 ),
+        _nextInt( randomNumberGenerator, _uniform_int ) {
+    }
+    virtual string insertVal() {
+        int x = _nextInt();
+        stringstream ss;
+        ss << "/accounts/region-" << x % 4 << "/customers/" << x / 4 % 1000 << "/orders/" << x;
+        return ss.str();
+    }
+private:
+    uniform_int< int > _uniform_int;
+    variate_generator< mt19937&, uniform_int< int > > _nextInt;
+};
+
 /**
  * OID Keys
  * Increasing Inserts
@@ -403,11 +427,14 @@ int main( int argc, const char **argv ) {
     DBClientConnection conn;
     conn.connect( "127.0.0.1:27017" );
     conn.dropCollection( ns );
+    // Comment this out to measure only the _id index.
+    conn.ensureIndex( ns, BSON( "_id" << -1 ), false, "", false, false, 2 );
 
 //    UniformInsertRangedUniformRemoveInteger strategy;
 //    UniformInsertUniformRemoveInteger strategy;
 //    UniformInsertRangedUniformRemoveString strategy;
 //    UniformInsertUniformRemoveString strategy;
+//    UniformInsertUniformRemovePath strategy;
 //    IncreasingInsertRangedUniformRemoveOID strategy;
 //    IncreasingInsertUniformRemoveOID strategy;
 //    IncreasingInsertIncreasingRemoveInteger strategy;
@@ -416,9 +443,10 @@ int main( int argc, const char **argv ) {
 
     Timer t;
     BSONObj statsCmd = BSON( "collstats" << index_collection );
+    BSONObj v2StatsCmd = BSON( "collstats" << v2_index_collection );
 
     // Print header, unless we are generating a script (in that case, comment this out).
-    cout << "ops,milliseconds,docs,totalBucketSize" << endl;
+    cout << "ops,milliseconds,docs,totalBucketSize,v2TotalBucketSize" << endl;
 
     long long i = 0;
     long long n = 10000000000;
@@ -436,7 +464,9 @@ int main( int argc, const char **argv ) {
             // The total number of bytes used for all allocated 8K buckets of the
             // btree.
             long long totalBucketSize = result.getField( "count" ).numberLong() * 8192;
-            cout << i << ',' << t.millis() << ',' << docs << ',' << totalBucketSize << endl;
+            conn.runCommand( db, v2StatsCmd, result );
+            long long v2TotalBucketSize = result.getField( "count" ).numberLong() * 8192;
+            cout << i << ',' << t.millis() << ',' << docs << ',' << totalBucketSize << ',' << v2TotalBucketSize << endl;
         }
     }
 }
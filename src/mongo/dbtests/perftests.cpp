@@ -38,6 +38,9 @@
 #include "../util/checksum.h"
 #include "../util/version.h"
 #include "../db/key.h"
+#include "../db/pipeline/document.h"
+#include "../db/pipeline/expression.h"
+#include "../db/pipeline/value.h"
 #include "../util/compress.h"
 #include "../util/concurrency/qlock.h"
 #include <boost/filesystem/operations.hpp>
@@ -460,6 +463,42 @@ namespace PerfTests {
         }
     };
 
+    /** pipeline arithmetic over a document's fields, as in a $project */
+    class Arithmetic : public NonDurTest {
+    public:
+        long long n;
+        BSONObj b, spec;
+        intrusive_ptr<Document> pDocument;
+        intrusive_ptr<Expression> pExpression;
+        /** @param optimize if false, there is no compiled program, and the tree is walked */
+        Arithmetic(bool optimize) {
+            n = 0;
+            b = BSON( "a" << 3 << "b" << 2.5 << "c" << 7LL << "d" << 11 << "e" << 4 );
+            pDocument = Document::createFromBsonObj(&b);
+            spec = fromjson( "{x:{$add:[{$multiply:['$a','$b']},{$subtract:['$c','$d']},"
+                             "{$divide:['$d','$e']},{$mod:['$d','$e']},'$a',1]}}" );
+            BSONElement e = spec.firstElement();
+            pExpression = Expression::parseOperand(&e);
+            if( optimize )
+                pExpression = pExpression->optimize();
+        }
+        void timed() {
+            n += pExpression->evaluate(pDocument)->coerceToLong();
+        }
+    };
+
+    class ArithmeticTree : public Arithmetic {
+    public:
+        ArithmeticTree() : Arithmetic(false) { }
+        string name() { return "ArithmeticTree"; }
+    };
+
+    class ArithmeticCompiled : public Arithmetic {
+    public:
+        ArithmeticCompiled() : Arithmetic(true) { }
+        string name() { return "ArithmeticCompiled"; }
+    };
+
     class KeyTest : public B {
     public:
         KeyV1Owned a,b,c;
@@ -1151,6 +1190,8 @@ namespace PerfTests {
                 add< BSONIter >();
                 add< BSONGetFields1 >();
                 add< BSONGetFields2 >();
+                add< ArithmeticTree >();
+                add< ArithmeticCompiled >();
                 //add< TaskQueueTest >();
                 add< InsertDup >();
                 add< Insert1 >();
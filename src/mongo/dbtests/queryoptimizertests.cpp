@@ -515,6 +515,8 @@ namespace QueryOptimizerTests {
                                                          BSON( "b" << 1 ), BSONObj() ) );
                 ASSERT( p->multikeyFrs().range( "a" ).universal() );
                 ASSERT_EQUALS( QueryPlan::Unhelpful, p->utility() );
+                // An index scan providing no order can't be chosen for a sorted query.
+                ASSERT( !p->skipScan() );
                 scoped_ptr<QueryPlan> p2( QueryPlan::make( nsd(), INDEXNO( "a" << 1 << "b" << 1 ),
                                                           FRSP( BSON( "b" << 1 << "c" << 1 ) ),
                                                           FRSP2( BSON( "b" << 1 << "c" << 1 ) ),
@@ -537,6 +539,7 @@ namespace QueryOptimizerTests {
                                                           BSONObj() ) );
                 ASSERT( p4->multikeyFrs().range( "b" ).universal() );
                 ASSERT_EQUALS( QueryPlan::Unhelpful, p4->utility() );
+                ASSERT( p4->skipScan() );
             }
         };
         
@@ -977,6 +980,21 @@ namespace QueryOptimizerTests {
             }
         };
 
+        /** An index whose leading field isn't queried is skip scanned if no index is helpful. */
+        class SkipScanIndex : public Base {
+        public:
+            void run() {
+                Helpers::ensureIndex( ns(), BSON( "a" << 1 << "b" << 1 ), false, "a_1_b_1" );
+                shared_ptr<QueryPlanSet> qps = makeQps( BSON( "b" << 1 ) );
+                ASSERT_EQUALS( 2, qps->nPlans() );
+                ASSERT_EQUALS( BSON( "a" << 1 << "b" << 1 ), qps->firstPlan()->indexKey() );
+                Helpers::ensureIndex( ns(), BSON( "b" << 1 << "c" << 1 ), false, "b_1_c_1" );
+                qps = makeQps( BSON( "b" << GT << 1 << "c" << 1 ) );
+                ASSERT_EQUALS( 2, qps->nPlans() );
+                ASSERT_EQUALS( BSON( "b" << 1 << "c" << 1 ), qps->firstPlan()->indexKey() );
+            }
+        };
+
         class FindOne : public Base {
         public:
             void run() {
@@ -1567,6 +1585,7 @@ namespace QueryOptimizerTests {
             add<QueryPlanSetTests::Count>();
             add<QueryPlanSetTests::QueryMissingNs>();
             add<QueryPlanSetTests::UnhelpfulIndex>();
+            add<QueryPlanSetTests::SkipScanIndex>();
             add<QueryPlanSetTests::FindOne>();
             add<QueryPlanSetTests::Delete>();
             add<QueryPlanSetTests::DeleteOneScan>();
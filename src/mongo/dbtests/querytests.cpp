@@ -222,6 +222,136 @@ namespace QueryTests {
         }
     };
 
+    /** A getMore reply may leave its large documents in the data files. */
+    class GatheredGetMore : public ClientBase {
+    public:
+        ~GatheredGetMore() {
+            client().dropCollection( ns() );
+        }
+        void run() {
+            string big( 2000, 'x' );
+            for( int i = 0; i < 10; ++i ) {
+                insert( ns(), i % 2 ? BSON( "_id" << i << "s" << big ) : BSON( "_id" << i ) );
+            }
+            long long plainId = cursorAfterTwo();
+            long long gatheredId = cursorAfterTwo();
+
+            Client::ReadContext ctx( ns() );
+            CurOp op( &(cc()) );
+            op.ensureStarted();
+            bool exhaust;
+            QueryResult *plain = processGetMore( ns(), 0, plainId, op, 0, exhaust );
+            GatheredReply gathered( 1000 );
+            QueryResult *reply = processGetMore( ns(), 0, gatheredId, op, 0, exhaust, &gathered );
+
+            // The four large documents left are referenced, the small ones copied.
+            ASSERT_EQUALS( 8, reply->nReturned );
+            ASSERT_EQUALS( plain->len, reply->len );
+            ASSERT_EQUALS( 4 * BSON( "_id" << 1 << "s" << big ).objsize(),
+                           gathered.referencedBytes() );
+
+            // Gathered, the reply is the same as the copied one.
+            vector< pair< char *, int > > data;
+            gathered.gather( reply, data );
+            ASSERT_EQUALS( 8U, data.size() );
+            string sent;
+            for( vector< pair< char *, int > >::const_iterator i = data.begin(); i != data.end(); ++i ) {
+                sent.append( i->first, i->second );
+            }
+            ASSERT_EQUALS( string( (char *)plain + sizeof( QueryResult ),
+                                   plain->len - sizeof( QueryResult ) ),
+                           sent.substr( sizeof( QueryResult ) ) );
+
+            // And so is it materialized.
+            BufBuilder b;
+            b.appendBuf( reply, reply->len - gathered.referencedBytes() );
+            gathered.materialize( b );
+            ASSERT( gathered.empty() );
+            ASSERT_EQUALS( sent, string( b.buf(), b.len() ) );
+
+            free( plain );
+            free( reply );
+        }
+    private:
+        static const char *ns() { return "unittests.querytests.GatheredGetMore"; }
+        /** @return a cursor after the first two documents */
+        long long cursorAfterTwo() {
+            auto_ptr< DBClientCursor > cursor = client().query( ns(), BSONObj(), 2 );
+            long long cursorId = cursor->getCursorId();
+            cursor->decouple();
+            return cursorId;
+        }
+    };
+
+    /** aggregate with a cursor leaves the rest of the result for getMore */
+    class AggregateCursor : public ClientBase {
+    public:
+        ~AggregateCursor() {
+            client().dropCollection( "unittests.querytests.AggregateCursor" );
+        }
+        void run() {
+            const char *ns = "unittests.querytests.AggregateCursor";
+            for( int i = 0; i < 1000; ++i ) {
+                insert( ns, BSON( "_id" << i << "a" << i % 10 ) );
+            }
+
+            BSONObj res;
+            ASSERT( client().runCommand( "unittests",
+                                         BSON( "aggregate" << "querytests.AggregateCursor" <<
+                                               "pipeline" << BSON_ARRAY( BSON( "$sort" << BSON( "_id" << -1 ) ) ) <<
+                                               "cursor" << BSON( "batchSize" << 10 ) ),
+                                         res ) );
+            BSONObj cursorObj = res[ "cursor" ].Obj();
+            ASSERT_EQUALS( string( ns ), cursorObj[ "ns" ].String() );
+            vector<BSONElement> firstBatch = cursorObj[ "firstBatch" ].Array();
+            ASSERT_EQUALS( 10U, firstBatch.size() );
+            ASSERT_EQUALS( 999, firstBatch[ 0 ].Obj()[ "_id" ].numberInt() );
+            long long cursorId = cursorObj[ "id" ].numberLong();
+            ASSERT( cursorId );
+
+            auto_ptr< DBClientCursor > cursor = client().getMore( ns, cursorId, 100 );
+            int expected = 989;
+            while( cursor->more() ) {
+                ASSERT_EQUALS( expected--, cursor->next()[ "_id" ].numberInt() );
+            }
+            ASSERT_EQUALS( -1, expected );
+            ASSERT_EQUALS( 0, cursor->getCursorId() );
+
+            // all of it in the first batch
+            ASSERT( client().runCommand( "unittests",
+                                         BSON( "aggregate" << "querytests.AggregateCursor" <<
+                                               "pipeline" << BSON_ARRAY( BSON( "$match" << BSON( "a" << 3 ) ) ) <<
+                                               "cursor" << BSON( "batchSize" << 1000 ) ),
+                                         res ) );
+            ASSERT_EQUALS( 100U, res[ "cursor" ][ "firstBatch" ].Array().size() );
+            ASSERT_EQUALS( 0, res[ "cursor" ][ "id" ].numberLong() );
+        }
+    };
+
+    /** dropping the collection kills an aggregate command's cursor */
+    class AggregateCursorDrop : public ClientBase {
+    public:
+        void run() {
+            const char *ns = "unittests.querytests.AggregateCursorDrop";
+            for( int i = 0; i < 100; ++i ) {
+                insert( ns, BSON( "_id" << i ) );
+            }
+
+            BSONObj res;
+            ASSERT( client().runCommand( "unittests",
+                                         BSON( "aggregate" << "querytests.AggregateCursorDrop" <<
+                                               "pipeline" << BSON_ARRAY( BSON( "$match" << BSONObj() ) ) <<
+                                               "cursor" << BSON( "batchSize" << 0 ) ),
+                                         res ) );
+            ASSERT( res[ "cursor" ][ "firstBatch" ].Array().empty() );
+            long long cursorId = res[ "cursor" ][ "id" ].numberLong();
+            ASSERT( cursorId );
+
+            client().dropCollection( ns );
+            ASSERT_THROWS( client().getMore( ns, cursorId )->more(), UserException );
+        }
+    };
+
     class PositiveLimit : public ClientBase {
     public:
         const char* ns;
@@ -1569,6 +1699,9 @@ namespace QueryTests {
             add< FindOneEmptyObj >();
             add< BoundedKey >();
             add< GetMore >();
+            add< GatheredGetMore >();
+            add< AggregateCursor >();
+            add< AggregateCursorDrop >();
             add< PositiveLimit >();
             add< ReturnOneOfManyAndTail >();
             add< TailNotAtEnd >();
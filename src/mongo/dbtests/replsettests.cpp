@@ -320,7 +320,7 @@ namespace ReplSetTests {
     };
 
     class BackgroundSyncTest : public replset::BackgroundSyncInterface {
-        std::queue<BSONObj> _queue;
+        std::deque<BSONObj> _queue;
     public:
         BackgroundSyncTest() {}
         virtual ~BackgroundSyncTest() {}
@@ -330,14 +330,24 @@ namespace ReplSetTests {
             }
             return &_queue.front();
         }
+        virtual bool peekAt(size_t i, BSONObj* op) {
+            if (i >= _queue.size()) {
+                return false;
+            }
+            *op = _queue[i];
+            return true;
+        }
         virtual void consume() {
-            _queue.pop();
+            _queue.pop_front();
+        }
+        size_t size() const {
+            return _queue.size();
         }
         virtual Member* getSyncTarget() {
             return 0;
         }
         void addDoc(BSONObj doc) {
-            _queue.push(doc.getOwned());
+            _queue.push_back(doc.getOwned());
         }
     };
 
@@ -345,12 +355,13 @@ namespace ReplSetTests {
         ReplSetConfig *_config;
         ReplSetConfig::MemberCfg *_myConfig;
         replset::BackgroundSyncInterface *_syncTail;
+        bool _primary;
     public:
         virtual ~ReplSetTest() {
             delete _myConfig;
             delete _config;
         }
-        ReplSetTest() : _syncTail(0) {
+        ReplSetTest() : _syncTail(0), _primary(false) {
             BSONArrayBuilder members;
             members.append(BSON("_id" << 0 << "host" << "host1"));
             members.append(BSON("_id" << 1 << "host" << "host2"));
@@ -361,8 +372,13 @@ namespace ReplSetTests {
         virtual bool isSecondary() {
             return true;
         }
+        // syncTail runs until we become primary; we also stop it once it has applied and
+        // consumed everything queued
         virtual bool isPrimary() {
-            return _syncTail->peek() == 0;
+            return _primary || _syncTail->peek() == 0;
+        }
+        void setPrimary(bool primary) {
+            _primary = primary;
         }
         virtual bool tryToGoLiveAsASecondary(OpTime& minvalid) {
             return false;
@@ -384,6 +400,7 @@ namespace ReplSetTests {
     class TestRSSync : public Base {
         BackgroundSyncTest *_bgsync;
         replset::SyncTail *_tailer;
+        ReplSetTest *_rst;
 
         void setup() {
             // setup background sync instance
@@ -393,9 +410,13 @@ namespace ReplSetTests {
             _tailer = new replset::SyncTail(_bgsync);
 
             // setup theReplSet
-            ReplSetTest *rst = new ReplSetTest();
-            rst->setSyncTail(_bgsync);
-            theReplSet = rst;
+            _rst = new ReplSetTest();
+            _rst->setSyncTail(_bgsync);
+            theReplSet = _rst;
+        }
+
+        static string collNs(int i) {
+            return str::stream() << ns() << "_" << i;
         }
 
         void addOp(const string& op, BSONObj o, BSONObj* o2 = 0, const char* coll = 0) {
@@ -447,6 +468,22 @@ namespace ReplSetTests {
                     "timestamp" << 1334810820))), &id);
         }
 
+        // ops on several collections, spread over the writer threads, each collection's
+        // updates depending on its inserts having been applied first
+        void addInterleaved(int nColls, int nDocs) {
+            for (int i=0; i<nDocs; i++) {
+                for (int c=0; c<nColls; c++) {
+                    addOp("i", BSON("_id" << i << "x" << 0), 0, collNs(c).c_str());
+                }
+            }
+            for (int i=0; i<nDocs; i++) {
+                for (int c=0; c<nColls; c++) {
+                    BSONObj id = BSON("_id" << i);
+                    addOp("u", BSON("$set" << BSON("x" << i)), &id, collNs(c).c_str());
+                }
+            }
+        }
+
         void addUniqueIndex() {
             addOp("i", BSON("ns" << ns() << "key" << BSON("x" << 1) << "name" << "x1" << "unique" << true), 0, "unittests.system.indexes");
             addInserts(2);
@@ -482,13 +519,40 @@ namespace ReplSetTests {
             ASSERT_EQUALS(1334813368, obj["requests"]["1000002_2"]["timestamp"].number());
             ASSERT_EQUALS(1334810820, obj["requests"]["100002_1"]["timestamp"].number());
 
-            // test dup key error
+            // ops on many collections are applied by the writer pool, in order per collection
+            const int nColls = 20;
+            addInterleaved(nColls, 50);
+            applyOplog();
+
+            ASSERT_EQUALS(0U, _bgsync->size());
+            for (int c=0; c<nColls; c++) {
+                ASSERT_EQUALS(50, static_cast<int>(client()->count(collNs(c))));
+                // an update applied before its insert would have left x at 0
+                ASSERT_EQUALS(49, static_cast<int>(client()->count(collNs(c),
+                                                                     BSON("x" << BSON("$gt" << 0)))));
+                client()->dropCollection(collNs(c));
+            }
+
+            // having become primary we stop, leaving what hasn't been applied queued
+            drop();
+            _rst->setPrimary(true);
+            addInserts(10);
+            applyOplog();
+
+            ASSERT_EQUALS(0, static_cast<int>(client()->count(ns())));
+            ASSERT_EQUALS(10U, _bgsync->size());
+            _rst->setPrimary(false);
+            applyOplog();
+            ASSERT_EQUALS(10, static_cast<int>(client()->count(ns())));
+
+            // test dup key error: the index build is applied, then the batch of inserts stops
+            // at the duplicate, and stays queued to be applied again
             drop();
             addUniqueIndex();
             applyOplog();
 
             ASSERT_EQUALS(1, static_cast<int>(client()->count(ns())));
-            ASSERT(_bgsync->peek() != NULL);
+            ASSERT_EQUALS(2U, _bgsync->size());
         }
     };
 
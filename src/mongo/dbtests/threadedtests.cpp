@@ -27,6 +27,7 @@
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 #include "../db/d_concurrency.h"
+#include "../db/pdfile.h"
 #include "../util/concurrency/synchronization.h"
 #include "../util/concurrency/qlock.h"
 #include "dbtests.h"
@@ -890,6 +891,53 @@ namespace ThreadedTests {
         }
     };
 
+    // writers of two collections of one db hold their CollectionWrite locks at the same time
+    class CollectionWritesAreConcurrent : public ThreadedTest<2> {
+    public:
+        CollectionWritesAreConcurrent() : inside(0) { }
+    private:
+        AtomicUInt inside;
+        static string ns(int x) { return str::stream() << "unittests.collectionwrite" << x; }
+        virtual void setup() {
+            // the collections have to exist for a CollectionWrite not to lock the whole db
+            DBDirectClient client;
+            for( int x = 1; x <= nthreads; x++ ) {
+                client.dropCollection( ns(x) );
+                client.insert( ns(x), BSON( "_id" << 0 ) );
+            }
+        }
+        virtual void subthread(int x) {
+            Client::initThread("collectionwrite");
+            {
+                Lock::CollectionWrite lk( ns(x) );
+                ASSERT( Lock::isCollectionWriteLocked( ns(x) ) );
+                Client::Context ctx( ns(x) );
+                BSONObj o = BSON( "_id" << x );
+                theDataFileMgr.insertWithObjMod( ns(x).c_str(), o );
+
+                // the other thread gets in only if our lock lets writers of its collection in
+                inside++;
+                Timer t;
+                while( inside.get() < (unsigned) nthreads && t.millis() < 10000 )
+                    sleepmillis(1);
+                ASSERT_EQUALS( (unsigned) nthreads, inside.get() );
+            }
+            cc().shutdown();
+        }
+        virtual void validate() {
+            DBDirectClient client;
+            for( int x = 1; x <= nthreads; x++ ) {
+                ASSERT_EQUALS( 2U, client.count( ns(x) ) );
+                client.dropCollection( ns(x) );
+            }
+
+            // a collection that doesn't exist yet gets its whole db locked
+            Lock::CollectionWrite lk( ns(0) );
+            ASSERT( !Lock::isCollectionWriteLocked( ns(0) ) );
+            ASSERT( Lock::isWriteLocked( ns(0) ) );
+        }
+    };
+
     // Tests waiting on the TicketHolder by running many more threads than can fit into the "hotel", but only
     // max _nRooms threads should ever get in at once
     class TicketHolderWaits : public ThreadedTest<10> {
@@ -999,6 +1047,7 @@ namespace ThreadedTests {
             add< RWLockTest4 >();
 
             add< MongoMutexTest >();
+            add< CollectionWritesAreConcurrent >();
             add< TicketHolderWaits >();
         }
     } myall;
@@ -18,6 +18,8 @@
 
 #include "pch.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "../db/jsobj.h"
 #include "../db/cmdline.h"
 
@@ -35,71 +37,96 @@ namespace mongo {
 
     Balancer balancer;
 
-    Balancer::Balancer() : _balancedLastTime(0), _policy( new BalancerPolicy() ) {}
+    Balancer::Balancer() : _balancedLastTime(0), _maxConcurrentMigrations(0), _policy( new BalancerPolicy() ) {}
 
     Balancer::~Balancer() {
     }
 
-    int Balancer::_moveChunks( const vector<CandidateChunkPtr>* candidateChunks ) {
-        int movedCount = 0;
+    int Balancer::_moveChunk( const CandidateChunk& chunkInfo ) {
+        DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
+        verify( cfg );
 
-        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
-            const CandidateChunk& chunkInfo = *it->get();
+        ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+        verify( cm );
 
-            DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
-            verify( cfg );
-
-            ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+        const BSONObj& chunkToMove = chunkInfo.chunk;
+        ChunkPtr c = cm->findChunk( chunkToMove["min"].Obj() );
+        if ( c->getMin().woCompare( chunkToMove["min"].Obj() ) || c->getMax().woCompare( chunkToMove["max"].Obj() ) ) {
+            // likely a split happened somewhere
+            cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
             verify( cm );
 
-            const BSONObj& chunkToMove = chunkInfo.chunk;
-            ChunkPtr c = cm->findChunk( chunkToMove["min"].Obj() );
+            c = cm->findChunk( chunkToMove["min"].Obj() );
             if ( c->getMin().woCompare( chunkToMove["min"].Obj() ) || c->getMax().woCompare( chunkToMove["max"].Obj() ) ) {
-                // likely a split happened somewhere
-                cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
-                verify( cm );
-
-                c = cm->findChunk( chunkToMove["min"].Obj() );
-                if ( c->getMin().woCompare( chunkToMove["min"].Obj() ) || c->getMax().woCompare( chunkToMove["max"].Obj() ) ) {
-                    log() << "chunk mismatch after reload, ignoring will retry issue cm: "
-                          << c->getMin() << " min: " << chunkToMove["min"].Obj() << endl;
-                    continue;
-                }
+                log() << "chunk mismatch after reload, ignoring will retry issue cm: "
+                      << c->getMin() << " min: " << chunkToMove["min"].Obj() << endl;
+                return 0;
             }
+        }
 
-            BSONObj res;
-            if ( c->moveAndCommit( Shard::make( chunkInfo.to ) , Chunk::MaxChunkSize , res ) ) {
-                movedCount++;
-                continue;
+        BSONObj res;
+        if ( c->moveAndCommit( Shard::make( chunkInfo.to ) , Chunk::MaxChunkSize , res ) ) {
+            return 1;
+        }
+
+        // the move requires acquiring the collection metadata's lock, which can fail
+        log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
+              << " chunk: " << chunkToMove << endl;
+
+        if ( res["chunkTooBig"].trueValue() ) {
+            // reload just to be safe
+            cm = cfg->getChunkManager( chunkInfo.ns );
+            verify( cm );
+            c = cm->findChunk( chunkToMove["min"].Obj() );
+            
+            log() << "forcing a split because migrate failed for size reasons" << endl;
+            
+            res = BSONObj();
+            c->singleSplit( true , res );
+            log() << "forced split results: " << res << endl;
+            
+            if ( ! res["ok"].trueValue() ) {
+                log() << "marking chunk as jumbo: " << c->toString() << endl;
+                c->markAsJumbo();
+                // we count it as moved so we do another round right away
+                return 1;
             }
 
-            // the move requires acquiring the collection metadata's lock, which can fail
-            log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
-                  << " chunk: " << chunkToMove << endl;
+        }
 
-            if ( res["chunkTooBig"].trueValue() ) {
-                // reload just to be safe
-                cm = cfg->getChunkManager( chunkInfo.ns );
-                verify( cm );
-                c = cm->findChunk( chunkToMove["min"].Obj() );
-                
-                log() << "forcing a split because migrate failed for size reasons" << endl;
-                
-                res = BSONObj();
-                c->singleSplit( true , res );
-                log() << "forced split results: " << res << endl;
-                
-                if ( ! res["ok"].trueValue() ) {
-                    log() << "marking chunk as jumbo: " << c->toString() << endl;
-                    c->markAsJumbo();
-                    // we increment moveCount so we do another round right away
-                    movedCount++;
-                }
+        return 0;
+    }
 
+    void Balancer::_moveChunkThread( const CandidateChunk* chunkInfo , AtomicUInt* movedCount ) {
+        setThreadName( "balancerMove" );
+        try {
+            movedCount->signedAdd( _moveChunk( *chunkInfo ) );
+        }
+        catch ( std::exception& e ) {
+            log() << "caught exception while moving chunk: " << chunkInfo->chunk << " of " << chunkInfo->ns
+                  << causedBy( e ) << endl;
+        }
+    }
+
+    int Balancer::_moveChunks( const vector<CandidateChunkPtr>* candidateChunks ) {
+        if ( _maxConcurrentMigrations == 1 || candidateChunks->size() < 2 ) {
+            int movedCount = 0;
+            for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
+                movedCount += _moveChunk( *it->get() );
             }
+            return movedCount;
         }
 
-        return movedCount;
+        // the candidates involve disjoint pairs of shards (see _doBalanceRound), so the migrations
+        // don't compete for a donor or a recipient
+        AtomicUInt movedCount;
+        boost::thread_group moves;
+        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
+            moves.create_thread( boost::bind( &Balancer::_moveChunkThread , this , it->get() , &movedCount ) );
+        }
+        moves.join_all();
+
+        return movedCount.get();
     }
 
     void Balancer::_ping( DBClientBase& conn, bool waiting ) {
@@ -203,11 +230,24 @@ namespace mongo {
 
         //
         // 3. For each collection, check if the balancing policy recommends moving anything around.
+        // When migrations run concurrently, a shard takes part in at most one of them: a collection
+        // gets one move per pair of shards the earlier moves left idle.
         //
 
+        const bool concurrent = _maxConcurrentMigrations != 1;
+        set<string> busyShards;
+
         for (vector<string>::const_iterator it = collections.begin(); it != collections.end(); ++it ) {
             const string& ns = *it;
 
+            if ( concurrent ) {
+                if ( _maxConcurrentMigrations > 0 &&
+                     candidateChunks->size() >= (unsigned)_maxConcurrentMigrations )
+                    break;
+                if ( busyShards.size() + 2 > allShards.size() )
+                    break;
+            }
+
             map< string,vector<BSONObj> > shardToChunksMap;
             cursor = conn.query( ShardNS::chunk , QUERY( "ns" << ns ).sort( "min" ) );
             while ( cursor->more() ) {
@@ -230,8 +270,30 @@ namespace mongo {
                 shardToChunksMap[s.getName()].size();
             }
 
-            CandidateChunk* p = _policy->balance( ns , shardLimitsMap , shardToChunksMap , _balancedLastTime );
-            if ( p ) candidateChunks->push_back( CandidateChunkPtr( p ) );
+            map< string, BSONObj > idleLimitsMap = shardLimitsMap;
+            for ( set<string>::const_iterator i = busyShards.begin(); i != busyShards.end(); ++i ) {
+                shardToChunksMap.erase( *i );
+                idleLimitsMap.erase( *i );
+            }
+
+            while ( CandidateChunk* p = _policy->balance( ns , idleLimitsMap , shardToChunksMap , _balancedLastTime ) ) {
+                candidateChunks->push_back( CandidateChunkPtr( p ) );
+                if ( ! concurrent )
+                    break;
+
+                busyShards.insert( p->from );
+                busyShards.insert( p->to );
+                shardToChunksMap.erase( p->from );
+                shardToChunksMap.erase( p->to );
+                idleLimitsMap.erase( p->from );
+                idleLimitsMap.erase( p->to );
+
+                if ( _maxConcurrentMigrations > 0 &&
+                     candidateChunks->size() >= (unsigned)_maxConcurrentMigrations )
+                    break;
+                if ( busyShards.size() + 2 > allShards.size() )
+                    break;
+            }
         }
     }
 
@@ -333,6 +395,11 @@ namespace mongo {
                     
                     LOG(1) << "*** start balancing round" << endl;
 
+                    // how many migrations may run at once; 0 or absent means as many as there are
+                    // disjoint pairs of shards to run them between
+                    BSONObj balancerDoc = conn->findOne( ShardNS::settings , BSON( "_id" << "balancer" ) );
+                    _maxConcurrentMigrations = balancerDoc["maxConcurrentMigrations"].numberInt();
+
                     vector<CandidateChunkPtr> candidateChunks;
                     _doBalanceRound( conn.conn() , &candidateChunks );
                     if ( candidateChunks.size() == 0 ) {
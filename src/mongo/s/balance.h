@@ -31,7 +31,12 @@ namespace mongo {
      *
      * The balancer does act continuously but in "rounds". At a given round, it would decide if there is an imbalance by
      * checking the difference in chunks between the most and least loaded shards. It would issue a request for a chunk
-     * migration per round, if it found so.
+     * migration per collection per round, if it found so.
+     *
+     * Migrations of a round run concurrently, as long as no shard is the donor or recipient of more than one of them.
+     * The 'maxConcurrentMigrations' field of the balancer's settings document caps how many run at once; 1 moves the
+     * chunks one at a time. Several chunks of one collection can move at once, between different pairs of shards:
+     * moveChunk holds the collection's metadata lock only to check and to commit a move.
      */
     class Balancer : public BackgroundJob {
     public:
@@ -57,6 +62,9 @@ namespace mongo {
         // number of moved chunks in last round
         int _balancedLastTime;
 
+        // from the balancer settings at the start of the round; 0 means no limit
+        int _maxConcurrentMigrations;
+
         // decide which chunks to move; owned here.
         scoped_ptr<BalancerPolicy> _policy;
         
@@ -74,18 +82,26 @@ namespace mongo {
          * be moved.
          *
          * @param conn is the connection with the config server(s)
-         * @param candidateChunks (IN/OUT) filled with candidate chunks, one per collection, that could possibly be moved
+         * @param candidateChunks (IN/OUT) filled with candidate chunks that could possibly be moved. Unless migrations are
+         * serial, candidates involve disjoint pairs of shards and a collection may have several; otherwise one per collection.
          */
         void _doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks );
 
         /**
-         * Issues chunk migration request, one at a time.
+         * Issues chunk migration requests, concurrently unless migrations are serial.
          *
          * @param candidateChunks possible chunks to move
          * @return number of chunks effectively moved
          */
         int _moveChunks( const vector<CandidateChunkPtr>* candidateChunks );
 
+        /**
+         * @return 1 if the chunk was moved (or found too big to move and marked jumbo), 0 otherwise
+         */
+        int _moveChunk( const CandidateChunk& chunkInfo );
+
+        void _moveChunkThread( const CandidateChunk* chunkInfo , AtomicUInt* movedCount );
+
         /**
          * Marks this balancer as being live on the config server(s).
          *
@@ -36,7 +36,7 @@
 
 namespace mongo {
 
-    ClientInfo::ClientInfo() {
+    ClientInfo::ClientInfo() : _port( 0 ), _curIsWrite( false ) {
         _cur = &_a;
         _prev = &_b;
         _autoSplitOk = true;
@@ -49,9 +49,24 @@ namespace mongo {
     void ClientInfo::addShard( const string& shard ) {
         _cur->insert( shard );
         _sinceLastGetError.insert( shard );
+        if ( _curIsWrite )
+            _writtenSinceLastGetError.insert( shard );
     }
 
-    void ClientInfo::newPeerRequest( const HostAndPort& peer ) {
+    void ClientInfo::releaseShardConnections() {
+        ShardConnection::releaseMyConnections( _writtenSinceLastGetError );
+
+        set<string> held;
+        set_intersection( _cur->begin() , _cur->end() ,
+                          _writtenSinceLastGetError.begin() , _writtenSinceLastGetError.end() ,
+                          inserter( held , held.begin() ) );
+        _cur->swap( held );
+        _sinceLastGetError = _writtenSinceLastGetError;
+    }
+
+    void ClientInfo::newPeerRequest( AbstractMessagingPort* port ) {
+        _port = port;
+        HostAndPort peer = port->remote();
         if ( ! _remote.hasPort() )
             _remote = peer;
         else if ( _remote != peer ) {
@@ -70,6 +85,7 @@ namespace mongo {
         _cur = _prev;
         _prev = temp;
         _cur->clear();
+        _curIsWrite = false;
     }
 
     ClientInfo * ClientInfo::get() {
@@ -90,6 +106,7 @@ namespace mongo {
     void ClientInfo::disconnect() {
         // should be handled by TL cleanup
         _lastAccess = 0;
+        _port = 0;
     }
 
     void ClientInfo::_addWriteBack( vector<WBInfo>& all , const BSONObj& gle ) {
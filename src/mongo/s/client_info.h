@@ -36,8 +36,8 @@ namespace mongo {
         ClientInfo();
         ~ClientInfo();
 
-        /** new request on behalf of a client, adjusts internal state */
-        void newPeerRequest( const HostAndPort& peer );
+        /** new request on behalf of a client connected on 'port', adjusts internal state */
+        void newPeerRequest( AbstractMessagingPort* port );
 
         /** new request not associated (yet or ever) with a client */
         void newRequest();
@@ -53,6 +53,9 @@ namespace mongo {
          */
         HostAndPort getRemote() const { return _remote; }
 
+        /** @return the port the client's requests arrive on, or 0 if there is no client */
+        AbstractMessagingPort* port() const { return _port; }
+
         /**
          * notes that this client use this shard
          * keeps track of all shards accessed this request
@@ -72,7 +75,21 @@ namespace mongo {
         /**
          * clears list of shards we've talked to
          */
-        void clearSinceLastGetError() { _sinceLastGetError.clear(); }
+        void clearSinceLastGetError() { _sinceLastGetError.clear(); _writtenSinceLastGetError.clear(); }
+
+        /**
+         * notes that the current request is a write, so the shards it uses are kept for
+         * getLastError by releaseShardConnections()
+         */
+        void noteWriteRequest() { _curIsWrite = true; }
+
+        /**
+         * returns this client's shard connections to the shared pool once a request is done,
+         * keeping only those to shards written to since the last getLastError.  the shards whose
+         * connections are released are no longer asked by getLastError, as another client's
+         * request may since have used the connection.
+         */
+        void releaseShardConnections();
 
 
         /**
@@ -114,6 +131,7 @@ namespace mongo {
 
         int _id; // unique client id
         HostAndPort _remote; // server:port of remote socket end
+        AbstractMessagingPort* _port;
 
         // we use _a and _b to store shards we've talked to on the current request and the previous
         // we use 2 so we can flip for getLastError type operations
@@ -126,6 +144,8 @@ namespace mongo {
 
 
         set<string> _sinceLastGetError; // all shards accessed since last getLastError
+        set<string> _writtenSinceLastGetError; // shards accessed by writes since last getLastError
+        bool _curIsWrite; // the current request is a write
 
         int _lastAccess;
         bool _autoSplitOk;
@@ -177,6 +177,16 @@ namespace mongo {
                 {
                     BSONObjBuilder bb( result.subobjStart( "network" ) );
                     networkCounter.append( bb );
+                    {
+                        BSONObjBuilder cb( bb.subobjStart( "compression" ) );
+                        Message::appendCompressionStats( cb );
+                        cb.done();
+                    }
+                    {
+                        BSONObjBuilder pb( bb.subobjStart( "buffers" ) );
+                        MessageBufferPool::appendStats( pb );
+                        pb.done();
+                    }
                     bb.done();
                 }
 
@@ -1065,6 +1075,7 @@ namespace mongo {
                 result.appendBool("ismaster", true );
                 result.append("msg", "isdbgrid");
                 result.appendNumber("maxBsonObjectSize", BSONObjMaxUserSize);
+                negotiateCompression( ClientInfo::get()->port(), cmdObj, result );
                 return true;
             }
         } ismaster;
@@ -1484,7 +1484,73 @@ namespace mongo {
                              BSONObjBuilder &result, bool fromRepl);
 
         private:
-            
+            bool runPipeline(const string &dbName, const string &fullns,
+                             BSONObj &cmdObj, string &errmsg,
+                             BSONObjBuilder &result,
+                             const intrusive_ptr<Pipeline> &pPipeline,
+                             const intrusive_ptr<ExpressionContext> &pExpCtx);
+
+            typedef DocumentSourceCommandFutures::FuturesList FuturesList;
+            typedef DocumentSourceCommandFutures::RequestList RequestList;
+
+            /*
+              The requests for DocumentSourceCommandFutures.  These run on
+              its joiner threads, so each gets a connection of its own
+              there; a stale config retry then rechecks the version on that
+              connection, not on one the request thread is using.
+             */
+            static shared_ptr<Future::CommandResult> runShardCommand(
+                const string &connString, const string &fullns,
+                const string &dbName, const BSONObj &cmd);
+            static shared_ptr<Future::CommandResult> runMergeCommand(
+                const string &connString, const string &dbName,
+                const BSONObj &cmd);
+
+            /*
+              Get the source for the merging pipeline to run over.
+
+              If nPartitions is set, the merge starts with a $group that is
+              to be finished on the shards, and the shards were asked to
+              split up their partial groups by a hash of their _id.  As each
+              shard's reply arrives, its partitions are added to those from
+              the others, without looking at the groups themselves.  Once
+              all are in, each partition is sent to a shard, in turn, to be
+              merged there; every group is finished by exactly one of the
+              merges, and their results, as they arrive, are the input for
+              the rest of the pipeline.  If a shard failed, or a partition
+              is too big for a command, the groups are merged here instead.
+
+              Otherwise, the source is just the shards' results, as they
+              arrive.
+
+              @param errmsg where the futures' sources write their errors
+              @param dbName the database name
+              @param shards the shards the pipeline was sent to
+              @param requests the shards' commands
+              @param nPartitions the number of partitions, or 0
+              @param pPipeline the merging pipeline; a $group merged on the
+                shards is taken off it
+              @param pExpCtx the expression context for the pipeline
+              @returns the source
+             */
+            intrusive_ptr<DocumentSource> prepareMergeSource(
+                string &errmsg, const string &dbName,
+                const set<Shard> &shards, const RequestList &requests,
+                int nPartitions,
+                const intrusive_ptr<Pipeline> &pPipeline,
+                const intrusive_ptr<ExpressionContext> &pExpCtx);
+
+            /*
+              mongos doesn't keep a cursor open on the result of a
+              pipeline, so for a cursor command all of the result comes
+              back in the first batch, with a cursor id of zero.
+
+              @param ns the namespace the cursor is on
+              @param res the reply with the "result" array
+              @param result where to write the reply with the cursor
+             */
+            static void resultToCursor(const string &ns, const BSONObj &res,
+                                       BSONObjBuilder &result);
         };
 
 
@@ -1513,6 +1579,48 @@ namespace mongo {
 
             string fullns(dbName + "." + pPipeline->getCollectionName());
 
+            if (!pPipeline->isCursorCommand())
+                return runPipeline(dbName, fullns, cmdObj, errmsg, result,
+                                   pPipeline, pExpCtx);
+
+            /* the shards mustn't open cursors either */
+            BSONObj arrayCmdObj(cmdObj.removeField(Pipeline::cursorName));
+            BSONObjBuilder arrayResult;
+            bool ok = runPipeline(dbName, fullns, arrayCmdObj, errmsg,
+                                  arrayResult, pPipeline, pExpCtx);
+            BSONObj res(arrayResult.done());
+            if (ok)
+                resultToCursor(fullns, res, result);
+            else
+                result.appendElements(res);
+            return ok;
+        }
+
+        void PipelineCommand::resultToCursor(const string &ns,
+                                             const BSONObj &res,
+                                             BSONObjBuilder &result) {
+            BSONArray firstBatch;
+            for(BSONObjIterator i(res); i.more(); ) {
+                BSONElement e(i.next());
+                if (str::equals(e.fieldName(), "result"))
+                    firstBatch = BSONArray(e.Obj());
+                else
+                    result.append(e);
+            }
+
+            BSONObjBuilder cursorBuilder(
+                result.subobjStart(Pipeline::cursorName));
+            cursorBuilder.append(Pipeline::cursorIdName, 0LL);
+            cursorBuilder.append(Pipeline::cursorNsName, ns);
+            cursorBuilder.append(Pipeline::firstBatchName, firstBatch);
+            cursorBuilder.done();
+        }
+
+        bool PipelineCommand::runPipeline(
+            const string &dbName, const string &fullns, BSONObj &cmdObj,
+            string &errmsg, BSONObjBuilder &result,
+            const intrusive_ptr<Pipeline> &pPipeline,
+            const intrusive_ptr<ExpressionContext> &pExpCtx) {
             /*
               If the system isn't running sharded, or the target collection
               isn't sharded, pass this on to a mongod.
@@ -1521,15 +1629,14 @@ namespace mongo {
             if (!conf || !conf->isShardingEnabled() || !conf->isSharded(fullns))
                 return passthrough(conf, cmdObj, result);
 
+            uassert(16420, str::stream() << DocumentSourceOut::outName <<
+                    " is not supported on sharded collections",
+                    !pPipeline->getOutput());
+
             /* split the pipeline into pieces for mongods and this mongos */
             intrusive_ptr<Pipeline> pShardPipeline(
                 pPipeline->splitForSharded());
 
-            /* create the command for the shards */
-            BSONObjBuilder commandBuilder;
-            pShardPipeline->toBson(&commandBuilder);
-            BSONObj shardedCommand(commandBuilder.done());
-
             BSONObjBuilder shardQueryBuilder;
 #ifdef NEVER
             BSONObjBuilder shardSortBuilder;
@@ -1545,27 +1652,37 @@ namespace mongo {
             cm->getShardsForQuery(shards, shardQuery);
 
             /*
-              From MRCmd::Run: "we need to use our connections to the shard
-              so filtering is done correctly for un-owned docs so we allocate
-              them in our thread and hand off"
+              Whether a leading $group is finished on the shards is decided
+              from the pipeline alone, before anything is sent.  Two
+              partitions per shard keep each merge well inside the command
+              size limit, given that no shard's reply is over it.
             */
-            vector<boost::shared_ptr<ShardConnection> > shardConns;
-            list<boost::shared_ptr<Future::CommandResult> > futures;
+            int nPartitions = 0;
+            if (cmdLine.aggregationShardMerge && !pPipeline->isExplain() &&
+                (shards.size() >= 2) && pPipeline->startsWithGroup())
+                nPartitions = 2 * shards.size();
+
+            /* create the command for the shards */
+            BSONObjBuilder commandBuilder;
+            pShardPipeline->toBson(&commandBuilder);
+            if (nPartitions)
+                commandBuilder.append(Pipeline::mergePartitionsName,
+                                      nPartitions);
+            BSONObj shardedCommand(commandBuilder.obj());
+
+            RequestList requests;
             for (set<Shard>::iterator i=shards.begin(), end=shards.end();
                  i != end; i++) {
-                boost::shared_ptr<ShardConnection> temp(
-                    new ShardConnection(i->getConnString(), fullns));
-                verify(temp->get());
-                futures.push_back(
-                    Future::spawnCommand(i->getConnString(), dbName,
-                                         shardedCommand , 0, temp->get()));
-                shardConns.push_back(temp);
+                requests.push_back(
+                    boost::bind(&PipelineCommand::runShardCommand,
+                                i->getConnString(), fullns, dbName,
+                                shardedCommand));
             }
-                    
-            /* wrap the list of futures with a source */
-            intrusive_ptr<DocumentSourceCommandFutures> pSource(
-                DocumentSourceCommandFutures::create(
-                    errmsg, &futures, pExpCtx));
+
+            /* wrap the shards' commands with a source */
+            intrusive_ptr<DocumentSource> pSource(
+                prepareMergeSource(errmsg, dbName, shards, requests,
+                                   nPartitions, pPipeline, pExpCtx));
 
             /* run the pipeline */
             bool failed = pPipeline->run(result, errmsg, pSource);
@@ -1589,15 +1706,123 @@ namespace mongo {
             }
 */
 
-            for(unsigned i = 0; i < shardConns.size(); ++i)
-                shardConns[i]->done();
-
             if (failed && (errmsg.length() > 0))
                 return false;
 
             return true;
         }
 
+        shared_ptr<Future::CommandResult> PipelineCommand::runShardCommand(
+            const string &connString, const string &fullns,
+            const string &dbName, const BSONObj &cmd) {
+            ShardConnection conn(connString, fullns);
+            shared_ptr<Future::CommandResult> pResult(
+                Future::spawnCommand(connString, dbName, cmd, 0, conn.get()));
+            pResult->join();
+            conn.done();
+            return pResult;
+        }
+
+        shared_ptr<Future::CommandResult> PipelineCommand::runMergeCommand(
+            const string &connString, const string &dbName,
+            const BSONObj &cmd) {
+            /*
+              The merges don't read the collection, so they don't need
+              versioned connections; the future gets a pooled one itself.
+            */
+            shared_ptr<Future::CommandResult> pResult(
+                Future::spawnCommand(connString, dbName, cmd, 0));
+            pResult->join();
+            return pResult;
+        }
+
+        intrusive_ptr<DocumentSource> PipelineCommand::prepareMergeSource(
+            string &errmsg, const string &dbName, const set<Shard> &shards,
+            const RequestList &requests, int nPartitions,
+            const intrusive_ptr<Pipeline> &pPipeline,
+            const intrusive_ptr<ExpressionContext> &pExpCtx) {
+            intrusive_ptr<DocumentSourceCommandFutures> pShardSource(
+                DocumentSourceCommandFutures::create(
+                    errmsg, requests, pExpCtx));
+            if (!nPartitions)
+                return pShardSource;
+
+            /* add up the shards' partitions, in the order they arrive */
+            vector<boost::shared_ptr<BSONArrayBuilder> > partitions;
+            for(int i = 0; i < nPartitions; ++i)
+                partitions.push_back(boost::shared_ptr<BSONArrayBuilder>(
+                                         new BSONArrayBuilder()));
+            FuturesList results;
+            bool mergeHere = false;
+            while(true) {
+                shared_ptr<Future::CommandResult> pResult(
+                    pShardSource->nextArrived());
+                if (!pResult)
+                    break;
+
+                results.push_back(pResult);
+                if (mergeHere)
+                    continue;
+
+                BSONElement partitionsElement(
+                    pResult->result()[Pipeline::partitionsName]);
+                if (partitionsElement.type() != Array) {
+                    mergeHere = true;
+                    continue;
+                }
+
+                int i = 0;
+                for(BSONObjIterator j(partitionsElement.embeddedObject());
+                    j.more() && (i < nPartitions); ++i) {
+                    BSONArrayBuilder &partition(*partitions[i]);
+                    for(BSONObjIterator k(j.next().embeddedObject());
+                        k.more(); )
+                        partition.append(k.next());
+
+                    /* many partial results for one _id can still be too big */
+                    if (partition.len() > BSONObjMaxUserSize)
+                        mergeHere = true;
+                }
+            }
+
+            /*
+              Failures have already been reported to errmsg; merge what did
+              arrive here, where the $group is still in the pipeline.
+            */
+            if (mergeHere || pShardSource->hasFailed())
+                return DocumentSourceCommandFutures::create(
+                    errmsg, results, pExpCtx);
+
+            intrusive_ptr<Pipeline> pMergePipeline(
+                pPipeline->splitForShardMerge());
+
+            LOG(1) << "merging the partial groups from " << results.size() <<
+                " shards in " << nPartitions << " partitions on the shards" <<
+                endl;
+
+            RequestList mergeRequests;
+            set<Shard>::const_iterator shard(shards.begin());
+            for(int i = 0; i < nPartitions; ++i) {
+                if (!partitions[i]->arrSize())
+                    continue;
+
+                BSONObjBuilder commandBuilder;
+                pMergePipeline->toBson(&commandBuilder);
+                commandBuilder.append(Pipeline::mergeInputName,
+                                      partitions[i]->arr());
+                mergeRequests.push_back(
+                    boost::bind(&PipelineCommand::runMergeCommand,
+                                shard->getConnString(), dbName,
+                                commandBuilder.obj()));
+
+                if (++shard == shards.end())
+                    shard = shards.begin();
+            }
+
+            return DocumentSourceCommandFutures::create(
+                errmsg, mergeRequests, pExpCtx);
+        }
+
     } // namespace pub_grid_cmds
 
     bool Command::runAgainstRegistered(const char *ns, BSONObj& jsobj, BSONObjBuilder& anObjBuilder, int queryOptions) {
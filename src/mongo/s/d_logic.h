@@ -140,6 +140,9 @@ namespace mongo {
 
         bool inCriticalMigrateSection();
 
+        /** @return true if [min,max) of ns overlaps the chunk this shard is migrating out */
+        bool isMigrating( const string& ns , const BSONObj& min , const BSONObj& max );
+
     private:
         bool _enabled;
 
@@ -179,6 +182,10 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+
+        /** hand a connection's info between threads when one thread services many connections */
+        static ShardedConnectionInfo* release();
+        static void set( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
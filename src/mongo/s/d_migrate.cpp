@@ -251,14 +251,16 @@ namespace mongo {
             _memoryUsed = 0;
         }
 
-        void start( string ns ,
+        /** @return false if another migration is already active here */
+        bool start( string ns ,
                     const BSONObj& min ,
                     const BSONObj& max ,
                     const BSONObj& shardKeyPattern ) {
             scoped_lock ll(_workLock);
             scoped_lock l(_m); // reads and writes _active
 
-            verify( ! _active );
+            if ( _active )
+                return false;
 
             verify( ! min.isEmpty() );
             verify( ! max.isEmpty() );
@@ -275,6 +277,7 @@ namespace mongo {
             verify( _memoryUsed == 0 );
 
             _active = true;
+            return true;
         }
 
         void done() {
@@ -358,7 +361,9 @@ namespace mongo {
         }
 
         void xfer( list<BSONObj> * l , BSONObjBuilder& b , const char * name , long long& size , bool explode ) {
-            const long long maxSize = 1024 * 1024;
+            // the recipient applies a whole batch per few lock acquisitions, so fewer and
+            // bigger batches are cheaper for both sides.  room is left for the other list.
+            const long long maxSize = BSONObjMaxUserSize / 2;
 
             if ( l->size() == 0 || size > maxSize )
                 return;
@@ -372,6 +377,8 @@ namespace mongo {
                 if ( explode ) {
                     BSONObj it;
                     if ( Helpers::findById( cc() , _ns.c_str() , t, it ) ) {
+                        if ( size > 0 && size + it.objsize() > maxSize )
+                            break; // next time
                         arr.append( it );
                         size += it.objsize();
                     }
@@ -596,6 +603,12 @@ namespace mongo {
         void setInCriticalSection( bool b ) { scoped_lock l(_m); _inCriticalSection = b; }
 
         bool isActive() const { return _getActive(); }
+
+        /** @return true if [min,max) of ns overlaps the chunk being migrated out */
+        bool isMigrating( const string& ns , const BSONObj& min , const BSONObj& max ) const {
+            scoped_lock l(_m);
+            return _active && _ns == ns && _min.woCompare( max ) < 0 && min.woCompare( _max ) < 0;
+        }
         
         void doRemove( OldDataCleanup& cleanup ) {
             int it = 0;
@@ -649,11 +662,15 @@ namespace mongo {
                              const BSONObj& min ,
                              const BSONObj& max ,
                              const BSONObj& shardKeyPattern ) {
-            migrateFromStatus.start( ns , min , max , shardKeyPattern );
+            _started = migrateFromStatus.start( ns , min , max , shardKeyPattern );
         }
         ~MigrateStatusHolder() {
-            migrateFromStatus.done();
+            if ( _started )
+                migrateFromStatus.done();
         }
+        bool started() const { return _started; }
+    private:
+        bool _started;
     };
 
     void _cleanupOldData( OldDataCleanup cleanup ) {
@@ -740,6 +757,21 @@ namespace mongo {
     } initialCloneCommand;
 
 
+    /** tells the TO-shard to drop a transfer that won't be committed */
+    static void abortRecvChunk( const Shard& toShard ) {
+        try {
+            scoped_ptr<ScopedDbConnection> conn(
+                    ScopedDbConnection::getScopedDbConnection( toShard.getConnString() ) );
+            BSONObj res;
+            conn->get()->runCommand( "admin" , BSON( "_recvChunkAbort" << 1 ) , res );
+            conn->done();
+            log() << "moveChunk aborted transfer on TO-shard: " << res << migrateLog;
+        }
+        catch( DBException& e ) {
+            warning() << "moveChunk could not abort transfer on TO-shard " << toShard.getConnString() << causedBy( e ) << migrateLog;
+        }
+    }
+
     /**
      * this is the main entry for moveChunk
      * called to initial a move
@@ -864,29 +896,34 @@ namespace mongo {
                 return false;
             }
 
+            // the collection's metadata lock is held while the move is checked (2) and committed (5), but not
+            // during the data transfer, so that other shards can migrate chunks of the same collection meanwhile.
+            // splits of the chunk being moved are refused by splitChunk in between.
             DistributedLock lockSetup( ConnectionString( shardingState.getConfigServer() , ConnectionString::SYNC ) , ns );
-            dist_lock_try dlk;
-
-            try{
-                dlk = dist_lock_try( &lockSetup , (string)"migrate-" + min.toString() );
-            }
-            catch( LockException& e ){
-                errmsg = str::stream() << "error locking distributed lock for migration " << "migrate-" << min.toString() << causedBy( e );
-                return false;
-            }
-
-            if ( ! dlk.got() ) {
-                errmsg = str::stream() << "the collection metadata could not be locked with lock " << "migrate-" << min.toString();
-                result.append( "who" , dlk.other() );
-                return false;
-            }
 
             BSONObj chunkInfo = BSON("min" << min << "max" << max << "from" << fromShard.getName() << "to" << toShard.getName() );
-            configServer.logChange( "moveChunk.start" , ns , chunkInfo );
 
             ShardChunkVersion maxVersion;
             string myOldShard;
             {
+                dist_lock_try dlk;
+
+                try{
+                    dlk = dist_lock_try( &lockSetup , (string)"migrate-" + min.toString() );
+                }
+                catch( LockException& e ){
+                    errmsg = str::stream() << "error locking distributed lock for migration " << "migrate-" << min.toString() << causedBy( e );
+                    return false;
+                }
+
+                if ( ! dlk.got() ) {
+                    errmsg = str::stream() << "the collection metadata could not be locked with lock " << "migrate-" << min.toString();
+                    result.append( "who" , dlk.other() );
+                    return false;
+                }
+
+                configServer.logChange( "moveChunk.start" , ns , chunkInfo );
+
                 scoped_ptr<ScopedDbConnection> conn( ScopedDbConnection::getScopedDbConnection(
                         shardingState.getConfigServer() ) );
 
@@ -971,6 +1008,11 @@ namespace mongo {
             }
 
             MigrateStatusHolder statusHolder( ns , min , max , shardKeyPattern );
+            if ( ! statusHolder.started() ) {
+                // another moveChunk started on this shard while we were checking
+                errmsg = "migration already in progress";
+                return false;
+            }
             {
                 // this gets a read lock, so we know we have a checkpoint for mods
                 if ( ! migrateFromStatus.storeCurrentLocs( maxChunkSize , errmsg , result ) )
@@ -1064,11 +1106,67 @@ namespace mongo {
 
             // 5.
             {
+                // take the collection's metadata lock back; other migrations of the collection may hold it briefly
+                // to commit
+                dist_lock_try dlk;
+                for ( int i = 0; i < 30 && ! dlk.got(); i++ ) {
+                    if ( i > 0 )
+                        sleepsecs( 1 );
+                    try {
+                        dlk = dist_lock_try( &lockSetup , (string)"migrate-" + min.toString() );
+                    }
+                    catch( LockException& e ) {
+                        warning() << "error locking distributed lock for migration commit" << causedBy( e ) << migrateLog;
+                    }
+                }
+
+                if ( ! dlk.got() ) {
+                    abortRecvChunk( toShard );
+                    errmsg = str::stream() << "the collection metadata could not be locked for commit with lock " << "migrate-" << min.toString();
+                    result.append( "who" , dlk.other() );
+                    return false;
+                }
+
+                // the collection may have changed while it was unlocked: other chunks migrated, or split, or the
+                // collection dropped. only this chunk needs to be as it was.
+                try {
+                    scoped_ptr<ScopedDbConnection> conn( ScopedDbConnection::getScopedDbConnection(
+                            shardingState.getConfigServer() ) );
+                    BSONObj x = conn->get()->findOne( ShardNS::chunk,
+                                                      Query( BSON( "ns" << ns ) )
+                                                          .sort( BSON( "lastmod" << -1 ) ) );
+                    BSONObj currChunk = conn->get()->findOne( ShardNS::chunk , shardId.wrap( "_id" ) );
+                    conn->done();
+
+                    if ( currChunk.isEmpty() ||
+                         currChunk["min"].Obj().woCompare( min ) || currChunk["max"].Obj().woCompare( max ) ||
+                         currChunk["shard"].String() != fromShard.getName() ) {
+                        abortRecvChunk( toShard );
+                        errmsg = "chunk changed during the transfer";
+                        result.append( "current" , currChunk );
+                        warning() << "aborted moveChunk because " << errmsg << ": " << currChunk << migrateLog;
+                        return false;
+                    }
+
+                    maxVersion = ShardChunkVersion::fromBSON( x, "lastmod" );
+                }
+                catch( DBException& e ) {
+                    abortRecvChunk( toShard );
+                    errmsg = str::stream() << "aborted moveChunk because could not get chunk data from config server " << shardingState.getConfigServer() << causedBy( e );
+                    warning() << errmsg << endl;
+                    return false;
+                }
+
+                // this shard may have received chunks of the collection during the transfer, which the manager
+                // loaded at 2. doesn't list; load the current one so that the donation below doesn't leave them out
+                ShardChunkVersion shardVersion = maxVersion;
+                shardingState.trySetVersion( ns , shardVersion /* will return updated */ );
+
                 // 5.a
                 // we're under the collection lock here, so no other migrate can change maxVersion or ShardChunkManager state
                 migrateFromStatus.setInCriticalSection( true );
-                ShardChunkVersion currVersion = maxVersion;
-                ShardChunkVersion myVersion = currVersion;
+                ShardChunkVersion currVersion = shardingState.getVersion( ns );
+                ShardChunkVersion myVersion = maxVersion;
                 myVersion.incMajor();
 
                 {
@@ -1333,6 +1431,10 @@ namespace mongo {
         return migrateFromStatus.getInCriticalSection();
     }
 
+    bool ShardingState::isMigrating( const string& ns , const BSONObj& min , const BSONObj& max ) {
+        return migrateFromStatus.isMigrating( ns , min , max );
+    }
+
     /* -----
        below this are the "to" side commands
 
@@ -1437,36 +1539,44 @@ namespace mongo {
 
             {
                 // 3. initial bulk clone
+                // the next batch is requested before this one is applied, so that the donor
+                // gathers it meanwhile
                 state = CLONE;
 
+                auto_ptr<DBClientCursor> pending = requestClone( conn.get() );
                 while ( true ) {
+                    auto_ptr<DBClientCursor> current = pending;
                     BSONObj res;
-                    if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
+                    if ( ! receiveClone( conn.get() , current , res ) ) {  // gets array of objects to copy, in disk order
                         state = FAIL;
                         errmsg = "_migrateClone failed: ";
                         errmsg += res.toString();
                         error() << errmsg << migrateLog;
-                        conn.done();
+                        if ( res.isEmpty() )
+                            conn.kill(); // no telling what is left on the connection
+                        else
+                            conn.done();
                         return;
                     }
 
                     BSONObj arr = res["objects"].Obj();
-                    int thisTime = 0;
+                    if ( arr.isEmpty() )
+                        break;
+
+                    pending = requestClone( conn.get() );
 
+                    ElapsedTracker tracker( 128 , 10 );
                     BSONObjIterator i( arr );
                     while( i.more() ) {
-                        BSONObj o = i.next().Obj();
-                        {
-                            Lock::DBWrite lk( ns );
+                        // a run of documents per lock acquisition
+                        Lock::DBWrite lk( ns );
+                        do {
+                            BSONObj o = i.next().Obj();
                             Helpers::upsert( ns, o, true );
-                        }
-                        thisTime++;
-                        numCloned++;
-                        clonedBytes += o.objsize();
+                            numCloned++;
+                            clonedBytes += o.objsize();
+                        } while ( i.more() && ! tracker.intervalHasElapsed() );
                     }
-
-                    if ( thisTime == 0 )
-                        break;
                 }
 
                 timing.done(3);
@@ -1608,6 +1718,9 @@ namespace mongo {
 
             bool didAnything = false;
 
+            // as for the clone, a run of mods per lock acquisition
+            ElapsedTracker tracker( 128 , 10 );
+
             if ( xfer["deleted"].isABSONObj() ) {
                 RemoveSaver rs( "moveChunk" , ns , "removedDuring" );
 
@@ -1615,28 +1728,30 @@ namespace mongo {
                 while ( i.more() ) {
                     Client::WriteContext cx(ns);
 
-                    BSONObj id = i.next().Obj();
+                    do {
+                        BSONObj id = i.next().Obj();
 
-                    // do not apply deletes if they do not belong to the chunk being migrated
-                    BSONObj fullObj;
-                    if ( Helpers::findById( cc() , ns.c_str() , id, fullObj ) ) {
-                        if ( ! isInRange( fullObj , min , max ) ) {
-                            log() << "not applying out of range deletion: " << fullObj << migrateLog;
+                        // do not apply deletes if they do not belong to the chunk being migrated
+                        BSONObj fullObj;
+                        if ( Helpers::findById( cc() , ns.c_str() , id, fullObj ) ) {
+                            if ( ! isInRange( fullObj , min , max ) ) {
+                                log() << "not applying out of range deletion: " << fullObj << migrateLog;
 
-                            continue;
+                                continue;
+                            }
                         }
-                    }
 
-                    Helpers::removeRange( ns ,
-                                          id ,
-                                          id,
-                                          findShardKeyIndexPattern_locked( ns , shardKeyPattern ), 
-                                          true , /*maxInclusive*/
-                                          cmdLine.moveParanoia ? &rs : 0 , /*callback*/
-                                          true ); /*fromMigrate*/
+                        Helpers::removeRange( ns ,
+                                              id ,
+                                              id,
+                                              findShardKeyIndexPattern_locked( ns , shardKeyPattern ), 
+                                              true , /*maxInclusive*/
+                                              cmdLine.moveParanoia ? &rs : 0 , /*callback*/
+                                              true ); /*fromMigrate*/
 
-                    *lastOpApplied = cx.ctx().getClient()->getLastOp().asDate();
-                    didAnything = true;
+                        *lastOpApplied = cx.ctx().getClient()->getLastOp().asDate();
+                        didAnything = true;
+                    } while ( i.more() && ! tracker.intervalHasElapsed() );
                 }
             }
 
@@ -1645,18 +1760,44 @@ namespace mongo {
                 while ( i.more() ) {
                     Client::WriteContext cx(ns);
 
-                    BSONObj it = i.next().Obj();
+                    do {
+                        BSONObj it = i.next().Obj();
 
-                    Helpers::upsert( ns , it , true );
+                        Helpers::upsert( ns , it , true );
 
-                    *lastOpApplied = cx.ctx().getClient()->getLastOp().asDate();
-                    didAnything = true;
+                        *lastOpApplied = cx.ctx().getClient()->getLastOp().asDate();
+                        didAnything = true;
+                    } while ( i.more() && ! tracker.intervalHasElapsed() );
                 }
             }
 
             return didAnything;
         }
 
+        /** send the donor a _migrateClone without waiting for the reply */
+        static auto_ptr<DBClientCursor> requestClone( DBClientBase* conn ) {
+            auto_ptr<DBClientCursor> c( new DBClientCursor( conn , "admin.$cmd" , BSON( "_migrateClone" << 1 ) ,
+                                                            -1 , 0 , 0 , 0 , 0 ) );
+            if ( conn->lazySupported() )
+                c->initLazy();
+            else
+                c->init();
+            return c;
+        }
+
+        /** @param res the reply, or empty if there was none */
+        static bool receiveClone( DBClientBase* conn , auto_ptr<DBClientCursor>& c , BSONObj& res ) {
+            if ( conn->lazySupported() ) {
+                bool retry = false;
+                if ( ! c->initLazyFinish( retry ) )
+                    return false;
+            }
+            if ( ! c->more() )
+                return false;
+            res = c->next().getOwned();
+            return res["ok"].trueValue();
+        }
+
         bool opReplicatedEnough( const ReplTime& lastOpApplied ) {
             // if replication is on, try to force enough secondaries to catch up
             // TODO opReplicatedEnough should eventually honor priorities and geo-awareness
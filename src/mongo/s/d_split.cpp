@@ -557,6 +557,12 @@ namespace mongo {
                 return false;
             }
 
+            // moveChunk lets go of the lock while it transfers data
+            if ( shardingState.isMigrating( ns , min , max ) ) {
+                errmsg = "the chunk is being migrated";
+                return false;
+            }
+
             // TODO This is a check migrate does to the letter. Factor it out and share. 2010-10-22
 
             ShardChunkVersion maxVersion;
@@ -351,6 +351,15 @@ namespace mongo {
         _tl.reset();
     }
 
+    ShardedConnectionInfo* ShardedConnectionInfo::release() {
+        return _tl.release();
+    }
+
+    void ShardedConnectionInfo::set( ShardedConnectionInfo* info ) {
+        verify( _tl.get() == 0 );
+        _tl.reset( info );
+    }
+
     const ConfigVersion ShardedConnectionInfo::getVersion( const string& ns ) const {
         NSVersionMap::const_iterator it = _versions.find( ns );
         if ( it != _versions.end() ) {
@@ -43,7 +43,7 @@ namespace mongo {
 
         _clientInfo = ClientInfo::get();
         if ( p ) {
-            _clientInfo->newPeerRequest( p->remote() );
+            _clientInfo->newPeerRequest( p );
         }
         else {
             _clientInfo->newRequest();
@@ -139,6 +139,7 @@ namespace mongo {
         }
         else {
             checkAuth( Auth::WRITE );
+            _clientInfo->noteWriteRequest();
             s->writeOp( op, *this );
         }
 
@@ -140,6 +140,10 @@ namespace mongo {
                     replyToQuery( ResultFlag_ErrSet, p , m , err );
                 }
             }
+
+            if ( cmdLine.releaseConnectionsAfterResponse ) {
+                ClientInfo::get()->releaseShardConnections();
+            }
         }
 
         virtual void disconnected( AbstractMessagingPort* p ) {
@@ -324,6 +328,7 @@ int _main(int argc, char* argv[]) {
     ( "test" , "just run unit tests" )
     ( "upgrade" , "upgrade meta data version" )
     ( "chunkSize" , po::value<int>(), "maximum amount of data per chunk" )
+    ( "shardReadAhead" , po::value<int>(), "getMore batches to request ahead of need on each shard cursor (default 0, off)" )
     ( "ipv6", "enable IPv6 support (disabled by default)" )
     ( "jsonp","allow JSONP access via http (has security implications)" )
     ( "noscripting", "disable scripting engine" )
@@ -366,6 +371,15 @@ int _main(int argc, char* argv[]) {
         Chunk::MaxChunkSize = csize * 1024 * 1024;
     }
 
+    if ( params.count( "shardReadAhead" ) ) {
+        int n = params["shardReadAhead"].as<int>();
+        if ( ! CmdLine::shardReadAheadOk( n ) ) {
+            out() << "error: --shardReadAhead must be between 0 and " << (int) CmdLine::MaxShardReadAhead << endl;
+            return 11;
+        }
+        cmdLine.shardReadAhead = n;
+    }
+
     if ( params.count( "localThreshold" ) ) {
         cmdLine.defaultLocalThresholdMillis = params["localThreshold"].as<int>();
     }
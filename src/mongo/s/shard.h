@@ -286,6 +286,12 @@ namespace mongo {
         /** checks all of my thread local connections for the version of this ns */
         static void checkMyConnectionVersions( const string & ns );
 
+        /**
+         * returns my thread local connections to the shared pool, except those to the shards in
+         * 'keep', so that idle clients don't hold a connection to every shard they've used
+         */
+        static void releaseMyConnections( const set<string>& keep );
+
     private:
         void _init();
         void _finishInit();
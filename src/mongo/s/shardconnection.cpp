@@ -134,6 +134,17 @@ namespace mongo {
             shardConnectionPool.release( addr , conn );
         }
 
+        void releaseAll( const set<string>& keep ) {
+            set<string,DBConnectionPool::serverNameCompare> keepHosts( keep.begin() , keep.end() );
+            for ( HostMap::iterator i=_hosts.begin(); i!=_hosts.end(); ++i ) {
+                Status* ss = i->second;
+                if ( ss->avail && ! keepHosts.count( i->first ) ) {
+                    release( i->first , ss->avail );
+                    ss->avail = 0;
+                }
+            }
+        }
+
         void _check( const string& ns ) {
             if ( ns.size() == 0 || _seenNS.count( ns ) )
                 return;
@@ -236,6 +247,10 @@ namespace mongo {
         ClientConnections::threadInstance()->checkVersions( ns );
     }
 
+    void ShardConnection::releaseMyConnections( const set<string>& keep ) {
+        ClientConnections::threadInstance()->releaseAll( keep );
+    }
+
     ShardConnection::~ShardConnection() {
         if ( _conn ) {
             if ( ! _conn->isFailed() ) {
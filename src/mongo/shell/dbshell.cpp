@@ -614,6 +614,7 @@ int _main( int argc, char* argv[] ) {
     ( "version", "show version information" )
     ( "verbose", "increase verbosity" )
     ( "ipv6", "enable IPv6 support (disabled by default)" )
+    ( "networkCompression", "compress messages with servers that use networkCompression" )
 #ifdef MONGO_SSL
     ( "ssl", "use all for connections" )
 #endif
@@ -685,6 +686,9 @@ int _main( int argc, char* argv[] ) {
     if ( params.count( "quiet" ) ) {
         mongo::cmdLine.quiet = true;
     }
+    if ( params.count( "networkCompression" ) ) {
+        mongo::cmdLine.networkCompression = true;
+    }
 #ifdef MONGO_SSL
     if ( params.count( "ssl" ) ) {
         mongo::cmdLine.sslOnNormalPorts = true;
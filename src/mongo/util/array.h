@@ -54,8 +54,10 @@ namespace mongo {
             _data[_size++] = t;
         }
 
-        void sort( int (*comp)(const void *, const void *) ) {
-            qsort( _data , _size , sizeof(T) , comp );
+        /** cmp is a strict weak ordering on T, as for std::sort */
+        template< class Cmp >
+        void sort( const Cmp& cmp ) {
+            std::sort( _data , _data + _size , cmp );
         }
 
         int size() {
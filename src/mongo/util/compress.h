@@ -16,6 +16,12 @@ namespace mongo {
         char* compressed,
         size_t* compressed_length);
 
+    /** uncompressed must have room for the whole result, which the caller must know */
+    bool rawUncompress(const char* compressed, size_t compressed_length, char* uncompressed);
+
+    /** the length the compressed data says it uncompresses to; false if it can't be read */
+    bool uncompressedLength(const char* compressed, size_t compressed_length, size_t* result);
+
 }
 
 
@@ -81,6 +81,7 @@ namespace mongo {
     public:
         T* get() const;
         void reset(T* v);
+        T* release(); // clears this thread's value without deleting it; caller takes ownership
         T* getMake() { 
             T *t = get();
             if( t == 0 )
@@ -99,6 +100,10 @@ namespace mongo {
     void TSP<T>::reset(T* v) { \
         tsp.reset(v); \
         _ ## p = v; \
+    } \
+    T* TSP<T>::release() { \
+        _ ## p = 0; \
+        return tsp.release(); \
     } 
 # else
 
@@ -113,6 +118,10 @@ namespace mongo {
         tsp.reset(v); \
         _ ## p = v; \
     } \
+    template<> T* TSP<T>::release() { \
+        _ ## p = 0; \
+        return tsp.release(); \
+    } \
     TSP<T> p;
 # endif
 
@@ -124,6 +133,7 @@ namespace mongo {
     public:
         T* get() const { return tsp.get(); }
         void reset(T* v) { tsp.reset(v); }
+        T* release() { return tsp.release(); }
         T* getMake() { 
             T *t = get();
             if( t == 0 )
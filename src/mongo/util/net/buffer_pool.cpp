@@ -0,0 +1,240 @@
+// @file buffer_pool.cpp
+
+/*    Copyright 2012 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "pch.h"
+
+#include "mongo/util/net/buffer_pool.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Classes of 1KB to 4MB; larger buffers are left to the allocator.
+        const int MinClassBits = 10;
+        const int MaxClassBits = 22;
+        const int NumClasses = MaxClassBits - MinClassBits + 1;
+
+        // A thread keeps one buffer of each class up to 32KB, enough for a request's message and
+        // its reply without holding on to much memory per connection.
+        const int ThreadClasses = 15 - MinClassBits + 1;
+
+        // All threads' caches together hold no more than this, about 260 threads' full caches, so
+        // that thousands of mostly idle connections don't each keep 63KB.
+        const long long ThreadCacheMaxBytes = 16 * 1024 * 1024;
+
+        // The shared pool keeps up to 64 buffers of a class, and no more than 2MB of a class
+        // beyond the first two buffers.
+        const int SharedMaxBuffers = 64;
+        const int SharedBytesPerClass = 2 * 1024 * 1024;
+
+        // Thread cache hits are counted per thread and added to the total in batches of this.
+        const unsigned ThreadHitsBatch = 256;
+
+        int classSize( int c ) {
+            return 1 << ( MinClassBits + c );
+        }
+
+        /** @return the smallest class of at least 'size' bytes, NumClasses if there is none. */
+        int classHolding( int size ) {
+            int c = 0;
+            while( c < NumClasses && classSize( c ) < size ) {
+                ++c;
+            }
+            return c;
+        }
+
+        /** @return the largest class of no more than 'capacity' bytes, -1 if there is none. */
+        int classWithin( int capacity ) {
+            int c = -1;
+            while( c + 1 < NumClasses && classSize( c + 1 ) <= capacity ) {
+                ++c;
+            }
+            return c;
+        }
+
+        int sharedMaxBuffers( int c ) {
+            return min( SharedMaxBuffers, max( 2, SharedBytesPerClass / classSize( c ) ) );
+        }
+
+        AtomicUInt64 threadHits;
+        AtomicUInt64 sharedHits;
+        AtomicUInt64 allocated;
+        AtomicUInt64 released;
+        AtomicUInt64 freed;
+        AtomicUInt64 threadCacheBytes;
+
+        SimpleMutex sharedMutex( "MessageBufferPool" );
+        vector< void* > shared[ NumClasses ];
+        long long sharedBytes = 0;
+
+        /** @return true if 'p', of class 'c', was kept in the shared pool. */
+        bool releaseShared( void *p, int c ) {
+            SimpleMutex::scoped_lock lk( sharedMutex );
+            if ( (int)shared[ c ].size() >= sharedMaxBuffers( c ) ) {
+                return false;
+            }
+            shared[ c ].push_back( p );
+            sharedBytes += classSize( c );
+            return true;
+        }
+
+        void* allocateShared( int c ) {
+            SimpleMutex::scoped_lock lk( sharedMutex );
+            if ( shared[ c ].empty() ) {
+                return 0;
+            }
+            void *p = shared[ c ].back();
+            shared[ c ].pop_back();
+            sharedBytes -= classSize( c );
+            return p;
+        }
+
+        class ThreadCache : boost::noncopyable {
+        public:
+            ThreadCache() : _hits() {
+                for( int c = 0; c < ThreadClasses; ++c ) {
+                    _buffers[ c ] = 0;
+                }
+            }
+
+            /** The thread is exiting: its buffers go to the shared pool. */
+            ~ThreadCache() {
+                for( int c = 0; c < ThreadClasses; ++c ) {
+                    if ( !_buffers[ c ] ) {
+                        continue;
+                    }
+                    threadCacheBytes.fetchAndSubtract( classSize( c ) );
+                    if ( !releaseShared( _buffers[ c ], c ) ) {
+                        free( _buffers[ c ] );
+                        freed.fetchAndAdd( 1 );
+                    }
+                }
+                threadHits.fetchAndAdd( _hits );
+            }
+
+            void* take( int c ) {
+                if ( c >= ThreadClasses || !_buffers[ c ] ) {
+                    return 0;
+                }
+                void *p = _buffers[ c ];
+                _buffers[ c ] = 0;
+                threadCacheBytes.fetchAndSubtract( classSize( c ) );
+                if ( ++_hits == ThreadHitsBatch ) {
+                    threadHits.fetchAndAdd( _hits );
+                    _hits = 0;
+                }
+                return p;
+            }
+
+            bool keep( void *p, int c ) {
+                if ( c >= ThreadClasses || _buffers[ c ] ) {
+                    return false;
+                }
+                if ( threadCacheBytes.addAndFetch( classSize( c ) ) > (unsigned long long)ThreadCacheMaxBytes ) {
+                    threadCacheBytes.fetchAndSubtract( classSize( c ) );
+                    return false;
+                }
+                _buffers[ c ] = p;
+                return true;
+            }
+
+        private:
+            void *_buffers[ ThreadClasses ];
+            unsigned _hits;
+        };
+
+        boost::thread_specific_ptr< ThreadCache > threadCache;
+
+        ThreadCache& cache() {
+            ThreadCache *c = threadCache.get();
+            if ( !c ) {
+                c = new ThreadCache();
+                threadCache.reset( c );
+            }
+            return *c;
+        }
+
+    } // namespace
+
+    void* MessageBufferPool::allocate( int size, int *capacity ) {
+        int c = classHolding( size );
+        if ( c < NumClasses ) {
+            void *p = cache().take( c );
+            if ( !p ) {
+                p = allocateShared( c );
+                if ( p ) {
+                    sharedHits.fetchAndAdd( 1 );
+                }
+            }
+            if ( p ) {
+                *capacity = classSize( c );
+                return p;
+            }
+            size = classSize( c );
+        }
+        void *p = malloc( size );
+        if ( !p ) {
+            msgasserted( 16423, "out of memory MessageBufferPool::allocate" );
+        }
+        allocated.fetchAndAdd( 1 );
+        *capacity = size;
+        return p;
+    }
+
+    void MessageBufferPool::release( void *p, int capacity ) {
+        if ( !p ) {
+            return;
+        }
+        int c = classWithin( capacity );
+        if ( c >= 0 && ( cache().keep( p, c ) || releaseShared( p, c ) ) ) {
+            released.fetchAndAdd( 1 );
+            return;
+        }
+        free( p );
+        freed.fetchAndAdd( 1 );
+    }
+
+    void MessageBufferPool::appendStats( BSONObjBuilder &b ) {
+        b.appendNumber( "threadCacheHits", (long long)threadHits.load() );
+        b.appendNumber( "sharedPoolHits", (long long)sharedHits.load() );
+        b.appendNumber( "allocated", (long long)allocated.load() );
+        b.appendNumber( "released", (long long)released.load() );
+        b.appendNumber( "freed", (long long)freed.load() );
+        b.appendNumber( "threadCacheBytes", (long long)threadCacheBytes.load() );
+        SimpleMutex::scoped_lock lk( sharedMutex );
+        b.appendNumber( "sharedPoolBytes", sharedBytes );
+    }
+
+    PooledBufBuilder::PooledBufBuilder( int initsize ) :
+        BufBuilder( 0 ) {
+        int capacity;
+        char *buf = static_cast< char* >( MessageBufferPool::allocate( initsize, &capacity ) );
+        adopt( buf, capacity );
+    }
+
+    PooledBufBuilder::~PooledBufBuilder() {
+        if ( buf() ) {
+            MessageBufferPool::release( buf(), getSize() );
+            decouple();
+        }
+    }
+
+} // namespace mongo
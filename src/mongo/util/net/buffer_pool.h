@@ -0,0 +1,58 @@
+// @file buffer_pool.h - size class pool of message and reply buffers
+
+/*    Copyright 2012 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/bson/util/builder.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    /**
+     * A cache of message and reply buffers in power of two size classes, so that a request
+     * doesn't go to the allocator for its message and its reply.  Each thread keeps one buffer of
+     * each of the smaller classes for itself, up to a limit on the bytes all threads keep; beyond
+     * that buffers go to a pool shared by all threads, and beyond that back to free().
+     *
+     * The buffers are ordinary malloc() blocks: whoever owns one may realloc() or free() it, and
+     * any malloc() block may be released here, with no more than its size as its capacity.
+     */
+    class MessageBufferPool {
+    public:
+        /** @return a buffer of at least 'size' bytes, with its actual size in '*capacity'. */
+        static void* allocate( int size, int *capacity );
+
+        /** Take back 'p', a malloc() block of at least 'capacity' bytes. */
+        static void release( void *p, int capacity );
+
+        /** Append the counts of buffers reused, allocated and freed. */
+        static void appendStats( BSONObjBuilder &b );
+    };
+
+    /**
+     * A BufBuilder whose buffer comes from the MessageBufferPool, for a reply that is decoupled
+     * into a Message.  Hand the Message getSize() as the buffer's capacity so that it goes back to
+     * the pool in its own class.
+     */
+    class PooledBufBuilder : public BufBuilder {
+    public:
+        explicit PooledBufBuilder( int initsize = 512 );
+        ~PooledBufBuilder();
+    };
+
+} // namespace mongo
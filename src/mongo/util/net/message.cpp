@@ -26,6 +26,9 @@
 #include "listen.h"
 
 #include "../goodies.h"
+#include "../compress.h"
+#include "../../db/jsobj.h"
+#include "../../platform/atomic_word.h"
 
 
 namespace mongo {
@@ -60,5 +63,117 @@ namespace mongo {
         return op == dbQuery || op == dbGetMore;
     }
 
+    // the opcode, data length and compressor after the header of a dbCompressed message
+    static const int CompressedHeaderSize = 4 + 4 + 1;
+
+    static AtomicUInt64 messagesCompressed;
+    static AtomicUInt64 bytesBeforeCompression;
+    static AtomicUInt64 bytesAfterCompression;
+    static AtomicUInt64 messagesDecompressed;
+    static AtomicUInt64 bytesBeforeDecompression;
+    static AtomicUInt64 bytesAfterDecompression;
+
+    void Message::appendCompressionStats( BSONObjBuilder &b ) {
+        b.appendNumber( "messagesCompressed", (long long)messagesCompressed.load() );
+        b.appendNumber( "bytesBeforeCompression", (long long)bytesBeforeCompression.load() );
+        b.appendNumber( "bytesAfterCompression", (long long)bytesAfterCompression.load() );
+        b.appendNumber( "messagesDecompressed", (long long)messagesDecompressed.load() );
+        b.appendNumber( "bytesBeforeDecompression", (long long)bytesBeforeDecompression.load() );
+        b.appendNumber( "bytesAfterDecompression", (long long)bytesAfterDecompression.load() );
+    }
+
+    bool Message::compress( Message &compressed ) const {
+        verify( compressed.empty() );
+        MsgData *h = header();
+        int dataLen = h->dataLen();
+
+        // the data of a message in several buffers is compressed from a copy
+        string copy;
+        const char *data;
+        if ( _buf ) {
+            data = _buf->_data;
+        }
+        else {
+            copy.reserve( dataLen );
+            copy.append( _data[ 0 ].first + MsgDataHeaderSize, _data[ 0 ].second - MsgDataHeaderSize );
+            for( MsgVec::const_iterator i = _data.begin() + 1; i != _data.end(); ++i ) {
+                copy.append( i->first, i->second );
+            }
+            data = copy.data();
+        }
+
+        int capacity;
+        MsgData *md = (MsgData *) MessageBufferPool::allocate( MsgDataHeaderSize +
+                                                               CompressedHeaderSize +
+                                                               maxCompressedLength( dataLen ),
+                                                               &capacity );
+        char *p = md->_data;
+        *reinterpret_cast<int*>( p ) = h->operation();
+        *reinterpret_cast<int*>( p + 4 ) = dataLen;
+        p[ 8 ] = compressorSnappy;
+        size_t compressedLen;
+        rawCompress( data, dataLen, p + CompressedHeaderSize, &compressedLen );
+
+        int len = MsgDataHeaderSize + CompressedHeaderSize + compressedLen;
+        if ( len >= h->len ) {
+            MessageBufferPool::release( md, capacity );
+            return false;
+        }
+        md->len = len;
+        md->id = h->id;
+        md->responseTo = h->responseTo;
+        md->setOperation( dbCompressed );
+        compressed.setData( md, true, capacity );
+
+        messagesCompressed.fetchAndAdd( 1 );
+        bytesBeforeCompression.fetchAndAdd( h->len );
+        bytesAfterCompression.fetchAndAdd( len );
+        return true;
+    }
+
+    bool Message::decompress() {
+        MsgData *h = singleData();
+        verify( h->operation() == dbCompressed );
+        if ( h->dataLen() < CompressedHeaderSize ) {
+            return false;
+        }
+        const char *p = h->_data;
+        int op = *reinterpret_cast<const int*>( p );
+        int dataLen = *reinterpret_cast<const int*>( p + 4 );
+        if ( op == dbCompressed || p[ 8 ] != compressorSnappy ||
+             dataLen < 0 || dataLen > 48000000 - MsgDataHeaderSize ) {
+            return false;
+        }
+
+        // snappy writes as much as the compressed data says it holds
+        const char *compressedData = p + CompressedHeaderSize;
+        size_t compressedLen = h->dataLen() - CompressedHeaderSize;
+        size_t len;
+        if ( !uncompressedLength( compressedData, compressedLen, &len ) ||
+             len != (size_t)dataLen ) {
+            return false;
+        }
+
+        int capacity;
+        MsgData *md = (MsgData *) MessageBufferPool::allocate( MsgDataHeaderSize + dataLen,
+                                                               &capacity );
+        if ( !rawUncompress( compressedData, compressedLen, md->_data ) ) {
+            MessageBufferPool::release( md, capacity );
+            return false;
+        }
+        md->len = MsgDataHeaderSize + dataLen;
+        md->id = h->id;
+        md->responseTo = h->responseTo;
+        md->setOperation( op );
+
+        messagesDecompressed.fetchAndAdd( 1 );
+        bytesBeforeDecompression.fetchAndAdd( h->len );
+        bytesAfterDecompression.fetchAndAdd( md->len );
+
+        reset();
+        _setData( md, true, capacity );
+        return true;
+    }
+
 
 } // namespace mongo
@@ -19,10 +19,12 @@
 
 #include "sock.h"
 #include "../../bson/util/atomic_int.h"
+#include "buffer_pool.h"
 #include "hostandport.h"
 
 namespace mongo {
 
+    class BSONObjBuilder;
     class Message;
     class MessagingPort;
     class PiggyBackData;
@@ -38,7 +40,8 @@ namespace mongo {
         dbQuery = 2004,
         dbGetMore = 2005,
         dbDelete = 2006,
-        dbKillCursors = 2007
+        dbKillCursors = 2007,
+        dbCompressed = 2012 /* another message compressed, see Message::compress() */
     };
 
     bool doesOpGetAResponse( int op );
@@ -54,6 +57,7 @@ namespace mongo {
         case dbGetMore: return "getmore";
         case dbDelete: return "remove";
         case dbKillCursors: return "killcursors";
+        case dbCompressed: return "compressed";
         default:
             massert( 16141, str::stream() << "cannot translate opcode " << op, !op );
             return "";
@@ -69,6 +73,7 @@ namespace mongo {
         case dbQuery:
         case dbGetMore:
         case dbKillCursors:
+        case dbCompressed:
             return false;
 
         case dbUpdate:
@@ -145,12 +150,12 @@ namespace mongo {
     class Message {
     public:
         // we assume here that a vector with initial size 0 does no allocation (0 is the default, but wanted to make it explicit).
-        Message() : _buf( 0 ), _data( 0 ), _freeIt( false ) {}
+        Message() : _buf( 0 ), _data( 0 ), _freeIt( false ), _capacity( 0 ) {}
         Message( void * data , bool freeIt ) :
-            _buf( 0 ), _data( 0 ), _freeIt( false ) {
+            _buf( 0 ), _data( 0 ), _freeIt( false ), _capacity( 0 ) {
             _setData( reinterpret_cast< MsgData* >( data ), freeIt );
         };
-        Message(Message& r) : _buf( 0 ), _data( 0 ), _freeIt( false ) {
+        Message(Message& r) : _buf( 0 ), _data( 0 ), _freeIt( false ), _capacity( 0 ) {
             *this = r;
         }
         ~Message() {
@@ -199,14 +204,15 @@ namespace mongo {
             for( vector< pair< char *, int > >::const_iterator i = _data.begin(); i != _data.end(); ++i ) {
                 totalSize += i->second;
             }
-            char *buf = (char*)malloc( totalSize );
+            int capacity;
+            char *buf = (char*)MessageBufferPool::allocate( totalSize, &capacity );
             char *p = buf;
             for( vector< pair< char *, int > >::const_iterator i = _data.begin(); i != _data.end(); ++i ) {
                 memcpy( p, i->first, i->second );
                 p += i->second;
             }
             reset();
-            _setData( (MsgData*)buf, true );
+            _setData( (MsgData*)buf, true, capacity );
         }
 
         // vector swap() so this is fast
@@ -220,48 +226,55 @@ namespace mongo {
             }
             r._freeIt = false;
             _freeIt = true;
+            _capacity = r._capacity;
+            r._capacity = 0;
             return *this;
         }
 
+        // the buffers go back to the MessageBufferPool, which frees those it doesn't keep
         void reset() {
             if ( _freeIt ) {
                 if ( _buf ) {
-                    free( _buf );
+                    MessageBufferPool::release( _buf, _capacity ? _capacity : _buf->len );
                 }
                 for( vector< pair< char *, int > >::const_iterator i = _data.begin(); i != _data.end(); ++i ) {
-                    free(i->first);
+                    MessageBufferPool::release( i->first, i->second );
                 }
             }
             _buf = 0;
             _data.clear();
             _freeIt = false;
+            _capacity = 0;
         }
 
         // use to add a buffer
         // assumes message will free everything
-        void appendData(char *d, int size) {
+        // capacity is the malloc()'d size of d if known, so it can be reused for as large a message
+        void appendData(char *d, int size, int capacity = 0) {
             if ( size <= 0 ) {
                 return;
             }
             if ( empty() ) {
                 MsgData *md = (MsgData*)d;
                 md->len = size; // can be updated later if more buffers added
-                _setData( md, true );
+                _setData( md, true, capacity );
                 return;
             }
             verify( _freeIt );
             if ( _buf ) {
                 _data.push_back( make_pair( (char*)_buf, _buf->len ) );
                 _buf = 0;
+                _capacity = 0;
             }
             _data.push_back( make_pair( d, size ) );
             header()->len += size;
         }
 
         // use to set first buffer if empty
-        void setData(MsgData *d, bool freeIt) {
+        // capacity is the malloc()'d size of d if known, so it can be reused for as large a message
+        void setData(MsgData *d, bool freeIt, int capacity = 0) {
             verify( empty() );
-            _setData( d, freeIt );
+            _setData( d, freeIt, capacity );
         }
         void setData(int operation, const char *msgtxt) {
             setData(operation, msgtxt, strlen(msgtxt)+1);
@@ -269,11 +282,12 @@ namespace mongo {
         void setData(int operation, const char *msgdata, size_t len) {
             verify( empty() );
             size_t dataLen = len + sizeof(MsgData) - 4;
-            MsgData *d = (MsgData *) malloc(dataLen);
+            int capacity;
+            MsgData *d = (MsgData *) MessageBufferPool::allocate(dataLen, &capacity);
             memcpy(d->_data, msgdata, len);
             d->len = fixEndian(dataLen);
             d->setOperation(operation);
-            _setData( d, true );
+            _setData( d, true, capacity );
         }
 
         bool doIFreeIt() {
@@ -281,13 +295,39 @@ namespace mongo {
         }
 
         void send( MessagingPort &p, const char *context );
+
+        /** Compressor ids of dbCompressed messages. */
+        enum Compressor {
+            compressorSnappy = 1
+        };
+
+        /**
+         * Fill the empty 'compressed' with this message wrapped in a dbCompressed message, which
+         * has this message's id and responseTo in its header followed by
+         *   int  this message's opcode
+         *   int  the length of this message's data, after its header
+         *   char the Compressor
+         *   the compressed data
+         * @return false, leaving 'compressed' empty, if compressing doesn't make it smaller.
+         */
+        bool compress( Message &compressed ) const;
+
+        /**
+         * Replace a dbCompressed message with the message it wraps.
+         * @return false if the message is malformed.
+         */
+        bool decompress();
+
+        /** Append the counts of messages compressed and decompressed. */
+        static void appendCompressionStats( BSONObjBuilder &b );
         
         string toString() const;
 
     private:
-        void _setData( MsgData *d, bool freeIt ) {
+        void _setData( MsgData *d, bool freeIt, int capacity = 0 ) {
             _freeIt = freeIt;
             _buf = d;
+            _capacity = capacity;
         }
         // if just one buffer, keep it in _buf, otherwise keep a sequence of buffers in _data
         MsgData * _buf;
@@ -295,6 +335,8 @@ namespace mongo {
         typedef vector< pair< char*, int > > MsgVec;
         MsgVec _data;
         bool _freeIt;
+        // malloc()'d size of _buf, 0 if only its len is known
+        int _capacity;
     };
 
 
@@ -28,6 +28,7 @@
 #include "../background.h"
 #include "../time_support.h"
 #include "../../db/cmdline.h"
+#include "../../db/jsobj.h"
 #include "../scopeguard.h"
 
 
@@ -120,21 +121,41 @@ namespace mongo {
     }
 
     MessagingPort::MessagingPort(int fd, const SockAddr& remote) 
-        : psock( new Socket( fd , remote ) ) , piggyBackData(0) {
+        : psock( new Socket( fd , remote ) ) , piggyBackData(0), _compressed(false) {
         ports.insert(this);
     }
 
     MessagingPort::MessagingPort( double timeout, int ll ) 
-        : psock( new Socket( timeout, ll ) ) {
+        : psock( new Socket( timeout, ll ) ), _compressed(false) {
         ports.insert(this);
         piggyBackData = 0;
     }
 
     MessagingPort::MessagingPort( boost::shared_ptr<Socket> sock )
-        : psock( sock ), piggyBackData( 0 ) {
+        : psock( sock ), piggyBackData( 0 ), _compressed( false ) {
         ports.insert(this);
     }
 
+    /* compression ---------------------------------------------------------------- */
+
+    // smaller messages aren't worth compressing
+    static const int MinCompressedMessageLen = 512;
+
+    void negotiateCompression( AbstractMessagingPort *port, const BSONObj &isMasterCmd,
+                               BSONObjBuilder &result ) {
+        BSONElement compressors = isMasterCmd[ "compression" ];
+        if ( !port || !cmdLine.networkCompression || compressors.type() != Array ) {
+            return;
+        }
+        BSONForEach( e, compressors.embeddedObject() ) {
+            if ( e.type() == String && str::equals( e.valuestr(), "snappy" ) ) {
+                port->setCompressed( true );
+                result.append( "compression", BSON_ARRAY( "snappy" ) );
+                return;
+            }
+        }
+    }
+
     void MessagingPort::shutdown() {
         psock->close();
     }
@@ -178,11 +199,9 @@ again:
                 return false;
             }
 
-            int z = (len+1023)&0xfffffc00;
-            verify(z>=len);
-            MsgData *md = (MsgData *) malloc(z);
+            int capacity;
+            MsgData *md = (MsgData *) MessageBufferPool::allocate(len, &capacity);
             ScopeGuard guard = MakeGuard(free, md);
-            verify(md);
             md->len = len;
 
             char *p = (char *) &md->id;
@@ -191,7 +210,13 @@ again:
             psock->recv( p, left );
 
             guard.Dismiss();
-            m.setData(md, true);
+            m.setData(md, true, capacity);
+
+            if ( m.operation() == dbCompressed && !m.decompress() ) {
+                log() << "recv(): invalid compressed message from " << remote() << endl;
+                m.reset();
+                return false;
+            }
             return true;
 
         }
@@ -210,6 +235,17 @@ again:
         say(/*received.from, */response, responseTo);
     }
 
+    void MessagingPort::replyGathered( const vector< pair< char *, int > > &data, MSGID responseTo ) {
+        verify( !data.empty() && canReplyGathered() );
+        MsgData *header = reinterpret_cast< MsgData* >( data[ 0 ].first );
+        header->id = nextMessageId();
+        header->responseTo = responseTo;
+        if ( piggyBackData && piggyBackData->len() ) {
+            piggyBackData->flush();
+        }
+        send( data, "reply" );
+    }
+
     bool MessagingPort::call(Message& toSend, Message& response) {
         mmm( log() << "*call()" << endl; )
         say(toSend);
@@ -263,6 +299,14 @@ again:
             }
         }
 
+        if ( _compressed && toSend.size() >= MinCompressedMessageLen ) {
+            Message compressed;
+            if ( toSend.compress( compressed ) ) {
+                compressed.send( *this, "say" );
+                return;
+            }
+        }
+
         toSend.send( *this, "say" );
     }
 
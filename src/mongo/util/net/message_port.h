@@ -22,6 +22,8 @@
 
 namespace mongo {
 
+    class BSONObj;
+    class BSONObjBuilder;
     class MessagingPort;
     class PiggyBackData;
 
@@ -39,6 +41,26 @@ namespace mongo {
 
         virtual void assertStillConnected() = 0;
 
+        /**
+         * Compress the messages sent from now on, once the other side has said it can read them.
+         * Compressed messages are read whether or not this is set.
+         */
+        virtual void setCompressed( bool compressed ) {}
+        virtual bool compressed() const { return false; }
+
+        /**
+         * Whether replyGathered() may be used.  A port that compresses its messages can't send a
+         * reply in place, as compressing copies it anyway.
+         */
+        virtual bool canReplyGathered() const { return false; }
+        /**
+         * Send a reply held in several buffers, the first starting with its MsgData header, without
+         * copying it into one.  The header's id and responseTo are set here.
+         */
+        virtual void replyGathered( const vector< pair< char *, int > > &data, MSGID responseTo ) {
+            verify( false );
+        }
+
     public:
         // TODO make this private with some helpers
 
@@ -68,6 +90,8 @@ namespace mongo {
         bool recv(Message& m);
         void reply(Message& received, Message& response, MSGID responseTo);
         void reply(Message& received, Message& response);
+        virtual bool canReplyGathered() const { return !_compressed; }
+        virtual void replyGathered( const vector< pair< char *, int > > &data, MSGID responseTo );
         bool call(Message& toSend, Message& response);
 
         void say(Message& toSend, int responseTo = -1);
@@ -90,6 +114,9 @@ namespace mongo {
 
         void assertStillConnected();
 
+        virtual void setCompressed( bool compressed ) { _compressed = compressed; }
+        virtual bool compressed() const { return _compressed; }
+
         boost::shared_ptr<Socket> psock;
                 
         void send( const char * data , int len, const char *context ) {
@@ -111,6 +138,8 @@ namespace mongo {
     private:
         
         PiggyBackData * piggyBackData;
+
+        bool _compressed;
         
         // this is the parsed version of remote
         // mutable because its initialized only on call to remote()
@@ -122,5 +151,13 @@ namespace mongo {
         friend class PiggyBackData;
     };
 
+    /**
+     * Handle the "compression" field of an isMaster command, listing the compressors the client
+     * can read.  If it lists "snappy" and this process runs with --networkCompression, messages
+     * sent on 'port' from now on are compressed and the result's "compression" field says so.
+     */
+    void negotiateCompression( AbstractMessagingPort *port, const BSONObj &isMasterCmd,
+                               BSONObjBuilder &result );
+
 
 } // namespace mongo
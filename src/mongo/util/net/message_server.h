@@ -28,6 +28,12 @@ namespace mongo {
 
     struct LastError;
 
+    /** what a connection keeps in thread locals between messages; see MessageHandler::detach */
+    class ConnectionThreadState {
+    public:
+        virtual ~ConnectionThreadState() {}
+    };
+
     class MessageHandler {
     public:
         virtual ~MessageHandler() {}
@@ -47,6 +53,22 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * for servers where a few threads take turns servicing many connections.
+         * @return a holder for one connection's thread local state, or 0 if this handler can
+         *         only be run with a thread per connection (the default).
+         */
+        virtual ConnectionThreadState* newConnectionThreadState() { return 0; }
+
+        /**
+         * move the calling thread's connection state into s, leaving the thread clean for
+         * another connection.  called after connected(), process() and disconnected().
+         */
+        virtual void detach( ConnectionThreadState* s ) { }
+
+        /** install state saved by detach() on the calling thread, before process() or disconnected() */
+        virtual void attach( ConnectionThreadState* s ) { }
     };
 
     class MessageServer {
@@ -0,0 +1,300 @@
+// message_server_event.cpp
+
+/*    Copyright 2009 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "pch.h"
+
+#include "mongo/util/net/message_server_event.h"
+
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/cmdline.h"
+#include "mongo/db/lasterror.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/net/listen.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+
+#ifdef __linux__
+# include <sys/epoll.h>
+#endif
+
+namespace mongo {
+
+#ifdef __linux__
+
+    struct EventMessageDispatcher::Connection {
+        Connection( MessagingPort* p ) :
+            port( p ), fd( p->psock->rawFD() ), le( new LastError() ), state( 0 ),
+            len( 0 ), lenRead( 0 ), md( 0 ), mdCapacity( 0 ), have( 0 ), bytesIn( 0 ),
+            otherSide( p->psock->remoteString() ) {
+        }
+        ~Connection() {
+            free( md );
+            delete state;
+            delete le;
+            delete port;
+        }
+
+        MessagingPort* port;
+        const int fd;
+        LastError* le;                  // connection owned, as in pms::threadRun
+        ConnectionThreadState* state;   // between messages, the handler's thread locals
+
+        // the message being read: its length prefix, then the rest into md
+        int len;
+        int lenRead;
+        MsgData* md;
+        int mdCapacity;
+        int have;
+
+        long long bytesIn;
+        const string otherSide;
+    };
+
+    EventMessageDispatcher::EventMessageDispatcher( MessageHandler* handler, int nWorkers ) :
+        _handler( handler ), _epfd( epoll_create( 1024 ) ), _workers( nWorkers ) {
+        massert( 16403, str::stream() << "epoll_create failed: " << errnoWithDescription(), _epfd >= 0 );
+        boost::thread thr( boost::bind( &EventMessageDispatcher::run, this ) );
+    }
+
+    bool EventMessageDispatcher::supported( MessageHandler* handler ) {
+#ifdef MONGO_SSL
+        if ( cmdLine.sslOnNormalPorts )
+            return false;
+#endif
+        ConnectionThreadState* s = handler->newConnectionThreadState();
+        bool ok = s != 0;
+        delete s;
+        return ok;
+    }
+
+    void EventMessageDispatcher::add( MessagingPort* p ) {
+        p->psock->setLogLevel(1);
+        Connection* c = new Connection( p );
+        c->state = _handler->newConnectionThreadState();
+        _workers.schedule( &EventMessageDispatcher::start, this, c );
+    }
+
+    void EventMessageDispatcher::arm( Connection* c, bool first ) {
+        epoll_event e;
+        e.events = EPOLLIN | EPOLLONESHOT;
+        e.data.ptr = c;
+        if ( epoll_ctl( _epfd, first ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, c->fd, &e ) != 0 ) {
+            log() << "epoll_ctl failed for " << c->otherSide << ": " << errnoWithDescription() << endl;
+            close( c );
+        }
+    }
+
+    void EventMessageDispatcher::run() {
+        setThreadName( "netEvent" );
+        const int N = 256;
+        epoll_event events[N];
+        while ( ! inShutdown() ) {
+            int n = epoll_wait( _epfd, events, N, 1000 );
+            if ( n < 0 ) {
+                if ( errno != EINTR ) {
+                    log() << "epoll_wait failed: " << errnoWithDescription() << endl;
+                    sleepmillis(10);
+                }
+                continue;
+            }
+            for ( int i = 0; i < n; i++ )
+                readable( static_cast<Connection*>( events[i].data.ptr ) );
+        }
+    }
+
+    /** read whatever has arrived.  a complete message goes to a worker, otherwise we rearm
+        and wait for more.  never blocks on the client. */
+    void EventMessageDispatcher::readable( Connection* c ) {
+        while ( 1 ) {
+            char* dst;
+            int want;
+            if ( c->lenRead < 4 ) {
+                dst = reinterpret_cast<char*>( &c->len ) + c->lenRead;
+                want = 4 - c->lenRead;
+            }
+            else {
+                dst = reinterpret_cast<char*>( c->md ) + c->have;
+                want = c->len - c->have;
+            }
+
+            int n = ::recv( c->fd, dst, want, MSG_DONTWAIT );
+            if ( n < 0 ) {
+                if ( errno == EINTR )
+                    continue;
+                if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                    arm( c, false );
+                    return;
+                }
+                LOG(1) << "recv failed for " << c->otherSide << ": " << errnoWithDescription() << endl;
+                close( c );
+                return;
+            }
+            if ( n == 0 ) {
+                close( c );
+                return;
+            }
+            c->bytesIn += n;
+
+            if ( c->lenRead < 4 ) {
+                c->lenRead += n;
+                if ( c->lenRead < 4 )
+                    continue;
+
+                if ( c->len == -1 ) {
+                    // endian check from the client, see MessagingPort::recv
+                    unsigned foo = 0x10203040;
+                    c->port->send( (char *) &foo, 4, "endian" );
+                    c->lenRead = 0;
+                    continue;
+                }
+                if ( c->len < 16 || c->len > 48000000 ) { // messages must be large enough for headers
+                    log(0) << "recv(): message len " << c->len << " is invalid, closing " << c->otherSide << endl;
+                    close( c );
+                    return;
+                }
+
+                c->md = (MsgData *) MessageBufferPool::allocate( c->len, &c->mdCapacity );
+                c->md->len = c->len;
+                c->have = 4;
+                continue;
+            }
+
+            c->have += n;
+            if ( c->have == c->len ) {
+                MsgData* md = c->md;
+                c->md = 0;
+                c->lenRead = 0;
+                _workers.schedule( &EventMessageDispatcher::serve, this, c, md, c->mdCapacity );
+                return;
+            }
+        }
+    }
+
+    void EventMessageDispatcher::attach( Connection* c ) {
+        lastError.reset( c->le );
+        _handler->attach( c->state );
+    }
+
+    void EventMessageDispatcher::detach( Connection* c ) {
+        _handler->detach( c->state );
+        lastError.release();
+    }
+
+    void EventMessageDispatcher::start( Connection* c ) {
+        setThreadName( "conn" );
+        lastError.reset( c->le );
+        try {
+            _handler->connected( c->port );
+        }
+        catch ( const DBException& e ) {
+            log() << "DBException accepting connection, closing client connection: " << e << endl;
+            detach( c );
+            close( c );
+            return;
+        }
+        detach( c );
+        arm( c, true );
+    }
+
+    void EventMessageDispatcher::serve( Connection* c, MsgData* md, int capacity ) {
+        Message m;
+        m.setData( md, true, capacity );
+
+        bool ok = false;
+        attach( c );
+        try {
+            if ( ! inShutdown() ) {
+                c->port->psock->clearCounters();
+                if ( m.operation() == dbCompressed ) {
+                    uassert( 16422, "invalid compressed message", m.decompress() );
+                }
+                _handler->process( m, c->port, c->le );
+                networkCounter.hit( c->bytesIn, c->port->psock->getBytesOut() );
+                c->bytesIn = 0;
+                ok = true;
+            }
+        }
+        catch ( AssertionException& e ) {
+            log() << "AssertionException handling request, closing client connection: " << e << endl;
+        }
+        catch ( SocketException& e ) {
+            log() << "SocketException handling request, closing client connection: " << e << endl;
+        }
+        catch ( const DBException& e ) { // must be right above std::exception to avoid catching subclasses
+            log() << "DBException handling request, closing client connection: " << e << endl;
+        }
+        catch ( std::exception &e ) {
+            error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+            dbexit( EXIT_UNCAUGHT );
+        }
+        catch ( ... ) {
+            error() << "Uncaught exception, terminating" << endl;
+            dbexit( EXIT_UNCAUGHT );
+        }
+        detach( c );
+
+        if ( ok )
+            arm( c, false );
+        else
+            close( c );
+    }
+
+    void EventMessageDispatcher::close( Connection* c ) {
+        epoll_event unused; // pre 2.6.9 kernels want a non-null event for EPOLL_CTL_DEL
+        epoll_ctl( _epfd, EPOLL_CTL_DEL, c->fd, &unused );
+
+        // the handler's disconnected() may block, so the teardown is never run on the epoll
+        // thread
+        _workers.schedule( &EventMessageDispatcher::finish, this, c );
+    }
+
+    void EventMessageDispatcher::finish( Connection* c ) {
+        setThreadName( "conn" );
+        attach( c );
+        _handler->disconnected( c->port );
+        detach( c );
+
+        if( !cmdLine.quiet ){
+            int conns = connTicketHolder.used()-1;
+            const char* word = (conns == 1 ? " connection" : " connections");
+            log() << "end connection " << c->otherSide << " (" << conns << word << " now open)" << endl;
+        }
+        c->port->shutdown();
+        delete c;
+        connTicketHolder.release();
+    }
+
+#else
+
+    EventMessageDispatcher::EventMessageDispatcher( MessageHandler* handler, int nWorkers ) :
+        _handler( handler ), _epfd( -1 ), _workers( 1 ) {
+        msgasserted( 16404, "--netModel event is only supported on linux" );
+    }
+
+    bool EventMessageDispatcher::supported( MessageHandler* handler ) {
+        return false;
+    }
+
+    void EventMessageDispatcher::add( MessagingPort* p ) {
+        verify( false );
+    }
+
+#endif
+
+}
@@ -0,0 +1,72 @@
+// message_server_event.h
+
+/*    Copyright 2009 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+
+namespace mongo {
+
+    /**
+     * services connections for PortMessageServer with --netModel event.
+     *
+     * one thread waits in epoll on every idle connection and reads each inbound Message whole,
+     * without blocking on a slow client.  complete messages go to a bounded pool of workers,
+     * which install the connection's thread local state (see MessageHandler::attach), run the
+     * handler -- which sends the reply -- and hand the connection back to the epoll thread.
+     * so the number of threads no longer grows with the number of connections.
+     *
+     * a connection is armed EPOLLONESHOT, so at any time exactly one thread (the epoll thread
+     * while it is assembling a message, or one worker) owns it.
+     *
+     * note an operation that blocks, say getLastError waiting on replication, holds a worker
+     * for its duration; size --netWorkers for that.
+     */
+    class EventMessageDispatcher : boost::noncopyable {
+    public:
+        EventMessageDispatcher( MessageHandler* handler, int nWorkers );
+
+        /** @return false if this platform or configuration can't use the event model */
+        static bool supported( MessageHandler* handler );
+
+        /** take over a newly accepted connection.  caller has already taken its connTicket. */
+        void add( MessagingPort* p );
+
+    private:
+        struct Connection;
+
+        void run();                         // the epoll thread
+        void readable( Connection* c );
+        void arm( Connection* c, bool first );
+        void close( Connection* c );
+
+        // run on the pool
+        void start( Connection* c );
+        void serve( Connection* c, MsgData* md, int capacity );
+        void finish( Connection* c );       // after close(): the handler's callbacks, then delete
+
+        void attach( Connection* c );
+        void detach( Connection* c );
+
+        MessageHandler* _handler;
+        int _epfd;
+        ThreadPool _workers;
+    };
+
+}
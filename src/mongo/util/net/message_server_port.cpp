@@ -24,6 +24,7 @@
 #include "message.h"
 #include "message_port.h"
 #include "message_server.h"
+#include "message_server_event.h"
 #include "listen.h"
 
 #include "../../db/cmdline.h"
@@ -115,6 +116,16 @@ namespace mongo {
 
             uassert( 10275 ,  "multiple PortMessageServer not supported" , ! pms::handler );
             pms::handler = handler;
+
+            if ( cmdLine.netModelEvent ) {
+                if ( EventMessageDispatcher::supported( handler ) ) {
+                    log() << "servicing connections with an event loop and " << cmdLine.netWorkers << " workers" << endl;
+                    _events.reset( new EventMessageDispatcher( handler, cmdLine.netWorkers ) );
+                }
+                else {
+                    warning() << "--netModel event not supported by this server or configuration, using a thread per connection" << endl;
+                }
+            }
         }
 
         virtual void acceptedMP(MessagingPort * p) {
@@ -130,6 +141,11 @@ namespace mongo {
                 return;
             }
 
+            if ( _events ) {
+                _events->add( p );
+                return;
+            }
+
             try {
 #ifndef __linux__  // TODO: consider making this ifdef _WIN32
                 {
@@ -201,6 +217,9 @@ namespace mongo {
         }
 
         virtual bool useUnixSockets() const { return true; }
+
+    private:
+        scoped_ptr<EventMessageDispatcher> _events; // null unless --netModel event
     };
 
 
@@ -31,6 +31,7 @@
 # include <netinet/tcp.h>
 # include <arpa/inet.h>
 # include <errno.h>
+# include <limits.h>
 # include <netdb.h>
 # if defined(__openbsd__)
 #  include <sys/uio.h>
@@ -697,6 +698,15 @@ namespace mongo {
         }
     }
 
+#if !defined(_WIN32)
+    // sendmsg() fails with more buffers than this; a longer vector is sent a window at a time
+# if defined(IOV_MAX)
+    const size_t MaxIovecsPerSend = IOV_MAX;
+# else
+    const size_t MaxIovecsPerSend = 1024;
+# endif
+#endif
+
     /** sends all data or throws an exception
      * @param context descriptive for logging
      */
@@ -714,7 +724,7 @@ namespace mongo {
         _send( data , context );
 #else
         vector< struct iovec > d( data.size() );
-        int i = 0;
+        size_t i = 0;
         for( vector< pair< char *, int > >::const_iterator j = data.begin(); j != data.end(); ++j ) {
             if ( j->second > 0 ) {
                 d[ i ].iov_base = j->first;
@@ -725,10 +735,14 @@ namespace mongo {
         }
         struct msghdr meta;
         memset( &meta, 0, sizeof( meta ) );
+        if ( i == 0 ) {
+            return;
+        }
+        struct iovec *end = &d[ 0 ] + i;
         meta.msg_iov = &d[ 0 ];
-        meta.msg_iovlen = d.size();
 
-        while( meta.msg_iovlen > 0 ) {
+        while( meta.msg_iov != end ) {
+            meta.msg_iovlen = std::min( size_t( end - meta.msg_iov ), MaxIovecsPerSend );
             int ret = ::sendmsg( _fd , &meta , portSendFlags );
             if ( ret == -1 ) {
                 if ( errno != EAGAIN || _timeout == 0 ) {
@@ -751,7 +765,6 @@ namespace mongo {
                     else {
                         ret -= i->iov_len;
                         ++i;
-                        --(meta.msg_iovlen);
                     }
                 }
             }
@@ -204,6 +204,9 @@ namespace mongo {
         string remoteString() const { return _remote.toString(); }
         unsigned remotePort() const { return _remote.getPort(); }
 
+        /** for readiness polling (e.g. epoll) only; i/o should go through this class */
+        int rawFD() const { return _fd; }
+
         void clearCounters() { _bytesIn = 0; _bytesOut = 0; }
         long long getBytesIn() const { return _bytesIn; }
         long long getBytesOut() const { return _bytesOut; }
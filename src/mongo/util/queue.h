@@ -19,8 +19,8 @@
 
 #include "pch.h"
 
+#include <deque>
 #include <limits>
-#include <queue>
 
 #include "mongo/util/timer.h"
 
@@ -59,7 +59,7 @@ namespace mongo {
             while (_queue.size()+tSize >= _maxSize) {
                 _cvNoLongerFull.wait( l.boost() );
             }
-            _queue.push( t );
+            _queue.push_back( t );
             _currentSize += tSize;
             _cvNoLongerEmpty.notify_one();
         }
@@ -76,7 +76,7 @@ namespace mongo {
 
         void clear() {
             scoped_lock l(_lock);
-            _queue = std::queue<T>();
+            _queue.clear();
             _currentSize = 0;
         }
 
@@ -86,7 +86,7 @@ namespace mongo {
                 return false;
 
             t = _queue.front();
-            _queue.pop();
+            _queue.pop_front();
             _currentSize -= _getSize(t);
             _cvNoLongerFull.notify_one();
 
@@ -100,7 +100,7 @@ namespace mongo {
                 _cvNoLongerEmpty.wait( l.boost() );
 
             T t = _queue.front();
-            _queue.pop();
+            _queue.pop_front();
             _currentSize -= _getSize(t);
             _cvNoLongerFull.notify_one();
 
@@ -128,13 +128,21 @@ namespace mongo {
             }
 
             t = _queue.front();
-            _queue.pop();
+            _queue.pop_front();
             _currentSize -= _getSize(t);
             _cvNoLongerFull.notify_one();
             return true;
         }
 
         bool blockingPeek(T& t, int maxSecondsToWait) {
+            return blockingPeekAt(0, t, maxSecondsToWait);
+        }
+
+        /**
+         * like blockingPeek, for the object 'i' places behind the front, so a consumer can look
+         * at several objects before popping any of them
+         */
+        bool blockingPeekAt(size_t i, T& t, int maxSecondsToWait) {
             Timer timer;
 
             boost::xtime xt;
@@ -142,18 +150,18 @@ namespace mongo {
             xt.sec += maxSecondsToWait;
 
             scoped_lock l( _lock );
-            while( _queue.empty() ) {
+            while( _queue.size() <= i ) {
                 if ( ! _cvNoLongerEmpty.timed_wait( l.boost() , xt ) )
                     return false;
             }
 
-            t = _queue.front();
+            t = _queue[i];
             return true;
         }
 
     private:
         mutable mongo::mutex _lock;
-        std::queue<T> _queue;
+        std::deque<T> _queue;
         const size_t _maxSize;
         size_t _currentSize;
         getSizeFunc _getSize;